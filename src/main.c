@@ -4,6 +4,10 @@
 #include <stdbool.h>
 #include <getopt.h>
 #include <unistd.h>
+#include <time.h>
+#include <ctype.h>
+#include <errno.h>
+#include <stdint.h>
 
 #include "config.h"
 #include "log.h"
@@ -12,110 +16,1134 @@
 
 #include "psv.h"
 #include "psv_json.h"
+#include "psv_writer.h"
+#include "psv_aggregate.h"
+#include "psv_sort.h"
+#include "psv_join.h"
+#include "psv_distinct.h"
+#include "psv_window.h"
+#include "psv_sample.h"
+#include "psv_profile.h"
+#include "psv_validate.h"
+#include "psv_where.h"
+#include "psv_infer.h"
+
+#define PSV_DEFAULT_MEMORY_BUDGET (256 * 1024 * 1024)
+#define PSV_DEFAULT_INFER_ROWS 1000
 
 static const char* progname;
 
+// Number of invalid cells found in validation mode, which decides the exit status
+static size_t num_validation_errors;
+
+// Long only options
+enum {
+    OPT_GROUP_BY = 256,
+    OPT_AGG,
+    OPT_MEMORY_BUDGET,
+    OPT_SORT_BY,
+    OPT_TOP,
+    OPT_JOIN,
+    OPT_JOIN_BUILD,
+    OPT_DISTINCT,
+    OPT_DISTINCT_ON,
+    OPT_DISTINCT_EXACT,
+    OPT_DISTINCT_APPROX,
+    OPT_WINDOW,
+    OPT_WINDOW_SLIDE,
+    OPT_WINDOW_ON,
+    OPT_SAMPLE,
+    OPT_SAMPLE_RATE,
+    OPT_SEED,
+    OPT_PROFILE,
+    OPT_VALIDATE,
+    OPT_LIST,
+    OPT_BINARY_AS,
+    OPT_DATETIME_AS,
+    OPT_INFER_TYPES,
+    OPT_INFER_ROWS,
+    OPT_SCHEMA,
+    OPT_COUNT,
+    OPT_WHERE,
+    OPT_FORMAT,
+    OPT_COLUMNAR,
+    OPT_ROWS_AS_ARRAYS,
+    OPT_NDJSON_ALL,
+    OPT_BATCH_SIZE,
+    OPT_NPY,
+};
+
+typedef struct {
+    // Table selection
+    int pos_selector;
+    char *id_selector;
+
+    // Output shape
+    bool compact_mode;
+    bool ndjson_all;        ///< Stream the rows of every table as lines, each tagged with its table
+    PsvWriterOptions writer; ///< Output format and how cells are encoded in it
+
+    // Group by aggregation mode
+    char *group_by;
+    char *aggregates;
+
+    // Window aggregation mode
+    char *window;
+    char *window_slide;
+    char *window_on;
+
+    // Sort mode
+    char *sort_by;
+    size_t top;
+
+    // Join mode
+    char *join;
+    char *join_build;
+
+    // Distinct mode
+    bool distinct;
+    char *distinct_on;
+    bool distinct_exact;
+    size_t distinct_approx;
+
+    // Sampling mode
+    size_t sample;
+    double sample_rate;
+    uint64_t seed;
+
+    // Profiling mode
+    bool profile;
+
+    // Validation mode
+    bool validate;
+
+    // Table listing mode
+    bool list;
+
+    // Schema mode
+    bool schema;
+
+    // Row counting mode
+    bool count;
+    char *where;
+
+    // Type inference for unannotated columns
+    bool infer_types;
+    size_t infer_rows;      ///< Number of leading rows to infer from, or 0 for all rows
+
+    // Memory budget for modes that may need to spill to temporary files
+    size_t memory_budget;
+} PsvOptions;
+
 static char *getDefaultTableID(char *defaultTableID, size_t maxLen, unsigned int tablePosition) {
     snprintf(defaultTableID, PSV_TABLE_ID_MAX, "table%d", tablePosition);
     return defaultTableID;
 }
 
-static void parse_table_to_json_from_stream(FILE* input_stream, FILE* output_stream, unsigned int *tallyCount, int pos_selector, char *id_selector, bool compact_mode) {
-    char defaultTableID[PSV_TABLE_ID_MAX];
+// Infer the types of a table's unannotated columns from its leading rows, then rewind to its first row
+static void infer_table_types(FILE* input_stream, PsvTable *table, const PsvOptions *options) {
+    if (!options->infer_types) {
+        return;
+    }
+
+    if (table->data_offset < 0) {
+        fprintf(stderr, "%s: warning: cannot infer the types of table '%s' as its input is not seekable\n", progname, table->id);
+        return;
+    }
+
+    PsvTypeInference inference;
+    psv_infer_init(&inference, table);
+
+    PsvRowBuffer row_buffer = {0};
+    size_t num_rows = 0;
+    bool undecided = inference.num_undecided > 0;
+    while (undecided && (options->infer_rows == 0 || num_rows < options->infer_rows) && psv_parse_table_row_buffer(input_stream, table, &row_buffer)) {
+        num_rows++;
+        undecided = psv_infer_add_row(&inference, row_buffer.cells);
+    }
+    psv_row_buffer_free(&row_buffer);
+
+    psv_infer_apply(&inference, table);
+    psv_infer_free(&inference);
+
+    if (!psv_parse_rewind_table_rows(input_stream, table)) {
+        fprintf(stderr, "%s: cannot rewind to the first row of table '%s'\n", progname, table->id);
+        exit(1);
+    }
+}
+
+// Infer the types of a fully parsed table's unannotated columns from its leading rows
+static void infer_parsed_table_types(PsvTable *table, const PsvOptions *options) {
+    if (!options->infer_types) {
+        return;
+    }
+
+    PsvTypeInference inference;
+    psv_infer_init(&inference, table);
+    bool undecided = inference.num_undecided > 0;
+    for (size_t i = 0; undecided && i < (size_t)table->num_data_rows && (options->infer_rows == 0 || i < options->infer_rows); i++) {
+        undecided = psv_infer_add_row(&inference, table->data_rows[i]);
+    }
+    psv_infer_apply(&inference, table);
+    psv_infer_free(&inference);
+}
+
+static void parse_table_to_json_from_stream(FILE* input_stream, FILE* output_stream, unsigned int *tallyCount, const PsvOptions *options) {
+    const int pos_selector = options->pos_selector;
+    char *id_selector = options->id_selector;
+    const bool compact_mode = options->compact_mode;
+    char defaultTableID[PSV_TABLE_ID_MAX];
+    PsvTable *table = NULL;
+
+    while ((table = psv_parse_table(input_stream, getDefaultTableID(defaultTableID, PSV_TABLE_ID_MAX, *tallyCount + 1))) != NULL) {
+
+        // Keep track of parsed tables position which is required for table positional selector to function correctly
+        *tallyCount = *tallyCount + 1;
+
+        if ((pos_selector > 0) && (pos_selector != *tallyCount)) {
+            // Select By Table Position mode was enabled, check if table position was reached
+            psv_free_table(&table);
+            continue;
+        } else if ((id_selector != NULL) && (strcmp(table->id, id_selector) != 0)) {
+            // Select By String ID mode was enabled, check if table ID matches
+            psv_free_table(&table);
+            continue;
+        }
+
+        // Table Found, print it to output stream
+        infer_parsed_table_types(table, options);
+        PsvTableWriter writer;
+        psv_table_writer_begin(&writer, &options->writer, output_stream, table, compact_mode, false);
+        for (int i = 0; i < table->num_data_rows; i++) {
+            psv_table_writer_write_row(&writer, table->data_rows[i]);
+        }
+        psv_table_writer_end(&writer);
+
+        // Release table memory
+        psv_free_table(&table);
+
+        // Check if in single table search mode
+        if ((pos_selector > 0) || (id_selector != NULL)) {
+            break;
+        }
+
+    }
+
+}
+
+static void parse_singular_table_streaming_rows_to_json_from_stream(FILE* input_stream, FILE* output_stream, unsigned int *tallyCount, const PsvOptions *options) {
+    const int pos_selector = options->pos_selector;
+    char *id_selector = options->id_selector;
+
+    if ((pos_selector == 0) && (id_selector == NULL)) {
+        // Expecting to be in singular table search mode
+        return;
+    }
+
+    PsvTable *table = NULL;
+    char defaultTableID[PSV_TABLE_ID_MAX];
+    while ((table = psv_parse_table_header(input_stream, getDefaultTableID(defaultTableID, PSV_TABLE_ID_MAX, *tallyCount + 1))) != NULL) {
+
+        // Keep track of parsed tables position which is required for table positional selector to function correctly
+        *tallyCount = *tallyCount + 1;
+
+        // Check if we found the table we are looking for
+        if ((pos_selector > 0) && (pos_selector != *tallyCount)) {
+            // Select By Table Position mode was enabled, check if table position was reached
+            psv_parse_skip_table_rows(input_stream, table);
+            psv_free_table(&table);
+            continue;
+        } else if ((id_selector != NULL) && (strcmp(table->id, id_selector) != 0)) {
+            // Select By String ID mode was enabled, check if table ID matches
+            psv_parse_skip_table_rows(input_stream, table);
+            psv_free_table(&table);
+            continue;
+        }
+
+        // Table found, start streaming out the rows
+        infer_table_types(input_stream, table, options);
+        PsvTableWriter writer;
+        psv_table_writer_begin(&writer, &options->writer, output_stream, table, true, true);
+        PsvDataRow data_row = NULL;
+        while ((data_row = psv_parse_table_row(input_stream, table)) != NULL) {
+            // Row Found, print it to output stream
+            psv_table_writer_write_row(&writer, data_row);
+
+            // Release row memory
+            psv_parse_table_free_row(table, &data_row);
+        }
+        psv_table_writer_end(&writer);
+
+        // Release table memory
+        psv_free_table(&table);
+        break;
+    }
+
+    return;
+}
+
+static bool is_single_table_mode(const PsvOptions *options) {
+    return (options->pos_selector > 0) || (options->id_selector != NULL);
+}
+
+// Whether rows are written one per line: a single table in compact mode, or every table with --ndjson-all
+static bool is_streaming_rows_mode(const PsvOptions *options) {
+    return (options->compact_mode && is_single_table_mode(options)) || options->ndjson_all;
+}
+
+static bool is_selected_table(PsvTable *table, unsigned int tallyCount, const PsvOptions *options) {
+    if ((options->pos_selector > 0) && (options->pos_selector != tallyCount)) {
+        // Select By Table Position mode was enabled, check if table position was reached
+        return false;
+    } else if ((options->id_selector != NULL) && (strcmp(table->id, options->id_selector) != 0)) {
+        // Select By String ID mode was enabled, check if table ID matches
+        return false;
+    }
+    return true;
+}
+
+static void parse_all_tables_streaming_rows_to_json_from_stream(FILE* input_stream, FILE* output_stream, unsigned int *tallyCount, const PsvOptions *options) {
+    PsvTable *table = NULL;
+    char defaultTableID[PSV_TABLE_ID_MAX];
+    while ((table = psv_parse_table_header(input_stream, getDefaultTableID(defaultTableID, PSV_TABLE_ID_MAX, *tallyCount + 1))) != NULL) {
+
+        // Keep track of parsed tables position which is required for table positional selector to function correctly
+        *tallyCount = *tallyCount + 1;
+
+        if (!is_selected_table(table, *tallyCount, options)) {
+            psv_parse_skip_table_rows(input_stream, table);
+            psv_free_table(&table);
+            continue;
+        }
+
+        // Stream out each row as a line tagged with its table, so only the header and one row are ever in memory
+        infer_table_types(input_stream, table, options);
+        PsvTableWriter writer;
+        psv_table_writer_begin(&writer, &options->writer, output_stream, table, true, true);
+        PsvDataRow data_row = NULL;
+        while ((data_row = psv_parse_table_row(input_stream, table)) != NULL) {
+            psv_table_writer_write_row(&writer, data_row);
+            psv_parse_table_free_row(table, &data_row);
+        }
+        psv_table_writer_end(&writer);
+
+        psv_free_table(&table);
+
+        // Check if in single table search mode
+        if (is_single_table_mode(options)) {
+            break;
+        }
+    }
+}
+
+static void group_by_table_rows_from_stream(FILE* input_stream, FILE* output_stream, unsigned int *tallyCount, const PsvOptions *options) {
+    PsvTable *table = NULL;
+    char defaultTableID[PSV_TABLE_ID_MAX];
+    while ((table = psv_parse_table_header(input_stream, getDefaultTableID(defaultTableID, PSV_TABLE_ID_MAX, *tallyCount + 1))) != NULL) {
+
+        // Keep track of parsed tables position which is required for table positional selector to function correctly
+        *tallyCount = *tallyCount + 1;
+
+        if (!is_selected_table(table, *tallyCount, options)) {
+            psv_parse_skip_table_rows(input_stream, table);
+            psv_free_table(&table);
+            continue;
+        }
+        infer_table_types(input_stream, table, options);
+
+        PsvAggregateSpec spec;
+        if (!psv_aggregate_spec_parse(&spec, table, options->group_by, options->aggregates ? options->aggregates : "count")) {
+            if (is_single_table_mode(options)) {
+                fprintf(stderr, "%s: %s in table '%s'\n", progname, spec.error, table->id);
+                exit(1);
+            }
+
+            // Not every table in a document needs to have the aggregated columns
+            fprintf(stderr, "%s: %s in table '%s', skipping table\n", progname, spec.error, table->id);
+            psv_parse_skip_table_rows(input_stream, table);
+            psv_aggregate_spec_free(&spec);
+            psv_free_table(&table);
+            continue;
+        }
+
+        // Hash aggregate each row as it is streamed in, so neither the table rows nor a cJSON tree is ever built
+        PsvGroupBy *group_by = psv_group_by_create(&spec, table->num_headers, options->memory_budget);
+        PsvDataRow data_row = NULL;
+        while ((data_row = psv_parse_table_row(input_stream, table)) != NULL) {
+            psv_group_by_add_row(group_by, data_row);
+            psv_parse_table_free_row(table, &data_row);
+        }
+
+        // Output one row per group
+        PsvTable *result_table = psv_aggregate_create_result_table(table, &spec, NULL, 0);
+        PsvTableWriter writer;
+        psv_table_writer_begin(&writer, &options->writer, output_stream, result_table, options->compact_mode, is_streaming_rows_mode(options));
+        while ((data_row = psv_group_by_next_row(group_by)) != NULL) {
+            psv_table_writer_write_row(&writer, data_row);
+            psv_parse_table_free_row(result_table, &data_row);
+        }
+        psv_table_writer_end(&writer);
+
+        psv_group_by_free(&group_by);
+        psv_free_table(&result_table);
+        psv_aggregate_spec_free(&spec);
+        psv_free_table(&table);
+
+        // Check if in single table search mode
+        if (is_single_table_mode(options)) {
+            break;
+        }
+    }
+}
+
+static void window_table_rows_from_stream(FILE* input_stream, FILE* output_stream, unsigned int *tallyCount, const PsvOptions *options) {
+    PsvTable *table = NULL;
+    char defaultTableID[PSV_TABLE_ID_MAX];
+    while ((table = psv_parse_table_header(input_stream, getDefaultTableID(defaultTableID, PSV_TABLE_ID_MAX, *tallyCount + 1))) != NULL) {
+
+        // Keep track of parsed tables position which is required for table positional selector to function correctly
+        *tallyCount = *tallyCount + 1;
+
+        if (!is_selected_table(table, *tallyCount, options)) {
+            psv_parse_skip_table_rows(input_stream, table);
+            psv_free_table(&table);
+            continue;
+        }
+        infer_table_types(input_stream, table, options);
+
+        PsvAggregateSpec aggregate_spec;
+        PsvWindowSpec window_spec;
+        const bool aggregate_spec_ok = psv_aggregate_spec_parse(&aggregate_spec, table, options->group_by, options->aggregates ? options->aggregates : "count");
+        if (!aggregate_spec_ok || !psv_window_spec_parse(&window_spec, table, options->window_on, options->window, options->window_slide)) {
+            const char *error = aggregate_spec_ok ? window_spec.error : aggregate_spec.error;
+            if (is_single_table_mode(options)) {
+                fprintf(stderr, "%s: %s in table '%s'\n", progname, error, table->id);
+                exit(1);
+            }
+
+            // Not every table in a document is a time series
+            fprintf(stderr, "%s: %s in table '%s', skipping table\n", progname, error, table->id);
+            psv_parse_skip_table_rows(input_stream, table);
+            psv_aggregate_spec_free(&aggregate_spec);
+            psv_free_table(&table);
+            continue;
+        }
+
+        // Windows are output as soon as the row stream moves past their end, so only open windows are held in memory
+        PsvTable *result_table = psv_window_create_result_table(table, &aggregate_spec);
+        PsvWindowAggregator *window = psv_window_create(&window_spec, &aggregate_spec, table->num_headers, options->memory_budget);
+        PsvTableWriter writer;
+        psv_table_writer_begin(&writer, &options->writer, output_stream, result_table, options->compact_mode, is_streaming_rows_mode(options));
+
+        size_t num_late_rows = 0;
+        size_t num_invalid_time_rows = 0;
+        bool input_done = false;
+        while (!input_done) {
+            PsvDataRow data_row = psv_parse_table_row(input_stream, table);
+            if (data_row == NULL) {
+                // Close the windows still open at the end of the table
+                psv_window_finish(window);
+                input_done = true;
+            } else {
+                const PsvWindowRowStatus status = psv_window_add_row(window, data_row);
+                num_late_rows += (status == PSV_WINDOW_ROW_LATE);
+                num_invalid_time_rows += (status == PSV_WINDOW_ROW_INVALID_TIME);
+                psv_parse_table_free_row(table, &data_row);
+            }
+
+            PsvDataRow result_row = NULL;
+            while ((result_row = psv_window_next_row(window)) != NULL) {
+                psv_table_writer_write_row(&writer, result_row);
+                psv_parse_table_free_row(result_table, &result_row);
+            }
+        }
+        psv_table_writer_end(&writer);
+
+        if (num_late_rows > 0) {
+            fprintf(stderr, "%s: warning: dropped %zu rows in table '%s' that arrived after their window was closed\n", progname, num_late_rows, table->id);
+        }
+        if (num_invalid_time_rows > 0) {
+            fprintf(stderr, "%s: warning: dropped %zu rows in table '%s' without a valid date/time\n", progname, num_invalid_time_rows, table->id);
+        }
+
+        psv_window_free(&window);
+        psv_free_table(&result_table);
+        psv_aggregate_spec_free(&aggregate_spec);
+        psv_free_table(&table);
+
+        // Check if in single table search mode
+        if (is_single_table_mode(options)) {
+            break;
+        }
+    }
+}
+
+static void sort_table_rows_from_stream(FILE* input_stream, FILE* output_stream, unsigned int *tallyCount, const PsvOptions *options) {
+    PsvTable *table = NULL;
+    char defaultTableID[PSV_TABLE_ID_MAX];
+    while ((table = psv_parse_table_header(input_stream, getDefaultTableID(defaultTableID, PSV_TABLE_ID_MAX, *tallyCount + 1))) != NULL) {
+
+        // Keep track of parsed tables position which is required for table positional selector to function correctly
+        *tallyCount = *tallyCount + 1;
+
+        if (!is_selected_table(table, *tallyCount, options)) {
+            psv_parse_skip_table_rows(input_stream, table);
+            psv_free_table(&table);
+            continue;
+        }
+        infer_table_types(input_stream, table, options);
+
+        PsvSortSpec spec;
+        if (!psv_sort_spec_parse(&spec, table, options->sort_by)) {
+            if (is_single_table_mode(options)) {
+                fprintf(stderr, "%s: %s in table '%s'\n", progname, spec.error, table->id);
+                exit(1);
+            }
+
+            // Not every table in a document needs to have the sorted columns
+            fprintf(stderr, "%s: %s in table '%s', skipping table\n", progname, spec.error, table->id);
+            psv_parse_skip_table_rows(input_stream, table);
+            psv_sort_spec_free(&spec);
+            psv_free_table(&table);
+            continue;
+        }
+
+        // Feed rows into the sorter as they are streamed in. It sorts in memory, spills sorted runs
+        // to temporary files when over the memory budget, or just keeps a bounded heap in top K mode.
+        PsvSorter *sorter = psv_sorter_create(&spec, table->num_headers, options->memory_budget, options->top);
+        PsvDataRow data_row = NULL;
+        while ((data_row = psv_parse_table_row(input_stream, table)) != NULL) {
+            psv_sorter_add_row(sorter, data_row);
+        }
+
+        PsvTableWriter writer;
+        psv_table_writer_begin(&writer, &options->writer, output_stream, table, options->compact_mode, is_streaming_rows_mode(options));
+        while ((data_row = psv_sorter_next_row(sorter)) != NULL) {
+            psv_table_writer_write_row(&writer, data_row);
+            psv_parse_table_free_row(table, &data_row);
+        }
+        psv_table_writer_end(&writer);
+
+        psv_sorter_free(&sorter);
+        psv_sort_spec_free(&spec);
+        psv_free_table(&table);
+
+        // Check if in single table search mode
+        if (is_single_table_mode(options)) {
+            break;
+        }
+    }
+}
+
+static void distinct_table_rows_from_stream(FILE* input_stream, FILE* output_stream, unsigned int *tallyCount, const PsvOptions *options) {
+    PsvTable *table = NULL;
+    char defaultTableID[PSV_TABLE_ID_MAX];
+    while ((table = psv_parse_table_header(input_stream, getDefaultTableID(defaultTableID, PSV_TABLE_ID_MAX, *tallyCount + 1))) != NULL) {
+
+        // Keep track of parsed tables position which is required for table positional selector to function correctly
+        *tallyCount = *tallyCount + 1;
+
+        if (!is_selected_table(table, *tallyCount, options)) {
+            psv_parse_skip_table_rows(input_stream, table);
+            psv_free_table(&table);
+            continue;
+        }
+        infer_table_types(input_stream, table, options);
+
+        PsvDistinctSpec spec;
+        if (!psv_distinct_spec_parse(&spec, table, options->distinct_on)) {
+            if (is_single_table_mode(options)) {
+                fprintf(stderr, "%s: %s in table '%s'\n", progname, spec.error, table->id);
+                exit(1);
+            }
+
+            // Not every table in a document needs to have the distinct columns
+            fprintf(stderr, "%s: %s in table '%s', skipping table\n", progname, spec.error, table->id);
+            psv_parse_skip_table_rows(input_stream, table);
+            psv_distinct_spec_free(&spec);
+            psv_free_table(&table);
+            continue;
+        }
+        spec.exact = options->distinct_exact;
+        spec.approximate_bytes = options->distinct_approx;
+
+        // Output the first row of each distinct key as it is streamed in, so rows are never buffered
+        PsvDistinct *distinct = psv_distinct_create(&spec);
+        PsvTableWriter writer;
+        psv_table_writer_begin(&writer, &options->writer, output_stream, table, options->compact_mode, is_streaming_rows_mode(options));
+        PsvDataRow data_row = NULL;
+        while ((data_row = psv_parse_table_row(input_stream, table)) != NULL) {
+            if (psv_distinct_add_row(distinct, data_row)) {
+                psv_table_writer_write_row(&writer, data_row);
+            }
+            psv_parse_table_free_row(table, &data_row);
+        }
+        psv_table_writer_end(&writer);
+
+        psv_distinct_free(&distinct);
+        psv_distinct_spec_free(&spec);
+        psv_free_table(&table);
+
+        // Check if in single table search mode
+        if (is_single_table_mode(options)) {
+            break;
+        }
+    }
+}
+
+static void sample_table_rows_from_stream(FILE* input_stream, FILE* output_stream, unsigned int *tallyCount, const PsvOptions *options) {
+    PsvTable *table = NULL;
+    char defaultTableID[PSV_TABLE_ID_MAX];
+    while ((table = psv_parse_table_header(input_stream, getDefaultTableID(defaultTableID, PSV_TABLE_ID_MAX, *tallyCount + 1))) != NULL) {
+
+        // Keep track of parsed tables position which is required for table positional selector to function correctly
+        *tallyCount = *tallyCount + 1;
+
+        if (!is_selected_table(table, *tallyCount, options)) {
+            psv_parse_skip_table_rows(input_stream, table);
+            psv_free_table(&table);
+            continue;
+        }
+        infer_table_types(input_stream, table, options);
+
+        // Vary the seed per table so that tables of the same length are not sampled at the same positions
+        const uint64_t seed = options->seed + *tallyCount;
+
+        PsvTableWriter writer;
+        psv_table_writer_begin(&writer, &options->writer, output_stream, table, options->compact_mode, is_streaming_rows_mode(options));
+
+        // Rows that are not sampled are skipped without being tokenized
+        bool input_done = false;
+        PsvDataRow data_row = NULL;
+        if (options->sample_rate > 0) {
+            // Bernoulli sampling never stores rows, so each kept row is output straight away
+            PsvBernoulliSampler sampler;
+            psv_bernoulli_init(&sampler, options->sample_rate, seed);
+            while (!input_done) {
+                for (uint64_t skip = psv_bernoulli_next_skip(&sampler); skip > 0 && !input_done; skip--) {
+                    input_done = !psv_parse_skip_table_row(input_stream, table);
+                }
+                if (!input_done && (data_row = psv_parse_table_row(input_stream, table)) != NULL) {
+                    psv_table_writer_write_row(&writer, data_row);
+                    psv_parse_table_free_row(table, &data_row);
+                } else {
+                    input_done = true;
+                }
+            }
+        } else {
+            PsvReservoir *reservoir = psv_reservoir_create(options->sample, table->num_headers, seed);
+            while (!input_done) {
+                for (uint64_t skip = psv_reservoir_next_skip(reservoir); skip > 0 && !input_done; skip--) {
+                    input_done = !psv_parse_skip_table_row(input_stream, table);
+                }
+                if (!input_done && (data_row = psv_parse_table_row(input_stream, table)) != NULL) {
+                    psv_reservoir_add_row(reservoir, data_row);
+                } else {
+                    input_done = true;
+                }
+            }
+
+            // The sample is output in table order
+            while ((data_row = psv_reservoir_next_row(reservoir)) != NULL) {
+                psv_table_writer_write_row(&writer, data_row);
+                psv_parse_table_free_row(table, &data_row);
+            }
+            psv_reservoir_free(&reservoir);
+        }
+        psv_table_writer_end(&writer);
+
+        psv_free_table(&table);
+
+        // Check if in single table search mode
+        if (is_single_table_mode(options)) {
+            break;
+        }
+    }
+}
+
+static void profile_table_from_stream(FILE* input_stream, FILE* output_stream, unsigned int *tallyCount, const PsvOptions *options) {
+    PsvTable *table = NULL;
+    char defaultTableID[PSV_TABLE_ID_MAX];
+    while ((table = psv_parse_table_header(input_stream, getDefaultTableID(defaultTableID, PSV_TABLE_ID_MAX, *tallyCount + 1))) != NULL) {
+
+        // Keep track of parsed tables position which is required for table positional selector to function correctly
+        *tallyCount = *tallyCount + 1;
+
+        if (!is_selected_table(table, *tallyCount, options)) {
+            psv_parse_skip_table_rows(input_stream, table);
+            psv_free_table(&table);
+            continue;
+        }
+        infer_table_types(input_stream, table, options);
+
+        // Fold each row into fixed size per column statistics as it is streamed in
+        PsvProfile profile;
+        psv_profile_init(&profile, table);
+        PsvDataRow data_row = NULL;
+        while ((data_row = psv_parse_table_row(input_stream, table)) != NULL) {
+            psv_profile_add_row(&profile, data_row);
+            psv_parse_table_free_row(table, &data_row);
+        }
+
+        cJSON *profile_json = psv_profile_create_json(&profile);
+        psv_writer_write_item(&options->writer, output_stream, profile_json);
+        cJSON_Delete(profile_json);
+
+        psv_profile_free(&profile);
+        psv_free_table(&table);
+
+        // Check if in single table search mode
+        if (is_single_table_mode(options)) {
+            break;
+        }
+    }
+}
+
+static cJSON *create_offset_json(off_t offset) {
+    return (offset >= 0) ? cJSON_CreateNumber(offset) : cJSON_CreateNull();
+}
+
+static void list_tables_from_stream(FILE* input_stream, FILE* output_stream, unsigned int *tallyCount, const PsvOptions *options) {
+    PsvTable *table = NULL;
+    char defaultTableID[PSV_TABLE_ID_MAX];
+    while ((table = psv_parse_table_header(input_stream, getDefaultTableID(defaultTableID, PSV_TABLE_ID_MAX, *tallyCount + 1))) != NULL) {
+
+        // Keep track of parsed tables position which is required for table positional selector to function correctly
+        *tallyCount = *tallyCount + 1;
+
+        // Rows are only counted, never tokenized
+        const size_t num_rows = psv_parse_skip_table_rows(input_stream, table);
+        if (!is_selected_table(table, *tallyCount, options)) {
+            psv_free_table(&table);
+            continue;
+        }
+
+        cJSON *table_json = psv_json_create_table_metadata_json(table);
+        cJSON_AddItemToObject(table_json, "position", cJSON_CreateNumber(*tallyCount));
+        cJSON_AddItemToObject(table_json, "num_rows", cJSON_CreateNumber(num_rows));
+        cJSON_AddItemToObject(table_json, "header_offset", create_offset_json(table->header_offset));
+        cJSON_AddItemToObject(table_json, "data_offset", create_offset_json(table->data_offset));
+        cJSON_AddItemToObject(table_json, "end_offset", create_offset_json(table->end_offset));
+        psv_writer_write_item(&options->writer, output_stream, table_json);
+        cJSON_Delete(table_json);
+        psv_free_table(&table);
+
+        // Check if in single table search mode
+        if (is_single_table_mode(options)) {
+            break;
+        }
+    }
+}
+
+static void schema_tables_from_stream(FILE* input_stream, FILE* output_stream, unsigned int *tallyCount, const PsvOptions *options) {
     PsvTable *table = NULL;
-
-    while ((table = psv_parse_table(input_stream, getDefaultTableID(defaultTableID, PSV_TABLE_ID_MAX, *tallyCount + 1))) != NULL) {
+    char defaultTableID[PSV_TABLE_ID_MAX];
+    while ((table = psv_parse_table_header(input_stream, getDefaultTableID(defaultTableID, PSV_TABLE_ID_MAX, *tallyCount + 1))) != NULL) {
 
         // Keep track of parsed tables position which is required for table positional selector to function correctly
         *tallyCount = *tallyCount + 1;
 
-        if ((pos_selector > 0) && (pos_selector != *tallyCount)) {
-            // Select By Table Position mode was enabled, check if table position was reached
-            psv_free_table(&table);
-            continue;
-        } else if ((id_selector != NULL) && (strcmp(table->id, id_selector) != 0)) {
-            // Select By String ID mode was enabled, check if table ID matches
+        if (!is_selected_table(table, *tallyCount, options)) {
+            psv_parse_skip_table_rows(input_stream, table);
             psv_free_table(&table);
             continue;
         }
 
-        // Table Found, print it to output stream
-        cJSON *table_json = compact_mode ? psv_json_create_table_rows(table) : psv_json_create_table_json(table);
-        char *json_string = cJSON_PrintUnformatted(table_json);
-        fprintf(output_stream, "%s\n", json_string);
-        free(json_string);
-        cJSON_Delete(table_json);
+        // Only the header is needed (and any rows to infer types from), so jump over the table body
+        infer_table_types(input_stream, table, options);
+        psv_parse_skip_table_rows(input_stream, table);
 
-        // Release table memory
+        cJSON *schema_json = psv_json_create_table_schema_json(table);
+        psv_writer_write_item(&options->writer, output_stream, schema_json);
+        cJSON_Delete(schema_json);
         psv_free_table(&table);
 
         // Check if in single table search mode
-        if ((pos_selector > 0) || (id_selector != NULL)) {
+        if (is_single_table_mode(options)) {
             break;
         }
-
     }
-
 }
 
-static void parse_singular_table_streaming_rows_to_json_from_stream(FILE* input_stream, FILE* output_stream, unsigned int *tallyCount, int pos_selector, char *id_selector, bool compact_mode) {
+static void count_table_rows_from_stream(FILE* input_stream, FILE* output_stream, unsigned int *tallyCount, const PsvOptions *options) {
+    PsvTable *table = NULL;
+    char defaultTableID[PSV_TABLE_ID_MAX];
+    PsvRowBuffer row_buffer = {0};
+    while ((table = psv_parse_table_header(input_stream, getDefaultTableID(defaultTableID, PSV_TABLE_ID_MAX, *tallyCount + 1))) != NULL) {
+
+        // Keep track of parsed tables position which is required for table positional selector to function correctly
+        *tallyCount = *tallyCount + 1;
 
-    if ((pos_selector == 0) && (id_selector == NULL)) {
-        // Expecting to be in singular table search mode
-        return;
+        if (!is_selected_table(table, *tallyCount, options)) {
+            psv_parse_skip_table_rows(input_stream, table);
+            psv_free_table(&table);
+            continue;
+        }
+        infer_table_types(input_stream, table, options);
+
+        size_t num_rows = 0;
+        if (options->where == NULL) {
+            // Count row lines without tokenizing them
+            num_rows = psv_parse_skip_table_rows(input_stream, table);
+        } else {
+            PsvWhereSpec spec;
+            if (!psv_where_spec_parse(&spec, table, options->where)) {
+                if (is_single_table_mode(options)) {
+                    fprintf(stderr, "%s: %s in table '%s'\n", progname, spec.error, table->id);
+                    exit(1);
+                }
+
+                // Not every table in a document needs to have the filtered column
+                fprintf(stderr, "%s: %s in table '%s', skipping table\n", progname, spec.error, table->id);
+                psv_parse_skip_table_rows(input_stream, table);
+                psv_where_spec_free(&spec);
+                psv_free_table(&table);
+                continue;
+            }
+
+            // Only tokenize rows up to the filtered column
+            while (psv_parse_table_row_buffer_columns(input_stream, table, &row_buffer, spec.column + 1)) {
+                if (psv_where_match(&spec, row_buffer.cells[spec.column])) {
+                    num_rows++;
+                }
+            }
+            psv_where_spec_free(&spec);
+        }
+
+        cJSON *count_json = cJSON_CreateObject();
+        cJSON_AddItemToObject(count_json, "id", cJSON_CreateString(table->id));
+        cJSON_AddItemToObject(count_json, "num_rows", cJSON_CreateNumber(num_rows));
+        psv_writer_write_item(&options->writer, output_stream, count_json);
+        cJSON_Delete(count_json);
+        psv_free_table(&table);
+
+        // Check if in single table search mode
+        if (is_single_table_mode(options)) {
+            break;
+        }
     }
+    psv_row_buffer_free(&row_buffer);
+}
 
+static void validate_table_from_stream(FILE* input_stream, FILE* output_stream, unsigned int *tallyCount, const PsvOptions *options) {
     PsvTable *table = NULL;
     char defaultTableID[PSV_TABLE_ID_MAX];
+    PsvRowBuffer row_buffer = {0};
+    PsvDecodeScratch decode_scratch = {0};
     while ((table = psv_parse_table_header(input_stream, getDefaultTableID(defaultTableID, PSV_TABLE_ID_MAX, *tallyCount + 1))) != NULL) {
 
         // Keep track of parsed tables position which is required for table positional selector to function correctly
         *tallyCount = *tallyCount + 1;
 
-        // Check if we found the table we are looking for
-        if ((pos_selector > 0) && (pos_selector != *tallyCount)) {
-            // Select By Table Position mode was enabled, check if table position was reached
-            while (psv_parse_skip_table_row(input_stream, table)) {/* Skip Rows */};
-            psv_free_table(&table);
-            continue;
-        } else if ((id_selector != NULL) && (strcmp(table->id, id_selector) != 0)) {
-            // Select By String ID mode was enabled, check if table ID matches
-            while (psv_parse_skip_table_row(input_stream, table)) {/* Skip Rows */};
+        if (!is_selected_table(table, *tallyCount, options)) {
+            psv_parse_skip_table_rows(input_stream, table);
             psv_free_table(&table);
             continue;
         }
+        infer_table_types(input_stream, table, options);
 
-        // Table found, start streaming out the rows
-        PsvDataRow data_row = NULL;
-        while ((data_row = psv_parse_table_row(input_stream, table)) != NULL) {
-            // Row Found, print it to output stream
-            cJSON *table_json = psv_json_create_table_single_row(table, data_row);
-            char *json_string = cJSON_PrintUnformatted(table_json);
-            fprintf(output_stream, "%s\n", json_string);
-            free(json_string);
-            cJSON_Delete(table_json);
+        // Resolve each column's checks once, then check rows in place without allocating
+        PsvColumnValidator *validators = malloc(table->num_headers * sizeof(PsvColumnValidator));
+        for (int i = 0; i < table->num_headers; i++) {
+            psv_validate_column_init(&validators[i], table, i);
+        }
 
-            // Release row memory
-            psv_parse_table_free_row(table, &data_row);
+        size_t row = 0;
+        while (psv_parse_table_row_buffer(input_stream, table, &row_buffer)) {
+            row++;
+            for (int i = 0; i < table->num_headers; i++) {
+                const char *reason = NULL;
+                const char *cell = row_buffer.cells[i];
+                if (cell == NULL || psv_validate_column_cell(&validators[i], cell, &decode_scratch, &reason)) {
+                    continue;
+                }
+
+                num_validation_errors++;
+                fprintf(output_stream, "%s: row %zu, column %d '%s'", table->id, row, i + 1, table->header_metadata[i].id);
+                if (row_buffer.offset >= 0) {
+                    fprintf(output_stream, " (byte %lld)", (long long)(row_buffer.offset + row_buffer.cell_offsets[i]));
+                }
+                fprintf(output_stream, ": %s: '%s'\n", reason, cell);
+            }
         }
 
-        // Release table memory
+        free(validators);
         psv_free_table(&table);
-        break;
+
+        // Check if in single table search mode
+        if (is_single_table_mode(options)) {
+            break;
+        }
     }
+    psv_row_buffer_free(&row_buffer);
+    psv_decode_scratch_free(&decode_scratch);
+}
 
-    return;
+typedef struct {
+    bool found;
+    size_t input;                   // Index of the input stream holding the table
+    off_t offset;                   // Stream offset to parse the table header from
+    char id[PSV_TABLE_ID_MAX];      // Table ID (needed again as the default ID when reparsing unnamed tables)
+    int num_rows;
+} JoinTableLocation;
+
+// Joining and type inference need to read their input twice, so copy non seekable input (e.g. a pipe) into a temporary file
+static FILE *open_seekable_stream(FILE *input_stream) {
+    if (fseeko(input_stream, 0, SEEK_CUR) == 0) {
+        return input_stream;
+    }
+
+    FILE *spool = tmpfile();
+    if (spool == NULL) {
+        fprintf(stderr, "%s: cannot create temporary file to spool input: %s\n", progname, strerror(errno));
+        exit(1);
+    }
+
+    char buffer[64 * 1024];
+    size_t read;
+    while ((read = fread(buffer, 1, sizeof(buffer), input_stream)) > 0) {
+        fwrite(buffer, 1, read, spool);
+    }
+    rewind(spool);
+    return spool;
+}
+
+// First pass: find where both tables are and how many rows each has, without tokenizing any rows
+static void locate_join_tables(FILE **input_streams, size_t num_input_streams, const PsvJoinSide *left, const PsvJoinSide *right, JoinTableLocation *left_location, JoinTableLocation *right_location) {
+    unsigned int tallyCount = 0;
+    char defaultTableID[PSV_TABLE_ID_MAX];
+
+    for (size_t i = 0; i < num_input_streams; i++) {
+        FILE *input_stream = input_streams[i];
+        off_t offset = ftello(input_stream);
+        PsvTable *table = NULL;
+        while ((table = psv_parse_table_header(input_stream, getDefaultTableID(defaultTableID, PSV_TABLE_ID_MAX, tallyCount + 1))) != NULL) {
+            tallyCount++;
+
+            JoinTableLocation *locations[2] = {left_location, right_location};
+            const char *ids[2] = {left->table_id, right->table_id};
+            const bool match[2] = {
+                !left_location->found && strcmp(table->id, ids[0]) == 0,
+                !right_location->found && strcmp(table->id, ids[1]) == 0,
+            };
+
+            const int num_rows = psv_parse_skip_table_rows(input_stream, table);
+
+            for (int j = 0; j < 2; j++) {
+                if (match[j]) {
+                    *locations[j] = (JoinTableLocation){.found = true, .input = i, .offset = offset, .num_rows = num_rows};
+                    memcpy(locations[j]->id, defaultTableID, PSV_TABLE_ID_MAX);
+                }
+            }
+
+            psv_free_table(&table);
+            offset = ftello(input_stream);
+        }
+    }
+}
+
+static PsvTable *open_join_table(FILE **input_streams, const JoinTableLocation *location) {
+    FILE *input_stream = input_streams[location->input];
+    fseeko(input_stream, location->offset, SEEK_SET);
+    return psv_parse_table_header(input_stream, (char *)location->id);
+}
+
+static void join_tables_from_streams(FILE **input_streams, size_t num_input_streams, FILE* output_stream, const PsvOptions *options) {
+    PsvJoinSide sides[2];
+    if (!psv_join_parse_spec(options->join, &sides[0], &sides[1])) {
+        fprintf(stderr, "%s: --join must be of the form left_id:key=right_id:key\n", progname);
+        exit(1);
+    }
+
+    JoinTableLocation locations[2] = {0};
+    locate_join_tables(input_streams, num_input_streams, &sides[0], &sides[1], &locations[0], &locations[1]);
+    for (int i = 0; i < 2; i++) {
+        if (!locations[i].found) {
+            fprintf(stderr, "%s: join table '%s' not found\n", progname, sides[i].table_id);
+            exit(1);
+        }
+    }
+
+    // Build the hash table on the smaller table unless the build side was explicitly chosen
+    int build = (locations[0].num_rows <= locations[1].num_rows) ? 0 : 1;
+    if (options->join_build) {
+        build = (strcmp(options->join_build, "right") == 0) ? 1 : 0;
+    }
+    const int probe = 1 - build;
+    log_debug("Join build side: %s (%d rows), probe side: %s (%d rows)", sides[build].table_id, locations[build].num_rows, sides[probe].table_id, locations[probe].num_rows);
+
+    PsvTable *tables[2] = {NULL, NULL};
+    tables[build] = open_join_table(input_streams, &locations[build]);
+    while (true) {
+        PsvDataRow data_row = psv_parse_table_row(input_streams[locations[build].input], tables[build]);
+        if (data_row == NULL) {
+            break;
+        }
+        tables[build]->data_rows = realloc(tables[build]->data_rows, (tables[build]->num_data_rows + 1) * sizeof(PsvDataRow));
+        tables[build]->data_rows[tables[build]->num_data_rows++] = data_row;
+    }
+    tables[probe] = open_join_table(input_streams, &locations[probe]);
+
+    int key_columns[2];
+    for (int i = 0; i < 2; i++) {
+        key_columns[i] = psv_find_header_column(tables[i], sides[i].key);
+        if (key_columns[i] < 0) {
+            fprintf(stderr, "%s: join column '%s' not found in table '%s'\n", progname, sides[i].key, tables[i]->id);
+            exit(1);
+        }
+    }
+
+    PsvJoinIndex index;
+    psv_join_index_build(&index, tables[build], key_columns[build], psv_join_key_type(tables[0], key_columns[0], tables[1], key_columns[1]));
+
+    // Stream the probe side, emitting one merged row (left columns then right columns) per match
+    PsvTable *result_table = psv_join_create_result_table(tables[0], tables[1]);
+    PsvDataRow merged_row = calloc(result_table->num_headers, sizeof(PsvDataField));
+    PsvTableWriter writer;
+    psv_table_writer_begin(&writer, &options->writer, output_stream, result_table, options->compact_mode, options->compact_mode || options->ndjson_all);
+
+    PsvDataRow probe_row = NULL;
+    while ((probe_row = psv_parse_table_row(input_streams[locations[probe].input], tables[probe])) != NULL) {
+        for (size_t row = psv_join_index_find(&index, probe_row[key_columns[probe]]); row != PSV_JOIN_NO_MATCH; row = psv_join_index_next(&index, row)) {
+            PsvDataRow rows[2];
+            rows[build] = tables[build]->data_rows[row];
+            rows[probe] = probe_row;
+            memcpy(merged_row, rows[0], tables[0]->num_headers * sizeof(PsvDataField));
+            memcpy(merged_row + tables[0]->num_headers, rows[1], tables[1]->num_headers * sizeof(PsvDataField));
+            psv_table_writer_write_row(&writer, merged_row);
+        }
+        psv_parse_table_free_row(tables[probe], &probe_row);
+    }
+    psv_table_writer_end(&writer);
+
+    free(merged_row);
+    psv_join_index_free(&index);
+    psv_free_table(&result_table);
+    psv_free_table(&tables[0]);
+    psv_free_table(&tables[1]);
+}
+
+static void join_tables_from_files(char **file_paths, int num_file_paths, FILE* output_stream, const PsvOptions *options) {
+    const size_t num_input_streams = (num_file_paths > 0) ? num_file_paths : 1;
+    FILE **input_streams = calloc(num_input_streams, sizeof(FILE *));
+
+    if (num_file_paths == 0) {
+        log_info("Processing stdin");
+        input_streams[0] = open_seekable_stream(stdin);
+    }
+
+    for (int i = 0; i < num_file_paths; i++) {
+        log_info("Processing %s", file_paths[i]);
+        input_streams[i] = fopen(file_paths[i], "r");
+        if (!input_streams[i]) {
+            fprintf(stderr, "%s: cannot open file '%s' for reading: %s\n", progname, file_paths[i], strerror(errno));
+            exit(1);
+        }
+        input_streams[i] = open_seekable_stream(input_streams[i]);
+    }
+
+    join_tables_from_streams(input_streams, num_input_streams, output_stream, options);
+
+    for (size_t i = 0; i < num_input_streams; i++) {
+        if (input_streams[i] != stdin) {
+            fclose(input_streams[i]);
+        }
+    }
+    free(input_streams);
 }
 
-static void parse_table_from_stream(FILE* input_stream, FILE* output_stream, unsigned int *tallyCount, int pos_selector, char *id_selector, bool compact_mode) {
-    if (compact_mode && ((pos_selector > 0) || (id_selector != NULL))) {
+static void parse_table_from_stream(FILE* input_stream, FILE* output_stream, unsigned int *tallyCount, const PsvOptions *options) {
+    const int pos_selector = options->pos_selector;
+    char *id_selector = options->id_selector;
+    const bool compact_mode = options->compact_mode;
+
+    if (options->list) {
+        // Output one line of metadata per table, skipping over the rows
+        list_tables_from_stream(input_stream, output_stream, tallyCount, options);
+    } else if (options->schema) {
+        // Output each table's header metadata and column types, skipping over the rows
+        schema_tables_from_stream(input_stream, output_stream, tallyCount, options);
+    } else if (options->count) {
+        // Output the number of rows per table, optionally only counting rows matching --where
+        count_table_rows_from_stream(input_stream, output_stream, tallyCount, options);
+    } else if (options->validate) {
+        // Report cells that do not match their column's data annotation instead of outputting JSON
+        validate_table_from_stream(input_stream, output_stream, tallyCount, options);
+    } else if (options->profile) {
+        // Output column statistics instead of the rows
+        profile_table_from_stream(input_stream, output_stream, tallyCount, options);
+    } else if (options->window) {
+        // Aggregate rows per time window as they are streamed in
+        window_table_rows_from_stream(input_stream, output_stream, tallyCount, options);
+    } else if (options->group_by || options->aggregates) {
+        // Aggregate rows into groups as they are streamed in
+        group_by_table_rows_from_stream(input_stream, output_stream, tallyCount, options);
+    } else if (options->sort_by) {
+        // Sort rows, spilling sorted runs to temporary files for tables larger than the memory budget
+        sort_table_rows_from_stream(input_stream, output_stream, tallyCount, options);
+    } else if (options->distinct) {
+        // Drop rows whose key was already seen, keeping the first occurrence
+        distinct_table_rows_from_stream(input_stream, output_stream, tallyCount, options);
+    } else if (options->sample > 0 || options->sample_rate > 0) {
+        // Randomly sample rows, skipping the rest without tokenizing them
+        sample_table_rows_from_stream(input_stream, output_stream, tallyCount, options);
+    } else if (options->ndjson_all) {
+        // Stream every table's rows as lines, tagged with their table, without ever holding a whole table
+        parse_all_tables_streaming_rows_to_json_from_stream(input_stream, output_stream, tallyCount, options);
+    } else if (compact_mode && ((pos_selector > 0) || (id_selector != NULL))) {
         // When in compact row only mode and singular table mode, you don't need to wrap the rows with a json array
         // Also it gives us an opportunity to operate in streaming mode to process very very large PSV tables
-        parse_singular_table_streaming_rows_to_json_from_stream(input_stream, output_stream, tallyCount, pos_selector, id_selector, compact_mode);
+        parse_singular_table_streaming_rows_to_json_from_stream(input_stream, output_stream, tallyCount, options);
     } else {
         // This is normal table by table streaming. Minimum optimisation for this mode as we don't know the number of tables etc...
-        parse_table_to_json_from_stream(input_stream, output_stream, tallyCount, pos_selector, id_selector, compact_mode);
+        parse_table_to_json_from_stream(input_stream, output_stream, tallyCount, options);
+    }
+}
+
+// Parse the leading decimal digits of an unsigned number (no sign or spaces), leaving `end` after them
+static bool parse_digits(const char *str, uint64_t *value, char **end) {
+    if (!isdigit((unsigned char)*str)) {
+        return false;
+    }
+    errno = 0;
+    const unsigned long long result = strtoull(str, end, 10);
+    if (errno == ERANGE) {
+        return false;
+    }
+    *value = result;
+    return true;
+}
+
+// Parse an unsigned decimal number that makes up the whole string
+static bool parse_unsigned(const char *str, uint64_t *value) {
+    char *end = NULL;
+    return parse_digits(str, value, &end) && *end == '\0';
+}
+
+// Parse a byte size with an optional K, M or G suffix
+static bool parse_size(const char *str, size_t *size) {
+    char *end = NULL;
+    uint64_t value = 0;
+    if (!parse_digits(str, &value, &end)) {
+        return false;
     }
+
+    unsigned int shift = 0;
+    switch (*end) {
+        case '\0': break;
+        case 'k': case 'K': shift = 10; break;
+        case 'm': case 'M': shift = 20; break;
+        case 'g': case 'G': shift = 30; break;
+        default: return false;
+    }
+    if (shift > 0 && !(end[1] == '\0' || ((end[1] == 'b' || end[1] == 'B') && end[2] == '\0'))) {
+        return false;
+    }
+    if (value > (SIZE_MAX >> shift)) {
+        return false;
+    }
+    *size = (size_t)(value << shift);
+    return true;
 }
 
 static void usage(int code) {
@@ -130,6 +1158,50 @@ static void usage(int code) {
         "  -i, --id <id>           specify the ID of a single table to output\n"
         "  -t, --table <pos>       specify the position of a single table to output (must be a positive integer)\n"
         "  -c, --compact           output only the rows\n"
+        "      --format <fmt>      output format, json (default) or cbor (an RFC 8742 CBOR sequence of the same values)\n"
+        "                          or cbor-packed (cbor with repeated strings and values written as references)\n"
+        "                          or arrow (an Arrow IPC stream per table)\n"
+        "                          or parquet (a Parquet file of one table, with --id, --table or --join)\n"
+        "      --columnar          output each table's columns instead of its rows (with --format cbor, [int] and [float] columns as typed arrays)\n"
+        "      --ndjson-all        stream the rows of every table as one JSON object per line, each with a \"__table\" id field\n"
+        "      --rows-as-arrays    output each row as an array of its cells in column order, with the keys written once per table\n"
+        "      --batch-size <n>    most rows per record batch with --format arrow (default 65536)\n"
+        "      --npy <dir>         write each [int], [float] and [bool] column of one table to <dir>/<key>.npy instead,\n"
+        "                          with a <dir>/<key>.mask.npy of its empty and invalid cells\n"
+        "      --datetime-as <enc>\n"
+        "                          output [datetime] cells as iso (normalised UTC), epoch (seconds) or epoch_ms (milliseconds)\n"
+        "      --binary-as <enc>   output [hex], [base64] and [dataURI] cells decoded and re-encoded as hex, base64 or base64url\n"
+        "      --list              output one line per table with its header, row count and byte offsets (rows are not parsed)\n"
+        "      --schema            output one line per table with its header metadata and each column's type and CBOR tag\n"
+        "      --infer-types       infer the types of columns without a data annotation (integer, float, bool, datetime or uuid)\n"
+        "      --infer-rows <n>    number of leading rows to infer types from, or 0 to read each table twice and use all rows (default 1000)\n"
+        "      --count             output the number of rows per table\n"
+        "      --where <key><op><value>\n"
+        "                          only count rows matching the predicate, op is one of = != < <= > >= ~ (contains)\n"
+        "      --validate          report cells that do not match their column's data annotation (exit status 1 if any)\n"
+        "      --profile           output per column statistics (counts, min/max, mean, quantiles, distinct and top values)\n"
+        "      --group-by <keys>   group rows by the comma separated column keys\n"
+        "      --agg <aggregates>  aggregates to compute per group e.g. count,sum(col),min(col),max(col),avg(col)\n"
+        "      --window <size>     aggregate rows per time window of a [datetime] column e.g. 5m (with --agg and optionally --group-by)\n"
+        "      --window-slide <size>\n"
+        "                          start a new overlapping window every <size> instead of tumbling windows e.g. 1m\n"
+        "      --window-on <key>   date/time column to window on (default: the first [datetime] column)\n"
+        "      --sort-by <keys>    sort rows by the comma separated column keys, each optionally suffixed with :asc or :desc\n"
+        "      --top <k>           only output the first k rows in --sort-by order\n"
+        "      --join <left_id:key=right_id:key>\n"
+        "                          output the rows of two tables joined on equal key columns\n"
+        "      --join-build <side> table to load into memory for --join, left or right (default: the smaller table)\n"
+        "      --distinct          only output the first of any identical rows\n"
+        "      --distinct-on <keys>\n"
+        "                          only output the first row of each distinct value of the comma separated column keys\n"
+        "      --distinct-exact    keep distinct keys in memory to rule out 128-bit hash collisions\n"
+        "      --distinct-approx <size>\n"
+        "                          use a fixed size bloom filter for --distinct e.g. 64M (may drop some unique rows)\n"
+        "      --sample <n>        output a uniform random sample of n rows (in table order)\n"
+        "      --sample-rate <p>   output each row with probability p, between 0 and 1\n"
+        "      --seed <seed>       random seed for --sample and --sample-rate, for a repeatable sample\n"
+        "      --memory-budget <size>\n"
+        "                          memory to use before spilling to temporary files e.g. 512M (default 256M)\n"
         "  -h, --help              display this help message and exit\n"
         "  -v, --version           output version information and exit\n\n"
         "For more information, use '%s --help'.\n",
@@ -141,12 +1213,12 @@ static void usage(int code) {
 int main(int argc, char* argv[]) {
     progname = argv[0];
 
-    bool compact_mode = false;
+    PsvOptions options = {.writer = PSV_WRITER_OPTIONS_DEFAULT, .memory_budget = PSV_DEFAULT_MEMORY_BUDGET, .infer_rows = PSV_DEFAULT_INFER_ROWS};
 
     int opt;
-    int pos_selector = 0;
-    char* id_selector = NULL;
     char* output_file = NULL;
+    bool seed_set = false;
+    uint64_t value = 0;     // Scratch for parsing numeric option arguments
 
 #if 0
     log_set_level(LOG_DEBUG);
@@ -167,6 +1239,39 @@ int main(int argc, char* argv[]) {
         {"help",    no_argument,       0, 'h'},
         {"version", no_argument,       0, 'v'},
         {"debug",   no_argument,       0, 'd'},
+        {"profile", no_argument,       0, OPT_PROFILE},
+        {"validate", no_argument,      0, OPT_VALIDATE},
+        {"list", no_argument,          0, OPT_LIST},
+        {"format",  required_argument, 0, OPT_FORMAT},
+        {"columnar", no_argument,      0, OPT_COLUMNAR},
+        {"rows-as-arrays", no_argument, 0, OPT_ROWS_AS_ARRAYS},
+        {"ndjson-all", no_argument,    0, OPT_NDJSON_ALL},
+        {"batch-size", required_argument, 0, OPT_BATCH_SIZE},
+        {"npy", required_argument, 0, OPT_NPY},
+        {"binary-as", required_argument, 0, OPT_BINARY_AS},
+        {"datetime-as", required_argument, 0, OPT_DATETIME_AS},
+        {"schema", no_argument,        0, OPT_SCHEMA},
+        {"infer-types", no_argument,   0, OPT_INFER_TYPES},
+        {"infer-rows", required_argument, 0, OPT_INFER_ROWS},
+        {"count", no_argument,         0, OPT_COUNT},
+        {"where", required_argument,   0, OPT_WHERE},
+        {"group-by", required_argument, 0, OPT_GROUP_BY},
+        {"agg",     required_argument, 0, OPT_AGG},
+        {"window",  required_argument, 0, OPT_WINDOW},
+        {"window-slide", required_argument, 0, OPT_WINDOW_SLIDE},
+        {"window-on", required_argument, 0, OPT_WINDOW_ON},
+        {"memory-budget", required_argument, 0, OPT_MEMORY_BUDGET},
+        {"join",    required_argument, 0, OPT_JOIN},
+        {"join-build", required_argument, 0, OPT_JOIN_BUILD},
+        {"sort-by", required_argument, 0, OPT_SORT_BY},
+        {"top",     required_argument, 0, OPT_TOP},
+        {"distinct", no_argument,      0, OPT_DISTINCT},
+        {"distinct-on", required_argument, 0, OPT_DISTINCT_ON},
+        {"distinct-exact", no_argument, 0, OPT_DISTINCT_EXACT},
+        {"distinct-approx", required_argument, 0, OPT_DISTINCT_APPROX},
+        {"sample",  required_argument, 0, OPT_SAMPLE},
+        {"sample-rate", required_argument, 0, OPT_SAMPLE_RATE},
+        {"seed",    required_argument, 0, OPT_SEED},
         {0, 0, 0, 0}
     };
 
@@ -178,19 +1283,19 @@ int main(int argc, char* argv[]) {
                 break;
             case 'i':
                 // ID based single table mode
-                id_selector = optarg;
+                options.id_selector = optarg;
                 break;
             case 't':
                 // Table Position Single Table
-                pos_selector = atoi(optarg);
-                if (pos_selector <= 0) {
+                options.pos_selector = atoi(optarg);
+                if (options.pos_selector <= 0) {
                     fprintf(stderr, "-t must be a positive integer\n");
                     usage(1);
                 }
                 break;
             case 'c':
                 // Compact Output Mode
-                compact_mode = true;
+                options.compact_mode = true;
                 break;
             case 'h':
                 // Help / Usage
@@ -205,6 +1310,188 @@ int main(int argc, char* argv[]) {
                 log_set_level(LOG_DEBUG);
                 log_set_quiet(false);
                 break;
+            case OPT_FORMAT:
+                // Output Format
+                if (!psv_output_format_parse(optarg, &options.writer.format)) {
+                    fprintf(stderr, "--format must be json, cbor, cbor-packed, arrow or parquet\n");
+                    usage(1);
+                }
+                break;
+            case OPT_COLUMNAR:
+                // Columnar Output
+                options.writer.columnar = true;
+                break;
+            case OPT_NDJSON_ALL:
+                // Stream Rows Of Every Table
+                options.ndjson_all = true;
+                options.writer.row_table_tags = true;
+                break;
+            case OPT_ROWS_AS_ARRAYS:
+                // Rows As Positional Arrays
+                options.writer.rows_as_arrays = true;
+                break;
+            case OPT_BATCH_SIZE: {
+                // Arrow Record Batch Size
+                uint64_t batch_size = 0;
+                if (!parse_unsigned(optarg, &batch_size) || batch_size == 0 || batch_size > INT32_MAX) {
+                    fprintf(stderr, "--batch-size must be a positive integer\n");
+                    usage(1);
+                }
+                options.writer.batch_size = batch_size;
+            } break;
+            case OPT_NPY:
+                // NumPy Output Of Numeric Columns
+                options.writer.format = PSV_OUTPUT_NPY;
+                options.writer.npy_directory = optarg;
+                break;
+            case OPT_BINARY_AS:
+                // Re-encode Binary Cells In JSON Output
+                if (!psv_binary_encoding_parse(optarg, &options.writer.binary_encoding)) {
+                    fprintf(stderr, "--binary-as must be text, hex, base64 or base64url\n");
+                    usage(1);
+                }
+                break;
+            case OPT_DATETIME_AS:
+                // Normalise Date/Time Cells In JSON Output
+                if (!psv_datetime_encoding_parse(optarg, &options.writer.datetime_encoding)) {
+                    fprintf(stderr, "--datetime-as must be text, iso, epoch or epoch_ms\n");
+                    usage(1);
+                }
+                break;
+            case OPT_LIST:
+                // Table Listing Mode
+                options.list = true;
+                break;
+            case OPT_INFER_TYPES:
+                // Type Inference For Unannotated Columns
+                options.infer_types = true;
+                break;
+            case OPT_INFER_ROWS:
+                // Number Of Rows To Infer Types From
+                if (!parse_unsigned(optarg, &value)) {
+                    fprintf(stderr, "--infer-rows must be a non negative integer\n");
+                    usage(1);
+                }
+                options.infer_types = true;
+                options.infer_rows = value;
+                break;
+            case OPT_SCHEMA:
+                // Schema Mode
+                options.schema = true;
+                break;
+            case OPT_COUNT:
+                // Row Counting Mode
+                options.count = true;
+                break;
+            case OPT_WHERE:
+                // Row Counting Filter
+                options.where = optarg;
+                break;
+            case OPT_VALIDATE:
+                // Validation Mode
+                options.validate = true;
+                break;
+            case OPT_PROFILE:
+                // Column Profiling Mode
+                options.profile = true;
+                break;
+            case OPT_GROUP_BY:
+                // Group By Aggregation Mode
+                options.group_by = optarg;
+                break;
+            case OPT_AGG:
+                // Aggregates To Compute Per Group
+                options.aggregates = optarg;
+                break;
+            case OPT_WINDOW:
+                // Window Aggregation Mode
+                options.window = optarg;
+                break;
+            case OPT_WINDOW_SLIDE:
+                // Sliding Window Step
+                options.window_slide = optarg;
+                break;
+            case OPT_WINDOW_ON:
+                // Window Date/Time Column
+                options.window_on = optarg;
+                break;
+            case OPT_SORT_BY:
+                // Sort Mode
+                options.sort_by = optarg;
+                break;
+            case OPT_TOP:
+                // Top K Rows In Sort Order
+                if (!parse_unsigned(optarg, &value) || value == 0 || value > SIZE_MAX) {
+                    fprintf(stderr, "--top must be a positive integer\n");
+                    usage(1);
+                }
+                options.top = value;
+                break;
+            case OPT_JOIN:
+                // Hash Join Mode
+                options.join = optarg;
+                break;
+            case OPT_JOIN_BUILD:
+                // Hash Join Build Side
+                if (strcmp(optarg, "left") != 0 && strcmp(optarg, "right") != 0) {
+                    fprintf(stderr, "--join-build must be left or right\n");
+                    usage(1);
+                }
+                options.join_build = optarg;
+                break;
+            case OPT_DISTINCT:
+                // Distinct Mode On Whole Rows
+                options.distinct = true;
+                break;
+            case OPT_DISTINCT_ON:
+                // Distinct Mode On Key Columns
+                options.distinct = true;
+                options.distinct_on = optarg;
+                break;
+            case OPT_DISTINCT_EXACT:
+                // Verify Distinct Keys Byte By Byte
+                options.distinct_exact = true;
+                break;
+            case OPT_DISTINCT_APPROX:
+                // Bounded Memory Bloom Filter Distinct
+                if (!parse_size(optarg, &options.distinct_approx) || options.distinct_approx == 0) {
+                    fprintf(stderr, "--distinct-approx must be a size such as 64M\n");
+                    usage(1);
+                }
+                break;
+            case OPT_SAMPLE:
+                // Reservoir Sampling Mode
+                if (!parse_unsigned(optarg, &value) || value == 0 || value > SIZE_MAX) {
+                    fprintf(stderr, "--sample must be a positive integer\n");
+                    usage(1);
+                }
+                options.sample = value;
+                break;
+            case OPT_SAMPLE_RATE: {
+                // Bernoulli Sampling Mode
+                char *end = NULL;
+                options.sample_rate = strtod(optarg, &end);
+                if (end == optarg || *end != '\0' || !(options.sample_rate > 0 && options.sample_rate <= 1)) {
+                    fprintf(stderr, "--sample-rate must be greater than 0 and at most 1\n");
+                    usage(1);
+                }
+            } break;
+            case OPT_SEED:
+                // Random Seed
+                if (!parse_unsigned(optarg, &options.seed)) {
+                    fprintf(stderr, "--seed must be a non negative integer below 2^64\n");
+                    usage(1);
+                }
+                seed_set = true;
+                break;
+            case OPT_MEMORY_BUDGET:
+                // Memory Budget Before Spilling To Temporary Files
+                if (!parse_size(optarg, &options.memory_budget)) {
+                    fprintf(stderr, "--memory-budget must be a size such as 512M\n");
+                    usage(1);
+                }
+                options.writer.row_group_budget = options.memory_budget; // Parquet row groups are buffered in memory
+                break;
             case '?':
                 // Unknown Argument
                 usage(1);
@@ -215,6 +1502,115 @@ int main(int argc, char* argv[]) {
         }
     }
 
+    // Each of these modes decides what is output, so at most one of them can be used at a time
+    const struct {
+        bool enabled;
+        const char *name;
+    } modes[] = {
+        {options.list, "--list"},
+        {options.schema, "--schema"},
+        {options.count, "--count"},
+        {options.validate, "--validate"},
+        {options.profile, "--profile"},
+        {options.window != NULL, "--window"},
+        {options.window == NULL && (options.group_by != NULL || options.aggregates != NULL), "--group-by/--agg"},
+        {options.sort_by != NULL, "--sort-by"},
+        {options.distinct, "--distinct/--distinct-on"},
+        {options.sample > 0 || options.sample_rate > 0, "--sample/--sample-rate"},
+        {options.join != NULL, "--join"},
+    };
+    const char *mode = NULL;
+    for (size_t i = 0; i < sizeof(modes) / sizeof(modes[0]); i++) {
+        if (!modes[i].enabled) {
+            continue;
+        }
+        if (mode != NULL) {
+            fprintf(stderr, "%s and %s cannot be used together\n", mode, modes[i].name);
+            usage(1);
+        }
+        mode = modes[i].name;
+    }
+
+    if (options.where != NULL && !options.count) {
+        fprintf(stderr, "--where requires --count\n");
+        usage(1);
+    }
+
+    if (options.top > 0 && options.sort_by == NULL) {
+        fprintf(stderr, "--top requires --sort-by\n");
+        usage(1);
+    }
+
+    if (options.sample > 0 && options.sample_rate > 0) {
+        fprintf(stderr, "--sample and --sample-rate cannot be used together\n");
+        usage(1);
+    }
+
+    if (!seed_set) {
+        // Different sample on every run unless a seed is given
+        options.seed = (uint64_t)time(NULL) ^ ((uint64_t)getpid() << 32);
+    }
+
+    if ((options.window_slide || options.window_on) && options.window == NULL) {
+        fprintf(stderr, "--window-slide and --window-on require --window\n");
+        usage(1);
+    }
+
+    if ((options.distinct_exact || options.distinct_approx > 0) && !options.distinct) {
+        fprintf(stderr, "--distinct-exact and --distinct-approx require --distinct or --distinct-on\n");
+        usage(1);
+    }
+
+    if (options.distinct_exact && options.distinct_approx > 0) {
+        fprintf(stderr, "--distinct-exact and --distinct-approx cannot be used together\n");
+        usage(1);
+    }
+
+    if (options.writer.columnar && options.writer.format != PSV_OUTPUT_JSON && options.writer.format != PSV_OUTPUT_CBOR) {
+        fprintf(stderr, "--columnar requires --format json or cbor\n");
+        usage(1);
+    }
+
+    if (options.ndjson_all && (options.writer.format != PSV_OUTPUT_JSON || options.writer.columnar || options.writer.rows_as_arrays)) {
+        fprintf(stderr, "--ndjson-all only applies to JSON row objects, not --format, --columnar or --rows-as-arrays\n");
+        usage(1);
+    }
+
+    if (options.ndjson_all && (options.list || options.schema || options.count || options.validate || options.profile)) {
+        fprintf(stderr, "--ndjson-all only applies to table rows, not --list, --schema, --count, --validate or --profile\n");
+        usage(1);
+    }
+
+    if (options.writer.rows_as_arrays && (options.writer.format != PSV_OUTPUT_JSON || options.writer.columnar)) {
+        fprintf(stderr, "--rows-as-arrays only applies to JSON rows, not --format or --columnar\n");
+        usage(1);
+    }
+
+    if ((options.writer.format == PSV_OUTPUT_ARROW || options.writer.format == PSV_OUTPUT_PARQUET) && (options.list || options.schema || options.count || options.validate || options.profile)) {
+        fprintf(stderr, "--format %s only applies to table rows, not --list, --schema, --count, --validate or --profile\n", (options.writer.format == PSV_OUTPUT_ARROW) ? "arrow" : "parquet");
+        usage(1);
+    }
+
+    if (options.writer.format == PSV_OUTPUT_PARQUET && !is_single_table_mode(&options) && !options.join) {
+        fprintf(stderr, "--format parquet writes a single table, so it needs --id, --table or --join\n");
+        usage(1);
+    }
+
+    if (options.writer.npy_directory != NULL) {
+        if (options.writer.format != PSV_OUTPUT_NPY) {
+            fprintf(stderr, "--npy cannot be used with --format\n");
+            usage(1);
+        }
+        if (options.list || options.schema || options.count || options.validate || options.profile) {
+            fprintf(stderr, "--npy only applies to table rows, not --list, --schema, --count, --validate or --profile\n");
+            usage(1);
+        }
+        if (!is_single_table_mode(&options) && !options.join) {
+            fprintf(stderr, "--npy writes the columns of a single table, so it needs --id, --table or --join\n");
+            usage(1);
+        }
+    }
+
     log_info("%s-%s", PACKAGE_NAME, PACKAGE_VERSION);
 
     // Prep output stream
@@ -229,7 +1625,10 @@ int main(int argc, char* argv[]) {
 
     // Process input files
     unsigned int tallyCount = 0;
-    if (optind < argc) {
+    if (options.join) {
+        // Join mode reads its input twice, so it manages its own input streams
+        join_tables_from_files(argv + optind, argc - optind, output_stream, &options);
+    } else if (optind < argc) {
         for (int i = optind; i < argc; i++) {
             const char *file_path = argv[i];
 
@@ -241,13 +1640,22 @@ int main(int argc, char* argv[]) {
                 exit(1);
             }
 
+            if (options.infer_types) {
+                // Type inference reads each table's rows twice
+                FILE *seekable_file = open_seekable_stream(input_file);
+                if (seekable_file != input_file) {
+                    fclose(input_file);
+                    input_file = seekable_file;
+                }
+            }
+
             // No input files provided, read from stdin
-            parse_table_from_stream(input_file, output_stream, &tallyCount, pos_selector, id_selector, compact_mode);
+            parse_table_from_stream(input_file, output_stream, &tallyCount, &options);
 
             // Table Found?
             if (tallyCount > 0) {
                 // Check if in single table search mode
-                if ((pos_selector > 0) || (id_selector != NULL)) {
+                if (is_single_table_mode(&options)) {
                     break;
                 }
             }
@@ -257,12 +1665,16 @@ int main(int argc, char* argv[]) {
     } else {
         // No input files provided, read from stdin
         log_info("Processing stdin");
-        parse_table_from_stream(stdin, output_stream, &tallyCount, pos_selector, id_selector, compact_mode);
+        FILE *input_stream = options.infer_types ? open_seekable_stream(stdin) : stdin;
+        parse_table_from_stream(input_stream, output_stream, &tallyCount, &options);
+        if (input_stream != stdin) {
+            fclose(input_stream);
+        }
     }
 
     if (output_file) {
         fclose(output_stream);
     }
 
-    return 0;
+    return (num_validation_errors > 0) ? 1 : 0;
 }
\ No newline at end of file
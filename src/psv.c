@@ -47,7 +47,10 @@ const DataAnnotationMapping data_annotation_mappings[] = {
 
     // Semantic Tag
     {"datetime", PSV_DATA_ANNOTATION_DATETIME, CBOR_TAG_STD_DATE_TIME_STRING},
-    {"uuid", PSV_DATA_ANNOTATION_DATETIME, CBOR_TAG_STD_DATE_TIME_STRING},
+    {"uuid", PSV_DATA_ANNOTATION_UUID, CBOR_TAG_BINARY_UUID},
+
+    // Encoded Payloads
+    {"cbor", PSV_DATA_ANNOTATION_CBOR, CBOR_TAG_ENCODED_CBOR_DATA_ITEM},
 
 };
 const size_t num_data_annotation_mappings = sizeof(data_annotation_mappings) / sizeof(data_annotation_mappings[0]);
@@ -90,6 +93,37 @@ static void match_data_annotation_types(PsvDataAnnotationField *data_annotation_
     }
 }
 
+/**
+ * @brief Compiles the decode pipeline of a header column from its data annotations.
+ *
+ * Data annotations are applied left to right, so the pipeline is the leading run of binary
+ * annotations (each decoding the text produced by the previous stage into bytes), optionally
+ * followed by a [cbor] annotation that decodes the bytes into a CBOR data item. Unrecognised
+ * annotations are skipped, and any other recognised annotation ends the pipeline.
+ *
+ * @param header_metadata The header column, with its data annotation types already matched.
+ */
+static void compile_decode_pipeline(PsvHeaderMetadataField *header_metadata) {
+    header_metadata->num_decode_stages = 0;
+    for (size_t i = 0; i < header_metadata->data_annotation_tag_size; i++) {
+        const PsvDataAnnotationType type = header_metadata->data_annotation_tags[i].type;
+        if (type == PSV_DATA_ANNOTATION_UNKNOWN) {
+            continue;
+        }
+
+        const bool binary = type == PSV_DATA_ANNOTATION_HEX || type == PSV_DATA_ANNOTATION_BASE64 || type == PSV_DATA_ANNOTATION_DATA_URI;
+        const bool has_bytes = header_metadata->num_decode_stages > 0;
+        if ((!binary && !(type == PSV_DATA_ANNOTATION_CBOR && has_bytes)) || header_metadata->num_decode_stages == PSV_DECODE_STAGES_MAX) {
+            break;
+        }
+
+        header_metadata->decode_stages[header_metadata->num_decode_stages++] = type;
+        if (type == PSV_DATA_ANNOTATION_CBOR) {
+            break;
+        }
+    }
+}
+
 /**
  * @brief Generates a JSON key from a header string.
  *
@@ -130,7 +164,7 @@ static char* generateJSONKey(const char* header, char* jsonKeyBuffer, size_t buf
             c = '_';
 
         // Ensure only one underscore between words and that we don't start with underscore
-        if (c == '_' && ((writePtr == NULL || writePtr[-1] == '_') || (writePtr == jsonKeyBuffer)))
+        if (c == '_' && (writePtr == jsonKeyBuffer || writePtr[-1] == '_'))
             continue;
 
         *writePtr++ = c;
@@ -138,7 +172,7 @@ static char* generateJSONKey(const char* header, char* jsonKeyBuffer, size_t buf
     }
 
     // Remove trailing underscore, if any
-    if (writePtr > 0 && *(writePtr - 1) == '_') {
+    if (writePtr > jsonKeyBuffer && *(writePtr - 1) == '_') {
         // Trailing _ found, end the string at the _
         *(writePtr - 1) = '\0';
     } else {
@@ -190,8 +224,8 @@ static char *tokenize_escaped_delim(char *str, char delim, char **tokenization_s
         if (*token_end == '\\') {
             if (*(token_end + 1) == '\\' || *(token_end + 1) == delim || ispunct(*(token_end + 1))) {
                 // Handle escaped backslash, delimiter and punctuation
+                // (the escaped character is stepped over below, so it is never taken as a delimiter)
                 memmove(token_end, token_end + 1, strlen(token_end + 1) + 1);
-                token_end++;
             }
         } else if (*token_end == delim) {
             // Found delimiter
@@ -482,6 +516,198 @@ void psv_free_table(PsvTable **tablePtr) {
     *tablePtr = NULL;
 }
 
+/**
+ * @brief Allocates an empty PsvTable structure.
+ *
+ * This function creates a table with no headers and no data rows. It is used by
+ * processing modes that synthesize a new table (e.g. aggregation results or joined
+ * tables) which is then populated with psv_table_add_header().
+ *
+ * @param id The ID to assign to the new table.
+ * @return A pointer to the newly allocated PsvTable structure.
+ */
+PsvTable *psv_create_table(const char *id) {
+    PsvTable *table = malloc(sizeof(PsvTable));
+    assert(table != NULL);
+    *table = (PsvTable){0};
+
+    snprintf(table->id, PSV_TABLE_ID_MAX, "%s", id);
+    table->parsing_state = PSV_TABLE_PARSING_DATA_ROW;
+    table->header_offset = -1;
+    table->data_offset = -1;
+    table->row_offset = -1;
+    table->end_offset = -1;
+    return table;
+}
+
+/**
+ * @brief Appends a header column to a PsvTable structure.
+ *
+ * This function parses a single raw header cell (e.g. `Age [int]` or `ID [uuid] {#id}`)
+ * in the same way as a Markdown table header, deriving its JSON key and data annotations,
+ * and appends it to the table's header metadata.
+ *
+ * @param table Pointer to the PsvTable structure to append the header column to.
+ * @param raw_header The trimmed raw header string.
+ * @return A pointer to the newly added header metadata field. The pointer is only valid
+ *         until the next header column is added to the table.
+ */
+PsvHeaderMetadataField *psv_table_add_header(PsvTable *table, const char *raw_header) {
+    const size_t raw_header_size = strlen(raw_header) + 1;
+
+    table->header_metadata = realloc(table->header_metadata, (table->num_headers + 1) * sizeof(PsvHeaderMetadataField));
+    assert(table->header_metadata != NULL);
+
+    PsvHeaderMetadataField *header_metadata = &table->header_metadata[table->num_headers];
+    *header_metadata = (PsvHeaderMetadataField){0};
+
+    // Raw Headers
+    header_metadata->raw_header = malloc(raw_header_size * sizeof(char));
+    assert(header_metadata->raw_header != NULL);
+    memcpy(header_metadata->raw_header, raw_header, raw_header_size);
+
+    // Json Keys
+    if (!parse_consistent_attribute_syntax_id(raw_header, header_metadata->id, (PSV_HEADER_ID_MAX) * sizeof(char))) {
+        // Consistent Attribute Syntax not found or does not contain id override
+        // Use heuristics to generate a reasonable json key
+        generateJSONKey(raw_header, header_metadata->id, PSV_HEADER_ID_MAX);
+    }
+
+    // Data Annotations
+    capture_data_annotations(raw_header, &header_metadata->data_annotation_tags, &header_metadata->data_annotation_tag_size);
+    match_data_annotation_types(header_metadata->data_annotation_tags, header_metadata->data_annotation_tag_size);
+    compile_decode_pipeline(header_metadata);
+
+    table->num_headers++;
+    return header_metadata;
+}
+
+/**
+ * @brief Finds the column index of a header by its JSON key.
+ *
+ * @param table Pointer to the PsvTable structure to search.
+ * @param key The JSON key of the header column (e.g. `age` for `Age [int]`).
+ * @return The index of the matching header column, or -1 if no column matches.
+ */
+int psv_find_header_column(PsvTable *table, const char *key) {
+    for (int i = 0; i < table->num_headers; i++) {
+        if (strcmp(table->header_metadata[i].id, key) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+/**
+ * @brief Resolves the basic value type of a header column.
+ *
+ * This function walks the column's data annotations from left to right and returns
+ * the first basic JSON compatible type found (text, integer, float or bool).
+ * Columns without any such annotation use their inferred type if it is a basic type,
+ * and otherwise fall back to text.
+ *
+ * @param table Pointer to the PsvTable structure.
+ * @param header_column The index of the header column.
+ * @return The basic PsvDataAnnotationType of the column.
+ */
+PsvDataAnnotationType psv_get_basic_type(PsvTable *table, size_t header_column) {
+    const PsvHeaderMetadataField *header_metadata = &table->header_metadata[header_column];
+    if (header_metadata->data_annotation_tag_size > 0) {
+        for (int i = 0; i < header_metadata->data_annotation_tag_size; i++) {
+            const PsvDataAnnotationType base_type = header_metadata->data_annotation_tags[i].type;
+            if (base_type == PSV_DATA_ANNOTATION_INTEGER)
+                return base_type;
+
+            if (base_type == PSV_DATA_ANNOTATION_FLOAT)
+                return base_type;
+
+            if (base_type == PSV_DATA_ANNOTATION_BOOL)
+                return base_type;
+
+            if (base_type == PSV_DATA_ANNOTATION_TEXT)
+                return base_type;
+        }
+    }
+
+    switch (header_metadata->inferred_type) {
+        case PSV_DATA_ANNOTATION_INTEGER:
+        case PSV_DATA_ANNOTATION_FLOAT:
+        case PSV_DATA_ANNOTATION_BOOL:
+            return header_metadata->inferred_type;
+        default:
+            return PSV_DATA_ANNOTATION_TEXT;
+    }
+}
+
+/**
+ * @brief Gets the name of a data annotation type, e.g. for describing a table's schema.
+ *
+ * @param type The data annotation type.
+ * @return A static string naming the type.
+ */
+const char *psv_data_annotation_type_name(PsvDataAnnotationType type) {
+    static const char *const names[PSV_DATA_ANNOTATION_MAX] = {
+        [PSV_DATA_ANNOTATION_UNKNOWN] = "unknown",
+        [PSV_DATA_ANNOTATION_TEXT] = "text",
+        [PSV_DATA_ANNOTATION_INTEGER] = "integer",
+        [PSV_DATA_ANNOTATION_FLOAT] = "float",
+        [PSV_DATA_ANNOTATION_BOOL] = "bool",
+        [PSV_DATA_ANNOTATION_HEX] = "hex",
+        [PSV_DATA_ANNOTATION_BASE64] = "base64",
+        [PSV_DATA_ANNOTATION_DATA_URI] = "dataURI",
+        [PSV_DATA_ANNOTATION_DATETIME] = "datetime",
+        [PSV_DATA_ANNOTATION_UUID] = "uuid",
+        [PSV_DATA_ANNOTATION_CBOR] = "cbor",
+    };
+    return (type >= 0 && type < PSV_DATA_ANNOTATION_MAX && names[type] != NULL) ? names[type] : "unknown";
+}
+
+/**
+ * @brief Gets the CBOR semantic tag of a data annotation type.
+ *
+ * @param type The data annotation type.
+ * @return The CBOR tag, or CBOR_TAG_INVALID_64BIT if the type has none.
+ */
+cbor_tag_t psv_data_annotation_type_cbor_tag(PsvDataAnnotationType type) {
+    for (size_t i = 0; i < num_data_annotation_mappings; i++) {
+        if (data_annotation_mappings[i].annotation_type == type) {
+            return data_annotation_mappings[i].tag;
+        }
+    }
+    return CBOR_TAG_INVALID_64BIT;
+}
+
+/**
+ * @brief Checks whether a column carries a given data annotation anywhere in its annotation stack.
+ *
+ * A column's inferred type counts as an annotation, so e.g. an unannotated column of timestamps
+ * can be windowed on once its types have been inferred.
+ *
+ * @param table Pointer to the PsvTable structure.
+ * @param header_column The index of the header column.
+ * @param type The data annotation to look for.
+ * @return true if the column is annotated with the type, false otherwise.
+ */
+bool psv_has_data_annotation(PsvTable *table, size_t header_column, PsvDataAnnotationType type) {
+    const PsvHeaderMetadataField *header_metadata = &table->header_metadata[header_column];
+    for (int i = 0; i < header_metadata->data_annotation_tag_size; i++) {
+        if (header_metadata->data_annotation_tags[i].type == type) {
+            return true;
+        }
+    }
+    return type != PSV_DATA_ANNOTATION_UNKNOWN && header_metadata->inferred_type == type;
+}
+
+/**
+ * @brief Interprets a `[bool]` data cell.
+ *
+ * @param data The trimmed cell string.
+ * @return true if the cell holds one of the recognised true values (true, yes, active, y), false otherwise.
+ */
+bool psv_data_is_true(const char *data) {
+    return strcmp(data, "true") == 0 || strcmp(data, "yes") == 0 || strcmp(data, "active") == 0 || strcmp(data, "y") == 0;
+}
+
 /**
  * @brief Parses a table header from a file stream and constructs a PsvTable structure.
  *
@@ -506,8 +732,16 @@ PsvTable * psv_parse_table_header(FILE *input, char *defaultTableID) {
     char *line = NULL;
     size_t len = 0;
 
+    // Byte offsets are tracked from the line lengths, so the stream position is only queried once
+    off_t next_line_offset = ftello(input);
+    const bool seekable = (next_line_offset >= 0);
+
     // Loop through lines in the input stream
     while ((read = getline(&line, &len, input)) != -1) {
+        const off_t line_offset = next_line_offset;
+        if (seekable) {
+            next_line_offset += read;
+        }
 
         // Check if the last character is a newline
         if (read > 0 && line[read - 1] == '\n') {
@@ -550,40 +784,14 @@ PsvTable * psv_parse_table_header(FILE *input, char *defaultTableID) {
                 }
 
                 assert(table->header_metadata == NULL);
+                table->header_offset = seekable ? line_offset : -1;
 
                 // Split and Cache header
                 char *tokenization_state = NULL;
                 char *token;
                 while ((token = tokenize_escaped_delim(trimmed_psv_row, '|', &tokenization_state)) != NULL) {
                     // Got Header Column
-                    const char * full_header_buffer = trim_whitespace(token);
-                    const size_t full_header_buffer_size = strlen(full_header_buffer) + 1;
-
-                    table->header_metadata = realloc(table->header_metadata, (table->num_headers + 1) * sizeof(PsvHeaderMetadataField));
-                    assert(table->header_metadata != NULL);
-
-                    table->header_metadata[table->num_headers] = (PsvHeaderMetadataField){0};
-
-                    PsvHeaderMetadataField *header_metadata = &table->header_metadata[table->num_headers];
-                    *header_metadata = (PsvHeaderMetadataField){0};
-
-                    // Raw Headers
-                    header_metadata->raw_header = malloc(full_header_buffer_size * sizeof(char));
-                    assert(header_metadata->raw_header != NULL);
-                    memcpy(header_metadata->raw_header, full_header_buffer, full_header_buffer_size);
-
-                    // Json Keys
-                    if (!parse_consistent_attribute_syntax_id(full_header_buffer, header_metadata->id, (PSV_HEADER_ID_MAX) * sizeof(char))) {
-                        // Consistent Attribute Syntax not found or does not contain id override
-                        // Use heuristics to generate a reasonable json key
-                        generateJSONKey(full_header_buffer, header_metadata->id, PSV_HEADER_ID_MAX);
-                    }
-
-                    // Data Annotations
-                    capture_data_annotations(full_header_buffer, &header_metadata->data_annotation_tags, &header_metadata->data_annotation_tag_size);
-                    match_data_annotation_types(header_metadata->data_annotation_tags, header_metadata->data_annotation_tag_size);
-
-                    table->num_headers++;
+                    psv_table_add_header(table, trim_whitespace(token));
                 }
 
                 // Diagnostics Printout of Header Content
@@ -643,6 +851,9 @@ PsvTable * psv_parse_table_header(FILE *input, char *defaultTableID) {
                     // It's most likely a markdown table
                     // We can now safely start parsing the data rows
                     table->parsing_state = PSV_TABLE_PARSING_DATA_ROW;
+                    table->data_offset = seekable ? next_line_offset : -1;
+                    table->row_offset = table->data_offset;
+                    table->end_offset = -1;
                 } else {
                     // Mismatch with headers, free the allocated memory
                     table->parsing_state = PSV_TABLE_PARSING_SCANNING;
@@ -679,6 +890,32 @@ PsvTable * psv_parse_table_header(FILE *input, char *defaultTableID) {
     return table;
 }
 
+/**
+ * @brief Reads the next line of a table body, keeping track of its byte offset.
+ *
+ * @param input The file stream to read from.
+ * @param table Pointer to the table being parsed. Its parsing state is set to
+ *              PSV_TABLE_PARSING_END if the line is not a data row.
+ * @param line Pointer to a getline() buffer.
+ * @param len Pointer to the getline() buffer size.
+ * @return The length of the data row line, or -1 if the table has ended.
+ */
+static ssize_t read_table_row_line(FILE *input, PsvTable *table, char **line, size_t *len) {
+    const off_t line_offset = table->row_offset;
+    const ssize_t read = getline(line, len, input);
+    if (read != -1 && table->row_offset >= 0) {
+        table->row_offset += read;
+    }
+
+    if (read == -1 || (*line)[0] != '|') {
+        // End of Table detected
+        table->parsing_state = PSV_TABLE_PARSING_END;
+        table->end_offset = line_offset;
+        return -1;
+    }
+    return read;
+}
+
 /**
  * @brief Parses a single data row from a file stream and constructs a PsvDataRow.
  *
@@ -705,38 +942,33 @@ PsvDataRow psv_parse_table_row(FILE *input, PsvTable *table) {
     ssize_t read;
 
     // Read a line from the input stream
-    if ((read = getline(&line, &len, input)) != -1) {
-        if (line[0] == '|') {
-            // Trim '|' on the right-hand side
-            for (int i = read - 1; i > 0; i--) {
-                if (line[i] == '|') {
-                    line[i] = '\0';
-                    break;
-                }
-            }
-
-            // Allocate memory for the data row and initialize with NULL
-            data_row = malloc(table->num_headers * sizeof(char *));
-            for (int i = 0 ; i < table->num_headers ; i++) {
-                data_row[i] = NULL;
+    if ((read = read_table_row_line(input, table, &line, &len)) != -1) {
+        // Trim '|' on the right-hand side
+        for (int i = read - 1; i > 0; i--) {
+            if (line[i] == '|') {
+                line[i] = '\0';
+                break;
             }
+        }
 
-            // Split and record each cell
-            char *tokenization_state = NULL;
-            for (int i = 0 ; i < table->num_headers ; i++) {
-                char *token = tokenize_escaped_delim(line + 1, '|', &tokenization_state);
-                token = trim_whitespace(token);
-                if ((token == NULL) || (*token == '\0')) {
-                    continue;;
-                }
+        // Allocate memory for the data row and initialize with NULL
+        data_row = malloc(table->num_headers * sizeof(char *));
+        for (int i = 0 ; i < table->num_headers ; i++) {
+            data_row[i] = NULL;
+        }
 
-                // Allocate memory for each data cell and copy the trimmed token
-                data_row[i] = malloc((strlen(token) + 1) * sizeof(char));
-                strcpy(data_row[i], token);
+        // Split and record each cell
+        char *tokenization_state = NULL;
+        for (int i = 0 ; i < table->num_headers ; i++) {
+            char *token = tokenize_escaped_delim(line + 1, '|', &tokenization_state);
+            token = trim_whitespace(token);
+            if ((token == NULL) || (*token == '\0')) {
+                continue;;
             }
-        } else {
-            // End of Table detected
-            table->parsing_state = PSV_TABLE_PARSING_END;
+
+            // Allocate memory for each data cell and copy the trimmed token
+            data_row[i] = malloc((strlen(token) + 1) * sizeof(char));
+            strcpy(data_row[i], token);
         }
     }
 
@@ -786,24 +1018,224 @@ bool psv_parse_skip_table_row(FILE *input, PsvTable *table) {
     if (table->parsing_state != PSV_TABLE_PARSING_DATA_ROW)
         return false;
 
-    bool row_found = false;
     char *line = NULL;
     size_t len = 0;
-    if (getline(&line, &len, input) != -1) {
-        if (line[0] == '|') {
-            // Is a data row
-            row_found = true;
-        } else {
-            // End of Table detected
-            table->parsing_state = PSV_TABLE_PARSING_END;
-        }
-    }
+    const bool row_found = (read_table_row_line(input, table, &line, &len) != -1);
 
     // Release getline's buffer
     free(line);
     return row_found;
 }
 
+/**
+ * @brief Repositions the stream back to the first data row of a table.
+ *
+ * This lets a table body be read twice (e.g. once to infer column types and once to convert it).
+ * It is only possible on seekable streams.
+ *
+ * @param input Pointer to the input file stream.
+ * @param table Pointer to the PsvTable structure whose header has been parsed.
+ * @return true if the table can be read again from its first row, false otherwise.
+ */
+bool psv_parse_rewind_table_rows(FILE *input, PsvTable *table) {
+    if (table->data_offset < 0 || fseeko(input, table->data_offset, SEEK_SET) != 0) {
+        return false;
+    }
+
+    table->parsing_state = PSV_TABLE_PARSING_DATA_ROW;
+    table->row_offset = table->data_offset;
+    table->end_offset = -1;
+    return true;
+}
+
+/**
+ * @brief Skips all remaining rows of a table without tokenizing them.
+ *
+ * Seekable streams are scanned a block at a time with memchr() for line starts, and the stream
+ * is then repositioned just after the line that ended the table (as if it had been read line by
+ * line). Other streams fall back to reading lines into a single reused buffer.
+ *
+ * @param input Pointer to the input file stream.
+ * @param table Pointer to the PsvTable structure representing the table being parsed.
+ * @return The number of data rows skipped.
+ */
+size_t psv_parse_skip_table_rows(FILE *input, PsvTable *table) {
+    size_t num_rows = 0;
+
+    // Cannot skip rows if not in data row parsing state
+    if (table->parsing_state != PSV_TABLE_PARSING_DATA_ROW)
+        return 0;
+
+    if (table->row_offset < 0) {
+        char *line = NULL;
+        size_t len = 0;
+        while (read_table_row_line(input, table, &line, &len) != -1) {
+            num_rows++;
+        }
+        free(line);
+        return num_rows;
+    }
+
+    char block[64 * 1024];
+    off_t block_offset = table->row_offset;
+    off_t end_offset = -1;      // Start of the line that ends the table, once found
+    bool at_line_start = true;
+    size_t block_size;
+    while ((block_size = fread(block, 1, sizeof(block), input)) > 0) {
+        size_t position = 0;
+        while (position < block_size) {
+            if (at_line_start && end_offset < 0) {
+                if (block[position] != '|') {
+                    end_offset = block_offset + position;
+                } else {
+                    num_rows++;
+                }
+            }
+
+            const char *newline = memchr(block + position, '\n', block_size - position);
+            if (newline == NULL) {
+                at_line_start = false;
+                break;
+            }
+            position = newline - block + 1;
+            at_line_start = true;
+
+            if (end_offset >= 0) {
+                // Leave the stream just after the line that ended the table
+                table->row_offset = block_offset + position;
+                fseeko(input, table->row_offset, SEEK_SET);
+                table->parsing_state = PSV_TABLE_PARSING_END;
+                table->end_offset = end_offset;
+                return num_rows;
+            }
+        }
+        block_offset += block_size;
+    }
+
+    // Reached the end of the stream
+    table->row_offset = block_offset;
+    table->parsing_state = PSV_TABLE_PARSING_END;
+    table->end_offset = (end_offset >= 0) ? end_offset : block_offset;
+    return num_rows;
+}
+
+/**
+ * @brief Parses a single data row into a reusable row buffer.
+ *
+ * This is the allocation free counterpart of psv_parse_table_row() for modes that only need to
+ * look at each row once. The line buffer and cell arrays are reused from row to row, cells are
+ * unescaped in place in a single pass, and the byte offset of every cell is recorded.
+ *
+ * @param input The file stream from which to read the data row.
+ * @param table Pointer to the PsvTable structure representing the table.
+ * @param row_buffer Pointer to the row buffer. Zero initialise it before the first call and
+ *                   release it with psv_row_buffer_free().
+ * @return true if a data row was parsed, false if the end of the table was reached.
+ */
+bool psv_parse_table_row_buffer(FILE *input, PsvTable *table, PsvRowBuffer *row_buffer) {
+    return psv_parse_table_row_buffer_columns(input, table, row_buffer, table->num_headers);
+}
+
+/**
+ * @brief Parses only the leading cells of a data row into a reusable row buffer.
+ *
+ * Like psv_parse_table_row_buffer(), but tokenizing stops after the first num_columns cells,
+ * which is all a filter on a single column needs. The remaining cells are set to NULL.
+ *
+ * @param input The file stream from which to read the data row.
+ * @param table Pointer to the PsvTable structure representing the table.
+ * @param row_buffer Pointer to the row buffer.
+ * @param num_columns Number of leading cells to parse.
+ * @return true if a data row was parsed, false if the end of the table was reached.
+ */
+bool psv_parse_table_row_buffer_columns(FILE *input, PsvTable *table, PsvRowBuffer *row_buffer, int num_columns) {
+
+    // Cannot return row if not in data row parsing state
+    if (table->parsing_state != PSV_TABLE_PARSING_DATA_ROW)
+        return false;
+
+    if (row_buffer->num_cells != table->num_headers) {
+        row_buffer->num_cells = table->num_headers;
+        row_buffer->cells = realloc(row_buffer->cells, (table->num_headers + 1) * sizeof(PsvDataField));
+        row_buffer->cell_offsets = realloc(row_buffer->cell_offsets, (table->num_headers + 1) * sizeof(size_t));
+        assert(row_buffer->cells != NULL && row_buffer->cell_offsets != NULL);
+    }
+
+    row_buffer->offset = table->row_offset;
+    const ssize_t read = read_table_row_line(input, table, &row_buffer->line, &row_buffer->line_capacity);
+    if (read == -1) {
+        return false;
+    }
+
+    char *line = row_buffer->line;
+
+    // Like psv_parse_table_row(), cells end at the last '|' of the line
+    ssize_t line_end = read - 1;
+    while (line_end > 0 && line[line_end] != '|') {
+        line_end--;
+    }
+    if (line_end == 0) {
+        line_end = read;
+    }
+
+    ssize_t position = 1;
+    for (int i = 0; i < table->num_headers; i++) {
+        row_buffer->cells[i] = NULL;
+        row_buffer->cell_offsets[i] = position;
+        if (position >= line_end || i >= num_columns) {
+            continue;
+        }
+
+        // Skip leading whitespace
+        while (position < line_end && line[position] != '|' && isspace((unsigned char)line[position])) {
+            position++;
+        }
+        row_buffer->cell_offsets[i] = position;
+
+        // Unescape up to the next unescaped delimiter, writing behind the read position
+        char *cell = &line[position];
+        char *write = cell;
+        char *last_non_space = cell;
+        while (position < line_end && line[position] != '|') {
+            if (line[position] == '\\' && position + 1 < line_end && ispunct((unsigned char)line[position + 1])) {
+                position++;
+                *write++ = line[position++];
+                last_non_space = write;
+                continue;
+            }
+            if (!isspace((unsigned char)line[position])) {
+                last_non_space = write + 1;
+            }
+            *write++ = line[position++];
+        }
+        position++;
+
+        // Trim trailing whitespace
+        *last_non_space = '\0';
+        if (*cell != '\0') {
+            row_buffer->cells[i] = cell;
+        }
+    }
+
+    return true;
+}
+
+/**
+ * @brief Releases the memory held by a row buffer.
+ *
+ * Frees the line buffer and cell arrays filled in by psv_parse_table_row_buffer() and
+ * psv_parse_table_row_buffer_columns(). The buffer is left zero initialised, so it can be reused
+ * for another table.
+ *
+ * @param row_buffer Pointer to the row buffer to release.
+ */
+void psv_row_buffer_free(PsvRowBuffer *row_buffer) {
+    free(row_buffer->line);
+    free(row_buffer->cells);
+    free(row_buffer->cell_offsets);
+    *row_buffer = (PsvRowBuffer){0};
+}
+
 /**
  * @brief Parses a table from a stream input.
  *
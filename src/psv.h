@@ -12,6 +12,7 @@
 
 #ifndef PSV_H
 #define PSV_H
+#include <stdbool.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <sys/types.h>
@@ -20,6 +21,7 @@
 
 #define PSV_TABLE_ID_MAX 255
 #define PSV_HEADER_ID_MAX 255
+#define PSV_DECODE_STAGES_MAX 8
 
 typedef enum {
     // This enum defines the most base types that all PSV parsers are expected to handle (except for lite versions) as standard.
@@ -42,6 +44,9 @@ typedef enum {
     PSV_DATA_ANNOTATION_DATETIME,    ///< [datetime] Standard date/time string https://en.wikipedia.org/wiki/ISO_8601
     PSV_DATA_ANNOTATION_UUID,        ///< [uuid] Universally unique identifier https://en.wikipedia.org/wiki/Universally_unique_identifier
 
+    // Encoded payloads (stacked after a binary annotation that provides the bytes e.g. [hex][cbor])
+    PSV_DATA_ANNOTATION_CBOR,        ///< [cbor] Bytes holding an encoded CBOR data item https://www.rfc-editor.org/rfc/rfc8949
+
     PSV_DATA_ANNOTATION_MAX
 } PsvDataAnnotationType;
 
@@ -76,6 +81,17 @@ typedef struct {
     size_t data_annotation_tag_size;
     PsvDataAnnotationField *data_annotation_tags;
 
+    // Decode pipeline compiled from the data annotation tags when the header is parsed. These are
+    // the binary annotations and a final optional [cbor] annotation, in the order a cell is decoded
+    // through them (e.g. hex text to bytes, then bytes to a CBOR data item). Empty if the column
+    // does not start with a binary annotation.
+    size_t num_decode_stages;
+    PsvDataAnnotationType decode_stages[PSV_DECODE_STAGES_MAX];
+
+    // Type inferred from the column's values for columns without a recognised data annotation
+    // (PSV_DATA_ANNOTATION_UNKNOWN unless type inference was run on the table)
+    PsvDataAnnotationType inferred_type;
+
     // TODO: Later on we may want to also capture the consistent attribute syntax here as well
 
 } PsvHeaderMetadataField;
@@ -96,15 +112,47 @@ typedef struct {
 
     int num_data_rows;
     PsvDataRow *data_rows;
+
+    // Byte offsets in the input stream, or -1 if the stream is not seekable (e.g. a pipe)
+    off_t header_offset;    ///< Start of the header row
+    off_t data_offset;      ///< Start of the first data row
+    off_t row_offset;       ///< Start of the next row to be read
+    off_t end_offset;       ///< End of the last data row, once the end of the table is reached
 } PsvTable;
 
+// Reusable buffer for parsing data rows without allocating per row.
+// The cells point into the line buffer, so are only valid until the next row is parsed.
+typedef struct {
+    char *line;
+    size_t line_capacity;
+    off_t offset;           ///< Stream offset of the row, or -1 if unknown
+
+    int num_cells;
+    PsvDataField *cells;    ///< Trimmed and unescaped cells, NULL for empty cells
+    size_t *cell_offsets;   ///< Byte offset of each cell within the row
+} PsvRowBuffer;
+
 void psv_free_table(PsvTable **tablePtr);
 
+PsvTable *psv_create_table(const char *id);
+PsvHeaderMetadataField *psv_table_add_header(PsvTable *table, const char *raw_header);
+int psv_find_header_column(PsvTable *table, const char *key);
+PsvDataAnnotationType psv_get_basic_type(PsvTable *table, size_t header_column);
+bool psv_has_data_annotation(PsvTable *table, size_t header_column, PsvDataAnnotationType type);
+const char *psv_data_annotation_type_name(PsvDataAnnotationType type);
+cbor_tag_t psv_data_annotation_type_cbor_tag(PsvDataAnnotationType type);
+bool psv_data_is_true(const char *data);
+
 PsvTable * psv_parse_table_header(FILE *input, char *defaultTableID);
 
 PsvDataRow psv_parse_table_row(FILE *input, PsvTable *table);
 void psv_parse_table_free_row(PsvTable *table, PsvDataRow *dataRowPtr);
 bool psv_parse_skip_table_row(FILE *input, PsvTable *table);
+bool psv_parse_rewind_table_rows(FILE *input, PsvTable *table);
+size_t psv_parse_skip_table_rows(FILE *input, PsvTable *table);
+bool psv_parse_table_row_buffer(FILE *input, PsvTable *table, PsvRowBuffer *row_buffer);
+bool psv_parse_table_row_buffer_columns(FILE *input, PsvTable *table, PsvRowBuffer *row_buffer, int num_columns);
+void psv_row_buffer_free(PsvRowBuffer *row_buffer);
 
 PsvTable *psv_parse_table(FILE *input, char *defaultTableID);
 
@@ -0,0 +1,710 @@
+/**
+ * @file psv_aggregate.c
+ * @brief Streaming Aggregation Of PSV Table Rows
+ *
+ * Copyright (C) 2024-2024 Brian Khuu <contact@briankhuu.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ */
+
+#include <string.h>
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <inttypes.h>
+#include <stdarg.h>
+#include <errno.h>
+#include <assert.h>
+
+#include "psv_aggregate.h"
+#include "psv_hash.h"
+#include "psv_spill.h"
+#include "psv_validate.h"
+#include "log.h"
+
+#ifdef NDEBUG
+    #define assert(expression) ((void)0)
+#endif
+
+// Number of spill partitions created each time the group by memory budget is exceeded
+#define PSV_GROUP_BY_PARTITIONS 16
+
+// Once partitions have been split this many times, stop honouring the memory budget.
+// (This only happens with pathological inputs, e.g. a single group key larger than the budget)
+#define PSV_GROUP_BY_MAX_LEVEL 8
+
+typedef struct {
+    const char *name;
+    PsvAggregateFunction function;
+} AggregateFunctionMapping;
+
+static const AggregateFunctionMapping aggregate_function_mappings[] = {
+    {"count", PSV_AGGREGATE_COUNT},
+    {"sum", PSV_AGGREGATE_SUM},
+    {"min", PSV_AGGREGATE_MIN},
+    {"max", PSV_AGGREGATE_MAX},
+    {"avg", PSV_AGGREGATE_AVG},
+};
+static const size_t num_aggregate_function_mappings = sizeof(aggregate_function_mappings) / sizeof(aggregate_function_mappings[0]);
+
+static char *copy_trimmed(const char *start, const char *end) {
+    while (start < end && isspace((unsigned char)*start)) {
+        start++;
+    }
+    while (end > start && isspace((unsigned char)end[-1])) {
+        end--;
+    }
+
+    char *copy = malloc(end - start + 1);
+    assert(copy != NULL);
+    memcpy(copy, start, end - start);
+    copy[end - start] = '\0';
+    return copy;
+}
+
+static bool parse_group_columns(PsvAggregateSpec *spec, PsvTable *table, const char *group_by) {
+    const char *token_start = group_by;
+    while (true) {
+        const char *token_end = strchr(token_start, ',');
+        if (token_end == NULL) {
+            token_end = token_start + strlen(token_start);
+        }
+
+        char *key = copy_trimmed(token_start, token_end);
+        const int column = psv_find_header_column(table, key);
+        if (column < 0) {
+            snprintf(spec->error, PSV_AGGREGATE_ERROR_MAX, "group by column '%s' not found", key);
+            free(key);
+            return false;
+        }
+        free(key);
+
+        spec->group_columns = realloc(spec->group_columns, (spec->num_group_columns + 1) * sizeof(int));
+        assert(spec->group_columns != NULL);
+        spec->group_columns[spec->num_group_columns++] = column;
+
+        if (*token_end == '\0') {
+            break;
+        }
+        token_start = token_end + 1;
+    }
+    return true;
+}
+
+static bool parse_aggregate(PsvAggregateSpec *spec, PsvTable *table, char *aggregate) {
+    PsvAggregateColumn aggregate_column = {.column = -1, .type = PSV_DATA_ANNOTATION_UNKNOWN};
+
+    // Split `function(column)` into its function name and argument
+    char *argument = strchr(aggregate, '(');
+    if (argument != NULL) {
+        char *argument_end = strchr(argument, ')');
+        if (argument_end == NULL) {
+            snprintf(spec->error, PSV_AGGREGATE_ERROR_MAX, "aggregate '%s' is missing ')'", aggregate);
+            return false;
+        }
+        *argument++ = '\0';
+        *argument_end = '\0';
+    }
+
+    bool function_found = false;
+    for (size_t i = 0; i < num_aggregate_function_mappings; i++) {
+        if (strcmp(aggregate, aggregate_function_mappings[i].name) == 0) {
+            aggregate_column.function = aggregate_function_mappings[i].function;
+            function_found = true;
+            break;
+        }
+    }
+
+    if (!function_found) {
+        snprintf(spec->error, PSV_AGGREGATE_ERROR_MAX, "unknown aggregate function '%s'", aggregate);
+        return false;
+    }
+
+    if (argument != NULL) {
+        char *key = copy_trimmed(argument, argument + strlen(argument));
+        aggregate_column.column = psv_find_header_column(table, key);
+        if (aggregate_column.column < 0) {
+            snprintf(spec->error, PSV_AGGREGATE_ERROR_MAX, "aggregate column '%s' not found", key);
+            free(key);
+            return false;
+        }
+        free(key);
+        aggregate_column.type = psv_get_basic_type(table, aggregate_column.column);
+    } else if (aggregate_column.function != PSV_AGGREGATE_COUNT) {
+        snprintf(spec->error, PSV_AGGREGATE_ERROR_MAX, "aggregate '%s' requires a column e.g. %s(col)", aggregate, aggregate);
+        return false;
+    }
+
+    spec->aggregates = realloc(spec->aggregates, (spec->num_aggregates + 1) * sizeof(PsvAggregateColumn));
+    assert(spec->aggregates != NULL);
+    spec->aggregates[spec->num_aggregates++] = aggregate_column;
+    return true;
+}
+
+/**
+ * @brief Parses group by columns and aggregate functions against a table header.
+ *
+ * @param spec Pointer to the aggregate specification to fill in.
+ * @param table Pointer to the table whose header the column keys are resolved against.
+ * @param group_by Comma separated list of group by column keys (e.g. `city,country`).
+ *                 May be NULL if rows are not grouped by any column.
+ * @param aggregates Comma separated list of aggregates (e.g. `count,sum(age),avg(age)`).
+ *                   Supported functions are count, count(col), sum(col), min(col), max(col) and avg(col).
+ * @return true on success. On failure false is returned and spec->error describes the problem.
+ *         The spec must be released with psv_aggregate_spec_free() in both cases.
+ */
+bool psv_aggregate_spec_parse(PsvAggregateSpec *spec, PsvTable *table, const char *group_by, const char *aggregates) {
+    *spec = (PsvAggregateSpec){0};
+
+    if (group_by != NULL && !parse_group_columns(spec, table, group_by)) {
+        return false;
+    }
+
+    // Split aggregates on top level commas only
+    const char *token_start = aggregates;
+    while (true) {
+        const char *token_end = token_start;
+        while (*token_end != '\0' && *token_end != ',') {
+            if (*token_end == '(') {
+                while (*token_end != '\0' && *token_end != ')') {
+                    token_end++;
+                }
+                if (*token_end == '\0') {
+                    break;
+                }
+            }
+            token_end++;
+        }
+
+        char *aggregate = copy_trimmed(token_start, token_end);
+        const bool ok = (*aggregate == '\0') || parse_aggregate(spec, table, aggregate);
+        free(aggregate);
+        if (!ok) {
+            return false;
+        }
+
+        if (*token_end == '\0') {
+            break;
+        }
+        token_start = token_end + 1;
+    }
+
+    if (spec->num_aggregates == 0) {
+        snprintf(spec->error, PSV_AGGREGATE_ERROR_MAX, "no aggregate functions specified");
+        return false;
+    }
+
+    return true;
+}
+
+void psv_aggregate_spec_free(PsvAggregateSpec *spec) {
+    free(spec->group_columns);
+    free(spec->aggregates);
+    *spec = (PsvAggregateSpec){0};
+}
+
+static const char *aggregate_result_annotation(const PsvAggregateColumn *aggregate) {
+    switch (aggregate->function) {
+        case PSV_AGGREGATE_COUNT:
+            return "int";
+        case PSV_AGGREGATE_AVG:
+            return "float";
+        case PSV_AGGREGATE_SUM:
+            return (aggregate->type == PSV_DATA_ANNOTATION_INTEGER) ? "int" : "float";
+        case PSV_AGGREGATE_MIN:
+        case PSV_AGGREGATE_MAX:
+            if (aggregate->type == PSV_DATA_ANNOTATION_INTEGER)
+                return "int";
+            if (aggregate->type == PSV_DATA_ANNOTATION_FLOAT)
+                return "float";
+            return "str";
+    }
+    return "str";
+}
+
+/**
+ * @brief Creates the header of the table produced by an aggregation.
+ *
+ * The result table has any leading columns first (e.g. the window bounds of a windowed
+ * aggregation), then the group by columns (keeping their original header and data
+ * annotations) followed by one column per aggregate, e.g. `sum(age) [int] {#sum_age}`.
+ *
+ * @param table Pointer to the source table.
+ * @param spec Pointer to the aggregate specification.
+ * @param leading_headers Raw headers of extra columns to put before the group by columns, or NULL.
+ * @param num_leading_headers Number of leading headers.
+ * @return A newly allocated header only PsvTable (free with psv_free_table()).
+ */
+PsvTable *psv_aggregate_create_result_table(PsvTable *table, const PsvAggregateSpec *spec, const char *const *leading_headers, int num_leading_headers) {
+    PsvTable *result_table = psv_create_table(table->id);
+
+    for (int i = 0; i < num_leading_headers; i++) {
+        psv_table_add_header(result_table, leading_headers[i]);
+    }
+
+    for (int i = 0; i < spec->num_group_columns; i++) {
+        const PsvHeaderMetadataField *header_metadata = &table->header_metadata[spec->group_columns[i]];
+        PsvHeaderMetadataField *result_header = psv_table_add_header(result_table, header_metadata->raw_header);
+        memcpy(result_header->id, header_metadata->id, PSV_HEADER_ID_MAX);
+    }
+
+    for (int i = 0; i < spec->num_aggregates; i++) {
+        const PsvAggregateColumn *aggregate = &spec->aggregates[i];
+        const char *function_name = aggregate_function_mappings[aggregate->function].name;
+        char raw_header[PSV_HEADER_ID_MAX * 2 + 32];
+        if (aggregate->column < 0) {
+            snprintf(raw_header, sizeof(raw_header), "%s [%s]", function_name, aggregate_result_annotation(aggregate));
+        } else {
+            const char *key = table->header_metadata[aggregate->column].id;
+            snprintf(raw_header, sizeof(raw_header), "%s(%s) [%s] {#%s_%s}", function_name, key, aggregate_result_annotation(aggregate), function_name, key);
+        }
+        psv_table_add_header(result_table, raw_header);
+    }
+
+    return result_table;
+}
+
+void psv_aggregate_states_init(const PsvAggregateSpec *spec, PsvAggregateState *states) {
+    for (int i = 0; i < spec->num_aggregates; i++) {
+        states[i] = (PsvAggregateState){0};
+    }
+}
+
+/**
+ * @brief Folds a data row into a set of running aggregate states.
+ *
+ * Integer columns are accumulated as 64-bit integers (a sum that overflows is a fatal error,
+ * while the running sum of an average carries on as a double), float columns as doubles. Text
+ * columns are compared lexicographically for min/max and parsed as numbers for sum/avg. Cells
+ * that are not valid numbers are skipped by every numeric aggregate, and empty cells are ignored
+ * by everything except plain count. Float and text cells are held to the same check as --validate
+ * applies to [float] cells, so values that overflow a double are not valid numbers either.
+ *
+ * @param spec Pointer to the aggregate specification.
+ * @param states Array of spec->num_aggregates aggregate states.
+ * @param data_row The data row to fold into the states.
+ * @return The number of additional heap bytes now held by the states (for memory budgeting).
+ */
+size_t psv_aggregate_states_update(const PsvAggregateSpec *spec, PsvAggregateState *states, PsvDataRow data_row) {
+    size_t heap_growth = 0;
+
+    for (int i = 0; i < spec->num_aggregates; i++) {
+        const PsvAggregateColumn *aggregate = &spec->aggregates[i];
+        PsvAggregateState *state = &states[i];
+
+        if (aggregate->column < 0) {
+            state->count++;
+            continue;
+        }
+
+        const char *data = data_row[aggregate->column];
+        if (data == NULL) {
+            continue;
+        }
+
+        if (aggregate->function == PSV_AGGREGATE_COUNT) {
+            state->count++;
+            continue;
+        }
+
+        if (aggregate->type == PSV_DATA_ANNOTATION_INTEGER) {
+            char *end = NULL;
+            errno = 0;
+            const int64_t value = strtoll(data, &end, 10);
+            if (end == data || *end != '\0' || errno == ERANGE) {
+                // Not an integer (or out of the int64 range)
+                continue;
+            }
+
+            if (aggregate->function == PSV_AGGREGATE_SUM || aggregate->function == PSV_AGGREGATE_AVG) {
+                int64_t sum = 0;
+                if (state->is_float_sum) {
+                    state->float_value += value;
+                } else if (!__builtin_add_overflow(state->int_value, value, &sum)) {
+                    state->int_value = sum;
+                } else if (aggregate->function == PSV_AGGREGATE_AVG) {
+                    // The average is a float anyway, so carry on summing as a double
+                    state->is_float_sum = true;
+                    state->float_value = (double)state->int_value + (double)value;
+                } else {
+                    fprintf(stderr, "psv: sum() of [int] column %d overflows a 64-bit integer\n", aggregate->column + 1);
+                    exit(1);
+                }
+            } else if (state->count == 0 || (aggregate->function == PSV_AGGREGATE_MIN ? value < state->int_value : value > state->int_value)) {
+                state->int_value = value;
+            }
+            state->count++;
+            continue;
+        }
+
+        if (aggregate->type != PSV_DATA_ANNOTATION_FLOAT && (aggregate->function == PSV_AGGREGATE_MIN || aggregate->function == PSV_AGGREGATE_MAX)) {
+            // Text min/max
+            if (state->count == 0 || (aggregate->function == PSV_AGGREGATE_MIN ? strcmp(data, state->text_value) < 0 : strcmp(data, state->text_value) > 0)) {
+                const size_t old_size = state->text_value ? strlen(state->text_value) + 1 : 0;
+                const size_t new_size = strlen(data) + 1;
+                state->text_value = realloc(state->text_value, new_size);
+                assert(state->text_value != NULL);
+                memcpy(state->text_value, data, new_size);
+                heap_growth += (new_size > old_size) ? new_size - old_size : 0;
+            }
+            state->count++;
+            continue;
+        }
+
+        const char *reason = NULL;
+        if (!psv_validate_get_type_validator(PSV_DATA_ANNOTATION_FLOAT)(data, &reason)) {
+            // Not a number (or out of the double range)
+            continue;
+        }
+        const double value = strtod(data, NULL);
+
+        if (aggregate->function == PSV_AGGREGATE_SUM || aggregate->function == PSV_AGGREGATE_AVG) {
+            state->float_value += value;
+        } else if (state->count == 0 || (aggregate->function == PSV_AGGREGATE_MIN ? value < state->float_value : value > state->float_value)) {
+            state->float_value = value;
+        }
+        state->count++;
+    }
+
+    return heap_growth;
+}
+
+static char *format_cell(const char *format, ...) __attribute__((format(printf, 1, 2)));
+static char *format_cell(const char *format, ...) {
+    char buffer[64];
+    va_list args;
+    va_start(args, format);
+    vsnprintf(buffer, sizeof(buffer), format, args);
+    va_end(args);
+    return strdup(buffer);
+}
+
+/**
+ * @brief Formats the final value of a set of aggregate states as data row cells.
+ *
+ * @param spec Pointer to the aggregate specification.
+ * @param states Array of spec->num_aggregates aggregate states.
+ * @param result_cells Array of at least spec->num_aggregates cells to fill with newly allocated strings.
+ *                     Aggregates without any input values (e.g. the sum of an all empty column) are left NULL.
+ */
+void psv_aggregate_states_format(const PsvAggregateSpec *spec, const PsvAggregateState *states, PsvDataRow result_cells) {
+    for (int i = 0; i < spec->num_aggregates; i++) {
+        const PsvAggregateColumn *aggregate = &spec->aggregates[i];
+        const PsvAggregateState *state = &states[i];
+
+        result_cells[i] = NULL;
+
+        if (aggregate->function == PSV_AGGREGATE_COUNT) {
+            result_cells[i] = format_cell("%" PRIu64, state->count);
+            continue;
+        }
+
+        if (state->count == 0) {
+            continue;
+        }
+
+        const bool is_integer = (aggregate->type == PSV_DATA_ANNOTATION_INTEGER);
+        switch (aggregate->function) {
+            case PSV_AGGREGATE_AVG:
+                result_cells[i] = format_cell("%.17g", ((is_integer && !state->is_float_sum) ? (double)state->int_value : state->float_value) / state->count);
+                break;
+            case PSV_AGGREGATE_SUM:
+                result_cells[i] = is_integer ? format_cell("%" PRId64, state->int_value) : format_cell("%.17g", state->float_value);
+                break;
+            case PSV_AGGREGATE_MIN:
+            case PSV_AGGREGATE_MAX:
+                if (is_integer) {
+                    result_cells[i] = format_cell("%" PRId64, state->int_value);
+                } else if (aggregate->type == PSV_DATA_ANNOTATION_FLOAT) {
+                    result_cells[i] = format_cell("%.17g", state->float_value);
+                } else {
+                    result_cells[i] = strdup(state->text_value);
+                }
+                break;
+            case PSV_AGGREGATE_COUNT:
+                break;
+        }
+    }
+}
+
+void psv_aggregate_states_clear(const PsvAggregateSpec *spec, PsvAggregateState *states) {
+    for (int i = 0; i < spec->num_aggregates; i++) {
+        free(states[i].text_value);
+        states[i] = (PsvAggregateState){0};
+    }
+}
+
+/*******************************************************************************
+ * Hash Aggregation (Group By)
+ *
+ * Rows are folded into per group aggregate states held in a hash map keyed by the
+ * group by column values. Only one group state is kept per distinct key, so memory
+ * use scales with the number of groups rather than the number of rows.
+ *
+ * If the number of groups outgrows the memory budget, rows belonging to groups that
+ * are not already in memory are hash partitioned into temporary spill files (rows of
+ * groups already in memory keep being aggregated in place). Once the input is done,
+ * the in memory groups are emitted first, then each spill partition is aggregated in
+ * turn with a fresh hash map. A partition that is still too large is split again
+ * with a different hash seed.
+ ******************************************************************************/
+
+typedef struct {
+    PsvDataField *key_cells;
+    PsvAggregateState *states;
+} PsvGroup;
+
+typedef struct {
+    FILE *file;
+    unsigned int level;
+} PsvGroupByPartition;
+
+struct PsvGroupBy {
+    const PsvAggregateSpec *spec;
+    int num_columns;
+    size_t memory_budget;
+    size_t memory_used;
+
+    // In memory groups, in first seen order
+    PsvHashMap groups_map;
+    PsvGroup *groups;
+    size_t num_groups;
+    size_t groups_capacity;
+
+    // Spill partitions of the level currently being aggregated
+    unsigned int level;
+    FILE *partitions[PSV_GROUP_BY_PARTITIONS];
+
+    // Spill partitions waiting to be aggregated
+    PsvGroupByPartition *pending;
+    size_t num_pending;
+
+    // Result iterator
+    bool input_done;
+    size_t next_group;
+
+    // Scratch buffer for serialized group keys
+    char *key_buffer;
+    size_t key_buffer_capacity;
+};
+
+PsvGroupBy *psv_group_by_create(const PsvAggregateSpec *spec, int num_columns, size_t memory_budget) {
+    PsvGroupBy *group_by = calloc(1, sizeof(PsvGroupBy));
+    assert(group_by != NULL);
+    group_by->spec = spec;
+    group_by->num_columns = num_columns;
+    group_by->memory_budget = memory_budget;
+    psv_hash_map_init(&group_by->groups_map, 0);
+    return group_by;
+}
+
+// Serialize the group by cells of a row into a single hash map key
+static size_t build_group_key(PsvGroupBy *group_by, PsvDataRow data_row) {
+    size_t key_size = 0;
+    for (int i = 0; i < group_by->spec->num_group_columns; i++) {
+        const char *data = data_row[group_by->spec->group_columns[i]];
+        const size_t data_size = data ? strlen(data) : 0;
+
+        // Each cell is written as either `\0` (empty cell) or `\1<data>\0`
+        const size_t required = key_size + data_size + 2;
+        if (required > group_by->key_buffer_capacity) {
+            group_by->key_buffer_capacity = required * 2;
+            group_by->key_buffer = realloc(group_by->key_buffer, group_by->key_buffer_capacity);
+            assert(group_by->key_buffer != NULL);
+        }
+
+        if (data) {
+            group_by->key_buffer[key_size++] = '\1';
+            memcpy(group_by->key_buffer + key_size, data, data_size);
+            key_size += data_size;
+        }
+        group_by->key_buffer[key_size++] = '\0';
+    }
+    return key_size;
+}
+
+static size_t add_group(PsvGroupBy *group_by, PsvDataRow data_row, size_t key_size) {
+    const PsvAggregateSpec *spec = group_by->spec;
+
+    if (group_by->num_groups == group_by->groups_capacity) {
+        group_by->groups_capacity = group_by->groups_capacity ? group_by->groups_capacity * 2 : 64;
+        group_by->groups = realloc(group_by->groups, group_by->groups_capacity * sizeof(PsvGroup));
+        assert(group_by->groups != NULL);
+    }
+
+    PsvGroup *group = &group_by->groups[group_by->num_groups];
+    group->key_cells = calloc(spec->num_group_columns ? spec->num_group_columns : 1, sizeof(PsvDataField));
+    group->states = malloc(spec->num_aggregates * sizeof(PsvAggregateState));
+    assert(group->key_cells != NULL && group->states != NULL);
+    for (int i = 0; i < spec->num_group_columns; i++) {
+        const char *data = data_row[spec->group_columns[i]];
+        group->key_cells[i] = data ? strdup(data) : NULL;
+    }
+    psv_aggregate_states_init(spec, group->states);
+
+    // Rough accounting of the heap used by this group, its key copies and its hash map slot
+    group_by->memory_used += sizeof(PsvGroup) + 2 * sizeof(PsvHashMapEntry) + 2 * key_size + spec->num_aggregates * sizeof(PsvAggregateState);
+
+    return group_by->num_groups++;
+}
+
+static void spill_row(PsvGroupBy *group_by, PsvDataRow data_row, size_t key_size) {
+    const PsvHash128 hash = psv_hash128(group_by->key_buffer, key_size, group_by->level);
+    const size_t partition = hash.high % PSV_GROUP_BY_PARTITIONS;
+
+    if (group_by->partitions[partition] == NULL) {
+        group_by->partitions[partition] = tmpfile();
+        if (group_by->partitions[partition] == NULL) {
+            fprintf(stderr, "psv: cannot create group by spill file: %s\n", strerror(errno));
+            exit(1);
+        }
+        log_debug("Group by memory budget exceeded, spilling partition %zu at level %u", partition, group_by->level);
+    }
+
+    if (!psv_spill_write_row(group_by->partitions[partition], group_by->num_columns, data_row)) {
+        fprintf(stderr, "psv: cannot write to group by spill file: %s\n", strerror(errno));
+        exit(1);
+    }
+}
+
+/**
+ * @brief Folds a data row into its group.
+ *
+ * @param group_by Pointer to the group by engine.
+ * @param data_row The data row. It is not retained, so the caller may free it afterwards.
+ */
+void psv_group_by_add_row(PsvGroupBy *group_by, PsvDataRow data_row) {
+    const size_t key_size = build_group_key(group_by, data_row);
+
+    size_t group_index = 0;
+    if (!psv_hash_map_find(&group_by->groups_map, group_by->key_buffer, key_size, &group_index)) {
+        const bool over_budget = group_by->memory_used > group_by->memory_budget;
+        if (over_budget && group_by->level < PSV_GROUP_BY_MAX_LEVEL) {
+            spill_row(group_by, data_row, key_size);
+            return;
+        }
+
+        group_index = add_group(group_by, data_row, key_size);
+        psv_hash_map_insert(&group_by->groups_map, group_by->key_buffer, key_size, &group_index);
+    }
+
+    PsvGroup *group = &group_by->groups[group_index];
+    group_by->memory_used += psv_aggregate_states_update(group_by->spec, group->states, data_row);
+}
+
+static void clear_groups(PsvGroupBy *group_by) {
+    for (size_t i = 0; i < group_by->num_groups; i++) {
+        PsvGroup *group = &group_by->groups[i];
+        for (int j = 0; j < group_by->spec->num_group_columns; j++) {
+            free(group->key_cells[j]);
+        }
+        free(group->key_cells);
+        psv_aggregate_states_clear(group_by->spec, group->states);
+        free(group->states);
+    }
+    group_by->num_groups = 0;
+    group_by->next_group = 0;
+    group_by->memory_used = 0;
+
+    psv_hash_map_free(&group_by->groups_map);
+    psv_hash_map_init(&group_by->groups_map, group_by->level);
+}
+
+// Move the spill partitions of the current level onto the pending list
+static void queue_partitions(PsvGroupBy *group_by) {
+    for (int i = 0; i < PSV_GROUP_BY_PARTITIONS; i++) {
+        if (group_by->partitions[i] == NULL) {
+            continue;
+        }
+
+        group_by->pending = realloc(group_by->pending, (group_by->num_pending + 1) * sizeof(PsvGroupByPartition));
+        assert(group_by->pending != NULL);
+        group_by->pending[group_by->num_pending++] = (PsvGroupByPartition){.file = group_by->partitions[i], .level = group_by->level + 1};
+        group_by->partitions[i] = NULL;
+    }
+}
+
+// Aggregate the next pending spill partition into the (cleared) in memory groups
+static bool load_next_partition(PsvGroupBy *group_by) {
+    if (group_by->num_pending == 0) {
+        return false;
+    }
+
+    PsvGroupByPartition partition = group_by->pending[--group_by->num_pending];
+    group_by->level = partition.level;
+    clear_groups(group_by);
+
+    rewind(partition.file);
+    PsvDataRow data_row;
+    while ((data_row = psv_spill_read_row(partition.file, group_by->num_columns)) != NULL) {
+        psv_group_by_add_row(group_by, data_row);
+        for (int i = 0; i < group_by->num_columns; i++) {
+            free(data_row[i]);
+        }
+        free(data_row);
+    }
+    fclose(partition.file);
+
+    queue_partitions(group_by);
+    return true;
+}
+
+/**
+ * @brief Returns the next aggregated group.
+ *
+ * Must only be called once all rows have been added. The first call finishes the
+ * in memory aggregation; spill partitions are aggregated lazily as iteration proceeds.
+ *
+ * @param group_by Pointer to the group by engine.
+ * @return A newly allocated result row laid out as described by psv_aggregate_create_result_table()
+ *         (free each cell and the row itself, e.g. with psv_parse_table_free_row() on the result table),
+ *         or NULL when all groups have been returned.
+ */
+PsvDataRow psv_group_by_next_row(PsvGroupBy *group_by) {
+    const PsvAggregateSpec *spec = group_by->spec;
+
+    if (!group_by->input_done) {
+        group_by->input_done = true;
+        queue_partitions(group_by);
+    }
+
+    while (group_by->next_group >= group_by->num_groups) {
+        if (!load_next_partition(group_by)) {
+            return NULL;
+        }
+    }
+
+    PsvGroup *group = &group_by->groups[group_by->next_group++];
+    PsvDataRow result_row = calloc(spec->num_group_columns + spec->num_aggregates, sizeof(PsvDataField));
+    assert(result_row != NULL);
+    for (int i = 0; i < spec->num_group_columns; i++) {
+        result_row[i] = group->key_cells[i] ? strdup(group->key_cells[i]) : NULL;
+    }
+    psv_aggregate_states_format(spec, group->states, result_row + spec->num_group_columns);
+    return result_row;
+}
+
+void psv_group_by_free(PsvGroupBy **group_by_ptr) {
+    PsvGroupBy *group_by = *group_by_ptr;
+
+    clear_groups(group_by);
+    psv_hash_map_free(&group_by->groups_map);
+    free(group_by->groups);
+
+    for (int i = 0; i < PSV_GROUP_BY_PARTITIONS; i++) {
+        if (group_by->partitions[i]) {
+            fclose(group_by->partitions[i]);
+        }
+    }
+    for (size_t i = 0; i < group_by->num_pending; i++) {
+        fclose(group_by->pending[i].file);
+    }
+    free(group_by->pending);
+    free(group_by->key_buffer);
+
+    free(group_by);
+    *group_by_ptr = NULL;
+}
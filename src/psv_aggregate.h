@@ -0,0 +1,73 @@
+/**
+ * @file psv_aggregate.h
+ * @brief Streaming Aggregation Of PSV Table Rows
+ *
+ * Copyright (C) 2024-2024 Brian Khuu <contact@briankhuu.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ */
+
+#ifndef PSV_AGGREGATE_H
+#define PSV_AGGREGATE_H
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "psv.h"
+
+#define PSV_AGGREGATE_ERROR_MAX (PSV_HEADER_ID_MAX + 64)
+
+typedef enum {
+    PSV_AGGREGATE_COUNT,    ///< count or count(col): Number of rows, or non-empty cells of a column
+    PSV_AGGREGATE_SUM,      ///< sum(col)
+    PSV_AGGREGATE_MIN,      ///< min(col)
+    PSV_AGGREGATE_MAX,      ///< max(col)
+    PSV_AGGREGATE_AVG,      ///< avg(col)
+} PsvAggregateFunction;
+
+typedef struct {
+    PsvAggregateFunction function;
+    int column;                     ///< Source column index, or -1 for a plain row count
+    PsvDataAnnotationType type;     ///< Basic type of the source column, which decides integer/float/text arithmetic
+} PsvAggregateColumn;
+
+typedef struct {
+    int num_group_columns;
+    int *group_columns;
+
+    int num_aggregates;
+    PsvAggregateColumn *aggregates;
+
+    char error[PSV_AGGREGATE_ERROR_MAX];
+} PsvAggregateSpec;
+
+// Running state of a single aggregate
+typedef struct {
+    uint64_t count;         ///< Number of values folded into this state
+    int64_t int_value;      ///< Running sum/min/max of integer columns
+    double float_value;     ///< Running sum/min/max of float columns, or of an integer average once it overflows int64
+    bool is_float_sum;      ///< The integer average's sum overflowed and is now held in float_value
+    char *text_value;       ///< Running min/max of text columns
+} PsvAggregateState;
+
+bool psv_aggregate_spec_parse(PsvAggregateSpec *spec, PsvTable *table, const char *group_by, const char *aggregates);
+void psv_aggregate_spec_free(PsvAggregateSpec *spec);
+PsvTable *psv_aggregate_create_result_table(PsvTable *table, const PsvAggregateSpec *spec, const char *const *leading_headers, int num_leading_headers);
+
+void psv_aggregate_states_init(const PsvAggregateSpec *spec, PsvAggregateState *states);
+size_t psv_aggregate_states_update(const PsvAggregateSpec *spec, PsvAggregateState *states, PsvDataRow data_row);
+void psv_aggregate_states_format(const PsvAggregateSpec *spec, const PsvAggregateState *states, PsvDataRow result_cells);
+void psv_aggregate_states_clear(const PsvAggregateSpec *spec, PsvAggregateState *states);
+
+// Hash aggregation (group by) engine
+typedef struct PsvGroupBy PsvGroupBy;
+
+PsvGroupBy *psv_group_by_create(const PsvAggregateSpec *spec, int num_columns, size_t memory_budget);
+void psv_group_by_add_row(PsvGroupBy *group_by, PsvDataRow data_row);
+PsvDataRow psv_group_by_next_row(PsvGroupBy *group_by);
+void psv_group_by_free(PsvGroupBy **group_by_ptr);
+
+#endif
@@ -0,0 +1,592 @@
+/**
+ * @file psv_arrow.c
+ * @brief Apache Arrow IPC Stream Output Of Tables
+ *
+ * Copyright (C) 2024-2024 Brian Khuu <contact@briankhuu.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Each table is written in the Arrow IPC streaming format: a Schema message, a RecordBatch
+ * message for every batch of rows, then the end of stream marker. A message is a continuation
+ * marker, the size of its flatbuffer metadata, the metadata, then the message body holding the
+ * buffers of the batch (each padded to 8 bytes).
+ *
+ * Columns are typed from their data annotations:
+ *
+ * - [int] and [float] become int64 and float64, and [bool] a bool bitmap.
+ * - [datetime] becomes a nanosecond timestamp in UTC.
+ * - Binary columns become binary, decoded through the column's decode pipeline.
+ * - [uuid] becomes a 16 byte fixed size binary with the arrow.uuid extension type.
+ * - Everything else is utf8.
+ *
+ * Empty cells, and cells that are not valid as their column's type, are null.
+ *
+ * The flatbuffers are built by a minimal forward builder rather than the flatbuffers library.
+ * Flatbuffer offsets must point forward, so each object is appended after the offset fields that
+ * refer to it, and those are patched once the object's position is known.
+ */
+
+#include <string.h>
+#include <stdlib.h>
+#include <assert.h>
+
+#include "psv_arrow.h"
+#include "psv_validate.h"
+#include "psv_datetime.h"
+
+#ifdef NDEBUG
+    #define assert(expression) ((void)0)
+#endif
+
+#define ARROW_CONTINUATION 0xFFFFFFFFu
+#define ARROW_METADATA_V5 4
+
+// MessageHeader union types (Message.fbs)
+#define ARROW_HEADER_SCHEMA 1
+#define ARROW_HEADER_RECORD_BATCH 3
+
+// Type union types (Schema.fbs)
+#define ARROW_TYPE_INT 2
+#define ARROW_TYPE_FLOATING_POINT 3
+#define ARROW_TYPE_BINARY 4
+#define ARROW_TYPE_UTF8 5
+#define ARROW_TYPE_BOOL 6
+#define ARROW_TYPE_TIMESTAMP 10
+#define ARROW_TYPE_FIXED_SIZE_BINARY 15
+
+#define ARROW_PRECISION_DOUBLE 2
+#define ARROW_TIME_UNIT_NANOSECOND 3
+
+// A batch is cut short once a column holds this much data, well before its int32 offsets could overflow
+#define ARROW_BATCH_DATA_MAX ((size_t)1 << 30)
+
+#define FB_FIELDS_MAX 8
+
+// Append zeroed bytes and return where they start (only valid until the next append)
+static uint8_t *reserve(PsvBytes *bytes, size_t size) {
+    if (bytes->size + size > bytes->capacity) {
+        bytes->capacity = (bytes->size + size) * 2;
+        bytes->data = realloc(bytes->data, bytes->capacity);
+        assert(bytes->data != NULL);
+    }
+    uint8_t *out = bytes->data + bytes->size;
+    memset(out, 0, size);
+    bytes->size += size;
+    return out;
+}
+
+static void put_le(uint8_t *out, uint64_t value, size_t size) {
+    for (size_t i = 0; i < size; i++) {
+        out[i] = (uint8_t)(value >> (i * 8));
+    }
+}
+
+static void append_le(PsvBytes *bytes, uint64_t value, size_t size) {
+    put_le(reserve(bytes, size), value, size);
+}
+
+static size_t pad8(size_t size) {
+    return (size + 7) & ~(size_t)7;
+}
+
+/**
+ * Forward flatbuffer builder
+ */
+
+// Scalar and offset fields of a flatbuffer table by field id (a size of 0 leaves the field out)
+typedef struct {
+    uint8_t sizes[FB_FIELDS_MAX];
+    uint64_t values[FB_FIELDS_MAX];
+    size_t positions[FB_FIELDS_MAX];    ///< Where each field was written, for patching offsets
+} FbTable;
+
+static void fb_align(PsvBytes *fb, size_t alignment) {
+    reserve(fb, (alignment - fb->size % alignment) % alignment);
+}
+
+static void fb_scalar(FbTable *table, int id, size_t size, uint64_t value) {
+    assert(id < FB_FIELDS_MAX);
+    table->sizes[id] = (uint8_t)size;
+    table->values[id] = value;
+}
+
+// An offset field, patched by fb_patch() once the object it refers to is written
+static void fb_offset(FbTable *table, int id) {
+    fb_scalar(table, id, 4, 0);
+}
+
+static void fb_patch(PsvBytes *fb, size_t position, size_t target) {
+    assert(target > position);
+    put_le(fb->data + position, target - position, 4);
+}
+
+// Write a table preceded by its vtable, and return the table's position
+static size_t fb_table(PsvBytes *fb, FbTable *table) {
+    int num_fields = 0;
+    for (int id = 0; id < FB_FIELDS_MAX; id++) {
+        if (table->sizes[id] > 0) {
+            num_fields = id + 1;
+        }
+    }
+
+    // Lay out the fields after the vtable offset, largest first so that each is aligned
+    size_t field_offsets[FB_FIELDS_MAX] = {0};
+    size_t table_size = 4;
+    for (size_t size = 8; size >= 1; size /= 2) {
+        for (int id = 0; id < num_fields; id++) {
+            if (table->sizes[id] == size) {
+                table_size = (table_size + size - 1) / size * size;
+                field_offsets[id] = table_size;
+                table_size += size;
+            }
+        }
+    }
+
+    fb_align(fb, 2);
+    const size_t vtable_position = fb->size;
+    append_le(fb, 4 + 2 * num_fields, 2);
+    append_le(fb, table_size, 2);
+    for (int id = 0; id < num_fields; id++) {
+        append_le(fb, field_offsets[id], 2);
+    }
+
+    fb_align(fb, 8);
+    const size_t table_position = fb->size;
+    uint8_t *out = reserve(fb, table_size);
+    put_le(out, table_position - vtable_position, 4);
+    for (int id = 0; id < num_fields; id++) {
+        if (table->sizes[id] > 0) {
+            put_le(out + field_offsets[id], table->values[id], table->sizes[id]);
+            table->positions[id] = table_position + field_offsets[id];
+        }
+    }
+    return table_position;
+}
+
+// Write the length of a vector and reserve its elements, which start 4 bytes after the returned position
+static size_t fb_vector(PsvBytes *fb, size_t length, size_t element_size, size_t alignment) {
+    fb_align(fb, 4);
+    while ((fb->size + 4) % alignment != 0) {
+        reserve(fb, 4);
+    }
+    const size_t position = fb->size;
+    append_le(fb, length, 4);
+    reserve(fb, length * element_size);
+    return position;
+}
+
+static size_t fb_string(PsvBytes *fb, const char *text) {
+    const size_t length = strlen(text);
+    fb_align(fb, 4);
+    const size_t position = fb->size;
+    append_le(fb, length, 4);
+    memcpy(reserve(fb, length + 1), text, length);
+    return position;
+}
+
+// Write a key and value pair of custom metadata for the offset at the given position
+static void fb_key_value(PsvBytes *fb, size_t position, const char *key, const char *value) {
+    FbTable key_value = {0};
+    fb_offset(&key_value, 0);
+    fb_offset(&key_value, 1);
+    fb_patch(fb, position, fb_table(fb, &key_value));
+    fb_patch(fb, key_value.positions[0], fb_string(fb, key));
+    fb_patch(fb, key_value.positions[1], fb_string(fb, value));
+}
+
+/**
+ * Messages
+ */
+
+// Start a message flatbuffer, returning the position of the header offset for the caller to patch
+static size_t begin_message(PsvBytes *fb, uint8_t header_type, uint64_t body_length) {
+    fb->size = 0;
+    reserve(fb, 4); // Root table offset
+
+    FbTable message = {0};
+    fb_scalar(&message, 0, 2, ARROW_METADATA_V5);
+    fb_scalar(&message, 1, 1, header_type);
+    fb_offset(&message, 2);
+    fb_scalar(&message, 3, 8, body_length);
+    fb_patch(fb, 0, fb_table(fb, &message));
+    return message.positions[2];
+}
+
+// Write the encapsulated message metadata, which the caller follows with the message body
+static void write_message(PsvArrowWriter *writer) {
+    PsvBytes *fb = &writer->message;
+    fb_align(fb, 8);
+
+    uint8_t prefix[8];
+    put_le(prefix, ARROW_CONTINUATION, 4);
+    put_le(prefix + 4, fb->size, 4);
+    fwrite(prefix, 1, sizeof(prefix), writer->output);
+    fwrite(fb->data, 1, fb->size, writer->output);
+}
+
+static uint8_t arrow_type_id(PsvArrowType type) {
+    switch (type) {
+        case PSV_ARROW_INT64: return ARROW_TYPE_INT;
+        case PSV_ARROW_FLOAT64: return ARROW_TYPE_FLOATING_POINT;
+        case PSV_ARROW_BOOL: return ARROW_TYPE_BOOL;
+        case PSV_ARROW_TIMESTAMP: return ARROW_TYPE_TIMESTAMP;
+        case PSV_ARROW_BINARY: return ARROW_TYPE_BINARY;
+        case PSV_ARROW_UUID: return ARROW_TYPE_FIXED_SIZE_BINARY;
+        case PSV_ARROW_UTF8: break;
+    }
+    return ARROW_TYPE_UTF8;
+}
+
+// Write a Field table for the offset at the given position
+static void write_field(PsvBytes *fb, size_t position, const char *name, PsvArrowType type) {
+    FbTable field = {0};
+    fb_offset(&field, 0);                       // name
+    fb_scalar(&field, 1, 1, true);              // nullable
+    fb_scalar(&field, 2, 1, arrow_type_id(type));
+    fb_offset(&field, 3);                       // type
+    fb_offset(&field, 5);                       // children
+    if (type == PSV_ARROW_UUID) {
+        fb_offset(&field, 6);                   // custom_metadata
+    }
+    fb_patch(fb, position, fb_table(fb, &field));
+    fb_patch(fb, field.positions[0], fb_string(fb, name));
+
+    FbTable type_table = {0};
+    if (type == PSV_ARROW_INT64) {
+        fb_scalar(&type_table, 0, 4, 64);       // bitWidth
+        fb_scalar(&type_table, 1, 1, true);     // is_signed
+    } else if (type == PSV_ARROW_FLOAT64) {
+        fb_scalar(&type_table, 0, 2, ARROW_PRECISION_DOUBLE);
+    } else if (type == PSV_ARROW_TIMESTAMP) {
+        fb_scalar(&type_table, 0, 2, ARROW_TIME_UNIT_NANOSECOND);
+        fb_offset(&type_table, 1);              // timezone
+    } else if (type == PSV_ARROW_UUID) {
+        fb_scalar(&type_table, 0, 4, PSV_UUID_SIZE);
+    }
+    fb_patch(fb, field.positions[3], fb_table(fb, &type_table));
+    if (type == PSV_ARROW_TIMESTAMP) {
+        fb_patch(fb, type_table.positions[1], fb_string(fb, "UTC"));
+    }
+
+    fb_patch(fb, field.positions[5], fb_vector(fb, 0, 4, 4));
+
+    if (type == PSV_ARROW_UUID) {
+        const size_t metadata = fb_vector(fb, 2, 4, 4);
+        fb_patch(fb, field.positions[6], metadata);
+        fb_key_value(fb, metadata + 4, "ARROW:extension:name", "arrow.uuid");
+        fb_key_value(fb, metadata + 8, "ARROW:extension:metadata", "");
+    }
+}
+
+static void write_schema(PsvArrowWriter *writer) {
+    PsvBytes *fb = &writer->message;
+    const PsvArrowBatch *batch = &writer->batch;
+    const size_t header = begin_message(fb, ARROW_HEADER_SCHEMA, 0);
+
+    FbTable schema = {0};
+    fb_scalar(&schema, 0, 2, 0);                // endianness: little
+    fb_offset(&schema, 1);                      // fields
+    fb_offset(&schema, 2);                      // custom_metadata
+    fb_patch(fb, header, fb_table(fb, &schema));
+
+    const size_t fields = fb_vector(fb, batch->num_columns, 4, 4);
+    fb_patch(fb, schema.positions[1], fields);
+    for (int i = 0; i < batch->num_columns; i++) {
+        write_field(fb, fields + 4 + 4 * i, batch->table->header_metadata[i].id, batch->columns[i].type);
+    }
+
+    const size_t metadata = fb_vector(fb, 1, 4, 4);
+    fb_patch(fb, schema.positions[2], metadata);
+    fb_key_value(fb, metadata + 4, "id", batch->table->id);
+
+    write_message(writer);
+}
+
+// Get the buffers of a column in the order Arrow expects them, returning how many there are
+static int column_buffers(const PsvArrowColumn *column, const PsvBytes **buffers, size_t *lengths) {
+    int num_buffers = 0;
+
+    // The validity bitmap may be left out when there are no nulls
+    buffers[num_buffers] = &column->validity;
+    lengths[num_buffers++] = (column->num_nulls > 0) ? column->validity.size : 0;
+
+    if (psv_arrow_is_variable_width(column->type)) {
+        buffers[num_buffers] = &column->offsets;
+        lengths[num_buffers++] = column->offsets.size;
+    }
+
+    buffers[num_buffers] = &column->values;
+    lengths[num_buffers++] = column->values.size;
+    return num_buffers;
+}
+
+static void write_record_batch(PsvArrowWriter *writer) {
+    PsvBytes *fb = &writer->message;
+    const PsvArrowBatch *batch = &writer->batch;
+    const PsvBytes *buffers[3];
+    size_t lengths[3];
+
+    size_t num_buffers = 0;
+    size_t body_length = 0;
+    for (int i = 0; i < batch->num_columns; i++) {
+        const int num_column_buffers = column_buffers(&batch->columns[i], buffers, lengths);
+        for (int j = 0; j < num_column_buffers; j++) {
+            body_length += pad8(lengths[j]);
+        }
+        num_buffers += num_column_buffers;
+    }
+
+    const size_t header = begin_message(fb, ARROW_HEADER_RECORD_BATCH, body_length);
+
+    FbTable record_batch = {0};
+    fb_scalar(&record_batch, 0, 8, batch->num_rows);   // length
+    fb_offset(&record_batch, 1);                        // nodes
+    fb_offset(&record_batch, 2);                        // buffers
+    fb_patch(fb, header, fb_table(fb, &record_batch));
+
+    // FieldNode structs of length and null count
+    const size_t nodes = fb_vector(fb, batch->num_columns, 16, 8);
+    fb_patch(fb, record_batch.positions[1], nodes);
+    for (int i = 0; i < batch->num_columns; i++) {
+        put_le(fb->data + nodes + 4 + 16 * i, batch->num_rows, 8);
+        put_le(fb->data + nodes + 4 + 16 * i + 8, batch->columns[i].num_nulls, 8);
+    }
+
+    // Buffer structs of offset and length within the body
+    const size_t buffer_list = fb_vector(fb, num_buffers, 16, 8);
+    fb_patch(fb, record_batch.positions[2], buffer_list);
+    size_t buffer_index = 0;
+    size_t body_offset = 0;
+    for (int i = 0; i < batch->num_columns; i++) {
+        const int num_column_buffers = column_buffers(&batch->columns[i], buffers, lengths);
+        for (int j = 0; j < num_column_buffers; j++) {
+            put_le(fb->data + buffer_list + 4 + 16 * buffer_index, body_offset, 8);
+            put_le(fb->data + buffer_list + 4 + 16 * buffer_index + 8, lengths[j], 8);
+            body_offset += pad8(lengths[j]);
+            buffer_index++;
+        }
+    }
+
+    write_message(writer);
+
+    static const uint8_t padding[8] = {0};
+    for (int i = 0; i < batch->num_columns; i++) {
+        const int num_column_buffers = column_buffers(&batch->columns[i], buffers, lengths);
+        for (int j = 0; j < num_column_buffers; j++) {
+            if (lengths[j] > 0) {
+                fwrite(buffers[j]->data, 1, lengths[j], writer->output);
+            }
+            fwrite(padding, 1, pad8(lengths[j]) - lengths[j], writer->output);
+        }
+    }
+}
+
+static void set_bit(PsvBytes *bitmap, size_t row, bool value) {
+    if (row % 8 == 0) {
+        reserve(bitmap, 1);
+    }
+    if (value) {
+        bitmap->data[row / 8] |= (uint8_t)(1u << (row % 8));
+    }
+}
+
+/**
+ * @brief Gets the Arrow type that a column is written as, from its data annotations.
+ *
+ * @param table The table.
+ * @param column The column index.
+ * @return The Arrow type of the column.
+ */
+PsvArrowType psv_arrow_column_type(PsvTable *table, int column) {
+    if (table->header_metadata[column].num_decode_stages > 0) {
+        return PSV_ARROW_BINARY;
+    }
+    if (psv_has_data_annotation(table, column, PSV_DATA_ANNOTATION_DATETIME)) {
+        return PSV_ARROW_TIMESTAMP;
+    }
+    if (psv_has_data_annotation(table, column, PSV_DATA_ANNOTATION_UUID)) {
+        return PSV_ARROW_UUID;
+    }
+
+    switch (psv_get_basic_type(table, column)) {
+        case PSV_DATA_ANNOTATION_INTEGER: return PSV_ARROW_INT64;
+        case PSV_DATA_ANNOTATION_FLOAT: return PSV_ARROW_FLOAT64;
+        case PSV_DATA_ANNOTATION_BOOL: return PSV_ARROW_BOOL;
+        default: break;
+    }
+    return PSV_ARROW_UTF8;
+}
+
+// Whether values of the type are stored as offsets into variable width data
+bool psv_arrow_is_variable_width(PsvArrowType type) {
+    return type == PSV_ARROW_UTF8 || type == PSV_ARROW_BINARY;
+}
+
+/**
+ * @brief Starts gathering rows of a table into column buffers.
+ *
+ * @param batch The batch to initialise. Release with psv_arrow_batch_free().
+ * @param table The table whose rows will be added.
+ */
+void psv_arrow_batch_init(PsvArrowBatch *batch, PsvTable *table) {
+    *batch = (PsvArrowBatch){0};
+    batch->table = table;
+    batch->num_columns = table->num_headers;
+    batch->columns = calloc(table->num_headers + 1, sizeof(PsvArrowColumn));
+    assert(batch->columns != NULL);
+    for (int i = 0; i < table->num_headers; i++) {
+        batch->columns[i].type = psv_arrow_column_type(table, i);
+    }
+    psv_arrow_batch_clear(batch);
+}
+
+void psv_arrow_batch_add_row(PsvArrowBatch *batch, PsvDataRow data_row) {
+    const size_t row = batch->num_rows;
+    for (int i = 0; i < batch->num_columns; i++) {
+        PsvArrowColumn *column = &batch->columns[i];
+        const char *cell = data_row[i];
+        const char *reason = NULL;
+        bool is_valid = (cell != NULL);
+
+        switch (column->type) {
+            case PSV_ARROW_INT64: {
+                is_valid = is_valid && psv_validate_get_type_validator(PSV_DATA_ANNOTATION_INTEGER)(cell, &reason);
+                append_le(&column->values, is_valid ? (uint64_t)strtoll(cell, NULL, 10) : 0, 8);
+            } break;
+            case PSV_ARROW_FLOAT64: {
+                is_valid = is_valid && psv_validate_get_type_validator(PSV_DATA_ANNOTATION_FLOAT)(cell, &reason);
+                const double value = is_valid ? strtod(cell, NULL) : 0.0;
+                uint64_t bits;
+                memcpy(&bits, &value, sizeof(bits));
+                append_le(&column->values, bits, 8);
+            } break;
+            case PSV_ARROW_BOOL: {
+                set_bit(&column->values, row, is_valid && psv_data_is_true(cell));
+            } break;
+            case PSV_ARROW_TIMESTAMP: {
+                int64_t epoch_ns = 0;
+                is_valid = is_valid && psv_datetime_parse(cell, &epoch_ns);
+                append_le(&column->values, is_valid ? (uint64_t)epoch_ns : 0, 8);
+            } break;
+            case PSV_ARROW_UUID: {
+                uint8_t uuid[PSV_UUID_SIZE];
+                is_valid = is_valid && psv_decode_uuid(cell, uuid, &reason);
+                if (!is_valid) {
+                    memset(uuid, 0, sizeof(uuid));
+                }
+                memcpy(reserve(&column->values, PSV_UUID_SIZE), uuid, PSV_UUID_SIZE);
+            } break;
+            case PSV_ARROW_BINARY: {
+                const PsvBytes *bytes = is_valid ? psv_decode_pipeline_bytes(&batch->table->header_metadata[i], cell, &batch->scratch, &reason) : NULL;
+                is_valid = (bytes != NULL);
+                if (is_valid && bytes->size > 0) {
+                    memcpy(reserve(&column->values, bytes->size), bytes->data, bytes->size);
+                }
+                append_le(&column->offsets, column->values.size, 4);
+            } break;
+            case PSV_ARROW_UTF8: {
+                if (is_valid) {
+                    const size_t size = strlen(cell);
+                    memcpy(reserve(&column->values, size), cell, size);
+                }
+                append_le(&column->offsets, column->values.size, 4);
+            } break;
+        }
+
+        set_bit(&column->validity, row, is_valid);
+        if (!is_valid) {
+            column->num_nulls++;
+        }
+    }
+    batch->num_rows++;
+}
+
+// Bytes held in the column buffers
+size_t psv_arrow_batch_data_size(const PsvArrowBatch *batch) {
+    size_t size = 0;
+    for (int i = 0; i < batch->num_columns; i++) {
+        size += batch->columns[i].validity.size + batch->columns[i].offsets.size + batch->columns[i].values.size;
+    }
+    return size;
+}
+
+// Whether a column holds so much data that the batch should be written out before its offsets could overflow
+bool psv_arrow_batch_is_full(const PsvArrowBatch *batch) {
+    for (int i = 0; i < batch->num_columns; i++) {
+        if (batch->columns[i].values.size >= ARROW_BATCH_DATA_MAX) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Empty the column buffers for the next batch, keeping their memory
+void psv_arrow_batch_clear(PsvArrowBatch *batch) {
+    for (int i = 0; i < batch->num_columns; i++) {
+        PsvArrowColumn *column = &batch->columns[i];
+        column->validity.size = 0;
+        column->offsets.size = 0;
+        column->values.size = 0;
+        column->num_nulls = 0;
+        if (psv_arrow_is_variable_width(column->type)) {
+            append_le(&column->offsets, 0, 4);
+        }
+    }
+    batch->num_rows = 0;
+}
+
+void psv_arrow_batch_free(PsvArrowBatch *batch) {
+    for (int i = 0; i < batch->num_columns; i++) {
+        psv_bytes_free(&batch->columns[i].validity);
+        psv_bytes_free(&batch->columns[i].offsets);
+        psv_bytes_free(&batch->columns[i].values);
+    }
+    free(batch->columns);
+    psv_decode_scratch_free(&batch->scratch);
+    *batch = (PsvArrowBatch){0};
+}
+
+/**
+ * @brief Starts writing a table as an Arrow IPC stream, by writing its schema message.
+ *
+ * @param writer The writer to initialise.
+ * @param output The output stream.
+ * @param table The table whose rows will be written.
+ * @param batch_size Most rows per record batch.
+ */
+void psv_arrow_writer_begin(PsvArrowWriter *writer, FILE *output, PsvTable *table, size_t batch_size) {
+    *writer = (PsvArrowWriter){0};
+    writer->output = output;
+    writer->batch_size = (batch_size > 0) ? batch_size : PSV_ARROW_DEFAULT_BATCH_SIZE;
+    psv_arrow_batch_init(&writer->batch, table);
+    write_schema(writer);
+}
+
+void psv_arrow_writer_write_row(PsvArrowWriter *writer, PsvDataRow data_row) {
+    psv_arrow_batch_add_row(&writer->batch, data_row);
+    if (writer->batch.num_rows >= writer->batch_size || psv_arrow_batch_is_full(&writer->batch)) {
+        write_record_batch(writer);
+        psv_arrow_batch_clear(&writer->batch);
+    }
+}
+
+/**
+ * @brief Writes the last record batch and the end of stream marker, and frees the writer.
+ *
+ * @param writer The writer.
+ */
+void psv_arrow_writer_end(PsvArrowWriter *writer) {
+    if (writer->batch.num_rows > 0) {
+        write_record_batch(writer);
+    }
+
+    const uint8_t end_of_stream[8] = {0xFF, 0xFF, 0xFF, 0xFF, 0, 0, 0, 0};
+    fwrite(end_of_stream, 1, sizeof(end_of_stream), writer->output);
+
+    psv_arrow_batch_free(&writer->batch);
+    psv_bytes_free(&writer->message);
+    *writer = (PsvArrowWriter){0};
+}
@@ -0,0 +1,75 @@
+/**
+ * @file psv_arrow.h
+ * @brief Apache Arrow IPC Stream Output Of Tables
+ *
+ * Copyright (C) 2024-2024 Brian Khuu <contact@briankhuu.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ */
+
+#ifndef PSV_ARROW_H
+#define PSV_ARROW_H
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "psv.h"
+#include "psv_decode.h"
+
+#define PSV_ARROW_DEFAULT_BATCH_SIZE 65536
+
+// Arrow type that a column is written as
+typedef enum {
+    PSV_ARROW_UTF8 = 0,
+    PSV_ARROW_INT64,
+    PSV_ARROW_FLOAT64,
+    PSV_ARROW_BOOL,
+    PSV_ARROW_TIMESTAMP,    ///< Nanoseconds since the Unix epoch, UTC
+    PSV_ARROW_BINARY,
+    PSV_ARROW_UUID,         ///< 16 byte fixed size binary with the arrow.uuid extension type
+} PsvArrowType;
+
+// Buffers of one column of the record batch being built
+typedef struct {
+    PsvArrowType type;
+    PsvBytes validity;      ///< Bit i % 8 of byte i / 8 is set if row i has a value
+    PsvBytes offsets;       ///< Variable width types only: int32 start offset of each row, then the end offset
+    PsvBytes values;        ///< Fixed width values, the bool bitmap, or the variable width data
+    size_t num_nulls;
+} PsvArrowColumn;
+
+// Rows of a table gathered into Arrow column buffers (also used to buffer Parquet row groups)
+typedef struct {
+    PsvTable *table;
+    size_t num_rows;
+    int num_columns;
+    PsvArrowColumn *columns;
+    PsvDecodeScratch scratch;
+} PsvArrowBatch;
+
+// Writes a table as an Arrow IPC stream: a schema message, record batches, then the end of stream marker
+typedef struct {
+    FILE *output;
+    size_t batch_size;      ///< Most rows per record batch
+    PsvArrowBatch batch;    ///< The record batch being built
+    PsvBytes message;       ///< Flatbuffer of the message being written
+} PsvArrowWriter;
+
+PsvArrowType psv_arrow_column_type(PsvTable *table, int column);
+bool psv_arrow_is_variable_width(PsvArrowType type);
+void psv_arrow_batch_init(PsvArrowBatch *batch, PsvTable *table);
+void psv_arrow_batch_add_row(PsvArrowBatch *batch, PsvDataRow data_row);
+size_t psv_arrow_batch_data_size(const PsvArrowBatch *batch);
+bool psv_arrow_batch_is_full(const PsvArrowBatch *batch);
+void psv_arrow_batch_clear(PsvArrowBatch *batch);
+void psv_arrow_batch_free(PsvArrowBatch *batch);
+
+void psv_arrow_writer_begin(PsvArrowWriter *writer, FILE *output, PsvTable *table, size_t batch_size);
+void psv_arrow_writer_write_row(PsvArrowWriter *writer, PsvDataRow data_row);
+void psv_arrow_writer_end(PsvArrowWriter *writer);
+
+#endif
@@ -0,0 +1,1146 @@
+/**
+ * @file psv_cbor.c
+ * @brief CBOR Encoding Of Tables And Decoding Of [cbor] Cells
+ *
+ * Copyright (C) 2024-2024 Brian Khuu <contact@briankhuu.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Encoding: rows are written as maps of column key to a native CBOR value of the column's type,
+ * with the semantic tag of the column's data annotation where the value fits the tag:
+ *
+ * - [int], [float] and [bool] cells become integers, floats (single precision when that is
+ *   lossless) and booleans. Cells that are not valid numbers stay text strings.
+ * - Binary cells become byte strings, decoded through the column's decode pipeline. A [cbor]
+ *   payload becomes an encoded CBOR data item (tag 24 around the byte string) if it is well formed.
+ * - [datetime] cells become a date/time string (tag 0), or epoch seconds (tag 1) with --datetime-as epoch.
+ * - [uuid] cells become a 16 byte binary UUID (tag 37).
+ *
+ * Decoding: [cbor] cells are converted to JSON following the CBOR to JSON advice of RFC 8949 section 6.1:
+ *
+ * - Integers and floats become numbers, with NaN and infinities as null.
+ * - Byte strings become text in the configured binary encoding (base64url by default), unless
+ *   an enclosing tag 21, 22 or 23 asks for base64url, base64 or hex.
+ * - Map keys that are not text strings are written as their JSON text.
+ * - Simple values other than true and false become null.
+ * - Tags are dropped and their content converted, except that a binary UUID (tag 37) becomes
+ *   its `8-4-4-4-12` string and a bignum (tags 2 and 3) of up to 8 bytes becomes a number.
+ *
+ * Decoding is strict: a truncated item, reserved additional information, a misplaced break or
+ * bytes left over after the item fail the whole cell.
+ */
+
+#include <string.h>
+#include <stdlib.h>
+#include <math.h>
+#include <assert.h>
+
+#include "psv_cbor.h"
+#include "psv_json.h"
+#include "psv_writer.h"
+#include "psv_validate.h"
+#include "cbor_constants.h"
+
+#ifdef NDEBUG
+    #define assert(expression) ((void)0)
+#endif
+
+#define CBOR_INFO_INDEFINITE 31
+#define CBOR_BREAK 0xFF
+
+typedef struct {
+    const uint8_t *data;
+    size_t size;
+    size_t offset;
+    PsvBinaryEncoding byte_encoding;
+    PsvBytes *string;           ///< Collects string chunks, NUL terminated
+    PsvBytes *text;             ///< Receives encoded byte strings
+    const char *reason;
+} CborReader;
+
+typedef struct {
+    uint8_t major;
+    uint8_t info;
+    uint64_t argument;
+} CborHead;
+
+static bool fail(CborReader *reader, const char *reason) {
+    reader->reason = reason;
+    return false;
+}
+
+static void append_bytes(PsvBytes *bytes, const uint8_t *data, size_t size) {
+    if (bytes->size + size + 1 > bytes->capacity) {
+        bytes->capacity = (bytes->size + size + 1) * 2;
+        bytes->data = realloc(bytes->data, bytes->capacity);
+        assert(bytes->data != NULL);
+    }
+    memcpy(bytes->data + bytes->size, data, size);
+    bytes->size += size;
+    bytes->data[bytes->size] = '\0';
+}
+
+static bool read_head(CborReader *reader, CborHead *head) {
+    if (reader->offset >= reader->size) {
+        return fail(reader, "truncated CBOR item");
+    }
+
+    const uint8_t initial = reader->data[reader->offset++];
+    head->major = initial >> 5;
+    head->info = initial & 0x1F;
+    head->argument = head->info;
+    if (head->info < 24) {
+        return true;
+    }
+    if (head->info == CBOR_INFO_INDEFINITE) {
+        if (head->major == PSV_CBOR_MAJOR_UNSIGNED || head->major == PSV_CBOR_MAJOR_NEGATIVE || head->major == PSV_CBOR_MAJOR_TAG) {
+            return fail(reader, "indefinite length on a CBOR integer or tag");
+        }
+        return true;
+    }
+    if (head->info > 27) {
+        return fail(reader, "reserved CBOR additional information");
+    }
+
+    // 1, 2, 4 or 8 byte big endian argument
+    const size_t length = (size_t)1 << (head->info - 24);
+    if (reader->size - reader->offset < length) {
+        return fail(reader, "truncated CBOR item");
+    }
+    head->argument = 0;
+    for (size_t i = 0; i < length; i++) {
+        head->argument = (head->argument << 8) | reader->data[reader->offset++];
+    }
+    return true;
+}
+
+// Read a definite or indefinite length string into reader->string (chunks of an indefinite string are concatenated)
+static bool read_string(CborReader *reader, const CborHead *head) {
+    reader->string->size = 0;
+    append_bytes(reader->string, (const uint8_t *)"", 0);
+
+    if (head->info != CBOR_INFO_INDEFINITE) {
+        if (head->argument > reader->size - reader->offset) {
+            return fail(reader, "truncated CBOR string");
+        }
+        append_bytes(reader->string, reader->data + reader->offset, head->argument);
+        reader->offset += head->argument;
+        return true;
+    }
+
+    while (true) {
+        if (reader->offset < reader->size && reader->data[reader->offset] == CBOR_BREAK) {
+            reader->offset++;
+            return true;
+        }
+
+        CborHead chunk;
+        if (!read_head(reader, &chunk)) {
+            return false;
+        }
+        if (chunk.major != head->major || chunk.info == CBOR_INFO_INDEFINITE) {
+            return fail(reader, "bad chunk in indefinite length CBOR string");
+        }
+        if (chunk.argument > reader->size - reader->offset) {
+            return fail(reader, "truncated CBOR string");
+        }
+        append_bytes(reader->string, reader->data + reader->offset, chunk.argument);
+        reader->offset += chunk.argument;
+    }
+}
+
+// Text strings must be valid UTF-8 (RFC 3629: no overlong forms, surrogates or code points past U+10FFFF)
+static bool is_valid_utf8(const uint8_t *data, size_t size) {
+    size_t i = 0;
+    while (i < size) {
+        const uint8_t lead = data[i];
+        if (lead < 0x80) {
+            i++;
+            continue;
+        }
+
+        size_t length;
+        uint8_t min = 0x80;
+        uint8_t max = 0xBF;
+        if (lead >= 0xC2 && lead <= 0xDF) {
+            length = 2;
+        } else if (lead >= 0xE0 && lead <= 0xEF) {
+            length = 3;
+            min = (lead == 0xE0) ? 0xA0 : 0x80;
+            max = (lead == 0xED) ? 0x9F : 0xBF;
+        } else if (lead >= 0xF0 && lead <= 0xF4) {
+            length = 4;
+            min = (lead == 0xF0) ? 0x90 : 0x80;
+            max = (lead == 0xF4) ? 0x8F : 0xBF;
+        } else {
+            return false;
+        }
+
+        if (size - i < length || data[i + 1] < min || data[i + 1] > max) {
+            return false;
+        }
+        for (size_t j = 2; j < length; j++) {
+            if ((data[i + j] & 0xC0) != 0x80) {
+                return false;
+            }
+        }
+        i += length;
+    }
+    return true;
+}
+
+// Half precision float (RFC 8949 appendix D)
+static double half_to_double(uint16_t half) {
+    const int exponent = (half >> 10) & 0x1F;
+    const int mantissa = half & 0x3FF;
+    double value;
+    if (exponent == 0) {
+        value = ldexp(mantissa, -24);
+    } else if (exponent != 31) {
+        value = ldexp(mantissa + 1024, exponent - 25);
+    } else {
+        value = (mantissa == 0) ? INFINITY : NAN;
+    }
+    return (half & 0x8000) ? -value : value;
+}
+
+static cJSON *create_number_json(double value) {
+    return isfinite(value) ? cJSON_CreateNumber(value) : cJSON_CreateNull();
+}
+
+static cJSON *read_item(CborReader *reader, int depth);
+
+// Tags with a JSON form of their own, or NULL to convert the tag content as it is
+static cJSON *read_known_tag(CborReader *reader, uint64_t tag) {
+    if (tag != CBOR_TAG_BINARY_UUID && tag != CBOR_TAG_UNSIGNED_BIGNUM && tag != CBOR_TAG_NEGATIVE_BIGNUM) {
+        return NULL;
+    }
+
+    const size_t content_offset = reader->offset;
+    CborHead content;
+    if (!read_head(reader, &content) || content.major != PSV_CBOR_MAJOR_BYTES || content.info == CBOR_INFO_INDEFINITE || content.argument > reader->size - reader->offset) {
+        reader->offset = content_offset;
+        return NULL;
+    }
+    const uint8_t *bytes = reader->data + reader->offset;
+
+    if (tag == CBOR_TAG_BINARY_UUID && content.argument == 16) {
+        char uuid[37];
+        size_t length = 0;
+        for (size_t i = 0; i < 16; i++) {
+            length += snprintf(uuid + length, sizeof(uuid) - length, (i == 4 || i == 6 || i == 8 || i == 10) ? "-%02x" : "%02x", bytes[i]);
+        }
+        reader->offset += content.argument;
+        return cJSON_CreateString(uuid);
+    }
+
+    if ((tag == CBOR_TAG_UNSIGNED_BIGNUM || tag == CBOR_TAG_NEGATIVE_BIGNUM) && content.argument <= 8) {
+        uint64_t value = 0;
+        for (size_t i = 0; i < content.argument; i++) {
+            value = (value << 8) | bytes[i];
+        }
+        reader->offset += content.argument;
+        return cJSON_CreateNumber((tag == CBOR_TAG_UNSIGNED_BIGNUM) ? (double)value : -1.0 - (double)value);
+    }
+
+    reader->offset = content_offset;
+    return NULL;
+}
+
+static cJSON *read_container(CborReader *reader, const CborHead *head, int depth) {
+    const bool is_map = head->major == PSV_CBOR_MAJOR_MAP;
+    const bool indefinite = head->info == CBOR_INFO_INDEFINITE;
+
+    // Every item takes at least one byte, which bounds the count before anything is allocated
+    if (!indefinite && head->argument > (reader->size - reader->offset) / (is_map ? 2 : 1)) {
+        fail(reader, "truncated CBOR container");
+        return NULL;
+    }
+
+    cJSON *container = is_map ? cJSON_CreateObject() : cJSON_CreateArray();
+    for (uint64_t i = 0; indefinite || i < head->argument; i++) {
+        if (indefinite && reader->offset < reader->size && reader->data[reader->offset] == CBOR_BREAK) {
+            reader->offset++;
+            break;
+        }
+
+        cJSON *key = NULL;
+        if (is_map && (key = read_item(reader, depth + 1)) == NULL) {
+            cJSON_Delete(container);
+            return NULL;
+        }
+
+        cJSON *value = read_item(reader, depth + 1);
+        if (value == NULL) {
+            cJSON_Delete(key);
+            cJSON_Delete(container);
+            return NULL;
+        }
+
+        if (!is_map) {
+            cJSON_AddItemToArray(container, value);
+            continue;
+        }
+
+        if (cJSON_IsString(key)) {
+            cJSON_AddItemToObject(container, key->valuestring, value);
+        } else {
+            char *key_string = cJSON_PrintUnformatted(key);
+            cJSON_AddItemToObject(container, key_string, value);
+            free(key_string);
+        }
+        cJSON_Delete(key);
+    }
+    return container;
+}
+
+static cJSON *read_item(CborReader *reader, int depth) {
+    if (depth > PSV_CBOR_DEPTH_MAX) {
+        fail(reader, "CBOR item nested too deeply");
+        return NULL;
+    }
+
+    CborHead head;
+    if (!read_head(reader, &head)) {
+        return NULL;
+    }
+
+    switch (head.major) {
+        case PSV_CBOR_MAJOR_UNSIGNED:
+            return cJSON_CreateNumber((double)head.argument);
+        case PSV_CBOR_MAJOR_NEGATIVE:
+            return cJSON_CreateNumber(-1.0 - (double)head.argument);
+        case PSV_CBOR_MAJOR_BYTES:
+            if (!read_string(reader, &head)) {
+                return NULL;
+            }
+            return cJSON_CreateString(psv_encode_binary(reader->byte_encoding, reader->string->data, reader->string->size, reader->text));
+        case PSV_CBOR_MAJOR_TEXT:
+            if (!read_string(reader, &head)) {
+                return NULL;
+            }
+            if (memchr(reader->string->data, '\0', reader->string->size) != NULL) {
+                fail(reader, "NUL character in CBOR text string");
+                return NULL;
+            }
+            if (!is_valid_utf8(reader->string->data, reader->string->size)) {
+                fail(reader, "invalid UTF-8 in CBOR text string");
+                return NULL;
+            }
+            return cJSON_CreateString((const char *)reader->string->data);
+        case PSV_CBOR_MAJOR_ARRAY:
+        case PSV_CBOR_MAJOR_MAP:
+            return read_container(reader, &head, depth);
+        case PSV_CBOR_MAJOR_TAG: {
+            cJSON *known = read_known_tag(reader, head.argument);
+            if (known != NULL) {
+                return known;
+            }
+
+            // Expected conversion tags pick the encoding of byte strings within their content
+            const PsvBinaryEncoding byte_encoding = reader->byte_encoding;
+            if (head.argument == CBOR_TAG_EXPECTED_CONVERSION_TO_BASE64URL_ENCODING) {
+                reader->byte_encoding = PSV_BINARY_AS_BASE64URL;
+            } else if (head.argument == CBOR_TAG_EXPECTED_CONVERSION_TO_BASE64_ENCODING) {
+                reader->byte_encoding = PSV_BINARY_AS_BASE64;
+            } else if (head.argument == CBOR_TAG_EXPECTED_CONVERSION_TO_BASE16_ENCODING) {
+                reader->byte_encoding = PSV_BINARY_AS_HEX;
+            }
+            cJSON *content = read_item(reader, depth + 1);
+            reader->byte_encoding = byte_encoding;
+            return content;
+        }
+        default:
+            break;
+    }
+
+    // Simple values and floats
+    switch (head.info) {
+        case CBOR_SIMPLE_VALUE_FALSE:
+            return cJSON_CreateFalse();
+        case CBOR_SIMPLE_VALUE_TRUE:
+            return cJSON_CreateTrue();
+        case 25:
+            return create_number_json(half_to_double((uint16_t)head.argument));
+        case 26: {
+            const uint32_t bits = (uint32_t)head.argument;
+            float value;
+            memcpy(&value, &bits, sizeof(value));
+            return create_number_json(value);
+        }
+        case 27: {
+            double value;
+            memcpy(&value, &head.argument, sizeof(value));
+            return create_number_json(value);
+        }
+        case CBOR_INFO_INDEFINITE:
+            fail(reader, "unexpected CBOR break");
+            return NULL;
+        default:
+            // null, undefined and unassigned simple values
+            return cJSON_CreateNull();
+    }
+}
+
+// Step over an item without converting it
+static bool skip_item(CborReader *reader, int depth) {
+    if (depth > PSV_CBOR_DEPTH_MAX) {
+        return fail(reader, "CBOR item nested too deeply");
+    }
+
+    CborHead head;
+    if (!read_head(reader, &head)) {
+        return false;
+    }
+
+    const bool indefinite = head.info == CBOR_INFO_INDEFINITE;
+    switch (head.major) {
+        case PSV_CBOR_MAJOR_BYTES:
+        case PSV_CBOR_MAJOR_TEXT: {
+            if (indefinite) {
+                if (!read_string(reader, &head)) {
+                    return false;
+                }
+            } else if (head.argument > reader->size - reader->offset) {
+                return fail(reader, "truncated CBOR string");
+            }
+            const uint8_t *text = indefinite ? reader->string->data : reader->data + reader->offset;
+            const size_t size = indefinite ? reader->string->size : head.argument;
+            if (!indefinite) {
+                reader->offset += head.argument;
+            }
+            if (head.major == PSV_CBOR_MAJOR_TEXT && !is_valid_utf8(text, size)) {
+                return fail(reader, "invalid UTF-8 in CBOR text string");
+            }
+            return true;
+        }
+        case PSV_CBOR_MAJOR_ARRAY:
+        case PSV_CBOR_MAJOR_MAP: {
+            const uint64_t num_items = (head.major == PSV_CBOR_MAJOR_MAP && !indefinite) ? head.argument * 2 : head.argument;
+            if (!indefinite && (head.argument > reader->size - reader->offset || num_items > reader->size - reader->offset)) {
+                return fail(reader, "truncated CBOR container");
+            }
+            for (uint64_t i = 0; indefinite || i < num_items; i++) {
+                if (indefinite && reader->offset < reader->size && reader->data[reader->offset] == CBOR_BREAK) {
+                    reader->offset++;
+                    return true;
+                }
+                if (!skip_item(reader, depth + 1)) {
+                    return false;
+                }
+            }
+            return true;
+        }
+        case PSV_CBOR_MAJOR_TAG:
+            return skip_item(reader, depth + 1);
+        case PSV_CBOR_MAJOR_SIMPLE:
+            return !indefinite || fail(reader, "unexpected CBOR break");
+        default:
+            return true;
+    }
+}
+
+/**
+ * @brief Checks that bytes hold exactly one well formed CBOR data item with valid UTF-8 text strings.
+ *
+ * @param data The encoded CBOR data item.
+ * @param size The number of bytes.
+ * @param reason Set to a short static description of the problem if the item is invalid.
+ * @return true if the item is well formed.
+ */
+bool psv_cbor_is_well_formed(const uint8_t *data, size_t size, const char **reason) {
+    static PsvDecodeScratch scratch = {0};
+    CborReader reader = {
+        .data = data,
+        .size = size,
+        .string = &scratch.buffers[0],
+        .text = &scratch.buffers[1],
+    };
+
+    if (skip_item(&reader, 0) && reader.offset != size) {
+        fail(&reader, "trailing bytes after CBOR item");
+    }
+    if (reader.reason != NULL) {
+        *reason = reader.reason;
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Decodes the bytes of a single CBOR data item to a JSON value.
+ *
+ * @param data The encoded CBOR data item.
+ * @param size The number of bytes, which must hold exactly one item.
+ * @param byte_encoding How byte strings within the item are written as text.
+ * @param scratch Reusable buffers, which should be kept across cells.
+ * @param reason Set to a short static description of the problem if the item is invalid.
+ * @return The JSON value, or NULL if the bytes are not a single well formed CBOR data item.
+ */
+cJSON *psv_cbor_to_json(const uint8_t *data, size_t size, PsvBinaryEncoding byte_encoding, PsvDecodeScratch *scratch, const char **reason) {
+    CborReader reader = {
+        .data = data,
+        .size = size,
+        .byte_encoding = (byte_encoding == PSV_BINARY_AS_TEXT) ? PSV_BINARY_AS_BASE64URL : byte_encoding,
+        .string = &scratch->buffers[0],
+        .text = &scratch->buffers[1],
+    };
+
+    cJSON *item = read_item(&reader, 0);
+    if (item != NULL && reader.offset != size) {
+        cJSON_Delete(item);
+        item = NULL;
+        fail(&reader, "trailing bytes after CBOR item");
+    }
+    if (item == NULL) {
+        *reason = reader.reason;
+    }
+    return item;
+}
+
+/**
+ * CBOR encoding
+ */
+
+static uint8_t *reserve_encoded(PsvCborEncoder *encoder, size_t size) {
+    PsvBytes *buffer = &encoder->buffer;
+    if (buffer->size + size > buffer->capacity) {
+        buffer->capacity = (buffer->size + size) * 2;
+        buffer->data = realloc(buffer->data, buffer->capacity);
+        assert(buffer->data != NULL);
+    }
+    uint8_t *out = buffer->data + buffer->size;
+    buffer->size += size;
+    return out;
+}
+
+// Write an item head with the argument in the shortest form (RFC 8949 section 4.2.1)
+void psv_cbor_encode_head(PsvCborEncoder *encoder, PsvCborMajorType major, uint64_t argument) {
+    const uint8_t initial = (uint8_t)(major << 5);
+    if (argument < 24) {
+        *reserve_encoded(encoder, 1) = initial | (uint8_t)argument;
+        return;
+    }
+
+    const uint8_t info = (argument <= UINT8_MAX) ? 24 : (argument <= UINT16_MAX) ? 25 : (argument <= UINT32_MAX) ? 26 : 27;
+    const size_t length = (size_t)1 << (info - 24);
+    uint8_t *out = reserve_encoded(encoder, 1 + length);
+    out[0] = initial | info;
+    for (size_t i = 0; i < length; i++) {
+        out[length - i] = (uint8_t)(argument >> (8 * i));
+    }
+}
+
+void psv_cbor_encode_indefinite(PsvCborEncoder *encoder, PsvCborMajorType major) {
+    *reserve_encoded(encoder, 1) = (uint8_t)(major << 5) | CBOR_INFO_INDEFINITE;
+}
+
+void psv_cbor_encode_break(PsvCborEncoder *encoder) {
+    *reserve_encoded(encoder, 1) = CBOR_BREAK;
+}
+
+void psv_cbor_encode_int(PsvCborEncoder *encoder, int64_t value) {
+    if (value >= 0) {
+        psv_cbor_encode_head(encoder, PSV_CBOR_MAJOR_UNSIGNED, (uint64_t)value);
+    } else {
+        // -1 - value without overflowing on INT64_MIN
+        psv_cbor_encode_head(encoder, PSV_CBOR_MAJOR_NEGATIVE, ~(uint64_t)value);
+    }
+}
+
+// Floats are written in single precision when that loses nothing, and in double precision otherwise
+void psv_cbor_encode_double(PsvCborEncoder *encoder, double value) {
+    const float single = (float)value;
+    if ((double)single == value || value != value) {
+        uint32_t bits;
+        memcpy(&bits, &single, sizeof(bits));
+        uint8_t *out = reserve_encoded(encoder, 5);
+        out[0] = (PSV_CBOR_MAJOR_SIMPLE << 5) | 26;
+        for (size_t i = 0; i < 4; i++) {
+            out[4 - i] = (uint8_t)(bits >> (8 * i));
+        }
+        return;
+    }
+
+    uint64_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    uint8_t *out = reserve_encoded(encoder, 9);
+    out[0] = (PSV_CBOR_MAJOR_SIMPLE << 5) | 27;
+    for (size_t i = 0; i < 8; i++) {
+        out[8 - i] = (uint8_t)(bits >> (8 * i));
+    }
+}
+
+void psv_cbor_encode_bool(PsvCborEncoder *encoder, bool value) {
+    *reserve_encoded(encoder, 1) = (PSV_CBOR_MAJOR_SIMPLE << 5) | (value ? CBOR_SIMPLE_VALUE_TRUE : CBOR_SIMPLE_VALUE_FALSE);
+}
+
+void psv_cbor_encode_null(PsvCborEncoder *encoder) {
+    *reserve_encoded(encoder, 1) = (PSV_CBOR_MAJOR_SIMPLE << 5) | CBOR_SIMPLE_VALUE_NULL;
+}
+
+static const uint8_t *make_key(PsvCborEncoder *encoder, const void *prefix, size_t prefix_size, const void *data, size_t size) {
+    PsvBytes *key = &encoder->key;
+    if (prefix_size + size > key->capacity) {
+        key->capacity = (prefix_size + size) * 2;
+        key->data = realloc(key->data, key->capacity);
+        assert(key->data != NULL);
+    }
+    memcpy(key->data, prefix, prefix_size);
+    memcpy(key->data + prefix_size, data, size);
+    key->size = prefix_size + size;
+    return key->data;
+}
+
+// Shortest string that the stringref spec numbers, given how many strings are numbered already
+static size_t stringref_min_size(size_t num_strings) {
+    return (num_strings < 24) ? 3 : (num_strings < 256) ? 4 : (num_strings < 65536) ? 5 : (num_strings < 4294967296ULL) ? 7 : 11;
+}
+
+// Size of a tag 25 or 29 reference to an index
+static size_t reference_size(size_t index) {
+    return 2 + ((index < 24) ? 1 : (index < 256) ? 2 : (index < 65536) ? 3 : (index < 4294967296ULL) ? 5 : 9);
+}
+
+static void encode_string(PsvCborEncoder *encoder, PsvCborMajorType major, const void *data, size_t size) {
+    if (encoder->packed && size >= stringref_min_size(encoder->num_strings)) {
+        // Keyed by major type as well, since a reference stands for a text or byte string as first written
+        const uint8_t major_byte = (uint8_t)major;
+        const char *key = (const char *)make_key(encoder, &major_byte, 1, data, size);
+        size_t index = encoder->num_strings;
+        if (psv_hash_map_find(&encoder->strings, key, encoder->key.size, &index)) {
+            psv_cbor_encode_head(encoder, PSV_CBOR_MAJOR_TAG, CBOR_TAG_REF_THE_NTH_PREV_SEEN_STRING);
+            psv_cbor_encode_head(encoder, PSV_CBOR_MAJOR_UNSIGNED, index);
+            return;
+        }
+
+        // The decoder numbers every string this long, so count it even when the map is full
+        if (encoder->strings.count < PSV_CBOR_PACKED_DICTIONARY_MAX) {
+            psv_hash_map_insert(&encoder->strings, key, encoder->key.size, &index);
+        }
+        encoder->num_strings++;
+    }
+
+    psv_cbor_encode_head(encoder, major, size);
+    memcpy(reserve_encoded(encoder, size), data, size);
+}
+
+void psv_cbor_encode_text(PsvCborEncoder *encoder, const char *text, size_t size) {
+    encode_string(encoder, PSV_CBOR_MAJOR_TEXT, text, size);
+}
+
+void psv_cbor_encode_bytes(PsvCborEncoder *encoder, const uint8_t *data, size_t size) {
+    encode_string(encoder, PSV_CBOR_MAJOR_BYTES, data, size);
+}
+
+/**
+ * @brief Starts a new namespace for packed mode, by writing tag 256 ahead of the next item.
+ *
+ * Stringrefs and shared value references only refer back within the item that follows, so
+ * the dictionaries are cleared. Does nothing unless the encoder is in packed mode.
+ *
+ * @param encoder The encoder.
+ */
+void psv_cbor_encode_namespace(PsvCborEncoder *encoder) {
+    if (!encoder->packed) {
+        return;
+    }
+
+    psv_hash_map_free(&encoder->strings);
+    psv_hash_map_free(&encoder->values);
+    psv_hash_map_init(&encoder->strings, 0);
+    psv_hash_map_init(&encoder->values, 0);
+    encoder->num_strings = 0;
+    encoder->num_shared = 0;
+
+    psv_cbor_encode_head(encoder, PSV_CBOR_MAJOR_TAG, CBOR_TAG_MARK_VALUE_AS_HAVING_STRING_REFERENCES);
+}
+
+/**
+ * @brief Encodes a JSON value, e.g. table metadata or the output of modes that build JSON.
+ *
+ * Numbers that are whole and fit in 64 bits are written as integers.
+ *
+ * @param encoder The encoder.
+ * @param item The JSON value.
+ */
+void psv_cbor_encode_json(PsvCborEncoder *encoder, const cJSON *item) {
+    if (cJSON_IsNumber(item)) {
+        const double value = item->valuedouble;
+        if (value == floor(value) && value >= -9223372036854775808.0 && value < 9223372036854775808.0) {
+            psv_cbor_encode_int(encoder, (int64_t)value);
+        } else {
+            psv_cbor_encode_double(encoder, value);
+        }
+    } else if (cJSON_IsString(item) || cJSON_IsRaw(item)) {
+        psv_cbor_encode_text(encoder, item->valuestring, strlen(item->valuestring));
+    } else if (cJSON_IsBool(item)) {
+        psv_cbor_encode_bool(encoder, cJSON_IsTrue(item));
+    } else if (cJSON_IsArray(item) || cJSON_IsObject(item)) {
+        const bool is_object = cJSON_IsObject(item);
+        psv_cbor_encode_head(encoder, is_object ? PSV_CBOR_MAJOR_MAP : PSV_CBOR_MAJOR_ARRAY, cJSON_GetArraySize(item));
+        for (const cJSON *child = item->child; child != NULL; child = child->next) {
+            if (is_object) {
+                psv_cbor_encode_text(encoder, child->string, strlen(child->string));
+            }
+            psv_cbor_encode_json(encoder, child);
+        }
+    } else {
+        psv_cbor_encode_null(encoder);
+    }
+}
+
+static void encode_datetime(PsvCborEncoder *encoder, const char *cell, int64_t epoch_ns) {
+    switch (encoder->datetime_encoding) {
+        case PSV_DATETIME_AS_EPOCH:
+        case PSV_DATETIME_AS_EPOCH_MS: {
+            psv_cbor_encode_head(encoder, PSV_CBOR_MAJOR_TAG, CBOR_TAG_EPOCH_BASED_DATE_TIME);
+            if (epoch_ns % PSV_NANOSECONDS_PER_SECOND == 0) {
+                psv_cbor_encode_int(encoder, epoch_ns / PSV_NANOSECONDS_PER_SECOND);
+            } else {
+                psv_cbor_encode_double(encoder, psv_datetime_epoch_seconds(epoch_ns));
+            }
+        } break;
+        case PSV_DATETIME_AS_ISO: {
+            char iso[PSV_DATETIME_STRING_MAX];
+            const size_t size = psv_datetime_format(epoch_ns, iso, sizeof(iso));
+            psv_cbor_encode_head(encoder, PSV_CBOR_MAJOR_TAG, CBOR_TAG_STD_DATE_TIME_STRING);
+            psv_cbor_encode_text(encoder, iso, size);
+        } break;
+        default:
+            psv_cbor_encode_head(encoder, PSV_CBOR_MAJOR_TAG, CBOR_TAG_STD_DATE_TIME_STRING);
+            psv_cbor_encode_text(encoder, cell, strlen(cell));
+            break;
+    }
+}
+
+// Value states of a cell in packed mode, other than the index of its shared value
+#define PSV_CBOR_VALUE_SEEN_ONCE SIZE_MAX
+#define PSV_CBOR_VALUE_NOT_SHARED (SIZE_MAX - 1)
+
+// Whether repeats of a column's cells are worth sharing (text is already covered by stringrefs)
+static bool is_shareable_column(PsvTable *table, int column) {
+    const PsvDataAnnotationType basic_type = psv_get_basic_type(table, column);
+    return table->header_metadata[column].num_decode_stages == 0 && (basic_type == PSV_DATA_ANNOTATION_INTEGER || basic_type == PSV_DATA_ANNOTATION_FLOAT || psv_has_data_annotation(table, column, PSV_DATA_ANNOTATION_DATETIME) || psv_has_data_annotation(table, column, PSV_DATA_ANNOTATION_UUID));
+}
+
+static void encode_cell_value(PsvCborEncoder *encoder, PsvTable *table, int column, const char *cell);
+
+/**
+ * @brief Encodes a cell as a native CBOR value of its column's type.
+ *
+ * In packed mode a typed cell is marked as shared (tag 28) the second time it is seen in its
+ * column, and written as a reference to the shared value (tag 29) from then on. Marking on the
+ * second sighting rather than the first keeps unique values free of the tag overhead.
+ *
+ * @param encoder The encoder.
+ * @param table The table the cell belongs to.
+ * @param column The index of the cell's column.
+ * @param cell The trimmed cell, or NULL if empty (written as null).
+ */
+void psv_cbor_encode_cell(PsvCborEncoder *encoder, PsvTable *table, int column, const char *cell) {
+    if (!encoder->packed || cell == NULL || !is_shareable_column(table, column)) {
+        encode_cell_value(encoder, table, column, cell);
+        return;
+    }
+
+    const int32_t column_key = column;
+    const char *key = (const char *)make_key(encoder, &column_key, sizeof(column_key), cell, strlen(cell));
+    size_t state_index = encoder->values.count;
+    if (psv_hash_map_find(&encoder->values, key, encoder->key.size, &state_index)) {
+        const size_t state = encoder->value_states[state_index];
+        if (state < PSV_CBOR_VALUE_NOT_SHARED) {
+            psv_cbor_encode_head(encoder, PSV_CBOR_MAJOR_TAG, CBOR_TAG_REF_NTH_MARKED_VALUE);
+            psv_cbor_encode_head(encoder, PSV_CBOR_MAJOR_UNSIGNED, state);
+            return;
+        }
+
+        const size_t value_offset = encoder->buffer.size;
+        encode_cell_value(encoder, table, column, cell);
+        if (state == PSV_CBOR_VALUE_NOT_SHARED) {
+            return;
+        }
+
+        // Second sighting: share the value if a reference is smaller than the value itself,
+        // unless it came out as a string (an invalid cell), which stringrefs already cover
+        const size_t value_size = encoder->buffer.size - value_offset;
+        const uint8_t value_major = encoder->buffer.data[value_offset] >> 5;
+        const bool is_string = value_major == PSV_CBOR_MAJOR_BYTES || value_major == PSV_CBOR_MAJOR_TEXT || (value_size >= 2 && encoder->buffer.data[value_offset] == 0xD8 && encoder->buffer.data[value_offset + 1] == CBOR_TAG_REF_THE_NTH_PREV_SEEN_STRING);
+        if (is_string || value_size <= reference_size(encoder->num_shared)) {
+            encoder->value_states[state_index] = PSV_CBOR_VALUE_NOT_SHARED;
+            return;
+        }
+
+        // Slip the tag 28 head in front of the value
+        reserve_encoded(encoder, 2);
+        uint8_t *value = encoder->buffer.data + value_offset;
+        memmove(value + 2, value, value_size);
+        value[0] = (PSV_CBOR_MAJOR_TAG << 5) | 24;
+        value[1] = CBOR_TAG_MARK_VALUE_AS_SHARED;
+        encoder->value_states[state_index] = encoder->num_shared++;
+        return;
+    }
+
+    if (encoder->values.count < PSV_CBOR_PACKED_DICTIONARY_MAX) {
+        psv_hash_map_insert(&encoder->values, key, encoder->key.size, &state_index);
+        if (state_index >= encoder->value_states_capacity) {
+            encoder->value_states_capacity = encoder->value_states_capacity ? encoder->value_states_capacity * 2 : 1024;
+            encoder->value_states = realloc(encoder->value_states, encoder->value_states_capacity * sizeof(size_t));
+            assert(encoder->value_states != NULL);
+        }
+        encoder->value_states[state_index] = PSV_CBOR_VALUE_SEEN_ONCE;
+    }
+    encode_cell_value(encoder, table, column, cell);
+}
+
+static void encode_cell_value(PsvCborEncoder *encoder, PsvTable *table, int column, const char *cell) {
+    if (cell == NULL) {
+        psv_cbor_encode_null(encoder);
+        return;
+    }
+
+    const PsvHeaderMetadataField *header_metadata = &table->header_metadata[column];
+    const char *reason = NULL;
+    if (header_metadata->num_decode_stages > 0) {
+        const PsvBytes *bytes = psv_decode_pipeline_bytes(header_metadata, cell, &encoder->scratch, &reason);
+        const bool is_cbor = psv_decode_pipeline_is_cbor(header_metadata);
+        if (bytes != NULL && (!is_cbor || psv_cbor_is_well_formed(bytes->data, bytes->size, &reason))) {
+            if (is_cbor) {
+                psv_cbor_encode_head(encoder, PSV_CBOR_MAJOR_TAG, CBOR_TAG_ENCODED_CBOR_DATA_ITEM);
+            }
+            psv_cbor_encode_bytes(encoder, bytes->data, bytes->size);
+            return;
+        }
+    } else if (psv_has_data_annotation(table, column, PSV_DATA_ANNOTATION_DATETIME)) {
+        int64_t epoch_ns;
+        if (psv_datetime_parse(cell, &epoch_ns)) {
+            encode_datetime(encoder, cell, epoch_ns);
+            return;
+        }
+    } else if (psv_has_data_annotation(table, column, PSV_DATA_ANNOTATION_UUID)) {
+        uint8_t uuid[PSV_UUID_SIZE];
+        if (psv_decode_uuid(cell, uuid, &reason)) {
+            psv_cbor_encode_head(encoder, PSV_CBOR_MAJOR_TAG, CBOR_TAG_BINARY_UUID);
+            psv_cbor_encode_bytes(encoder, uuid, PSV_UUID_SIZE);
+            return;
+        }
+    } else {
+        switch (psv_validate_cell_basic_type(table, column, cell)) {
+            case PSV_DATA_ANNOTATION_BOOL: psv_cbor_encode_bool(encoder, psv_data_is_true(cell)); return;
+            case PSV_DATA_ANNOTATION_INTEGER: psv_cbor_encode_int(encoder, strtoll(cell, NULL, 10)); return;
+            case PSV_DATA_ANNOTATION_FLOAT: psv_cbor_encode_double(encoder, strtod(cell, NULL)); return;
+            default: break;
+        }
+    }
+
+    // Text, or a cell that is not valid as its column's type
+    psv_cbor_encode_text(encoder, cell, strlen(cell));
+}
+
+// Encode a row as a map of column key to cell value
+void psv_cbor_encode_row(PsvCborEncoder *encoder, PsvTable *table, PsvDataRow data_row) {
+    psv_cbor_encode_head(encoder, PSV_CBOR_MAJOR_MAP, table->num_headers);
+    for (int i = 0; i < table->num_headers; i++) {
+        const char *key = table->header_metadata[i].id;
+        psv_cbor_encode_text(encoder, key, strlen(key));
+        psv_cbor_encode_cell(encoder, table, i, data_row[i]);
+    }
+}
+
+// Write out the encoded bytes and clear the buffer for the next item
+void psv_cbor_encoder_flush(PsvCborEncoder *encoder, FILE *output) {
+    fwrite(encoder->buffer.data, 1, encoder->buffer.size, output);
+    encoder->buffer.size = 0;
+}
+
+void psv_cbor_encoder_free(PsvCborEncoder *encoder) {
+    psv_bytes_free(&encoder->buffer);
+    psv_bytes_free(&encoder->key);
+    psv_decode_scratch_free(&encoder->scratch);
+    psv_hash_map_free(&encoder->strings);
+    psv_hash_map_free(&encoder->values);
+    free(encoder->value_states);
+    encoder->value_states = NULL;
+    encoder->value_states_capacity = 0;
+}
+
+/**
+ * CBOR columnar encoding
+ *
+ * Cells are gathered per column while rows stream in, then each column is written as a single
+ * value. [int] and [float] columns become RFC 8746 typed arrays (sint64 and binary64, little
+ * endian), whose contents can be copied straight into a vector by the reader. Empty cells are
+ * zero in the typed array and set in the column's null bitmap.
+ *
+ * A typed column that meets a cell which is not a valid number falls back to an array of
+ * encoded cells like any other column, so that the cell is written as text as in row output.
+ */
+
+static void write_le64(uint8_t *out, uint64_t value) {
+    for (int i = 0; i < 8; i++) {
+        out[i] = (uint8_t)(value >> (i * 8));
+    }
+}
+
+static uint64_t read_le64(const uint8_t *in) {
+    uint64_t value = 0;
+    for (int i = 0; i < 8; i++) {
+        value |= (uint64_t)in[i] << (i * 8);
+    }
+    return value;
+}
+
+static cbor_tag_t typed_array_tag(PsvTable *table, int column) {
+    if (table->header_metadata[column].num_decode_stages > 0 || psv_has_data_annotation(table, column, PSV_DATA_ANNOTATION_DATETIME) || psv_has_data_annotation(table, column, PSV_DATA_ANNOTATION_UUID)) {
+        return CBOR_TAG_INVALID_64BIT;
+    }
+
+    const PsvDataAnnotationType basic_type = psv_get_basic_type(table, column);
+    if (basic_type == PSV_DATA_ANNOTATION_INTEGER) {
+        return CBOR_TAG_SINT64_LITTLE_ENDIAN_TYPED_ARRAY;
+    }
+    if (basic_type == PSV_DATA_ANNOTATION_FLOAT) {
+        return CBOR_TAG_IEEE_754_BINARY64_LITTLE_ENDIAN_TYPED_ARRAY;
+    }
+    return CBOR_TAG_INVALID_64BIT;
+}
+
+static bool is_null_row(const PsvCborColumn *column, size_t row) {
+    return (column->nulls.data[row / 8] >> (row % 8)) & 1;
+}
+
+// Re-encode the elements gathered so far as encoded cells, which are the same values a row would have had
+static void demote_typed_column(PsvCborColumns *columns, PsvCborColumn *column) {
+    PsvCborEncoder *encoder = &columns->encoder;
+    encoder->buffer.size = 0;
+    for (size_t row = 0; row < columns->num_rows; row++) {
+        const uint64_t bits = read_le64(column->values.data + row * 8);
+        if (is_null_row(column, row)) {
+            psv_cbor_encode_null(encoder);
+        } else if (column->tag == CBOR_TAG_SINT64_LITTLE_ENDIAN_TYPED_ARRAY) {
+            psv_cbor_encode_int(encoder, (int64_t)bits);
+        } else {
+            double value;
+            memcpy(&value, &bits, sizeof(value));
+            psv_cbor_encode_double(encoder, value);
+        }
+    }
+
+    // Swap buffers so the column keeps the encoded cells and the encoder reuses the old elements
+    const PsvBytes cells = encoder->buffer;
+    encoder->buffer = column->values;
+    encoder->buffer.size = 0;
+    column->values = cells;
+    psv_bytes_free(&column->nulls);
+    column->num_nulls = 0;
+    column->tag = CBOR_TAG_INVALID_64BIT;
+}
+
+/**
+ * @brief Starts gathering the columns of a table.
+ *
+ * @param columns The columns to initialise. Release with psv_cbor_columns_free().
+ * @param table The table whose rows will be added.
+ * @param datetime_encoding How [datetime] cells are encoded.
+ */
+void psv_cbor_columns_init(PsvCborColumns *columns, PsvTable *table, PsvDatetimeEncoding datetime_encoding) {
+    *columns = (PsvCborColumns){0};
+    columns->encoder.datetime_encoding = datetime_encoding;
+    columns->num_columns = table->num_headers;
+    columns->columns = calloc(table->num_headers + 1, sizeof(PsvCborColumn));
+    assert(columns->columns != NULL);
+    for (int i = 0; i < table->num_headers; i++) {
+        columns->columns[i].tag = typed_array_tag(table, i);
+        append_bytes(&columns->columns[i].values, (const uint8_t *)"", 0); // Tables without rows still get a buffer
+    }
+}
+
+void psv_cbor_columns_add_row(PsvCborColumns *columns, PsvTable *table, PsvDataRow data_row) {
+    const size_t row = columns->num_rows;
+    for (int i = 0; i < columns->num_columns; i++) {
+        PsvCborColumn *column = &columns->columns[i];
+        const char *cell = data_row[i];
+        const char *reason = NULL;
+
+        if (column->tag != CBOR_TAG_INVALID_64BIT) {
+            const bool is_int = column->tag == CBOR_TAG_SINT64_LITTLE_ENDIAN_TYPED_ARRAY;
+            const PsvCellValidator validator = psv_validate_get_type_validator(is_int ? PSV_DATA_ANNOTATION_INTEGER : PSV_DATA_ANNOTATION_FLOAT);
+            if (cell == NULL || validator(cell, &reason)) {
+                uint64_t bits = 0;
+                if (cell != NULL && is_int) {
+                    bits = (uint64_t)strtoll(cell, NULL, 10);
+                } else if (cell != NULL) {
+                    const double value = strtod(cell, NULL);
+                    memcpy(&bits, &value, sizeof(bits));
+                }
+
+                if (row % 8 == 0) {
+                    const uint8_t no_nulls = 0;
+                    append_bytes(&column->nulls, &no_nulls, 1);
+                }
+                if (cell == NULL) {
+                    column->nulls.data[row / 8] |= (uint8_t)(1u << (row % 8));
+                    column->num_nulls++;
+                }
+
+                uint8_t element[8];
+                write_le64(element, bits);
+                append_bytes(&column->values, element, sizeof(element));
+                continue;
+            }
+
+            demote_typed_column(columns, column);
+        }
+
+        PsvCborEncoder *encoder = &columns->encoder;
+        psv_cbor_encode_cell(encoder, table, i, cell);
+        append_bytes(&column->values, encoder->buffer.data, encoder->buffer.size);
+        encoder->buffer.size = 0;
+    }
+    columns->num_rows++;
+}
+
+/**
+ * @brief Encodes the gathered columns as two entries, "columns" and "nulls", of the caller's map.
+ *
+ * "columns" maps each column key to its typed array or array of cells, and "nulls" maps the
+ * key of each typed array column that has empty cells to its null bitmap.
+ *
+ * @param columns The gathered columns.
+ * @param encoder The encoder to write to (not in packed mode, since columns are not in row order).
+ * @param table The table the rows were added from.
+ */
+void psv_cbor_columns_encode(PsvCborColumns *columns, PsvCborEncoder *encoder, PsvTable *table) {
+    assert(!encoder->packed);
+
+    psv_cbor_encode_text(encoder, "columns", strlen("columns"));
+    psv_cbor_encode_head(encoder, PSV_CBOR_MAJOR_MAP, columns->num_columns);
+    int num_null_bitmaps = 0;
+    for (int i = 0; i < columns->num_columns; i++) {
+        const PsvCborColumn *column = &columns->columns[i];
+        const char *key = table->header_metadata[i].id;
+        psv_cbor_encode_text(encoder, key, strlen(key));
+        if (column->tag == CBOR_TAG_INVALID_64BIT) {
+            psv_cbor_encode_head(encoder, PSV_CBOR_MAJOR_ARRAY, columns->num_rows);
+            memcpy(reserve_encoded(encoder, column->values.size), column->values.data, column->values.size);
+            continue;
+        }
+
+        psv_cbor_encode_head(encoder, PSV_CBOR_MAJOR_TAG, column->tag);
+        psv_cbor_encode_bytes(encoder, column->values.data, column->values.size);
+        if (column->num_nulls > 0) {
+            num_null_bitmaps++;
+        }
+    }
+
+    psv_cbor_encode_text(encoder, "nulls", strlen("nulls"));
+    psv_cbor_encode_head(encoder, PSV_CBOR_MAJOR_MAP, num_null_bitmaps);
+    for (int i = 0; i < columns->num_columns; i++) {
+        const PsvCborColumn *column = &columns->columns[i];
+        if (column->tag == CBOR_TAG_INVALID_64BIT || column->num_nulls == 0) {
+            continue;
+        }
+        const char *key = table->header_metadata[i].id;
+        psv_cbor_encode_text(encoder, key, strlen(key));
+        psv_cbor_encode_bytes(encoder, column->nulls.data, column->nulls.size);
+    }
+}
+
+void psv_cbor_columns_free(PsvCborColumns *columns) {
+    for (int i = 0; i < columns->num_columns; i++) {
+        psv_bytes_free(&columns->columns[i].values);
+        psv_bytes_free(&columns->columns[i].nulls);
+    }
+    free(columns->columns);
+    psv_cbor_encoder_free(&columns->encoder);
+    *columns = (PsvCborColumns){0};
+}
+
+// Encode the header metadata of a table as the first entries of a map of num_extra more entries
+static void encode_metadata_map(PsvCborEncoder *encoder, PsvTable *table, size_t num_extra) {
+    cJSON *metadata_json = psv_json_create_table_metadata_json(table);
+    psv_cbor_encode_head(encoder, PSV_CBOR_MAJOR_MAP, cJSON_GetArraySize(metadata_json) + num_extra);
+    for (const cJSON *child = metadata_json->child; child != NULL; child = child->next) {
+        psv_cbor_encode_text(encoder, child->string, strlen(child->string));
+        psv_cbor_encode_json(encoder, child);
+    }
+    cJSON_Delete(metadata_json);
+}
+
+/**
+ * Streaming table writer
+ *
+ * Writes the same shapes as the JSON table writer, as CBOR data items: a row map per item when
+ * streaming rows, an array of row maps in compact mode, or otherwise the header metadata map with
+ * the rows array as its last entry. The rows array is an indefinite length array since the number
+ * of rows is not known up front.
+ *
+ * In packed format, references only reach back within one item, so streamed rows are written as
+ * one array per table instead, sharing a single dictionary.
+ *
+ * In columnar mode the rows are gathered into columns instead, and each table is written as one
+ * item when the writer ends: the header metadata with "columns" and "nulls" entries, or only
+ * those two entries in compact mode (including when streaming rows).
+ */
+void psv_cbor_writer_begin(PsvCborWriter *writer, const PsvWriterOptions *options, FILE *output, PsvTable *table, bool compact_mode, bool streaming_rows) {
+    *writer = (PsvCborWriter){0};
+    writer->output = output;
+    writer->table = table;
+    writer->compact_mode = compact_mode;
+    writer->streaming_rows = streaming_rows;
+    writer->columnar = options->columnar;
+    writer->encoder.datetime_encoding = options->datetime_encoding;
+    writer->encoder.packed = (options->format == PSV_OUTPUT_CBOR_PACKED);
+
+    if ((writer->encoder.packed || writer->columnar) && streaming_rows) {
+        writer->compact_mode = true;
+        writer->streaming_rows = false;
+    }
+
+    if (writer->columnar) {
+        psv_cbor_columns_init(&writer->columns, table, options->datetime_encoding);
+        return;
+    }
+
+    if (writer->streaming_rows) {
+        return;
+    }
+
+    psv_cbor_encode_namespace(&writer->encoder);
+    if (!writer->compact_mode) {
+        encode_metadata_map(&writer->encoder, table, 1);
+        psv_cbor_encode_text(&writer->encoder, "rows", strlen("rows"));
+    }
+    psv_cbor_encode_indefinite(&writer->encoder, PSV_CBOR_MAJOR_ARRAY);
+    psv_cbor_encoder_flush(&writer->encoder, output);
+}
+
+void psv_cbor_writer_write_row(PsvCborWriter *writer, PsvDataRow data_row) {
+    if (writer->columnar) {
+        psv_cbor_columns_add_row(&writer->columns, writer->table, data_row);
+        return;
+    }
+
+    psv_cbor_encode_row(&writer->encoder, writer->table, data_row);
+    psv_cbor_encoder_flush(&writer->encoder, writer->output);
+}
+
+void psv_cbor_writer_end(PsvCborWriter *writer) {
+    if (writer->columnar) {
+        if (writer->compact_mode) {
+            psv_cbor_encode_head(&writer->encoder, PSV_CBOR_MAJOR_MAP, 2);
+        } else {
+            encode_metadata_map(&writer->encoder, writer->table, 2);
+        }
+        psv_cbor_columns_encode(&writer->columns, &writer->encoder, writer->table);
+        psv_cbor_encoder_flush(&writer->encoder, writer->output);
+        psv_cbor_columns_free(&writer->columns);
+    } else if (!writer->streaming_rows) {
+        psv_cbor_encode_break(&writer->encoder);
+        psv_cbor_encoder_flush(&writer->encoder, writer->output);
+    }
+    psv_cbor_encoder_free(&writer->encoder);
+}
@@ -0,0 +1,120 @@
+/**
+ * @file psv_cbor.h
+ * @brief CBOR Encoding Of Tables And Decoding Of [cbor] Cells
+ *
+ * Copyright (C) 2024-2024 Brian Khuu <contact@briankhuu.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ */
+
+#ifndef PSV_CBOR_H
+#define PSV_CBOR_H
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "psv.h"
+#include "cJSON.h"
+#include "psv_decode.h"
+#include "psv_datetime.h"
+#include "psv_hash.h"
+
+#define PSV_CBOR_DEPTH_MAX 64
+
+// Most strings and values that packed mode remembers per namespace, which bounds its memory use
+// (later repeats of strings and values past this are written out in full)
+#define PSV_CBOR_PACKED_DICTIONARY_MAX 262144
+
+// CBOR major types (RFC 8949 section 3.1)
+typedef enum {
+    PSV_CBOR_MAJOR_UNSIGNED = 0,
+    PSV_CBOR_MAJOR_NEGATIVE = 1,
+    PSV_CBOR_MAJOR_BYTES = 2,
+    PSV_CBOR_MAJOR_TEXT = 3,
+    PSV_CBOR_MAJOR_ARRAY = 4,
+    PSV_CBOR_MAJOR_MAP = 5,
+    PSV_CBOR_MAJOR_TAG = 6,
+    PSV_CBOR_MAJOR_SIMPLE = 7,
+} PsvCborMajorType;
+
+// Encodes CBOR data items into a buffer, which the caller writes out and clears between items
+typedef struct {
+    PsvBytes buffer;
+    PsvDecodeScratch scratch;           ///< Decode pipeline buffers for binary cells
+    PsvDatetimeEncoding datetime_encoding;
+
+    // Packed mode: repeated strings become stringrefs (tag 25) and repeated typed cells become
+    // shared value references (tag 29), within a namespace started by psv_cbor_encode_namespace()
+    bool packed;
+    PsvBytes key;                       ///< Scratch buffer for dictionary keys
+    PsvHashMap strings;                 ///< Major type and string bytes to stringref index
+    size_t num_strings;                 ///< Strings numbered so far, including those not kept in the map
+    PsvHashMap values;                  ///< Column and cell to an index into value_states
+    size_t *value_states;               ///< Shared value index of a cell, or a PSV_CBOR_VALUE_* state
+    size_t value_states_capacity;
+    size_t num_shared;                  ///< Values marked as shared so far
+} PsvCborEncoder;
+
+// A column gathered for columnar output
+typedef struct {
+    cbor_tag_t tag;             ///< RFC 8746 typed array tag, or CBOR_TAG_INVALID_64BIT for an array of encoded cells
+    PsvBytes values;            ///< Little endian typed array elements, or the encoded cells
+    PsvBytes nulls;             ///< Typed arrays only: bit i % 8 of byte i / 8 is set if row i is empty
+    size_t num_nulls;
+} PsvCborColumn;
+
+// Columns of a table gathered row by row, so that each can be written out as one array
+typedef struct {
+    PsvCborEncoder encoder;     ///< Encodes the cells of columns that are not typed arrays
+    int num_columns;
+    size_t num_rows;
+    PsvCborColumn *columns;
+} PsvCborColumns;
+
+// Output options, defined in psv_writer.h
+struct PsvWriterOptions;
+
+// Writes a table as CBOR data items one row at a time
+typedef struct {
+    FILE *output;
+    PsvTable *table;
+    bool compact_mode;
+    bool streaming_rows;
+    bool columnar;
+    PsvCborEncoder encoder;
+    PsvCborColumns columns;     ///< Rows gathered into columns in columnar mode
+} PsvCborWriter;
+
+cJSON *psv_cbor_to_json(const uint8_t *data, size_t size, PsvBinaryEncoding byte_encoding, PsvDecodeScratch *scratch, const char **reason);
+
+bool psv_cbor_is_well_formed(const uint8_t *data, size_t size, const char **reason);
+
+void psv_cbor_encode_head(PsvCborEncoder *encoder, PsvCborMajorType major, uint64_t argument);
+void psv_cbor_encode_indefinite(PsvCborEncoder *encoder, PsvCborMajorType major);
+void psv_cbor_encode_break(PsvCborEncoder *encoder);
+void psv_cbor_encode_int(PsvCborEncoder *encoder, int64_t value);
+void psv_cbor_encode_double(PsvCborEncoder *encoder, double value);
+void psv_cbor_encode_bool(PsvCborEncoder *encoder, bool value);
+void psv_cbor_encode_null(PsvCborEncoder *encoder);
+void psv_cbor_encode_text(PsvCborEncoder *encoder, const char *text, size_t size);
+void psv_cbor_encode_bytes(PsvCborEncoder *encoder, const uint8_t *data, size_t size);
+void psv_cbor_encode_namespace(PsvCborEncoder *encoder);
+void psv_cbor_encode_json(PsvCborEncoder *encoder, const cJSON *item);
+void psv_cbor_encode_cell(PsvCborEncoder *encoder, PsvTable *table, int column, const char *cell);
+void psv_cbor_encode_row(PsvCborEncoder *encoder, PsvTable *table, PsvDataRow data_row);
+void psv_cbor_encoder_flush(PsvCborEncoder *encoder, FILE *output);
+void psv_cbor_encoder_free(PsvCborEncoder *encoder);
+
+void psv_cbor_columns_init(PsvCborColumns *columns, PsvTable *table, PsvDatetimeEncoding datetime_encoding);
+void psv_cbor_columns_add_row(PsvCborColumns *columns, PsvTable *table, PsvDataRow data_row);
+void psv_cbor_columns_encode(PsvCborColumns *columns, PsvCborEncoder *encoder, PsvTable *table);
+void psv_cbor_columns_free(PsvCborColumns *columns);
+
+void psv_cbor_writer_begin(PsvCborWriter *writer, const struct PsvWriterOptions *options, FILE *output, PsvTable *table, bool compact_mode, bool streaming_rows);
+void psv_cbor_writer_write_row(PsvCborWriter *writer, PsvDataRow data_row);
+void psv_cbor_writer_end(PsvCborWriter *writer);
+
+#endif
@@ -0,0 +1,332 @@
+/**
+ * @file psv_datetime.c
+ * @brief Date/Time And Duration Helpers For [datetime] Cells
+ *
+ * Copyright (C) 2024-2024 Brian Khuu <contact@briankhuu.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Timestamps are handled as signed 64-bit nanoseconds since the Unix epoch (UTC), which covers
+ * the years 1678 to 2262. Parsing is done by hand rather than with strptime()/mktime() so it
+ * does not depend on the locale or the local timezone.
+ */
+
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <inttypes.h>
+
+#include "psv_datetime.h"
+
+// Days since 1970-01-01 of a proleptic Gregorian calendar date (Howard Hinnant's days_from_civil)
+static int64_t days_from_civil(int64_t year, unsigned month, unsigned day) {
+    year -= month <= 2;
+    const int64_t era = (year >= 0 ? year : year - 399) / 400;
+    const unsigned year_of_era = (unsigned)(year - era * 400);
+    const unsigned day_of_year = (153 * (month > 2 ? month - 3 : month + 9) + 2) / 5 + day - 1;
+    const unsigned day_of_era = year_of_era * 365 + year_of_era / 4 - year_of_era / 100 + day_of_year;
+    return era * 146097 + (int64_t)day_of_era - 719468;
+}
+
+// Inverse of days_from_civil()
+static void civil_from_days(int64_t days, int64_t *year, unsigned *month, unsigned *day) {
+    days += 719468;
+    const int64_t era = (days >= 0 ? days : days - 146096) / 146097;
+    const unsigned day_of_era = (unsigned)(days - era * 146097);
+    const unsigned year_of_era = (day_of_era - day_of_era / 1460 + day_of_era / 36524 - day_of_era / 146096) / 365;
+    const unsigned day_of_year = day_of_era - (365 * year_of_era + year_of_era / 4 - year_of_era / 100);
+    const unsigned month_prime = (5 * day_of_year + 2) / 153;
+    *day = day_of_year - (153 * month_prime + 2) / 5 + 1;
+    *month = month_prime < 10 ? month_prime + 3 : month_prime - 9;
+    *year = (int64_t)year_of_era + era * 400 + (*month <= 2);
+}
+
+static int days_in_month(int year, int month) {
+    static const int days[] = {31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
+    const bool leap_year = (year % 4 == 0 && year % 100 != 0) || year % 400 == 0;
+    return (month == 2 && leap_year) ? 29 : days[month - 1];
+}
+
+// Parse exactly `digits` decimal digits
+static bool parse_digits(const char **str, int digits, int *value) {
+    int result = 0;
+    for (int i = 0; i < digits; i++) {
+        const char c = (*str)[i];
+        if (c < '0' || c > '9') {
+            return false;
+        }
+        result = result * 10 + (c - '0');
+    }
+    *str += digits;
+    *value = result;
+    return true;
+}
+
+// Value of a decimal digit, flagging anything else in `invalid` (without branching on each digit)
+static inline unsigned digit_value(char c, unsigned *invalid) {
+    const unsigned value = (unsigned char)c - '0';
+    *invalid |= (value > 9);
+    return value;
+}
+
+/**
+ * @brief Parses an ISO 8601 date/time string into nanoseconds since the Unix epoch.
+ *
+ * Accepts `YYYY-MM-DD`, optionally followed by `T` (or a space) and `HH:MM`, `HH:MM:SS` or
+ * `HH:MM:SS.fraction`, optionally followed by `Z` or a `+HH:MM` / `-HH:MM` / `+HHMM` / `+HH` UTC offset.
+ * Offsets must be at most 23:59. Times without an offset are taken to be UTC.
+ *
+ * The fixed width date and time fields are read at known positions and all their digits are
+ * checked together, so the common `YYYY-MM-DDTHH:MM:SS` prefix costs a handful of branches
+ * rather than one or more per character.
+ *
+ * @param str The date/time string.
+ * @param epoch_ns Set to the number of nanoseconds since 1970-01-01T00:00:00Z.
+ * @return true if the whole string is a valid date/time, false otherwise.
+ */
+bool psv_datetime_parse(const char *str, int64_t *epoch_ns) {
+    int hour = 0, minute = 0, second = 0;
+    int64_t nanoseconds = 0;
+    int64_t offset_seconds = 0;
+
+    // Never read past the end of the string when checking the fixed width fields
+    const size_t length = strnlen(str, 19);
+    if (length < 10) {
+        return false;
+    }
+
+    unsigned invalid = (str[4] != '-') | (str[7] != '-');
+    const int year = digit_value(str[0], &invalid) * 1000 + digit_value(str[1], &invalid) * 100 + digit_value(str[2], &invalid) * 10 + digit_value(str[3], &invalid);
+    const int month = digit_value(str[5], &invalid) * 10 + digit_value(str[6], &invalid);
+    const int day = digit_value(str[8], &invalid) * 10 + digit_value(str[9], &invalid);
+    if (invalid) {
+        return false;
+    }
+    str += 10;
+
+    if (*str == 'T' || *str == 't' || *str == ' ') {
+        if (length < 16) {
+            return false;
+        }
+        invalid = (str[3] != ':');
+        hour = digit_value(str[1], &invalid) * 10 + digit_value(str[2], &invalid);
+        minute = digit_value(str[4], &invalid) * 10 + digit_value(str[5], &invalid);
+        if (invalid) {
+            return false;
+        }
+        str += 6;
+
+        if (*str == ':') {
+            if (length < 19) {
+                return false;
+            }
+            second = digit_value(str[1], &invalid) * 10 + digit_value(str[2], &invalid);
+            if (invalid) {
+                return false;
+            }
+            str += 3;
+
+            if (*str == '.' || *str == ',') {
+                str++;
+                int num_digits = 0;
+                while (*str >= '0' && *str <= '9') {
+                    // Digits beyond nanosecond precision are truncated
+                    if (num_digits < 9) {
+                        nanoseconds = nanoseconds * 10 + (*str - '0');
+                    }
+                    num_digits++;
+                    str++;
+                }
+                if (num_digits == 0) {
+                    return false;
+                }
+                static const int64_t scale[10] = {1000000000, 100000000, 10000000, 1000000, 100000, 10000, 1000, 100, 10, 1};
+                nanoseconds *= scale[(num_digits < 9) ? num_digits : 9];
+            }
+        }
+
+        if (*str == 'Z' || *str == 'z') {
+            str++;
+        } else if (*str == '+' || *str == '-') {
+            const int sign = (*str++ == '-') ? -1 : 1;
+            int offset_hours, offset_minutes = 0;
+            if (!parse_digits(&str, 2, &offset_hours)) {
+                return false;
+            }
+            if (*str == ':') {
+                str++;
+                if (!parse_digits(&str, 2, &offset_minutes)) {
+                    return false;
+                }
+            } else if (*str != '\0' && !parse_digits(&str, 2, &offset_minutes)) {
+                return false;
+            }
+            if (offset_hours > 23 || offset_minutes > 59) {
+                return false;
+            }
+            offset_seconds = sign * (offset_hours * 3600 + offset_minutes * 60);
+        }
+    }
+
+    // Leap seconds (second 60) are accepted and simply roll over into the next minute
+    if (*str != '\0' || hour > 23 || minute > 59 || second > 60) {
+        return false;
+    }
+
+    // Consecutive timestamps in a column mostly share their date, so remember the last date converted
+    static int cached_date = -1;
+    static int64_t cached_days = 0;
+    const int date = (year * 100 + month) * 100 + day;
+    if (date != cached_date) {
+        if (month < 1 || month > 12 || day < 1 || (day > 28 && day > days_in_month(year, month))) {
+            return false;
+        }
+        cached_date = date;
+        cached_days = days_from_civil(year, month, day);
+    }
+
+    const int64_t seconds = cached_days * 86400 + hour * 3600 + minute * 60 + second - offset_seconds;
+    if (seconds < INT64_MIN / PSV_NANOSECONDS_PER_SECOND + 1 || seconds > INT64_MAX / PSV_NANOSECONDS_PER_SECOND - 1) {
+        // Outside of the years 1678 to 2262 that fit in 64-bit nanoseconds
+        return false;
+    }
+    *epoch_ns = seconds * PSV_NANOSECONDS_PER_SECOND + nanoseconds;
+    return true;
+}
+
+/**
+ * @brief Converts nanoseconds since the Unix epoch to seconds, with a fraction if needed.
+ *
+ * The whole seconds and the fraction are converted separately, as a double cannot hold every
+ * 64-bit nanosecond count exactly (e.g. `.25` seconds would otherwise come out as `.2499998`).
+ *
+ * @param epoch_ns Nanoseconds since 1970-01-01T00:00:00Z.
+ * @return Seconds since 1970-01-01T00:00:00Z.
+ */
+double psv_datetime_epoch_seconds(int64_t epoch_ns) {
+    int64_t seconds = epoch_ns / PSV_NANOSECONDS_PER_SECOND;
+    int64_t nanoseconds = epoch_ns % PSV_NANOSECONDS_PER_SECOND;
+    if (nanoseconds < 0) {
+        seconds--;
+        nanoseconds += PSV_NANOSECONDS_PER_SECOND;
+    }
+    return (double)seconds + (double)nanoseconds / PSV_NANOSECONDS_PER_SECOND;
+}
+
+/**
+ * @brief Formats nanoseconds since the Unix epoch as an ISO 8601 UTC date/time string.
+ *
+ * The fractional part is only included when non zero, and trailing zeros are trimmed
+ * (e.g. `2024-03-01T12:00:00Z` or `2024-03-01T12:00:00.25Z`).
+ *
+ * @param epoch_ns Nanoseconds since 1970-01-01T00:00:00Z.
+ * @param buffer Output buffer, at least PSV_DATETIME_STRING_MAX bytes for any timestamp.
+ * @param buffer_size Size of the output buffer.
+ * @return The length of the formatted string (as snprintf()).
+ */
+size_t psv_datetime_format(int64_t epoch_ns, char *buffer, size_t buffer_size) {
+    int64_t seconds = epoch_ns / PSV_NANOSECONDS_PER_SECOND;
+    int64_t nanoseconds = epoch_ns % PSV_NANOSECONDS_PER_SECOND;
+    if (nanoseconds < 0) {
+        seconds--;
+        nanoseconds += PSV_NANOSECONDS_PER_SECOND;
+    }
+
+    int64_t days = seconds / 86400;
+    int64_t second_of_day = seconds % 86400;
+    if (second_of_day < 0) {
+        days--;
+        second_of_day += 86400;
+    }
+
+    int64_t year;
+    unsigned month, day;
+    civil_from_days(days, &year, &month, &day);
+
+    char fraction[12] = "";
+    if (nanoseconds != 0) {
+        int digits = 9;
+        while (nanoseconds % 10 == 0) {
+            nanoseconds /= 10;
+            digits--;
+        }
+        snprintf(fraction, sizeof(fraction), ".%0*" PRId64, digits, nanoseconds);
+    }
+
+    return snprintf(buffer, buffer_size, "%04" PRId64 "-%02u-%02uT%02d:%02d:%02d%sZ",
+                    year, month, day, (int)(second_of_day / 3600), (int)(second_of_day / 60 % 60), (int)(second_of_day % 60), fraction);
+}
+
+/**
+ * @brief Parses a duration such as `500ms`, `30s`, `5m`, `1h`, `1d` or `2w`.
+ *
+ * A number without a unit is taken to be in seconds.
+ *
+ * @param str The duration string.
+ * @param duration_ns Set to the duration in nanoseconds.
+ * @return true if the string is a valid positive duration, false otherwise.
+ */
+bool psv_duration_parse(const char *str, int64_t *duration_ns) {
+    static const struct {
+        const char *unit;
+        int64_t nanoseconds;
+    } duration_units[] = {
+        {"ns", 1},
+        {"us", 1000},
+        {"ms", 1000000},
+        {"s", PSV_NANOSECONDS_PER_SECOND},
+        {"", PSV_NANOSECONDS_PER_SECOND},
+        {"m", 60 * PSV_NANOSECONDS_PER_SECOND},
+        {"h", 3600 * PSV_NANOSECONDS_PER_SECOND},
+        {"d", 86400 * PSV_NANOSECONDS_PER_SECOND},
+        {"w", 7 * 86400 * PSV_NANOSECONDS_PER_SECOND},
+    };
+
+    char *end = NULL;
+    const long long value = strtoll(str, &end, 10);
+    if (end == str || value <= 0) {
+        return false;
+    }
+
+    for (size_t i = 0; i < sizeof(duration_units) / sizeof(duration_units[0]); i++) {
+        if (strcmp(end, duration_units[i].unit) == 0) {
+            if (value > INT64_MAX / duration_units[i].nanoseconds) {
+                return false;
+            }
+            *duration_ns = value * duration_units[i].nanoseconds;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/**
+ * @brief Parses the name of a date/time output encoding (text, iso, epoch or epoch_ms).
+ *
+ * @param name The encoding name.
+ * @param encoding Set to the parsed encoding.
+ * @return true if the name is known, false otherwise.
+ */
+bool psv_datetime_encoding_parse(const char *name, PsvDatetimeEncoding *encoding) {
+    static const struct {
+        const char *name;
+        PsvDatetimeEncoding encoding;
+    } encodings[] = {
+        {"text", PSV_DATETIME_AS_TEXT},
+        {"iso", PSV_DATETIME_AS_ISO},
+        {"epoch", PSV_DATETIME_AS_EPOCH},
+        {"epoch_ms", PSV_DATETIME_AS_EPOCH_MS},
+    };
+
+    for (size_t i = 0; i < sizeof(encodings) / sizeof(encodings[0]); i++) {
+        if (strcmp(name, encodings[i].name) == 0) {
+            *encoding = encodings[i].encoding;
+            return true;
+        }
+    }
+    return false;
+}
@@ -0,0 +1,38 @@
+/**
+ * @file psv_datetime.h
+ * @brief Date/Time And Duration Helpers For [datetime] Cells
+ *
+ * Copyright (C) 2024-2024 Brian Khuu <contact@briankhuu.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ */
+
+#ifndef PSV_DATETIME_H
+#define PSV_DATETIME_H
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define PSV_NANOSECONDS_PER_SECOND 1000000000LL
+
+// Large enough for "-YYYYYY-MM-DDTHH:MM:SS.nnnnnnnnnZ"
+#define PSV_DATETIME_STRING_MAX 40
+
+// How [datetime] cells are written to text based outputs such as JSON
+typedef enum {
+    PSV_DATETIME_AS_TEXT = 0,   ///< The cell as it is written in the table
+    PSV_DATETIME_AS_ISO,        ///< Normalised ISO 8601 UTC string
+    PSV_DATETIME_AS_EPOCH,      ///< Seconds since the Unix epoch, with a fraction if needed (as CBOR tag 1)
+    PSV_DATETIME_AS_EPOCH_MS,   ///< Whole milliseconds since the Unix epoch
+} PsvDatetimeEncoding;
+
+bool psv_datetime_parse(const char *str, int64_t *epoch_ns);
+size_t psv_datetime_format(int64_t epoch_ns, char *buffer, size_t buffer_size);
+double psv_datetime_epoch_seconds(int64_t epoch_ns);
+bool psv_duration_parse(const char *str, int64_t *duration_ns);
+bool psv_datetime_encoding_parse(const char *name, PsvDatetimeEncoding *encoding);
+
+#endif
@@ -0,0 +1,445 @@
+/**
+ * @file psv_decode.c
+ * @brief Decoding Of Binary PSV Cells ([hex], [base64] and [dataURI]) To Raw Bytes
+ *
+ * Copyright (C) 2024-2024 Brian Khuu <contact@briankhuu.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * The decoders are strict: they accept exactly what --validate accepts for the same annotation
+ * and reject anything else with a short reason, rather than skipping stray characters.
+ *
+ * Decoding is table driven. Each input character is looked up in a 256 entry table that gives
+ * its value, with invalid characters mapped to a value with the high bits set. A whole group
+ * (two hex digits or four base64 characters) is then combined and checked for invalid
+ * characters with a single branch, so the inner loops stay branch light on large cells.
+ */
+
+#include <string.h>
+#include <stdlib.h>
+#include <assert.h>
+
+#include "psv_decode.h"
+
+#ifdef NDEBUG
+    #define assert(expression) ((void)0)
+#endif
+
+#define INVALID 0xFF
+
+// Base64 alphabet flags, to reject cells that mix the standard and URL safe alphabets
+enum {
+    ALPHABET_STANDARD = 1 << 0,
+    ALPHABET_URL = 1 << 1,
+};
+
+static uint8_t hex_values[256];
+static uint8_t base64_values[256];
+static uint8_t base64_alphabets[256];
+static const char hex_digits[] = "0123456789abcdef";
+static const char base64_standard[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+static const char base64_url[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789-_";
+
+static void init_decode_tables(void) {
+    if (hex_values[0] == INVALID) {
+        return;
+    }
+
+    memset(hex_values, INVALID, sizeof(hex_values));
+    memset(base64_values, INVALID, sizeof(base64_values));
+    for (int i = 0; i < 16; i++) {
+        hex_values[(uint8_t)hex_digits[i]] = i;
+        hex_values[(uint8_t)"0123456789ABCDEF"[i]] = i;
+    }
+    for (int i = 0; i < 64; i++) {
+        base64_values[(uint8_t)base64_standard[i]] = i;
+        base64_values[(uint8_t)base64_url[i]] = i;
+    }
+    base64_alphabets['+'] = base64_alphabets['/'] = ALPHABET_STANDARD;
+    base64_alphabets['-'] = base64_alphabets['_'] = ALPHABET_URL;
+}
+
+static uint8_t *reserve_bytes(PsvBytes *bytes, size_t size) {
+    if (size + 1 > bytes->capacity) {
+        bytes->capacity = (size + 1) * 2;
+        bytes->data = realloc(bytes->data, bytes->capacity);
+        assert(bytes->data != NULL);
+    }
+    return bytes->data;
+}
+
+/**
+ * @brief Decodes a [hex] cell, with an optional `0x` prefix.
+ *
+ * @param cell The trimmed cell.
+ * @param bytes Reusable buffer that receives the decoded bytes.
+ * @param reason Set to a short static description of the problem if the cell is invalid.
+ * @return true if the cell was decoded, false if it is not valid hex.
+ */
+bool psv_decode_hex(const char *cell, PsvBytes *bytes, const char **reason) {
+    init_decode_tables();
+
+    const char *digits = cell;
+    if (digits[0] == '0' && (digits[1] == 'x' || digits[1] == 'X')) {
+        digits += 2;
+    }
+
+    const size_t length = strlen(digits);
+    if (length == 0) {
+        *reason = "not hexadecimal";
+        return false;
+    }
+    if (length % 2 != 0) {
+        *reason = "odd number of hex digits";
+        return false;
+    }
+
+    uint8_t *out = reserve_bytes(bytes, length / 2);
+    const uint8_t *in = (const uint8_t *)digits;
+    for (size_t i = 0; i < length / 2; i++) {
+        const uint8_t high = hex_values[in[2 * i]];
+        const uint8_t low = hex_values[in[2 * i + 1]];
+        if ((high | low) & 0xF0) {
+            *reason = "not hexadecimal";
+            return false;
+        }
+        out[i] = (high << 4) | low;
+    }
+
+    bytes->size = length / 2;
+    return true;
+}
+
+// Decode a base64 payload of a known length (the payload does not need to be NUL terminated)
+static bool decode_base64(const char *payload, size_t length, PsvBytes *bytes, const char **reason) {
+    init_decode_tables();
+
+    // Strip up to two padding characters, which must then make up a whole group
+    size_t padding = 0;
+    while (padding < 2 && length > 0 && payload[length - 1] == '=') {
+        length--;
+        padding++;
+    }
+    if ((padding > 0 && (length + padding) % 4 != 0) || length % 4 == 1) {
+        *reason = "bad base64 length or padding";
+        return false;
+    }
+
+    const size_t num_groups = length / 4;
+    const size_t tail = length % 4;
+    uint8_t *out = reserve_bytes(bytes, num_groups * 3 + 2);
+    const uint8_t *in = (const uint8_t *)payload;
+    uint8_t alphabets = 0;
+    for (size_t i = 0; i < num_groups; i++, in += 4, out += 3) {
+        const uint8_t a = base64_values[in[0]];
+        const uint8_t b = base64_values[in[1]];
+        const uint8_t c = base64_values[in[2]];
+        const uint8_t d = base64_values[in[3]];
+        if ((a | b | c | d) & 0xC0) {
+            *reason = "not base64";
+            return false;
+        }
+        alphabets |= base64_alphabets[in[0]] | base64_alphabets[in[1]] | base64_alphabets[in[2]] | base64_alphabets[in[3]];
+
+        const uint32_t group = ((uint32_t)a << 18) | ((uint32_t)b << 12) | ((uint32_t)c << 6) | d;
+        out[0] = group >> 16;
+        out[1] = group >> 8;
+        out[2] = group;
+    }
+
+    // Last partial group of 2 or 3 characters
+    if (tail > 0) {
+        uint32_t group = 0;
+        for (size_t i = 0; i < tail; i++) {
+            const uint8_t value = base64_values[in[i]];
+            if (value & 0xC0) {
+                *reason = "not base64";
+                return false;
+            }
+            alphabets |= base64_alphabets[in[i]];
+            group |= (uint32_t)value << (18 - 6 * i);
+        }
+        out[0] = group >> 16;
+        if (tail == 3) {
+            out[1] = group >> 8;
+        }
+    }
+
+    if (alphabets == (ALPHABET_STANDARD | ALPHABET_URL)) {
+        *reason = "not base64";
+        return false;
+    }
+
+    bytes->size = num_groups * 3 + (tail > 0 ? tail - 1 : 0);
+    return true;
+}
+
+/**
+ * @brief Decodes a [base64] cell, in either the standard or URL safe alphabet (but not a mix).
+ *
+ * Padding is optional, but if present it must complete the last group.
+ *
+ * @param cell The trimmed cell.
+ * @param bytes Reusable buffer that receives the decoded bytes.
+ * @param reason Set to a short static description of the problem if the cell is invalid.
+ * @return true if the cell was decoded, false if it is not valid base64.
+ */
+bool psv_decode_base64(const char *cell, PsvBytes *bytes, const char **reason) {
+    return decode_base64(cell, strlen(cell), bytes, reason);
+}
+
+/**
+ * @brief Decodes the payload of a [dataURI] cell (RFC 2397).
+ *
+ * Payloads marked `;base64` are decoded as base64, others are URL percent decoded.
+ * The media type is not kept.
+ *
+ * @param cell The trimmed cell.
+ * @param bytes Reusable buffer that receives the decoded bytes.
+ * @param reason Set to a short static description of the problem if the cell is invalid.
+ * @return true if the cell was decoded, false if it is not a valid data URI.
+ */
+bool psv_decode_data_uri(const char *cell, PsvBytes *bytes, const char **reason) {
+    init_decode_tables();
+
+    const char *comma = strchr(cell, ',');
+    if (strncmp(cell, "data:", 5) != 0 || comma == NULL) {
+        *reason = "not a data URI";
+        return false;
+    }
+
+    const char *payload = comma + 1;
+    const size_t length = strlen(payload);
+    if (comma - cell >= 12 && strncmp(comma - 7, ";base64", 7) == 0) {
+        return decode_base64(payload, length, bytes, reason);
+    }
+
+    uint8_t *out = reserve_bytes(bytes, length);
+    size_t size = 0;
+    for (size_t i = 0; i < length; i++) {
+        if (payload[i] != '%') {
+            out[size++] = payload[i];
+            continue;
+        }
+
+        const uint8_t high = (i + 1 < length) ? hex_values[(uint8_t)payload[i + 1]] : INVALID;
+        const uint8_t low = (i + 2 < length) ? hex_values[(uint8_t)payload[i + 2]] : INVALID;
+        if ((high | low) & 0xF0) {
+            *reason = "bad percent escape in data URI";
+            return false;
+        }
+        out[size++] = (high << 4) | low;
+        i += 2;
+    }
+
+    bytes->size = size;
+    return true;
+}
+
+/**
+ * @brief Decodes a [uuid] cell in the `8-4-4-4-12` hex digit form into its 16 bytes.
+ *
+ * Hex digits may be in either case, so UUIDs that differ only in case decode to the same bytes.
+ *
+ * @param cell The trimmed cell.
+ * @param uuid Receives the 16 bytes of the UUID.
+ * @param reason Set to a short static description of the problem if the cell is invalid.
+ * @return true if the cell was decoded, false if it is not a UUID.
+ */
+bool psv_decode_uuid(const char *cell, uint8_t uuid[PSV_UUID_SIZE], const char **reason) {
+    init_decode_tables();
+
+    // Offsets of the first hex digit of each byte
+    static const uint8_t byte_offsets[PSV_UUID_SIZE] = {0, 2, 4, 6, 9, 11, 14, 16, 19, 21, 24, 26, 28, 30, 32, 34};
+
+    if (strnlen(cell, 37) != 36 || cell[8] != '-' || cell[13] != '-' || cell[18] != '-' || cell[23] != '-') {
+        *reason = "not a UUID";
+        return false;
+    }
+
+    uint8_t invalid = 0;
+    for (int i = 0; i < PSV_UUID_SIZE; i++) {
+        const uint8_t high = hex_values[(uint8_t)cell[byte_offsets[i]]];
+        const uint8_t low = hex_values[(uint8_t)cell[byte_offsets[i] + 1]];
+        invalid |= high | low;
+        uuid[i] = (high << 4) | low;
+    }
+    if (invalid & 0xF0) {
+        *reason = "not a UUID";
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Decodes a cell of a binary data annotation type.
+ *
+ * @param type PSV_DATA_ANNOTATION_HEX, PSV_DATA_ANNOTATION_BASE64 or PSV_DATA_ANNOTATION_DATA_URI.
+ * @param cell The trimmed cell.
+ * @param bytes Reusable buffer that receives the decoded bytes.
+ * @param reason Set to a short static description of the problem if the cell is invalid.
+ * @return true if the cell was decoded, false otherwise.
+ */
+bool psv_decode_binary(PsvDataAnnotationType type, const char *cell, PsvBytes *bytes, const char **reason) {
+    switch (type) {
+        case PSV_DATA_ANNOTATION_HEX:
+            return psv_decode_hex(cell, bytes, reason);
+        case PSV_DATA_ANNOTATION_BASE64:
+            return psv_decode_base64(cell, bytes, reason);
+        case PSV_DATA_ANNOTATION_DATA_URI:
+            return psv_decode_data_uri(cell, bytes, reason);
+        default:
+            *reason = "not a binary type";
+            return false;
+    }
+}
+
+/**
+ * @brief Runs the binary stages of a column's compiled decode pipeline on a cell.
+ *
+ * The first stage decodes the cell text and each later stage decodes the bytes of the stage
+ * before it as text (e.g. `[base64][hex]` is hex digits that were then base64 encoded). A
+ * final [cbor] stage is left to the caller, which gets the bytes of the CBOR data item.
+ *
+ * @param header_metadata The header column, whose pipeline was compiled when it was parsed.
+ * @param cell The trimmed cell.
+ * @param scratch Reusable buffers, which should be kept across rows.
+ * @param reason Set to a short static description of the problem if a stage fails.
+ * @return The decoded bytes (owned by the scratch buffers), or NULL if the column has no binary
+ *         stages or the cell failed to decode.
+ */
+const PsvBytes *psv_decode_pipeline_bytes(const PsvHeaderMetadataField *header_metadata, const char *cell, PsvDecodeScratch *scratch, const char **reason) {
+    const char *text = cell;
+    PsvBytes *bytes = NULL;
+    for (size_t i = 0; i < header_metadata->num_decode_stages; i++) {
+        const PsvDataAnnotationType stage = header_metadata->decode_stages[i];
+        if (stage == PSV_DATA_ANNOTATION_CBOR) {
+            break;
+        }
+
+        if (bytes != NULL) {
+            // Feed the previous stage's bytes to this stage as text (reserve_bytes() left room for the NUL)
+            if (memchr(bytes->data, '\0', bytes->size) != NULL) {
+                *reason = "NUL byte in decoded text";
+                return NULL;
+            }
+            bytes->data[bytes->size] = '\0';
+            text = (const char *)bytes->data;
+        }
+
+        bytes = &scratch->buffers[i % 2];
+        if (!psv_decode_binary(stage, text, bytes, reason)) {
+            return NULL;
+        }
+    }
+
+    if (bytes == NULL) {
+        *reason = "not a binary type";
+    }
+    return bytes;
+}
+
+/**
+ * @brief Checks whether a column's decode pipeline ends in a [cbor] stage.
+ *
+ * @param header_metadata The header column.
+ * @return true if the cells decode to CBOR data items.
+ */
+bool psv_decode_pipeline_is_cbor(const PsvHeaderMetadataField *header_metadata) {
+    return header_metadata->num_decode_stages > 0 && header_metadata->decode_stages[header_metadata->num_decode_stages - 1] == PSV_DATA_ANNOTATION_CBOR;
+}
+
+/**
+ * @brief Parses the name of a binary encoding (text, hex, base64 or base64url).
+ *
+ * @param name The encoding name.
+ * @param encoding Set to the parsed encoding.
+ * @return true if the name is known, false otherwise.
+ */
+bool psv_binary_encoding_parse(const char *name, PsvBinaryEncoding *encoding) {
+    static const struct {
+        const char *name;
+        PsvBinaryEncoding encoding;
+    } encodings[] = {
+        {"text", PSV_BINARY_AS_TEXT},
+        {"hex", PSV_BINARY_AS_HEX},
+        {"base64", PSV_BINARY_AS_BASE64},
+        {"base64url", PSV_BINARY_AS_BASE64URL},
+    };
+
+    for (size_t i = 0; i < sizeof(encodings) / sizeof(encodings[0]); i++) {
+        if (strcmp(name, encodings[i].name) == 0) {
+            *encoding = encodings[i].encoding;
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief Encodes bytes as text.
+ *
+ * @param encoding PSV_BINARY_AS_HEX, PSV_BINARY_AS_BASE64 or PSV_BINARY_AS_BASE64URL.
+ * @param data The bytes to encode.
+ * @param size The number of bytes.
+ * @param text Reusable buffer that receives the NUL terminated text.
+ * @return The encoded text (owned by the text buffer).
+ */
+const char *psv_encode_binary(PsvBinaryEncoding encoding, const uint8_t *data, size_t size, PsvBytes *text) {
+    if (encoding == PSV_BINARY_AS_HEX) {
+        char *out = (char *)reserve_bytes(text, size * 2);
+        for (size_t i = 0; i < size; i++) {
+            out[2 * i] = hex_digits[data[i] >> 4];
+            out[2 * i + 1] = hex_digits[data[i] & 0xF];
+        }
+        text->size = size * 2;
+        out[text->size] = '\0';
+        return out;
+    }
+
+    const bool url_safe = (encoding == PSV_BINARY_AS_BASE64URL);
+    const char *alphabet = url_safe ? base64_url : base64_standard;
+    char *out = (char *)reserve_bytes(text, (size + 2) / 3 * 4);
+    size_t length = 0;
+    size_t i = 0;
+    for (; i + 3 <= size; i += 3) {
+        const uint32_t group = ((uint32_t)data[i] << 16) | ((uint32_t)data[i + 1] << 8) | data[i + 2];
+        out[length++] = alphabet[(group >> 18) & 0x3F];
+        out[length++] = alphabet[(group >> 12) & 0x3F];
+        out[length++] = alphabet[(group >> 6) & 0x3F];
+        out[length++] = alphabet[group & 0x3F];
+    }
+
+    const size_t tail = size - i;
+    if (tail > 0) {
+        const uint32_t group = ((uint32_t)data[i] << 16) | ((tail == 2) ? (uint32_t)data[i + 1] << 8 : 0);
+        out[length++] = alphabet[(group >> 18) & 0x3F];
+        out[length++] = alphabet[(group >> 12) & 0x3F];
+        if (tail == 2) {
+            out[length++] = alphabet[(group >> 6) & 0x3F];
+        }
+        if (!url_safe) {
+            out[length++] = '=';
+            if (tail == 1) {
+                out[length++] = '=';
+            }
+        }
+    }
+
+    text->size = length;
+    out[length] = '\0';
+    return out;
+}
+
+void psv_bytes_free(PsvBytes *bytes) {
+    free(bytes->data);
+    *bytes = (PsvBytes){0};
+}
+
+void psv_decode_scratch_free(PsvDecodeScratch *scratch) {
+    psv_bytes_free(&scratch->buffers[0]);
+    psv_bytes_free(&scratch->buffers[1]);
+}
@@ -0,0 +1,57 @@
+/**
+ * @file psv_decode.h
+ * @brief Decoding Of Binary PSV Cells ([hex], [base64] and [dataURI]) To Raw Bytes
+ *
+ * Copyright (C) 2024-2024 Brian Khuu <contact@briankhuu.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ */
+
+#ifndef PSV_DECODE_H
+#define PSV_DECODE_H
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "psv.h"
+
+#define PSV_UUID_SIZE 16
+
+// Reusable byte buffer (decoded bytes, or NUL terminated text when encoding)
+typedef struct {
+    uint8_t *data;
+    size_t size;
+    size_t capacity;
+} PsvBytes;
+
+// Reusable buffers for running a column's decode pipeline (each stage decodes from one into the other)
+typedef struct {
+    PsvBytes buffers[2];
+} PsvDecodeScratch;
+
+// How binary cells are written to text based outputs such as JSON
+typedef enum {
+    PSV_BINARY_AS_TEXT = 0,     ///< The cell as it is written in the table
+    PSV_BINARY_AS_HEX,          ///< Lowercase hex digits
+    PSV_BINARY_AS_BASE64,       ///< Standard base64 with padding
+    PSV_BINARY_AS_BASE64URL,    ///< URL safe base64 without padding
+} PsvBinaryEncoding;
+
+bool psv_decode_hex(const char *cell, PsvBytes *bytes, const char **reason);
+bool psv_decode_base64(const char *cell, PsvBytes *bytes, const char **reason);
+bool psv_decode_data_uri(const char *cell, PsvBytes *bytes, const char **reason);
+bool psv_decode_uuid(const char *cell, uint8_t uuid[PSV_UUID_SIZE], const char **reason);
+bool psv_decode_binary(PsvDataAnnotationType type, const char *cell, PsvBytes *bytes, const char **reason);
+const PsvBytes *psv_decode_pipeline_bytes(const PsvHeaderMetadataField *header_metadata, const char *cell, PsvDecodeScratch *scratch, const char **reason);
+bool psv_decode_pipeline_is_cbor(const PsvHeaderMetadataField *header_metadata);
+void psv_decode_scratch_free(PsvDecodeScratch *scratch);
+
+bool psv_binary_encoding_parse(const char *name, PsvBinaryEncoding *encoding);
+const char *psv_encode_binary(PsvBinaryEncoding encoding, const uint8_t *data, size_t size, PsvBytes *text);
+
+void psv_bytes_free(PsvBytes *bytes);
+
+#endif
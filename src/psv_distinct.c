@@ -0,0 +1,310 @@
+/**
+ * @file psv_distinct.c
+ * @brief Streaming Deduplication Of PSV Table Rows
+ *
+ * Copyright (C) 2024-2024 Brian Khuu <contact@briankhuu.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Rows are streamed through and only the first occurrence of each distinct key is kept, so the
+ * output preserves input order and rows are never buffered.
+ *
+ * - By default only a 128-bit hash of each seen key is stored (16 bytes per distinct key).
+ *   Two different keys would have to collide on all 128 bits to be wrongly merged.
+ * - In exact mode the serialized key bytes are kept as well, and compared on every hash match.
+ * - In approximate mode a fixed size bloom filter is used instead, so memory use is bounded
+ *   regardless of the number of distinct keys. The trade off is that a false positive drops
+ *   a row that was actually unique; duplicates are never let through.
+ */
+
+#include <string.h>
+#include <ctype.h>
+#include <stdlib.h>
+#include <assert.h>
+
+#include "psv_distinct.h"
+#include "psv_hash.h"
+#include "psv_decode.h"
+
+#ifdef NDEBUG
+    #define assert(expression) ((void)0)
+#endif
+
+#define BLOOM_NUM_HASHES 7
+
+typedef struct {
+    size_t offset;
+    size_t size;
+} DistinctKeyRef;
+
+struct PsvDistinct {
+    const PsvDistinctSpec *spec;
+
+    // Hash set of seen keys (an all zero hash marks an empty slot)
+    PsvHash128 *slots;
+    DistinctKeyRef *key_refs;   ///< Per slot location of the key bytes in key_store (exact mode only)
+    size_t capacity;
+    size_t count;
+
+    // Key bytes of every distinct key (exact mode only)
+    char *key_store;
+    size_t key_store_size;
+    size_t key_store_capacity;
+
+    // Bloom filter (approximate mode only)
+    uint8_t *bloom;
+    uint64_t bloom_bits;
+
+    // Scratch buffer for serialized keys
+    char *key_buffer;
+    size_t key_buffer_capacity;
+};
+
+// [uuid] key columns are compared on their 16-byte form, so differently cased spellings of a UUID are the same key
+static void find_uuid_columns(PsvDistinctSpec *spec, PsvTable *table) {
+    spec->uuid_columns = calloc(spec->num_columns ? spec->num_columns : 1, sizeof(bool));
+    assert(spec->uuid_columns != NULL);
+    for (int i = 0; i < spec->num_columns; i++) {
+        spec->uuid_columns[i] = psv_has_data_annotation(table, spec->columns[i], PSV_DATA_ANNOTATION_UUID);
+    }
+}
+
+/**
+ * @brief Parses the distinct key columns against a table header.
+ *
+ * The exact and approximate_bytes fields are left for the caller to set.
+ *
+ * @param spec Pointer to the distinct specification to fill in.
+ * @param table Pointer to the table whose header the column keys are resolved against.
+ * @param distinct_on Comma separated list of column keys, or NULL to compare whole rows.
+ * @return true on success. On failure false is returned and spec->error describes the problem.
+ *         The spec must be released with psv_distinct_spec_free() in both cases.
+ */
+bool psv_distinct_spec_parse(PsvDistinctSpec *spec, PsvTable *table, const char *distinct_on) {
+    *spec = (PsvDistinctSpec){0};
+
+    if (distinct_on == NULL) {
+        spec->columns = malloc((table->num_headers ? table->num_headers : 1) * sizeof(int));
+        assert(spec->columns != NULL);
+        for (int i = 0; i < table->num_headers; i++) {
+            spec->columns[spec->num_columns++] = i;
+        }
+        find_uuid_columns(spec, table);
+        return true;
+    }
+
+    const char *token_start = distinct_on;
+    while (true) {
+        const char *token_end = strchr(token_start, ',');
+        if (token_end == NULL) {
+            token_end = token_start + strlen(token_start);
+        }
+
+        // Copy and trim the key
+        while (token_start < token_end && isspace((unsigned char)*token_start)) {
+            token_start++;
+        }
+        char key[PSV_HEADER_ID_MAX];
+        snprintf(key, sizeof(key), "%.*s", (int)(token_end - token_start), token_start);
+        for (char *end = key + strlen(key); end > key && isspace((unsigned char)end[-1]); end--) {
+            end[-1] = '\0';
+        }
+
+        const int column = psv_find_header_column(table, key);
+        if (column < 0) {
+            snprintf(spec->error, PSV_DISTINCT_ERROR_MAX, "distinct column '%s' not found", key);
+            return false;
+        }
+
+        spec->columns = realloc(spec->columns, (spec->num_columns + 1) * sizeof(int));
+        assert(spec->columns != NULL);
+        spec->columns[spec->num_columns++] = column;
+
+        if (*token_end == '\0') {
+            break;
+        }
+        token_start = token_end + 1;
+    }
+
+    find_uuid_columns(spec, table);
+    return true;
+}
+
+void psv_distinct_spec_free(PsvDistinctSpec *spec) {
+    free(spec->columns);
+    free(spec->uuid_columns);
+    *spec = (PsvDistinctSpec){0};
+}
+
+PsvDistinct *psv_distinct_create(const PsvDistinctSpec *spec) {
+    PsvDistinct *distinct = calloc(1, sizeof(PsvDistinct));
+    assert(distinct != NULL);
+    distinct->spec = spec;
+
+    if (spec->approximate_bytes > 0) {
+        distinct->bloom = calloc(spec->approximate_bytes, 1);
+        assert(distinct->bloom != NULL);
+        distinct->bloom_bits = (uint64_t)spec->approximate_bytes * 8;
+    }
+
+    return distinct;
+}
+
+// Serialize the key cells of a row, each cell written as either `\0` (empty cell), `\2<16 uuid bytes>`
+// (valid cell of a [uuid] column) or `\1<data>\0`
+static size_t build_key(PsvDistinct *distinct, PsvDataRow data_row) {
+    size_t key_size = 0;
+    for (int i = 0; i < distinct->spec->num_columns; i++) {
+        const char *data = data_row[distinct->spec->columns[i]];
+        const size_t data_size = data ? strlen(data) : 0;
+
+        const size_t required = key_size + (data_size > PSV_UUID_SIZE ? data_size : PSV_UUID_SIZE) + 2;
+        if (required > distinct->key_buffer_capacity) {
+            distinct->key_buffer_capacity = required * 2;
+            distinct->key_buffer = realloc(distinct->key_buffer, distinct->key_buffer_capacity);
+            assert(distinct->key_buffer != NULL);
+        }
+
+        const char *reason = NULL;
+        if (data && distinct->spec->uuid_columns[i] && psv_decode_uuid(data, (uint8_t *)distinct->key_buffer + key_size + 1, &reason)) {
+            distinct->key_buffer[key_size] = '\2';
+            key_size += 1 + PSV_UUID_SIZE;
+            continue;
+        }
+
+        if (data) {
+            distinct->key_buffer[key_size++] = '\1';
+            memcpy(distinct->key_buffer + key_size, data, data_size);
+            key_size += data_size;
+        }
+        distinct->key_buffer[key_size++] = '\0';
+    }
+    return key_size;
+}
+
+static bool bloom_add(PsvDistinct *distinct, PsvHash128 hash) {
+    // Derive the bit positions from the two halves of the hash (Kirsch-Mitzenmacher double hashing)
+    bool seen = true;
+    for (uint64_t i = 0; i < BLOOM_NUM_HASHES; i++) {
+        const uint64_t bit = (hash.low + i * hash.high) % distinct->bloom_bits;
+        const uint8_t mask = (uint8_t)(1u << (bit & 7));
+        if (!(distinct->bloom[bit >> 3] & mask)) {
+            distinct->bloom[bit >> 3] |= mask;
+            seen = false;
+        }
+    }
+    return !seen;
+}
+
+static void grow_slots(PsvDistinct *distinct) {
+    const size_t old_capacity = distinct->capacity;
+    PsvHash128 *old_slots = distinct->slots;
+    DistinctKeyRef *old_key_refs = distinct->key_refs;
+
+    distinct->capacity = old_capacity ? old_capacity * 2 : 1024;
+    distinct->slots = calloc(distinct->capacity, sizeof(PsvHash128));
+    assert(distinct->slots != NULL);
+    if (distinct->spec->exact) {
+        distinct->key_refs = malloc(distinct->capacity * sizeof(DistinctKeyRef));
+        assert(distinct->key_refs != NULL);
+    }
+
+    const size_t mask = distinct->capacity - 1;
+    for (size_t i = 0; i < old_capacity; i++) {
+        if (old_slots[i].low == 0 && old_slots[i].high == 0) {
+            continue;
+        }
+        size_t slot = old_slots[i].low & mask;
+        while (distinct->slots[slot].low != 0 || distinct->slots[slot].high != 0) {
+            slot = (slot + 1) & mask;
+        }
+        distinct->slots[slot] = old_slots[i];
+        if (distinct->spec->exact) {
+            distinct->key_refs[slot] = old_key_refs[i];
+        }
+    }
+
+    free(old_slots);
+    free(old_key_refs);
+}
+
+static bool hash_set_add(PsvDistinct *distinct, PsvHash128 hash, size_t key_size) {
+    if (hash.low == 0 && hash.high == 0) {
+        // Keep the all zero hash free to mark empty slots
+        hash.low = 1;
+    }
+
+    // Keep the load factor under 70%
+    if ((distinct->count + 1) * 10 > distinct->capacity * 7) {
+        grow_slots(distinct);
+    }
+
+    const size_t mask = distinct->capacity - 1;
+    size_t slot = hash.low & mask;
+    while (distinct->slots[slot].low != 0 || distinct->slots[slot].high != 0) {
+        if (distinct->slots[slot].low == hash.low && distinct->slots[slot].high == hash.high) {
+            if (!distinct->spec->exact) {
+                return false;
+            }
+
+            // Verify the key bytes. A genuine 128-bit collision just carries on probing.
+            const DistinctKeyRef *key_ref = &distinct->key_refs[slot];
+            if (key_ref->size == key_size && memcmp(distinct->key_store + key_ref->offset, distinct->key_buffer, key_size) == 0) {
+                return false;
+            }
+        }
+        slot = (slot + 1) & mask;
+    }
+
+    distinct->slots[slot] = hash;
+    distinct->count++;
+
+    if (distinct->spec->exact) {
+        if (distinct->key_store_size + key_size > distinct->key_store_capacity) {
+            distinct->key_store_capacity = (distinct->key_store_size + key_size) * 2;
+            distinct->key_store = realloc(distinct->key_store, distinct->key_store_capacity);
+            assert(distinct->key_store != NULL);
+        }
+        memcpy(distinct->key_store + distinct->key_store_size, distinct->key_buffer, key_size);
+        distinct->key_refs[slot] = (DistinctKeyRef){.offset = distinct->key_store_size, .size = key_size};
+        distinct->key_store_size += key_size;
+    }
+
+    return true;
+}
+
+/**
+ * @brief Records a row's key and checks whether it was seen before.
+ *
+ * @param distinct Pointer to the distinct filter.
+ * @param data_row The row to check. It is not retained.
+ * @return true if this is the first row with this key (the row should be output), false if it is a duplicate.
+ */
+bool psv_distinct_add_row(PsvDistinct *distinct, PsvDataRow data_row) {
+    const size_t key_size = build_key(distinct, data_row);
+    const PsvHash128 hash = psv_hash128(distinct->key_buffer, key_size, 0);
+
+    if (distinct->bloom != NULL) {
+        return bloom_add(distinct, hash);
+    }
+
+    return hash_set_add(distinct, hash, key_size);
+}
+
+void psv_distinct_free(PsvDistinct **distinct_ptr) {
+    PsvDistinct *distinct = *distinct_ptr;
+    if (distinct == NULL) {
+        return;
+    }
+
+    free(distinct->slots);
+    free(distinct->key_refs);
+    free(distinct->key_store);
+    free(distinct->bloom);
+    free(distinct->key_buffer);
+    free(distinct);
+    *distinct_ptr = NULL;
+}
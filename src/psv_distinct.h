@@ -0,0 +1,42 @@
+/**
+ * @file psv_distinct.h
+ * @brief Streaming Deduplication Of PSV Table Rows
+ *
+ * Copyright (C) 2024-2024 Brian Khuu <contact@briankhuu.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ */
+
+#ifndef PSV_DISTINCT_H
+#define PSV_DISTINCT_H
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "psv.h"
+
+#define PSV_DISTINCT_ERROR_MAX (PSV_HEADER_ID_MAX + 64)
+
+typedef struct {
+    int num_columns;
+    int *columns;               ///< Columns that make up the distinct key (all columns if --distinct-on is not used)
+    bool *uuid_columns;         ///< Per key column, whether it is a [uuid] column keyed on its 16-byte form
+
+    bool exact;                 ///< Keep the key bytes to verify 128-bit hash matches
+    size_t approximate_bytes;   ///< If non zero, use a bloom filter of this many bytes instead of a hash set
+
+    char error[PSV_DISTINCT_ERROR_MAX];
+} PsvDistinctSpec;
+
+bool psv_distinct_spec_parse(PsvDistinctSpec *spec, PsvTable *table, const char *distinct_on);
+void psv_distinct_spec_free(PsvDistinctSpec *spec);
+
+typedef struct PsvDistinct PsvDistinct;
+
+PsvDistinct *psv_distinct_create(const PsvDistinctSpec *spec);
+bool psv_distinct_add_row(PsvDistinct *distinct, PsvDataRow data_row);
+void psv_distinct_free(PsvDistinct **distinct_ptr);
+
+#endif
@@ -0,0 +1,232 @@
+/**
+ * @file psv_hash.c
+ * @brief Hashing And Hash Map Helpers For PSV Processing Modes
+ *
+ * Copyright (C) 2024-2024 Brian Khuu <contact@briankhuu.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ */
+
+#include <string.h>
+#include <stdlib.h>
+#include <assert.h>
+
+#include "psv_hash.h"
+
+#ifdef NDEBUG
+    #define assert(expression) ((void)0)
+#endif
+
+#define PSV_HASH_MAP_INITIAL_CAPACITY 64
+
+static inline uint64_t rotl64(uint64_t x, int8_t r) {
+    return (x << r) | (x >> (64 - r));
+}
+
+static inline uint64_t fmix64(uint64_t k) {
+    k ^= k >> 33;
+    k *= 0xff51afd7ed558ccdULL;
+    k ^= k >> 33;
+    k *= 0xc4ceb9fe1a85ec53ULL;
+    k ^= k >> 33;
+    return k;
+}
+
+static inline uint64_t read_u64_le(const uint8_t *p) {
+    return ((uint64_t)p[0]) | ((uint64_t)p[1] << 8) | ((uint64_t)p[2] << 16) | ((uint64_t)p[3] << 24) |
+           ((uint64_t)p[4] << 32) | ((uint64_t)p[5] << 40) | ((uint64_t)p[6] << 48) | ((uint64_t)p[7] << 56);
+}
+
+/**
+ * @brief Computes a 128-bit hash of a byte string.
+ *
+ * This is MurmurHash3 (x64, 128-bit variant) by Austin Appleby, which is in the public domain.
+ * It is fast on 64-bit targets and has a low enough collision rate that a 128-bit digest can
+ * stand in for the full value in row deduplication.
+ *
+ * @param data Pointer to the bytes to hash.
+ * @param size The number of bytes to hash.
+ * @param seed Seed value, used to derive independent hash functions (e.g. when re-partitioning).
+ * @return The 128-bit hash.
+ */
+PsvHash128 psv_hash128(const void *data, size_t size, uint64_t seed) {
+    const uint8_t *bytes = (const uint8_t *)data;
+    const size_t num_blocks = size / 16;
+    const uint64_t c1 = 0x87c37b91114253d5ULL;
+    const uint64_t c2 = 0x4cf5ad432745937fULL;
+
+    uint64_t h1 = seed;
+    uint64_t h2 = seed;
+
+    // Body
+    for (size_t i = 0; i < num_blocks; i++) {
+        uint64_t k1 = read_u64_le(bytes + i * 16);
+        uint64_t k2 = read_u64_le(bytes + i * 16 + 8);
+
+        k1 *= c1; k1 = rotl64(k1, 31); k1 *= c2; h1 ^= k1;
+        h1 = rotl64(h1, 27); h1 += h2; h1 = h1 * 5 + 0x52dce729;
+
+        k2 *= c2; k2 = rotl64(k2, 33); k2 *= c1; h2 ^= k2;
+        h2 = rotl64(h2, 31); h2 += h1; h2 = h2 * 5 + 0x38495ab5;
+    }
+
+    // Tail
+    const uint8_t *tail = bytes + num_blocks * 16;
+    uint64_t k1 = 0;
+    uint64_t k2 = 0;
+    switch (size & 15) {
+        case 15: k2 ^= ((uint64_t)tail[14]) << 48; /* fall through */
+        case 14: k2 ^= ((uint64_t)tail[13]) << 40; /* fall through */
+        case 13: k2 ^= ((uint64_t)tail[12]) << 32; /* fall through */
+        case 12: k2 ^= ((uint64_t)tail[11]) << 24; /* fall through */
+        case 11: k2 ^= ((uint64_t)tail[10]) << 16; /* fall through */
+        case 10: k2 ^= ((uint64_t)tail[ 9]) << 8;  /* fall through */
+        case  9: k2 ^= ((uint64_t)tail[ 8]) << 0;
+                 k2 *= c2; k2 = rotl64(k2, 33); k2 *= c1; h2 ^= k2;
+                 /* fall through */
+        case  8: k1 ^= ((uint64_t)tail[ 7]) << 56; /* fall through */
+        case  7: k1 ^= ((uint64_t)tail[ 6]) << 48; /* fall through */
+        case  6: k1 ^= ((uint64_t)tail[ 5]) << 40; /* fall through */
+        case  5: k1 ^= ((uint64_t)tail[ 4]) << 32; /* fall through */
+        case  4: k1 ^= ((uint64_t)tail[ 3]) << 24; /* fall through */
+        case  3: k1 ^= ((uint64_t)tail[ 2]) << 16; /* fall through */
+        case  2: k1 ^= ((uint64_t)tail[ 1]) << 8;  /* fall through */
+        case  1: k1 ^= ((uint64_t)tail[ 0]) << 0;
+                 k1 *= c1; k1 = rotl64(k1, 31); k1 *= c2; h1 ^= k1;
+    }
+
+    // Finalization
+    h1 ^= size;
+    h2 ^= size;
+
+    h1 += h2;
+    h2 += h1;
+
+    h1 = fmix64(h1);
+    h2 = fmix64(h2);
+
+    h1 += h2;
+    h2 += h1;
+
+    return (PsvHash128){.low = h1, .high = h2};
+}
+
+uint64_t psv_hash64(const void *data, size_t size, uint64_t seed) {
+    return psv_hash128(data, size, seed).low;
+}
+
+void psv_hash_map_init(PsvHashMap *map, uint64_t seed) {
+    *map = (PsvHashMap){0};
+    map->seed = seed;
+}
+
+void psv_hash_map_free(PsvHashMap *map) {
+    if (map->entries) {
+        for (size_t i = 0; i < map->capacity; i++) {
+            free(map->entries[i].key);
+        }
+        free(map->entries);
+    }
+    *map = (PsvHashMap){0};
+}
+
+static PsvHashMapEntry *hash_map_probe(PsvHashMapEntry *entries, size_t capacity, uint64_t hash, const char *key, size_t key_size) {
+    // Linear probing. Capacity is always a power of two.
+    size_t index = hash & (capacity - 1);
+    while (true) {
+        PsvHashMapEntry *entry = &entries[index];
+        if (entry->key == NULL) {
+            return entry;
+        }
+
+        if (entry->hash == hash && entry->key_size == key_size && (key_size == 0 || memcmp(entry->key, key, key_size) == 0)) {
+            return entry;
+        }
+
+        index = (index + 1) & (capacity - 1);
+    }
+}
+
+static void hash_map_grow(PsvHashMap *map) {
+    const size_t new_capacity = (map->capacity == 0) ? PSV_HASH_MAP_INITIAL_CAPACITY : map->capacity * 2;
+    PsvHashMapEntry *new_entries = calloc(new_capacity, sizeof(PsvHashMapEntry));
+    assert(new_entries != NULL);
+
+    for (size_t i = 0; i < map->capacity; i++) {
+        PsvHashMapEntry *entry = &map->entries[i];
+        if (entry->key == NULL) {
+            continue;
+        }
+
+        *hash_map_probe(new_entries, new_capacity, entry->hash, entry->key, entry->key_size) = *entry;
+    }
+
+    free(map->entries);
+    map->entries = new_entries;
+    map->capacity = new_capacity;
+}
+
+/**
+ * @brief Looks up a key in the hash map.
+ *
+ * @param map Pointer to the hash map.
+ * @param key Pointer to the key bytes.
+ * @param key_size The number of key bytes.
+ * @param value Set to the value associated with the key if found. May be NULL.
+ * @return true if the key was found, false otherwise.
+ */
+bool psv_hash_map_find(PsvHashMap *map, const char *key, size_t key_size, size_t *value) {
+    if (map->count == 0) {
+        return false;
+    }
+
+    const uint64_t hash = psv_hash64(key, key_size, map->seed);
+    PsvHashMapEntry *entry = hash_map_probe(map->entries, map->capacity, hash, key, key_size);
+    if (entry->key == NULL) {
+        return false;
+    }
+
+    if (value) {
+        *value = entry->value;
+    }
+    return true;
+}
+
+/**
+ * @brief Inserts a key into the hash map if it is not already present.
+ *
+ * @param map Pointer to the hash map.
+ * @param key Pointer to the key bytes. The key is copied into the map.
+ * @param key_size The number of key bytes.
+ * @param value On input, the value to associate with a newly inserted key.
+ *              On output, the value associated with the key (the existing one if already present).
+ * @return true if the key was newly inserted, false if it was already present.
+ */
+bool psv_hash_map_insert(PsvHashMap *map, const char *key, size_t key_size, size_t *value) {
+    // Keep load factor below 70% so that linear probing chains stay short
+    if ((map->count + 1) * 10 > map->capacity * 7) {
+        hash_map_grow(map);
+    }
+
+    const uint64_t hash = psv_hash64(key, key_size, map->seed);
+    PsvHashMapEntry *entry = hash_map_probe(map->entries, map->capacity, hash, key, key_size);
+    if (entry->key != NULL) {
+        *value = entry->value;
+        return false;
+    }
+
+    // Allocate at least one byte so that zero length keys are distinguishable from empty slots
+    entry->key = malloc(key_size > 0 ? key_size : 1);
+    assert(entry->key != NULL);
+    if (key_size > 0) {
+        memcpy(entry->key, key, key_size);
+    }
+    entry->key_size = key_size;
+    entry->hash = hash;
+    entry->value = *value;
+    map->count++;
+    return true;
+}
@@ -0,0 +1,47 @@
+/**
+ * @file psv_hash.h
+ * @brief Hashing And Hash Map Helpers For PSV Processing Modes
+ *
+ * Copyright (C) 2024-2024 Brian Khuu <contact@briankhuu.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ */
+
+#ifndef PSV_HASH_H
+#define PSV_HASH_H
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+typedef struct {
+    uint64_t low;
+    uint64_t high;
+} PsvHash128;
+
+PsvHash128 psv_hash128(const void *data, size_t size, uint64_t seed);
+uint64_t psv_hash64(const void *data, size_t size, uint64_t seed);
+
+// Open addressing hash map from an owned byte string key to a caller defined index
+typedef struct {
+    uint64_t hash;
+    char *key;
+    size_t key_size;
+    size_t value;
+} PsvHashMapEntry;
+
+typedef struct {
+    PsvHashMapEntry *entries;
+    size_t capacity;
+    size_t count;
+    uint64_t seed;
+} PsvHashMap;
+
+void psv_hash_map_init(PsvHashMap *map, uint64_t seed);
+void psv_hash_map_free(PsvHashMap *map);
+bool psv_hash_map_find(PsvHashMap *map, const char *key, size_t key_size, size_t *value);
+bool psv_hash_map_insert(PsvHashMap *map, const char *key, size_t key_size, size_t *value);
+
+#endif
@@ -0,0 +1,161 @@
+/**
+ * @file psv_infer.c
+ * @brief Type Inference For PSV Columns Without Data Annotations
+ *
+ * Copyright (C) 2024-2024 Brian Khuu <contact@briankhuu.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Every unannotated column starts with all inferable types as candidates. Each non empty cell
+ * is checked with the same character class validators as --validate, and any type it is not
+ * valid as is dropped. Once all of a table's columns are down to text there is nothing left to
+ * learn, so the caller can stop reading rows early.
+ *
+ * When more than one candidate remains the most specific wins, in the order integer, float,
+ * bool, datetime, uuid. Numbers with redundant leading zeros (e.g. `007` zip or product codes)
+ * are kept as text, since converting them would lose the zeros.
+ */
+
+#include <string.h>
+#include <stdlib.h>
+#include <assert.h>
+
+#include "psv_infer.h"
+#include "psv_validate.h"
+
+#ifdef NDEBUG
+    #define assert(expression) ((void)0)
+#endif
+
+// Inferable types, from most to least specific
+static const PsvDataAnnotationType inferable_types[] = {
+    PSV_DATA_ANNOTATION_INTEGER,
+    PSV_DATA_ANNOTATION_FLOAT,
+    PSV_DATA_ANNOTATION_BOOL,
+    PSV_DATA_ANNOTATION_DATETIME,
+    PSV_DATA_ANNOTATION_UUID,
+};
+#define NUM_INFERABLE_TYPES (sizeof(inferable_types) / sizeof(inferable_types[0]))
+#define ALL_CANDIDATES ((uint8_t)((1u << NUM_INFERABLE_TYPES) - 1))
+#define NUMBER_CANDIDATES ((uint8_t)0x3)    ///< Integer and float
+
+static bool has_recognised_annotation(const PsvHeaderMetadataField *header_metadata) {
+    for (int i = 0; i < header_metadata->data_annotation_tag_size; i++) {
+        if (header_metadata->data_annotation_tags[i].type != PSV_DATA_ANNOTATION_UNKNOWN) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// e.g. `007` or `-01.5`, but not `0`, `0.5` or `-0`
+static bool has_leading_zero(const char *cell) {
+    if (*cell == '-' || *cell == '+') {
+        cell++;
+    }
+    return cell[0] == '0' && cell[1] >= '0' && cell[1] <= '9';
+}
+
+/**
+ * @brief Starts inferring the types of a table's unannotated columns.
+ *
+ * Columns that already have a recognised data annotation are left as they are.
+ *
+ * @param inference The inference state to initialise. Release with psv_infer_free().
+ * @param table The table whose columns are inferred.
+ */
+void psv_infer_init(PsvTypeInference *inference, PsvTable *table) {
+    *inference = (PsvTypeInference){0};
+    inference->num_columns = table->num_headers;
+    inference->candidates = calloc(table->num_headers + 1, sizeof(uint8_t));
+    inference->num_values = calloc(table->num_headers + 1, sizeof(size_t));
+    assert(inference->candidates != NULL && inference->num_values != NULL);
+
+    for (int i = 0; i < table->num_headers; i++) {
+        if (!has_recognised_annotation(&table->header_metadata[i])) {
+            inference->candidates[i] = ALL_CANDIDATES;
+            inference->num_undecided++;
+        }
+    }
+}
+
+/**
+ * @brief Narrows down the candidate types of each column using the cells of one row.
+ *
+ * @param inference The inference state.
+ * @param cells The trimmed cells of the row (NULL for empty cells).
+ * @return true if more rows could still change the outcome, false once every column is text.
+ */
+bool psv_infer_add_row(PsvTypeInference *inference, const PsvDataField *cells) {
+    for (int i = 0; i < inference->num_columns; i++) {
+        uint8_t candidates = inference->candidates[i];
+        const char *cell = cells[i];
+        if (candidates == 0 || cell == NULL) {
+            continue;
+        }
+
+        inference->num_values[i]++;
+        if (has_leading_zero(cell)) {
+            candidates &= ~NUMBER_CANDIDATES;
+        }
+
+        for (size_t j = 0; j < NUM_INFERABLE_TYPES; j++) {
+            const uint8_t candidate = 1u << j;
+            if ((candidates & candidate) == 0) {
+                continue;
+            }
+
+            const char *reason = NULL;
+            if (!psv_validate_get_type_validator(inferable_types[j])(cell, &reason)) {
+                candidates &= ~candidate;
+            }
+        }
+
+        inference->candidates[i] = candidates;
+        if (candidates == 0) {
+            inference->num_undecided--;
+        }
+    }
+
+    return inference->num_undecided > 0;
+}
+
+/**
+ * @brief Sets the inferred type of each unannotated column of a table.
+ *
+ * Columns with no values at all, or with values that fit none of the inferable types, are
+ * inferred as text.
+ *
+ * @param inference The inference state after all sampled rows were added.
+ * @param table The table to update (the same table that the inference was initialised with).
+ */
+void psv_infer_apply(PsvTypeInference *inference, PsvTable *table) {
+    assert(inference->num_columns == table->num_headers);
+    for (int i = 0; i < table->num_headers; i++) {
+        PsvHeaderMetadataField *header_metadata = &table->header_metadata[i];
+        if (has_recognised_annotation(header_metadata)) {
+            continue;
+        }
+
+        header_metadata->inferred_type = PSV_DATA_ANNOTATION_TEXT;
+        if (inference->num_values[i] == 0) {
+            continue;
+        }
+
+        for (size_t j = 0; j < NUM_INFERABLE_TYPES; j++) {
+            if (inference->candidates[i] & (1u << j)) {
+                header_metadata->inferred_type = inferable_types[j];
+                break;
+            }
+        }
+    }
+}
+
+void psv_infer_free(PsvTypeInference *inference) {
+    free(inference->candidates);
+    free(inference->num_values);
+    *inference = (PsvTypeInference){0};
+}
@@ -0,0 +1,32 @@
+/**
+ * @file psv_infer.h
+ * @brief Type Inference For PSV Columns Without Data Annotations
+ *
+ * Copyright (C) 2024-2024 Brian Khuu <contact@briankhuu.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ */
+
+#ifndef PSV_INFER_H
+#define PSV_INFER_H
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "psv.h"
+
+typedef struct {
+    int num_columns;
+    uint8_t *candidates;    ///< Per column bit set of types that every value seen so far is valid as
+    size_t *num_values;     ///< Per column count of non empty values seen
+    int num_undecided;      ///< Columns that still have a candidate type
+} PsvTypeInference;
+
+void psv_infer_init(PsvTypeInference *inference, PsvTable *table);
+bool psv_infer_add_row(PsvTypeInference *inference, const PsvDataField *cells);
+void psv_infer_apply(PsvTypeInference *inference, PsvTable *table);
+void psv_infer_free(PsvTypeInference *inference);
+
+#endif
@@ -0,0 +1,237 @@
+/**
+ * @file psv_join.c
+ * @brief Hash Join Of Two PSV Tables By Key Column
+ *
+ * Copyright (C) 2024-2024 Brian Khuu <contact@briankhuu.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * The build side of the join is parsed into a PsvTable and indexed by its key column in a
+ * hash map. The probe side is then streamed row by row and each row is looked up in the
+ * index, so only the build side is ever held in memory.
+ */
+
+#include <string.h>
+#include <stdlib.h>
+#include <inttypes.h>
+#include <errno.h>
+#include <assert.h>
+
+#include "psv_join.h"
+#include "psv_decode.h"
+
+#ifdef NDEBUG
+    #define assert(expression) ((void)0)
+#endif
+
+static bool parse_join_side(const char *start, const char *end, PsvJoinSide *side) {
+    const char *separator = memchr(start, ':', end - start);
+    if (separator == NULL || separator == start || separator + 1 == end) {
+        return false;
+    }
+
+    *side = (PsvJoinSide){0};
+    snprintf(side->table_id, PSV_TABLE_ID_MAX, "%.*s", (int)(separator - start), start);
+    snprintf(side->key, PSV_HEADER_ID_MAX, "%.*s", (int)(end - separator - 1), separator + 1);
+    return true;
+}
+
+/**
+ * @brief Parses a join specification of the form `left_id:key=right_id:key`.
+ *
+ * @param join The join specification string.
+ * @param left Set to the table ID and key column of the left table.
+ * @param right Set to the table ID and key column of the right table.
+ * @return true if the specification is well formed, false otherwise.
+ */
+bool psv_join_parse_spec(const char *join, PsvJoinSide *left, PsvJoinSide *right) {
+    const char *equals = strchr(join, '=');
+    if (equals == NULL) {
+        return false;
+    }
+
+    return parse_join_side(join, equals, left) && parse_join_side(equals + 1, equals + strlen(equals), right);
+}
+
+/**
+ * @brief Creates the header of a joined table.
+ *
+ * The joined table has all columns of the left table followed by all columns of the right table.
+ * Right table columns whose JSON key clashes with a left table column are renamed to `<right table id>_<key>`.
+ *
+ * @param left_table Pointer to the left table.
+ * @param right_table Pointer to the right table.
+ * @return A newly allocated header only PsvTable (free with psv_free_table()).
+ */
+PsvTable *psv_join_create_result_table(PsvTable *left_table, PsvTable *right_table) {
+    char id[PSV_TABLE_ID_MAX];
+    snprintf(id, PSV_TABLE_ID_MAX, "%.*s_%.*s", PSV_TABLE_ID_MAX / 2 - 1, left_table->id, PSV_TABLE_ID_MAX / 2 - 1, right_table->id);
+    PsvTable *result_table = psv_create_table(id);
+
+    for (int i = 0; i < left_table->num_headers; i++) {
+        PsvHeaderMetadataField *header_metadata = psv_table_add_header(result_table, left_table->header_metadata[i].raw_header);
+        memcpy(header_metadata->id, left_table->header_metadata[i].id, PSV_HEADER_ID_MAX);
+    }
+
+    for (int i = 0; i < right_table->num_headers; i++) {
+        const char *key = right_table->header_metadata[i].id;
+        const bool clash = psv_find_header_column(left_table, key) >= 0;
+        PsvHeaderMetadataField *header_metadata = psv_table_add_header(result_table, right_table->header_metadata[i].raw_header);
+        if (clash) {
+            snprintf(header_metadata->id, PSV_HEADER_ID_MAX, "%.*s_%.*s", PSV_HEADER_ID_MAX / 2 - 1, right_table->id, PSV_HEADER_ID_MAX / 2 - 1, key);
+        } else {
+            memcpy(header_metadata->id, key, PSV_HEADER_ID_MAX);
+        }
+    }
+
+    return result_table;
+}
+
+// Type a key column is compared as: [int] and [uuid] key columns keep their type, anything else compares as text
+static PsvDataAnnotationType key_column_type(PsvTable *table, int key_column) {
+    if (psv_has_data_annotation(table, key_column, PSV_DATA_ANNOTATION_UUID)) {
+        return PSV_DATA_ANNOTATION_UUID;
+    }
+    const PsvDataAnnotationType basic_type = psv_get_basic_type(table, key_column);
+    return (basic_type == PSV_DATA_ANNOTATION_INTEGER) ? basic_type : PSV_DATA_ANNOTATION_TEXT;
+}
+
+/**
+ * @brief Decides the one type both sides of a join compare their keys as.
+ *
+ * Keys of two [int] (or two [uuid]) columns compare as that type, and so do a typed key column and a
+ * plain text one, so `007` in an [int] column matches `7` in an unannotated one. Mismatched types compare
+ * as text. Both sides are normalized the same way, so the result does not depend on the build side.
+ *
+ * @return The key type to pass to psv_join_index_build().
+ */
+PsvDataAnnotationType psv_join_key_type(PsvTable *left_table, int left_key_column, PsvTable *right_table, int right_key_column) {
+    const PsvDataAnnotationType left_type = key_column_type(left_table, left_key_column);
+    const PsvDataAnnotationType right_type = key_column_type(right_table, right_key_column);
+    if (left_type == right_type || right_type == PSV_DATA_ANNOTATION_TEXT) {
+        return left_type;
+    }
+    return (left_type == PSV_DATA_ANNOTATION_TEXT) ? right_type : PSV_DATA_ANNOTATION_TEXT;
+}
+
+// Normalize a key cell so that equal values of the key type match (e.g. `007` and `7` as [int] keys,
+// or differently cased spellings of the same UUID as [uuid] keys). Cells that are not valid values of
+// the key type are keyed on their text behind a different marker byte, so they only match the same text.
+static size_t normalize_key(PsvJoinIndex *index, PsvDataAnnotationType key_type, const char *key) {
+    const size_t key_size = strlen(key);
+    const size_t required = key_size + 32;
+    if (required > index->key_buffer_capacity) {
+        index->key_buffer_capacity = required * 2;
+        index->key_buffer = realloc(index->key_buffer, index->key_buffer_capacity);
+        assert(index->key_buffer != NULL);
+    }
+
+    if (key_type == PSV_DATA_ANNOTATION_INTEGER) {
+        char *end = NULL;
+        errno = 0;
+        const int64_t value = strtoll(key, &end, 10);
+        if (end != key && *end == '\0' && errno != ERANGE) {
+            index->key_buffer[0] = '\2';
+            return 1 + snprintf(index->key_buffer + 1, index->key_buffer_capacity - 1, "%" PRId64, value);
+        }
+    }
+
+    if (key_type == PSV_DATA_ANNOTATION_UUID) {
+        // Valid UUIDs are keyed on their 16 bytes
+        const char *reason = NULL;
+        if (psv_decode_uuid(key, (uint8_t *)index->key_buffer + 1, &reason)) {
+            index->key_buffer[0] = '\2';
+            return 1 + PSV_UUID_SIZE;
+        }
+    }
+
+    if (key_type == PSV_DATA_ANNOTATION_INTEGER || key_type == PSV_DATA_ANNOTATION_UUID) {
+        index->key_buffer[0] = '\1';
+        memcpy(index->key_buffer + 1, key, key_size);
+        return 1 + key_size;
+    }
+
+    memcpy(index->key_buffer, key, key_size);
+    return key_size;
+}
+
+/**
+ * @brief Builds a hash index over the key column of a fully parsed table.
+ *
+ * Rows with an empty key cell are never matched. Rows sharing a key are chained in input order.
+ *
+ * @param index Pointer to the index to build.
+ * @param table Pointer to the build side table. Must outlive the index.
+ * @param key_column Index of the key column in the table.
+ * @param key_type Type both sides' keys are compared as, from psv_join_key_type().
+ */
+void psv_join_index_build(PsvJoinIndex *index, PsvTable *table, int key_column, PsvDataAnnotationType key_type) {
+    *index = (PsvJoinIndex){0};
+    index->table = table;
+    index->key_column = key_column;
+    index->key_type = key_type;
+    psv_hash_map_init(&index->map, 0);
+
+    index->next_row = malloc((table->num_data_rows + 1) * sizeof(size_t));
+    index->last_row = malloc((table->num_data_rows + 1) * sizeof(size_t));
+    assert(index->next_row != NULL && index->last_row != NULL);
+
+    for (size_t row = 0; row < (size_t)table->num_data_rows; row++) {
+        index->next_row[row] = PSV_JOIN_NO_MATCH;
+        index->last_row[row] = row;
+
+        const char *key = table->data_rows[row][key_column];
+        if (key == NULL) {
+            continue;
+        }
+
+        const size_t key_size = normalize_key(index, index->key_type, key);
+        size_t first_row = row;
+        if (!psv_hash_map_insert(&index->map, index->key_buffer, key_size, &first_row)) {
+            // Append to the chain of rows sharing this key
+            index->next_row[index->last_row[first_row]] = row;
+            index->last_row[first_row] = row;
+        }
+    }
+}
+
+/**
+ * @brief Finds the first build side row matching a probe key.
+ *
+ * The probe key is normalized exactly like the build side keys, as the index's key type.
+ *
+ * @param index Pointer to the index.
+ * @param key The probe side key cell. May be NULL, which never matches.
+ * @return The row index of the first match in the build table, or PSV_JOIN_NO_MATCH.
+ */
+size_t psv_join_index_find(PsvJoinIndex *index, const char *key) {
+    if (key == NULL) {
+        return PSV_JOIN_NO_MATCH;
+    }
+
+    const size_t key_size = normalize_key(index, index->key_type, key);
+    size_t row = PSV_JOIN_NO_MATCH;
+    return psv_hash_map_find(&index->map, index->key_buffer, key_size, &row) ? row : PSV_JOIN_NO_MATCH;
+}
+
+/**
+ * @brief Finds the next build side row with the same key as a previous match.
+ *
+ * @param index Pointer to the index.
+ * @param row A row index previously returned by psv_join_index_find() or psv_join_index_next().
+ * @return The row index of the next match in the build table, or PSV_JOIN_NO_MATCH.
+ */
+size_t psv_join_index_next(PsvJoinIndex *index, size_t row) {
+    return index->next_row[row];
+}
+
+void psv_join_index_free(PsvJoinIndex *index) {
+    psv_hash_map_free(&index->map);
+    free(index->next_row);
+    free(index->last_row);
+    free(index->key_buffer);
+    *index = (PsvJoinIndex){0};
+}
@@ -0,0 +1,49 @@
+/**
+ * @file psv_join.h
+ * @brief Hash Join Of Two PSV Tables By Key Column
+ *
+ * Copyright (C) 2024-2024 Brian Khuu <contact@briankhuu.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ */
+
+#ifndef PSV_JOIN_H
+#define PSV_JOIN_H
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "psv.h"
+#include "psv_hash.h"
+
+#define PSV_JOIN_NO_MATCH SIZE_MAX
+
+typedef struct {
+    char table_id[PSV_TABLE_ID_MAX];
+    char key[PSV_HEADER_ID_MAX];
+} PsvJoinSide;
+
+// Hash index over the rows of a fully parsed table (the build side of the join)
+typedef struct {
+    PsvTable *table;
+    int key_column;
+    PsvDataAnnotationType key_type;     ///< Type both sides' keys are compared as
+    PsvHashMap map;
+    size_t *next_row;   ///< Next row with the same key, or PSV_JOIN_NO_MATCH
+    size_t *last_row;   ///< Last row with the same key (only valid for the first row of each key)
+    char *key_buffer;
+    size_t key_buffer_capacity;
+} PsvJoinIndex;
+
+bool psv_join_parse_spec(const char *join, PsvJoinSide *left, PsvJoinSide *right);
+PsvTable *psv_join_create_result_table(PsvTable *left_table, PsvTable *right_table);
+
+PsvDataAnnotationType psv_join_key_type(PsvTable *left_table, int left_key_column, PsvTable *right_table, int right_key_column);
+void psv_join_index_build(PsvJoinIndex *index, PsvTable *table, int key_column, PsvDataAnnotationType key_type);
+size_t psv_join_index_find(PsvJoinIndex *index, const char *key);
+size_t psv_join_index_next(PsvJoinIndex *index, size_t row);
+void psv_join_index_free(PsvJoinIndex *index);
+
+#endif
@@ -1,61 +1,99 @@
 #include <stdbool.h>
 #include <stdlib.h>
 #include <string.h>
+#include <limits.h>
 #include "psv_json.h"
+#include "psv_writer.h"
+#include "psv_validate.h"
+#include "psv_decode.h"
+#include "psv_datetime.h"
+#include "psv_cbor.h"
 
-static PsvDataAnnotationType get_basic_type(PsvTable *table, size_t header_column) {
-    const PsvHeaderMetadataField *header_metadata = &table->header_metadata[header_column];
-    if (header_metadata->data_annotation_tag_size > 0) {
-        for (int i = 0; i < header_metadata->data_annotation_tag_size; i++) {    
-            const PsvDataAnnotationType base_type = header_metadata->data_annotation_tags[i].type;
-            if (base_type == PSV_DATA_ANNOTATION_INTEGER)
-                return base_type;
+// Cells as they are in the table, for the cJSON builders that take no options
+static const PsvWriterOptions default_options = PSV_WRITER_OPTIONS_DEFAULT;
 
-            if (base_type == PSV_DATA_ANNOTATION_FLOAT)
-                return base_type;
-            
-            if (base_type == PSV_DATA_ANNOTATION_BOOL)
-                return base_type;
-            
-            if (base_type == PSV_DATA_ANNOTATION_TEXT)
-                return base_type;
+// Create the JSON value of a [datetime] cell in the given encoding, or return NULL to keep the cell as it is
+static cJSON *create_datetime_json(const char *data, PsvDatetimeEncoding datetime_encoding) {
+    int64_t epoch_ns;
+    if (!psv_datetime_parse(data, &epoch_ns)) {
+        return NULL;
+    }
+
+    switch (datetime_encoding) {
+        case PSV_DATETIME_AS_ISO: {
+            char iso[PSV_DATETIME_STRING_MAX];
+            psv_datetime_format(epoch_ns, iso, sizeof(iso));
+            return cJSON_CreateString(iso);
+        }
+        case PSV_DATETIME_AS_EPOCH:
+            return cJSON_CreateNumber(psv_datetime_epoch_seconds(epoch_ns));
+        case PSV_DATETIME_AS_EPOCH_MS: {
+            int64_t milliseconds = epoch_ns / 1000000;
+            if (epoch_ns % 1000000 < 0) {
+                milliseconds--;
+            }
+            return cJSON_CreateNumber(milliseconds);
         }
+        default:
+            return NULL;
+    }
+}
+
+// Run a cell through its column's decode pipeline, giving the JSON value of a [cbor] item or the bytes
+// re-encoded in the given binary encoding, or return NULL to keep the cell as it is
+static cJSON *create_decoded_json(const PsvHeaderMetadataField *header_metadata, const char *data, PsvBinaryEncoding binary_encoding) {
+    static PsvDecodeScratch pipeline_scratch = {0};
+    static PsvDecodeScratch cbor_scratch = {0};
+
+    const bool is_cbor = psv_decode_pipeline_is_cbor(header_metadata);
+    if (!is_cbor && binary_encoding == PSV_BINARY_AS_TEXT) {
+        return NULL;
+    }
+
+    const char *reason = NULL;
+    const PsvBytes *bytes = psv_decode_pipeline_bytes(header_metadata, data, &pipeline_scratch, &reason);
+    if (bytes == NULL) {
+        return NULL;
+    }
+    if (is_cbor) {
+        return psv_cbor_to_json(bytes->data, bytes->size, binary_encoding, &cbor_scratch, &reason);
+    }
+    return cJSON_CreateString(psv_encode_binary(binary_encoding, bytes->data, bytes->size, &cbor_scratch.buffers[0]));
+}
+
+// Create the JSON value of a cell, typed by its column
+static cJSON *create_cell_json(const PsvWriterOptions *options, PsvTable *table, int column, const char *data) {
+    if (data == NULL) {
+        return cJSON_CreateNull();
     }
 
-    return PSV_DATA_ANNOTATION_TEXT;
+    const PsvHeaderMetadataField *header_metadata = &table->header_metadata[column];
+    switch (psv_validate_cell_basic_type(table, column, data)) {
+        case PSV_DATA_ANNOTATION_INTEGER: return cJSON_CreateNumber(strtoll(data, NULL, 10));
+        case PSV_DATA_ANNOTATION_FLOAT: return cJSON_CreateNumber(atof(data));
+        case PSV_DATA_ANNOTATION_BOOL: return cJSON_CreateBool(psv_data_is_true(data));
+        default: break;
+    }
+
+    // Text, including binary annotations such as [hex] which are text encoded bytes
+    cJSON *datetime_json = (options->datetime_encoding != PSV_DATETIME_AS_TEXT && psv_has_data_annotation(table, column, PSV_DATA_ANNOTATION_DATETIME)) ? create_datetime_json(data, options->datetime_encoding) : NULL;
+    if (datetime_json != NULL) {
+        return datetime_json;
+    }
+    cJSON *decoded_json = (header_metadata->num_decode_stages > 0) ? create_decoded_json(header_metadata, data, options->binary_encoding) : NULL;
+    return decoded_json ? decoded_json : cJSON_CreateString(data);
+}
+
+static void add_row_cells_json(cJSON *row_json, const PsvWriterOptions *options, PsvTable *table, char **data_row_entry) {
+    for (int i = 0; i < table->num_headers; i++) {
+        cJSON_AddItemToObject(row_json, table->header_metadata[i].id, create_cell_json(options, table, i, data_row_entry[i]));
+    }
 }
 
 // Create JSON object of a single tabular row
 cJSON *psv_json_create_table_single_row(PsvTable *table, char **data_row_entry) {
     cJSON *single_row_json = cJSON_CreateObject();
-    for (int i = 0; i < table->num_headers; i++) {
-        const PsvHeaderMetadataField *header_metadata = &table->header_metadata[i];
-        const char *key = header_metadata->id;
-        const char *data = data_row_entry[i];
-        if (data) {
-            const PsvDataAnnotationType basic_type = get_basic_type(table, i);
-            switch (basic_type) {
-                case PSV_DATA_ANNOTATION_INTEGER: {
-                    cJSON_AddItemToObject(single_row_json, key, cJSON_CreateNumber(atoi(data)));
-                } break;
-                case PSV_DATA_ANNOTATION_FLOAT: {
-                    cJSON_AddItemToObject(single_row_json, key, cJSON_CreateNumber(atof(data)));
-                } break;
-                case PSV_DATA_ANNOTATION_BOOL: {
-                    const bool isTrue = strcmp(data, "true") == 0 || strcmp(data, "yes") == 0 || strcmp(data, "active") == 0 || strcmp(data, "y") == 0;
-                    cJSON_AddItemToObject(single_row_json, key, cJSON_CreateBool(isTrue));
-                } break;
-                case PSV_DATA_ANNOTATION_TEXT: {
-                    cJSON_AddItemToObject(single_row_json, key, cJSON_CreateString(data));
-                } break;
-                default: {
-                    cJSON_AddItemToObject(single_row_json, key, cJSON_CreateString(data));
-                }
-            }
-        } else {
-            cJSON_AddItemToObject(single_row_json, key, cJSON_CreateNull());
-        }
-    }
+    add_row_cells_json(single_row_json, &default_options, table, data_row_entry);
     return single_row_json;
 }
 
@@ -68,8 +106,8 @@ cJSON *psv_json_create_table_rows(PsvTable *table) {
     return rows_json;
 }
 
-// Create JSON object representing a table
-cJSON *psv_json_create_table_json(PsvTable *table) {
+// Create JSON object representing a table header (without any rows)
+cJSON *psv_json_create_table_metadata_json(PsvTable *table) {
     cJSON *table_json = cJSON_CreateObject();
     cJSON_AddItemToObject(table_json, "id", cJSON_CreateString(table->id));
 
@@ -100,8 +138,296 @@ cJSON *psv_json_create_table_json(PsvTable *table) {
         cJSON_AddItemToArray(data_annotation_json, data_annotation_entry_json);
     }
     cJSON_AddItemToObject(table_json, "data_annotation", data_annotation_json);
+    return table_json;
+}
+
+// Create JSON object representing a table header along with each column's resolved type and CBOR tag
+cJSON *psv_json_create_table_schema_json(PsvTable *table) {
+    cJSON *table_json = psv_json_create_table_metadata_json(table);
+
+    cJSON *columns_json = cJSON_CreateArray();
+    for (int i = 0; i < table->num_headers; i++) {
+        const PsvHeaderMetadataField *header_metadata = &table->header_metadata[i];
+
+        // The first recognised data annotation from the left decides the column's type
+        const PsvDataAnnotationField *data_annotation = NULL;
+        for (int j = 0; j < header_metadata->data_annotation_tag_size; j++) {
+            if (header_metadata->data_annotation_tags[j].type != PSV_DATA_ANNOTATION_UNKNOWN) {
+                data_annotation = &header_metadata->data_annotation_tags[j];
+                break;
+            }
+        }
+
+        cJSON *column_json = cJSON_CreateObject();
+        cJSON_AddItemToObject(column_json, "key", cJSON_CreateString(header_metadata->id));
+        PsvDataAnnotationType type = PSV_DATA_ANNOTATION_TEXT;
+        if (data_annotation != NULL) {
+            type = data_annotation->type;
+        } else if (header_metadata->inferred_type != PSV_DATA_ANNOTATION_UNKNOWN) {
+            type = header_metadata->inferred_type;
+        }
+        cJSON_AddItemToObject(column_json, "type", cJSON_CreateString(psv_data_annotation_type_name(type)));
+        cJSON_AddItemToObject(column_json, "json_type", cJSON_CreateString(psv_data_annotation_type_name(psv_get_basic_type(table, i))));
+        const cbor_tag_t tag = (data_annotation != NULL) ? data_annotation->tag : psv_data_annotation_type_cbor_tag(type);
+        if (tag != CBOR_TAG_INVALID_64BIT) {
+            cJSON_AddItemToObject(column_json, "cbor_tag", cJSON_CreateNumber(tag));
+        } else {
+            cJSON_AddItemToObject(column_json, "cbor_tag", cJSON_CreateNull());
+        }
+        cJSON_AddItemToArray(columns_json, column_json);
+    }
+    cJSON_AddItemToObject(table_json, "columns", columns_json);
+    return table_json;
+}
 
+// Create JSON object representing a table
+cJSON *psv_json_create_table_json(PsvTable *table) {
+    cJSON *table_json = psv_json_create_table_metadata_json(table);
     cJSON *rows_json = psv_json_create_table_rows(table);
     cJSON_AddItemToObject(table_json, "rows", rows_json);
     return table_json;
 }
+
+static void append_text(PsvBytes *bytes, const char *text, size_t size) {
+    if (bytes->size + size > bytes->capacity) {
+        bytes->capacity = (bytes->size + size) * 2;
+        bytes->data = realloc(bytes->data, bytes->capacity);
+    }
+    memcpy(bytes->data + bytes->size, text, size);
+    bytes->size += size;
+}
+
+// Whether cJSON would print a string without escaping any of its characters
+static bool is_plain_json_string(const char *text) {
+    for (const unsigned char *c = (const unsigned char *)text; *c != '\0'; c++) {
+        if (*c < 32 || *c == '"' || *c == '\\') {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Append the JSON text of a cell, the same as create_cell_json() would print it
+static void append_cell_json(PsvBytes *column_json, const PsvWriterOptions *options, PsvTable *table, int column, const char *data) {
+    if (data == NULL) {
+        append_text(column_json, "null", strlen("null"));
+        return;
+    }
+
+    // Print the common cases directly, the same way cJSON would, rather than building a cJSON item per cell
+    const PsvHeaderMetadataField *header_metadata = &table->header_metadata[column];
+    switch (psv_validate_cell_basic_type(table, column, data)) {
+        case PSV_DATA_ANNOTATION_BOOL: {
+            const char *json_string = psv_data_is_true(data) ? "true" : "false";
+            append_text(column_json, json_string, strlen(json_string));
+        } return;
+        case PSV_DATA_ANNOTATION_INTEGER: {
+            const long long value = strtoll(data, NULL, 10);
+            if (value >= INT_MIN && value <= INT_MAX) {
+                char json_string[16];
+                append_text(column_json, json_string, snprintf(json_string, sizeof(json_string), "%d", (int)value));
+                return;
+            }
+        } break;
+        case PSV_DATA_ANNOTATION_FLOAT: break;
+        default: {
+            const bool is_datetime = (options->datetime_encoding != PSV_DATETIME_AS_TEXT && psv_has_data_annotation(table, column, PSV_DATA_ANNOTATION_DATETIME));
+            if (!is_datetime && header_metadata->num_decode_stages == 0 && is_plain_json_string(data)) {
+                append_text(column_json, "\"", 1);
+                append_text(column_json, data, strlen(data));
+                append_text(column_json, "\"", 1);
+                return;
+            }
+        }
+    }
+
+    cJSON *cell_json = create_cell_json(options, table, column, data);
+    char *json_string = cJSON_PrintUnformatted(cell_json);
+    append_text(column_json, json_string, strlen(json_string));
+    free(json_string);
+    cJSON_Delete(cell_json);
+}
+
+// Append a cell to its column's JSON array text, which is left open until the table ends
+static void append_column_json(PsvBytes *column_json, const PsvWriterOptions *options, PsvTable *table, int column, const char *data) {
+    append_text(column_json, (column_json->size == 0) ? "[" : ",", 1);
+    append_cell_json(column_json, options, table, column, data);
+}
+
+// Write a row as a JSON array of its cells in column order
+static void write_row_array_json(PsvJsonWriter *writer, PsvDataRow data_row) {
+    PsvBytes *row_json = &writer->row_json;
+    row_json->size = 0;
+    append_text(row_json, "[", 1);
+    for (int i = 0; i < writer->table->num_headers; i++) {
+        if (i > 0) {
+            append_text(row_json, ",", 1);
+        }
+        append_cell_json(row_json, writer->options, writer->table, i, data_row[i]);
+    }
+    append_text(row_json, "]", 1);
+    fwrite(row_json->data, 1, row_json->size, writer->output);
+}
+
+// Write the keys of a table as a JSON array, the header row of compact array rows
+static void write_keys_json(PsvJsonWriter *writer) {
+    cJSON *keys_json = cJSON_CreateArray();
+    for (int i = 0; i < writer->table->num_headers; i++) {
+        cJSON_AddItemToArray(keys_json, cJSON_CreateString(writer->table->header_metadata[i].id));
+    }
+    char *json_string = cJSON_PrintUnformatted(keys_json);
+    fputs(json_string, writer->output);
+    free(json_string);
+    cJSON_Delete(keys_json);
+}
+
+// Write a table as a "columns" object of JSON arrays keyed by column, after the header metadata unless in compact mode
+static void write_json_columns(PsvJsonWriter *writer) {
+    if (writer->compact_mode) {
+        fputc('{', writer->output);
+    } else {
+        cJSON *metadata_json = psv_json_create_table_metadata_json(writer->table);
+        char *json_string = cJSON_PrintUnformatted(metadata_json);
+        fwrite(json_string, 1, strlen(json_string) - 1, writer->output); // Drop the closing '}'
+        fputc(',', writer->output);
+        free(json_string);
+        cJSON_Delete(metadata_json);
+    }
+
+    fputs("\"columns\":{", writer->output);
+    for (int i = 0; i < writer->table->num_headers; i++) {
+        cJSON *key_json = cJSON_CreateString(writer->table->header_metadata[i].id);
+        char *key_string = cJSON_PrintUnformatted(key_json);
+        fprintf(writer->output, "%s%s:", (i > 0) ? "," : "", key_string);
+        free(key_string);
+        cJSON_Delete(key_json);
+
+        PsvBytes *column_json = &writer->json_columns[i];
+        if (column_json->size == 0) {
+            fputc('[', writer->output);
+        }
+        fwrite(column_json->data, 1, column_json->size, writer->output);
+        fputc(']', writer->output);
+        psv_bytes_free(column_json);
+    }
+    fputs("}}\n", writer->output);
+
+    free(writer->json_columns);
+    writer->json_columns = NULL;
+}
+
+/**
+ * Streaming table writer
+ *
+ * Writes the same JSON as psv_json_create_table_json() / psv_json_create_table_rows(), but one row at a
+ * time so that processing modes which produce rows incrementally (e.g. aggregation or sorting) never need
+ * to hold the full table or its cJSON tree in memory.
+ *
+ *  - streaming_rows: one JSON object per row per line (same as compact single table mode)
+ *  - compact_mode:   a single JSON array of row objects
+ *  - otherwise:      a full table object with the header metadata followed by the rows
+ *
+ * With rows as arrays, each row is an array of its cells in column order, and the keys are only
+ * written once per table: in the header metadata, or as the first array in compact mode (the
+ * first line when streaming rows).
+ *
+ * In columnar mode the rows are gathered into columns instead, and each table is written as one
+ * object when the writer ends: the header metadata with a "columns" object of arrays keyed by
+ * column, or only the "columns" object in compact mode (including when streaming rows). Each
+ * column's array is kept as JSON text so that no cJSON tree is held for the rows.
+ */
+void psv_json_writer_begin(PsvJsonWriter *writer, const PsvWriterOptions *options, FILE *output, PsvTable *table, bool compact_mode, bool streaming_rows) {
+    *writer = (PsvJsonWriter){0};
+    writer->options = options;
+    writer->output = output;
+    writer->table = table;
+    writer->compact_mode = compact_mode;
+    writer->streaming_rows = streaming_rows;
+
+    if (options->columnar) {
+        writer->compact_mode = compact_mode || streaming_rows;
+        writer->streaming_rows = false;
+        writer->json_columns = calloc(table->num_headers + 1, sizeof(PsvBytes));
+        return;
+    }
+
+    if (streaming_rows) {
+        if (options->rows_as_arrays) {
+            write_keys_json(writer);
+            fputc('\n', output);
+        }
+        return;
+    }
+
+    if (compact_mode) {
+        fputc('[', output);
+        if (options->rows_as_arrays) {
+            write_keys_json(writer);
+        }
+        return;
+    }
+
+    // Print the header metadata object but leave it open, so that the rows array can be appended
+    cJSON *metadata_json = psv_json_create_table_metadata_json(table);
+    char *json_string = cJSON_PrintUnformatted(metadata_json);
+    const size_t json_string_length = strlen(json_string);
+    fwrite(json_string, 1, json_string_length - 1, output); // Drop the closing '}'
+    fputs(",\"rows\":[", output);
+    free(json_string);
+    cJSON_Delete(metadata_json);
+}
+
+void psv_json_writer_write_row(PsvJsonWriter *writer, PsvDataRow data_row) {
+    if (writer->options->columnar) {
+        for (int i = 0; i < writer->table->num_headers; i++) {
+            append_column_json(&writer->json_columns[i], writer->options, writer->table, i, data_row[i]);
+        }
+        writer->num_rows++;
+        return;
+    }
+
+    if (writer->options->rows_as_arrays) {
+        // The keys array is the first item in compact mode, so every row follows a comma
+        if (!writer->streaming_rows && (writer->num_rows > 0 || writer->compact_mode)) {
+            fputc(',', writer->output);
+        }
+        write_row_array_json(writer, data_row);
+        if (writer->streaming_rows) {
+            fputc('\n', writer->output);
+        }
+        writer->num_rows++;
+        return;
+    }
+
+    cJSON *row_json = cJSON_CreateObject();
+    if (writer->options->row_table_tags && writer->streaming_rows) {
+        cJSON_AddItemToObject(row_json, PSV_JSON_TABLE_KEY, cJSON_CreateString(writer->table->id));
+    }
+    add_row_cells_json(row_json, writer->options, writer->table, data_row);
+    char *json_string = cJSON_PrintUnformatted(row_json);
+    if (writer->streaming_rows) {
+        fprintf(writer->output, "%s\n", json_string);
+    } else {
+        if (writer->num_rows > 0) {
+            fputc(',', writer->output);
+        }
+        fputs(json_string, writer->output);
+    }
+    free(json_string);
+    cJSON_Delete(row_json);
+    writer->num_rows++;
+}
+
+void psv_json_writer_end(PsvJsonWriter *writer) {
+    if (writer->options->columnar) {
+        write_json_columns(writer);
+        return;
+    }
+
+    psv_bytes_free(&writer->row_json);
+    if (writer->streaming_rows) {
+        return;
+    }
+
+    fputs(writer->compact_mode ? "]\n" : "]}\n", writer->output);
+}
@@ -3,9 +3,34 @@
 
 #include "psv.h"
 #include "cJSON.h"
+#include "psv_decode.h"
+
+// Key of the table id in streamed rows of every table (--ndjson-all)
+#define PSV_JSON_TABLE_KEY "__table"
+
+// Output options, defined in psv_writer.h
+struct PsvWriterOptions;
 
 cJSON *psv_json_create_table_single_row(PsvTable *table, char **data_row_entry);
 cJSON *psv_json_create_table_rows(PsvTable *table);
+cJSON *psv_json_create_table_metadata_json(PsvTable *table);
+cJSON *psv_json_create_table_schema_json(PsvTable *table);
 cJSON *psv_json_create_table_json(PsvTable *table);
 
+// Writes a table as JSON one row at a time
+typedef struct {
+    const struct PsvWriterOptions *options;
+    FILE *output;
+    PsvTable *table;
+    bool compact_mode;
+    bool streaming_rows;
+    size_t num_rows;
+    PsvBytes *json_columns; ///< JSON array text of each column in columnar mode
+    PsvBytes row_json;      ///< JSON text of the row being written when rows are arrays
+} PsvJsonWriter;
+
+void psv_json_writer_begin(PsvJsonWriter *writer, const struct PsvWriterOptions *options, FILE *output, PsvTable *table, bool compact_mode, bool streaming_rows);
+void psv_json_writer_write_row(PsvJsonWriter *writer, PsvDataRow data_row);
+void psv_json_writer_end(PsvJsonWriter *writer);
+
 #endif /* PSV_JSON_H */
\ No newline at end of file
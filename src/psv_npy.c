@@ -0,0 +1,179 @@
+/**
+ * @file psv_npy.c
+ * @brief NumPy .npy Output Of Numeric Columns
+ *
+ * Copyright (C) 2024-2024 Brian Khuu <contact@briankhuu.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Each [int], [float] and [bool] column of a table is written to its own version 1.0 .npy file
+ * as a one dimensional little endian '<i8', '<f8' or '|b1' array. Values are appended as rows
+ * arrive, so the table is never held in memory. The row count is not known until the end, so
+ * the header is written with a fixed size and rewritten with the final shape once all rows are in.
+ *
+ * NumPy arrays have no nulls, so each column also gets a '|b1' <key>.mask.npy file that is true
+ * where the cell is empty or not valid as the column's type, in the numpy.ma convention. Those
+ * cells are written as NaN in float columns, 0 in int columns and false in bool columns, so the
+ * values of an int column can only be told apart from real zeros through the mask.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <math.h>
+#include <assert.h>
+
+#include "psv_npy.h"
+#include "psv_validate.h"
+
+#ifdef NDEBUG
+    #define assert(expression) ((void)0)
+#endif
+
+static const char *npy_descr(PsvArrowType type) {
+    switch (type) {
+        case PSV_ARROW_INT64: return "<i8";
+        case PSV_ARROW_FLOAT64: return "<f8";
+        default: break;
+    }
+    return "|b1";
+}
+
+// The data annotation whose validator decides which cells of a column are masked
+static PsvDataAnnotationType npy_annotation_type(PsvArrowType type) {
+    switch (type) {
+        case PSV_ARROW_INT64: return PSV_DATA_ANNOTATION_INTEGER;
+        case PSV_ARROW_FLOAT64: return PSV_DATA_ANNOTATION_FLOAT;
+        default: break;
+    }
+    return PSV_DATA_ANNOTATION_BOOL;
+}
+
+// Write the magic string, version 1.0 and header dict, padded with spaces to PSV_NPY_HEADER_SIZE
+static void write_header(FILE *file, PsvArrowType type, size_t num_rows) {
+    static const uint8_t preamble[10] = {0x93, 'N', 'U', 'M', 'P', 'Y', 1, 0, (PSV_NPY_HEADER_SIZE - 10) & 0xFF, (PSV_NPY_HEADER_SIZE - 10) >> 8};
+    char header[PSV_NPY_HEADER_SIZE + 1];
+    memcpy(header, preamble, sizeof(preamble));
+    const int length = sizeof(preamble) + snprintf(header + sizeof(preamble), sizeof(header) - sizeof(preamble),
+        "{'descr': '%s', 'fortran_order': False, 'shape': (%zu,), }", npy_descr(type), num_rows);
+    assert(length < PSV_NPY_HEADER_SIZE);
+    memset(header + length, ' ', PSV_NPY_HEADER_SIZE - length);
+    header[PSV_NPY_HEADER_SIZE - 1] = '\n';
+    fwrite(header, 1, PSV_NPY_HEADER_SIZE, file);
+}
+
+// Open <directory>/<key><suffix>, with characters that cannot be in a file name replaced by '_'
+static FILE *open_column_file(const char *directory, const char *key, const char *suffix) {
+    const size_t directory_length = strlen(directory);
+    const size_t key_length = strlen(key);
+    char *path = malloc(directory_length + key_length + strlen(suffix) + sizeof("/"));
+    assert(path != NULL);
+
+    memcpy(path, directory, directory_length);
+    char *name = path + directory_length;
+    *name++ = '/';
+    for (size_t i = 0; i < key_length; i++) {
+        const char c = key[i];
+        const bool is_safe = (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '_' || c == '-' || (c == '.' && i > 0);
+        name[i] = is_safe ? c : '_';
+    }
+    strcpy(name + key_length, suffix);
+
+    FILE *file = fopen(path, "wb");
+    if (file == NULL) {
+        fprintf(stderr, "psv: cannot open file '%s' for writing: %s\n", path, strerror(errno));
+        exit(1);
+    }
+    free(path);
+    return file;
+}
+
+/**
+ * @brief Starts writing the numeric columns of a table as .npy files.
+ *
+ * @param writer The writer to initialise.
+ * @param directory Existing directory to write the files into (overwriting files of the same name).
+ * @param table The table whose rows will be written.
+ */
+void psv_npy_writer_begin(PsvNpyWriter *writer, const char *directory, PsvTable *table) {
+    *writer = (PsvNpyWriter){0};
+    writer->table = table;
+    writer->columns = calloc(table->num_headers + 1, sizeof(PsvNpyColumn));
+    assert(writer->columns != NULL);
+
+    for (int i = 0; i < table->num_headers; i++) {
+        const PsvArrowType type = psv_arrow_column_type(table, i);
+        if (type != PSV_ARROW_INT64 && type != PSV_ARROW_FLOAT64 && type != PSV_ARROW_BOOL) {
+            continue;
+        }
+        PsvNpyColumn *column = &writer->columns[writer->num_columns++];
+        column->column = i;
+        column->type = type;
+        column->file = open_column_file(directory, table->header_metadata[i].id, ".npy");
+        column->mask_file = open_column_file(directory, table->header_metadata[i].id, ".mask.npy");
+        write_header(column->file, type, 0);
+        write_header(column->mask_file, PSV_ARROW_BOOL, 0);
+    }
+
+    if (writer->num_columns == 0) {
+        fprintf(stderr, "psv: warning: table '%s' has no [int], [float] or [bool] columns to write as .npy\n", table->id);
+    }
+}
+
+void psv_npy_writer_write_row(PsvNpyWriter *writer, PsvDataRow data_row) {
+    for (int i = 0; i < writer->num_columns; i++) {
+        const PsvNpyColumn *column = &writer->columns[i];
+        const char *cell = data_row[column->column];
+        const char *reason = NULL;
+
+        const bool is_valid = (cell != NULL) && psv_validate_get_type_validator(npy_annotation_type(column->type))(cell, &reason);
+        fputc(is_valid ? 0 : 1, column->mask_file);
+
+        if (column->type == PSV_ARROW_BOOL) {
+            fputc((is_valid && psv_data_is_true(cell)) ? 1 : 0, column->file);
+            continue;
+        }
+
+        uint64_t bits = 0;
+        if (column->type == PSV_ARROW_INT64) {
+            bits = is_valid ? (uint64_t)strtoll(cell, NULL, 10) : 0;
+        } else {
+            const double value = is_valid ? strtod(cell, NULL) : NAN;
+            memcpy(&bits, &value, sizeof(bits));
+        }
+
+        uint8_t value[8];
+        for (int byte = 0; byte < 8; byte++) {
+            value[byte] = (uint8_t)(bits >> (byte * 8));
+        }
+        fwrite(value, 1, sizeof(value), column->file);
+    }
+    writer->num_rows++;
+}
+
+/**
+ * @brief Rewrites each file's header with the final row count, closes the files and frees the writer.
+ *
+ * @param writer The writer.
+ */
+void psv_npy_writer_end(PsvNpyWriter *writer) {
+    for (int i = 0; i < writer->num_columns; i++) {
+        PsvNpyColumn *column = &writer->columns[i];
+        fseek(column->file, 0, SEEK_SET);
+        write_header(column->file, column->type, writer->num_rows);
+        fseek(column->mask_file, 0, SEEK_SET);
+        write_header(column->mask_file, PSV_ARROW_BOOL, writer->num_rows);
+        const bool is_file_closed = (fclose(column->file) == 0);
+        const bool is_mask_file_closed = (fclose(column->mask_file) == 0);
+        if (!is_file_closed || !is_mask_file_closed) {
+            fprintf(stderr, "psv: cannot write .npy file of column '%s'\n", writer->table->header_metadata[column->column].id);
+            exit(1);
+        }
+    }
+    free(writer->columns);
+    *writer = (PsvNpyWriter){0};
+}
@@ -0,0 +1,46 @@
+/**
+ * @file psv_npy.h
+ * @brief NumPy .npy Output Of Numeric Columns
+ *
+ * Copyright (C) 2024-2024 Brian Khuu <contact@briankhuu.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ */
+
+#ifndef PSV_NPY_H
+#define PSV_NPY_H
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "psv.h"
+#include "psv_arrow.h"
+
+// Size of the magic string, version, header length and padded header dict, so the data is 64 byte aligned
+#define PSV_NPY_HEADER_SIZE 128
+
+// A numeric column being written to its own .npy file
+typedef struct {
+    int column;             ///< Index of the column in the table
+    PsvArrowType type;      ///< PSV_ARROW_INT64, PSV_ARROW_FLOAT64 or PSV_ARROW_BOOL
+    FILE *file;
+    FILE *mask_file;        ///< <key>.mask.npy, true where the cell is empty or not valid as the column's type
+} PsvNpyColumn;
+
+// Writes each [int], [float] and [bool] column of a table to <directory>/<key>.npy, with a <key>.mask.npy beside it
+typedef struct {
+    PsvTable *table;
+    size_t num_rows;
+    int num_columns;
+    PsvNpyColumn *columns;
+} PsvNpyWriter;
+
+void psv_npy_writer_begin(PsvNpyWriter *writer, const char *directory, PsvTable *table);
+void psv_npy_writer_write_row(PsvNpyWriter *writer, PsvDataRow data_row);
+void psv_npy_writer_end(PsvNpyWriter *writer);
+
+#endif
@@ -0,0 +1,618 @@
+/**
+ * @file psv_parquet.c
+ * @brief Apache Parquet File Output Of Tables
+ *
+ * Copyright (C) 2024-2024 Brian Khuu <contact@briankhuu.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Rows are gathered into Arrow column buffers (see psv_arrow.c) until they reach the row group
+ * budget, then each column is written out as a column chunk of uncompressed version 1 data
+ * pages. The file metadata, with the schema and the location of every column chunk, is written
+ * after the last row group, so the file can be written to a pipe without seeking.
+ *
+ * Columns take their physical and logical types from the same mapping as Arrow output, and are
+ * all optional (empty cells, and cells that are not valid as their column's type, are null):
+ *
+ * - [int] and [float] become INT64 and DOUBLE, written PLAIN.
+ * - [bool] becomes BOOLEAN, written with the RLE / bit packing hybrid encoding.
+ * - [datetime] becomes INT64 with a UTC nanosecond TIMESTAMP logical type.
+ * - Binary columns become BYTE_ARRAY, [uuid] a 16 byte FIXED_LEN_BYTE_ARRAY with the UUID logical type.
+ * - Text becomes BYTE_ARRAY with the STRING logical type. A column chunk with few distinct values
+ *   (at most half as many as it has values) is dictionary encoded: a PLAIN dictionary page, then
+ *   data pages of RLE_DICTIONARY indices.
+ *
+ * The footer and page headers use the Thrift compact protocol, written by the small encoder below.
+ */
+
+#include <string.h>
+#include <stdlib.h>
+#include <assert.h>
+
+#include "psv_parquet.h"
+#include "psv_hash.h"
+
+#ifdef NDEBUG
+    #define assert(expression) ((void)0)
+#endif
+
+// Physical types (parquet.thrift)
+#define PARQUET_TYPE_BOOLEAN 0
+#define PARQUET_TYPE_INT64 2
+#define PARQUET_TYPE_DOUBLE 5
+#define PARQUET_TYPE_BYTE_ARRAY 6
+#define PARQUET_TYPE_FIXED_LEN_BYTE_ARRAY 7
+
+#define PARQUET_REPETITION_OPTIONAL 1
+#define PARQUET_CONVERTED_UTF8 0
+
+#define PARQUET_ENCODING_PLAIN 0
+#define PARQUET_ENCODING_RLE 3
+#define PARQUET_ENCODING_RLE_DICTIONARY 8
+
+#define PARQUET_PAGE_DATA 0
+#define PARQUET_PAGE_DICTIONARY 2
+
+// Thrift compact protocol types
+#define THRIFT_TRUE 1
+#define THRIFT_FALSE 2
+#define THRIFT_I32 5
+#define THRIFT_I64 6
+#define THRIFT_BINARY 8
+#define THRIFT_LIST 9
+#define THRIFT_STRUCT 12
+
+#define THRIFT_DEPTH_MAX 8
+
+// Append zeroed bytes and return where they start (only valid until the next append)
+static uint8_t *reserve(PsvBytes *bytes, size_t size) {
+    if (bytes->size + size > bytes->capacity) {
+        bytes->capacity = (bytes->size + size) * 2;
+        bytes->data = realloc(bytes->data, bytes->capacity);
+        assert(bytes->data != NULL);
+    }
+    uint8_t *out = bytes->data + bytes->size;
+    memset(out, 0, size);
+    bytes->size += size;
+    return out;
+}
+
+static void put_le32(uint8_t *out, uint32_t value) {
+    for (int i = 0; i < 4; i++) {
+        out[i] = (uint8_t)(value >> (i * 8));
+    }
+}
+
+static uint32_t get_le32(const uint8_t *in) {
+    return (uint32_t)in[0] | ((uint32_t)in[1] << 8) | ((uint32_t)in[2] << 16) | ((uint32_t)in[3] << 24);
+}
+
+static void append_byte(PsvBytes *bytes, uint8_t value) {
+    *reserve(bytes, 1) = value;
+}
+
+static void append_varint(PsvBytes *bytes, uint64_t value) {
+    while (value >= 0x80) {
+        append_byte(bytes, (uint8_t)(value | 0x80));
+        value >>= 7;
+    }
+    append_byte(bytes, (uint8_t)value);
+}
+
+/**
+ * Thrift compact protocol encoder
+ */
+
+typedef struct {
+    PsvBytes *out;
+    int depth;
+    int last_ids[THRIFT_DEPTH_MAX];     ///< Last field id written in each open struct
+} ThriftWriter;
+
+static uint64_t zigzag(int64_t value) {
+    return ((uint64_t)value << 1) ^ ((value < 0) ? UINT64_MAX : 0);
+}
+
+static void thrift_begin(ThriftWriter *thrift, PsvBytes *out) {
+    *thrift = (ThriftWriter){0};
+    thrift->out = out;
+}
+
+static void thrift_field(ThriftWriter *thrift, int id, uint8_t type) {
+    const int delta = id - thrift->last_ids[thrift->depth];
+    if (delta > 0 && delta <= 15) {
+        append_byte(thrift->out, (uint8_t)((delta << 4) | type));
+    } else {
+        append_byte(thrift->out, type);
+        append_varint(thrift->out, zigzag(id));
+    }
+    thrift->last_ids[thrift->depth] = id;
+}
+
+static void thrift_i32(ThriftWriter *thrift, int id, int32_t value) {
+    thrift_field(thrift, id, THRIFT_I32);
+    append_varint(thrift->out, zigzag(value));
+}
+
+static void thrift_i64(ThriftWriter *thrift, int id, int64_t value) {
+    thrift_field(thrift, id, THRIFT_I64);
+    append_varint(thrift->out, zigzag(value));
+}
+
+static void thrift_bool(ThriftWriter *thrift, int id, bool value) {
+    thrift_field(thrift, id, value ? THRIFT_TRUE : THRIFT_FALSE);
+}
+
+// A string as a list element or field value, without the field header
+static void thrift_string_value(ThriftWriter *thrift, const char *text) {
+    const size_t size = strlen(text);
+    append_varint(thrift->out, size);
+    memcpy(reserve(thrift->out, size), text, size);
+}
+
+static void thrift_string(ThriftWriter *thrift, int id, const char *text) {
+    thrift_field(thrift, id, THRIFT_BINARY);
+    thrift_string_value(thrift, text);
+}
+
+static void thrift_list(ThriftWriter *thrift, int id, uint8_t element_type, size_t size) {
+    thrift_field(thrift, id, THRIFT_LIST);
+    if (size < 15) {
+        append_byte(thrift->out, (uint8_t)((size << 4) | element_type));
+    } else {
+        append_byte(thrift->out, 0xF0 | element_type);
+        append_varint(thrift->out, size);
+    }
+}
+
+// Open a struct that is a list element (a struct field also needs thrift_struct())
+static void thrift_element(ThriftWriter *thrift) {
+    assert(thrift->depth + 1 < THRIFT_DEPTH_MAX);
+    thrift->depth++;
+    thrift->last_ids[thrift->depth] = 0;
+}
+
+static void thrift_struct(ThriftWriter *thrift, int id) {
+    thrift_field(thrift, id, THRIFT_STRUCT);
+    thrift_element(thrift);
+}
+
+// Close the innermost struct, or the top level struct
+static void thrift_end(ThriftWriter *thrift) {
+    append_byte(thrift->out, 0);
+    if (thrift->depth > 0) {
+        thrift->depth--;
+    }
+}
+
+static void thrift_empty_struct(ThriftWriter *thrift, int id) {
+    thrift_struct(thrift, id);
+    thrift_end(thrift);
+}
+
+/**
+ * RLE / bit packing hybrid encoding (used for definition levels, booleans and dictionary indices)
+ */
+
+static size_t run_length(const uint32_t *values, size_t start, size_t count) {
+    size_t end = start;
+    while (end < count && values[end] == values[start]) {
+        end++;
+    }
+    return end - start;
+}
+
+static void encode_rle_hybrid(PsvBytes *out, const uint32_t *values, size_t count, int bit_width) {
+    const size_t value_size = (bit_width + 7) / 8;
+    size_t i = 0;
+    while (i < count) {
+        const size_t run = run_length(values, i, count);
+        if (run >= 8) {
+            append_varint(out, run << 1);
+            const uint32_t value = values[i];
+            uint8_t *out_value = reserve(out, value_size);
+            for (size_t j = 0; j < value_size; j++) {
+                out_value[j] = (uint8_t)(value >> (j * 8));
+            }
+            i += run;
+            continue;
+        }
+
+        // Bit pack groups of 8 values until a long run starts at a group boundary, padding the last group
+        size_t end = i;
+        do {
+            end += 8;
+        } while (end < count && run_length(values, end, count) < 8);
+
+        const size_t num_groups = (end - i) / 8;
+        append_varint(out, (num_groups << 1) | 1);
+        uint8_t *packed = reserve(out, num_groups * bit_width);
+        for (size_t j = i; j < end && j < count; j++) {
+            const size_t bit_offset = (j - i) * bit_width;
+            for (int bit = 0; bit < bit_width; bit++) {
+                if ((values[j] >> bit) & 1) {
+                    packed[(bit_offset + bit) / 8] |= (uint8_t)(1u << ((bit_offset + bit) % 8));
+                }
+            }
+        }
+        i = end;
+    }
+}
+
+// The hybrid encoding with its size in front, as definition levels and booleans are written in data pages
+static void encode_rle_hybrid_with_length(PsvBytes *out, const uint32_t *values, size_t count, int bit_width) {
+    const size_t length_position = out->size;
+    reserve(out, 4);
+    encode_rle_hybrid(out, values, count, bit_width);
+    put_le32(out->data + length_position, (uint32_t)(out->size - length_position - 4));
+}
+
+/**
+ * Column chunks
+ */
+
+// Where a column chunk was written, for its column metadata
+typedef struct {
+    bool is_dictionary;
+    uint64_t offset;            ///< Start of the first page (the dictionary page if there is one)
+    uint64_t data_page_offset;
+    uint64_t size;
+} ColumnChunkInfo;
+
+static uint8_t physical_type(PsvArrowType type) {
+    switch (type) {
+        case PSV_ARROW_INT64: return PARQUET_TYPE_INT64;
+        case PSV_ARROW_FLOAT64: return PARQUET_TYPE_DOUBLE;
+        case PSV_ARROW_BOOL: return PARQUET_TYPE_BOOLEAN;
+        case PSV_ARROW_TIMESTAMP: return PARQUET_TYPE_INT64;
+        case PSV_ARROW_UUID: return PARQUET_TYPE_FIXED_LEN_BYTE_ARRAY;
+        case PSV_ARROW_BINARY:
+        case PSV_ARROW_UTF8: break;
+    }
+    return PARQUET_TYPE_BYTE_ARRAY;
+}
+
+static size_t fixed_width(PsvArrowType type) {
+    return (type == PSV_ARROW_UUID) ? PSV_UUID_SIZE : 8;
+}
+
+static bool is_valid_row(const PsvArrowColumn *column, size_t row) {
+    return (column->validity.data[row / 8] >> (row % 8)) & 1;
+}
+
+// Size of a row's value when written PLAIN (a byte per boolean, which is good enough for cutting pages)
+static size_t plain_value_size(const PsvArrowColumn *column, size_t row) {
+    if (column->type == PSV_ARROW_BOOL) {
+        return 1;
+    }
+    if (psv_arrow_is_variable_width(column->type)) {
+        return 4 + get_le32(column->offsets.data + 4 * (row + 1)) - get_le32(column->offsets.data + 4 * row);
+    }
+    return fixed_width(column->type);
+}
+
+static uint32_t *scratch_values(PsvBytes *bytes, size_t count) {
+    bytes->size = 0;
+    return (uint32_t *)reserve(bytes, (count + 1) * sizeof(uint32_t));
+}
+
+/**
+ * @brief Dictionary encodes a text column chunk, if it has few enough distinct values.
+ *
+ * Fills the writer's dictionary page with the distinct values (PLAIN encoded) and its indices
+ * with the dictionary index of each row.
+ *
+ * @return The number of dictionary entries, or 0 if the column chunk should be written PLAIN.
+ */
+static size_t build_dictionary(PsvParquetWriter *writer, const PsvArrowColumn *column, size_t num_rows) {
+    const size_t num_values = num_rows - column->num_nulls;
+    uint32_t *indices = scratch_values(&writer->indices, num_rows);
+    writer->dictionary.size = 0;
+
+    PsvHashMap map;
+    psv_hash_map_init(&map, 0);
+    size_t num_entries = 0;
+    for (size_t row = 0; row < num_rows; row++) {
+        if (!is_valid_row(column, row)) {
+            continue;
+        }
+
+        const uint32_t start = get_le32(column->offsets.data + 4 * row);
+        const uint32_t size = get_le32(column->offsets.data + 4 * (row + 1)) - start;
+        const char *value = (const char *)column->values.data + start;
+        size_t index = map.count;
+        if (!psv_hash_map_find(&map, value, size, &index)) {
+            // Not worth it once there are more distinct values than half of all values
+            if (map.count >= PSV_PARQUET_DICTIONARY_MAX || (map.count + 1) * 2 > num_values) {
+                num_entries = 0;
+                break;
+            }
+            psv_hash_map_insert(&map, value, size, &index);
+            put_le32(reserve(&writer->dictionary, 4), size);
+            memcpy(reserve(&writer->dictionary, size), value, size);
+        }
+        indices[row] = (uint32_t)index;
+        num_entries = map.count;
+    }
+    psv_hash_map_free(&map);
+    return num_entries;
+}
+
+static void write_page(PsvParquetWriter *writer, int page_type, const PsvBytes *body, size_t num_values, int encoding, ColumnChunkInfo *chunk) {
+    ThriftWriter thrift;
+    writer->thrift.size = 0;
+    thrift_begin(&thrift, &writer->thrift);
+    thrift_i32(&thrift, 1, page_type);
+    thrift_i32(&thrift, 2, (int32_t)body->size);     // uncompressed_page_size
+    thrift_i32(&thrift, 3, (int32_t)body->size);     // compressed_page_size
+    if (page_type == PARQUET_PAGE_DICTIONARY) {
+        thrift_struct(&thrift, 7);
+        thrift_i32(&thrift, 1, (int32_t)num_values);
+        thrift_i32(&thrift, 2, encoding);
+        thrift_end(&thrift);
+    } else {
+        thrift_struct(&thrift, 5);
+        thrift_i32(&thrift, 1, (int32_t)num_values);
+        thrift_i32(&thrift, 2, encoding);
+        thrift_i32(&thrift, 3, PARQUET_ENCODING_RLE);   // definition levels
+        thrift_i32(&thrift, 4, PARQUET_ENCODING_RLE);   // repetition levels (none, as columns are not nested)
+        thrift_end(&thrift);
+    }
+    thrift_end(&thrift);
+
+    fwrite(writer->thrift.data, 1, writer->thrift.size, writer->output);
+    fwrite(body->data, 1, body->size, writer->output);
+    writer->offset += writer->thrift.size + body->size;
+    chunk->size += writer->thrift.size + body->size;
+}
+
+// Encode the rows [start, end) of a column as the body of a data page
+static void encode_data_page(PsvParquetWriter *writer, const PsvArrowColumn *column, size_t start, size_t end, int index_bit_width) {
+    PsvBytes *page = &writer->page;
+    page->size = 0;
+
+    // Definition levels: 1 for a value and 0 for a null
+    uint32_t *values = scratch_values(&writer->levels, end - start);
+    for (size_t row = start; row < end; row++) {
+        values[row - start] = is_valid_row(column, row);
+    }
+    encode_rle_hybrid_with_length(page, values, end - start, 1);
+
+    // Then only the non null values
+    size_t num_values = 0;
+    if (index_bit_width > 0) {
+        const uint32_t *indices = (const uint32_t *)writer->indices.data;
+        for (size_t row = start; row < end; row++) {
+            if (is_valid_row(column, row)) {
+                values[num_values++] = indices[row];
+            }
+        }
+        append_byte(page, (uint8_t)index_bit_width);
+        encode_rle_hybrid(page, values, num_values, index_bit_width);
+    } else if (column->type == PSV_ARROW_BOOL) {
+        for (size_t row = start; row < end; row++) {
+            if (is_valid_row(column, row)) {
+                values[num_values++] = (column->values.data[row / 8] >> (row % 8)) & 1;
+            }
+        }
+        encode_rle_hybrid_with_length(page, values, num_values, 1);
+    } else if (psv_arrow_is_variable_width(column->type)) {
+        for (size_t row = start; row < end; row++) {
+            if (is_valid_row(column, row)) {
+                const uint32_t value_start = get_le32(column->offsets.data + 4 * row);
+                const uint32_t size = get_le32(column->offsets.data + 4 * (row + 1)) - value_start;
+                put_le32(reserve(page, 4), size);
+                if (size > 0) {
+                    memcpy(reserve(page, size), column->values.data + value_start, size);
+                }
+            }
+        }
+    } else {
+        const size_t width = fixed_width(column->type);
+        for (size_t row = start; row < end; row++) {
+            if (is_valid_row(column, row)) {
+                memcpy(reserve(page, width), column->values.data + row * width, width);
+            }
+        }
+    }
+}
+
+static void write_column_chunk(PsvParquetWriter *writer, const PsvArrowColumn *column, ColumnChunkInfo *chunk) {
+    const size_t num_rows = writer->batch.num_rows;
+    *chunk = (ColumnChunkInfo){.offset = writer->offset};
+
+    int index_bit_width = 0;
+    const size_t num_entries = (column->type == PSV_ARROW_UTF8) ? build_dictionary(writer, column, num_rows) : 0;
+    if (num_entries > 0) {
+        chunk->is_dictionary = true;
+        index_bit_width = 1;
+        while (((size_t)1 << index_bit_width) < num_entries) {
+            index_bit_width++;
+        }
+        write_page(writer, PARQUET_PAGE_DICTIONARY, &writer->dictionary, num_entries, PARQUET_ENCODING_PLAIN, chunk);
+    }
+
+    chunk->data_page_offset = writer->offset;
+    const int encoding = chunk->is_dictionary ? PARQUET_ENCODING_RLE_DICTIONARY : (column->type == PSV_ARROW_BOOL) ? PARQUET_ENCODING_RLE : PARQUET_ENCODING_PLAIN;
+    size_t start = 0;
+    while (start < num_rows) {
+        size_t end = start;
+        size_t page_size = 0;
+        while (end < num_rows && page_size < PSV_PARQUET_PAGE_SIZE) {
+            page_size += plain_value_size(column, end);
+            end++;
+        }
+        encode_data_page(writer, column, start, end, index_bit_width);
+        write_page(writer, PARQUET_PAGE_DATA, &writer->page, end - start, encoding, chunk);
+        start = end;
+    }
+}
+
+static void write_row_group(PsvParquetWriter *writer) {
+    const PsvArrowBatch *batch = &writer->batch;
+    const uint64_t row_group_offset = writer->offset;
+    ColumnChunkInfo *chunks = calloc(batch->num_columns + 1, sizeof(ColumnChunkInfo));
+    assert(chunks != NULL);
+    for (int i = 0; i < batch->num_columns; i++) {
+        write_column_chunk(writer, &batch->columns[i], &chunks[i]);
+    }
+
+    // RowGroup struct for the file metadata
+    ThriftWriter thrift;
+    thrift_begin(&thrift, &writer->row_groups);
+    thrift_list(&thrift, 1, THRIFT_STRUCT, batch->num_columns);
+    for (int i = 0; i < batch->num_columns; i++) {
+        const PsvArrowColumn *column = &batch->columns[i];
+        const ColumnChunkInfo *chunk = &chunks[i];
+        thrift_element(&thrift);
+        thrift_i64(&thrift, 2, chunk->offset);                  // file_offset
+        thrift_struct(&thrift, 3);                              // meta_data
+        thrift_i32(&thrift, 1, physical_type(column->type));
+        thrift_list(&thrift, 2, THRIFT_I32, chunk->is_dictionary ? 3 : 2);
+        append_varint(thrift.out, zigzag(PARQUET_ENCODING_PLAIN));
+        append_varint(thrift.out, zigzag(PARQUET_ENCODING_RLE));
+        if (chunk->is_dictionary) {
+            append_varint(thrift.out, zigzag(PARQUET_ENCODING_RLE_DICTIONARY));
+        }
+        thrift_list(&thrift, 3, THRIFT_BINARY, 1);              // path_in_schema
+        thrift_string_value(&thrift, batch->table->header_metadata[i].id);
+        thrift_i32(&thrift, 4, 0);                              // codec: uncompressed
+        thrift_i64(&thrift, 5, batch->num_rows);                // num_values
+        thrift_i64(&thrift, 6, chunk->size);                    // total_uncompressed_size
+        thrift_i64(&thrift, 7, chunk->size);                    // total_compressed_size
+        thrift_i64(&thrift, 9, chunk->data_page_offset);
+        if (chunk->is_dictionary) {
+            thrift_i64(&thrift, 11, chunk->offset);             // dictionary_page_offset
+        }
+        thrift_struct(&thrift, 12);                             // statistics
+        thrift_i64(&thrift, 3, column->num_nulls);
+        thrift_end(&thrift);
+        thrift_end(&thrift);
+        thrift_end(&thrift);
+    }
+    thrift_i64(&thrift, 2, writer->offset - row_group_offset);  // total_byte_size
+    thrift_i64(&thrift, 3, batch->num_rows);
+    thrift_i64(&thrift, 5, row_group_offset);                   // file_offset
+    thrift_i64(&thrift, 6, writer->offset - row_group_offset);  // total_compressed_size
+    thrift_end(&thrift);
+
+    free(chunks);
+    writer->num_rows += batch->num_rows;
+    writer->num_row_groups++;
+    psv_arrow_batch_clear(&writer->batch);
+}
+
+// Write a column's SchemaElement, as a list element
+static void write_schema_element(ThriftWriter *thrift, const char *name, PsvArrowType type) {
+    thrift_element(thrift);
+    thrift_i32(thrift, 1, physical_type(type));
+    if (type == PSV_ARROW_UUID) {
+        thrift_i32(thrift, 2, PSV_UUID_SIZE);                   // type_length
+    }
+    thrift_i32(thrift, 3, PARQUET_REPETITION_OPTIONAL);
+    thrift_string(thrift, 4, name);
+    if (type == PSV_ARROW_UTF8) {
+        thrift_i32(thrift, 6, PARQUET_CONVERTED_UTF8);
+    }
+
+    if (type == PSV_ARROW_UTF8 || type == PSV_ARROW_TIMESTAMP || type == PSV_ARROW_UUID) {
+        thrift_struct(thrift, 10);                              // logicalType
+        if (type == PSV_ARROW_UTF8) {
+            thrift_empty_struct(thrift, 1);                     // STRING
+        } else if (type == PSV_ARROW_TIMESTAMP) {
+            thrift_struct(thrift, 8);                           // TIMESTAMP
+            thrift_bool(thrift, 1, true);                       // isAdjustedToUTC
+            thrift_struct(thrift, 2);                           // unit
+            thrift_empty_struct(thrift, 3);                     // NANOS
+            thrift_end(thrift);
+            thrift_end(thrift);
+        } else {
+            thrift_empty_struct(thrift, 14);                    // UUID
+        }
+        thrift_end(thrift);
+    }
+    thrift_end(thrift);
+}
+
+/**
+ * @brief Starts writing a table as a Parquet file.
+ *
+ * @param writer The writer to initialise.
+ * @param output The output stream.
+ * @param table The table whose rows will be written.
+ * @param row_group_budget Buffered bytes at which a row group is written out.
+ */
+void psv_parquet_writer_begin(PsvParquetWriter *writer, FILE *output, PsvTable *table, size_t row_group_budget) {
+    *writer = (PsvParquetWriter){0};
+    writer->output = output;
+    writer->row_group_budget = row_group_budget;
+    psv_arrow_batch_init(&writer->batch, table);
+
+    fwrite("PAR1", 1, 4, output);
+    writer->offset = 4;
+}
+
+void psv_parquet_writer_write_row(PsvParquetWriter *writer, PsvDataRow data_row) {
+    psv_arrow_batch_add_row(&writer->batch, data_row);
+    if (psv_arrow_batch_data_size(&writer->batch) >= writer->row_group_budget || psv_arrow_batch_is_full(&writer->batch)) {
+        write_row_group(writer);
+    }
+}
+
+/**
+ * @brief Writes the last row group and the file metadata, and frees the writer.
+ *
+ * @param writer The writer.
+ */
+void psv_parquet_writer_end(PsvParquetWriter *writer) {
+    if (writer->batch.num_rows > 0) {
+        write_row_group(writer);
+    }
+
+    const PsvArrowBatch *batch = &writer->batch;
+    ThriftWriter thrift;
+    writer->thrift.size = 0;
+    thrift_begin(&thrift, &writer->thrift);
+    thrift_i32(&thrift, 1, 1);                                  // version
+
+    thrift_list(&thrift, 2, THRIFT_STRUCT, batch->num_columns + 1);
+    thrift_element(&thrift);                                    // root of the schema
+    thrift_string(&thrift, 4, "schema");
+    thrift_i32(&thrift, 5, batch->num_columns);
+    thrift_end(&thrift);
+    for (int i = 0; i < batch->num_columns; i++) {
+        write_schema_element(&thrift, batch->table->header_metadata[i].id, batch->columns[i].type);
+    }
+
+    thrift_i64(&thrift, 3, writer->num_rows);
+    thrift_list(&thrift, 4, THRIFT_STRUCT, writer->num_row_groups);
+    if (writer->row_groups.size > 0) {
+        memcpy(reserve(&writer->thrift, writer->row_groups.size), writer->row_groups.data, writer->row_groups.size);
+    }
+
+    thrift_list(&thrift, 5, THRIFT_STRUCT, 1);                  // key_value_metadata
+    thrift_element(&thrift);
+    thrift_string(&thrift, 1, "id");
+    thrift_string(&thrift, 2, batch->table->id);
+    thrift_end(&thrift);
+    thrift_string(&thrift, 6, "psv");                           // created_by
+    thrift_end(&thrift);
+
+    fwrite(writer->thrift.data, 1, writer->thrift.size, writer->output);
+    uint8_t footer[8];
+    put_le32(footer, (uint32_t)writer->thrift.size);
+    memcpy(footer + 4, "PAR1", 4);
+    fwrite(footer, 1, sizeof(footer), writer->output);
+
+    psv_arrow_batch_free(&writer->batch);
+    psv_bytes_free(&writer->row_groups);
+    psv_bytes_free(&writer->thrift);
+    psv_bytes_free(&writer->page);
+    psv_bytes_free(&writer->dictionary);
+    psv_bytes_free(&writer->indices);
+    psv_bytes_free(&writer->levels);
+    *writer = (PsvParquetWriter){0};
+}
@@ -0,0 +1,53 @@
+/**
+ * @file psv_parquet.h
+ * @brief Apache Parquet File Output Of Tables
+ *
+ * Copyright (C) 2024-2024 Brian Khuu <contact@briankhuu.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ */
+
+#ifndef PSV_PARQUET_H
+#define PSV_PARQUET_H
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "psv.h"
+#include "psv_decode.h"
+#include "psv_arrow.h"
+
+// Buffered bytes at which a row group is written out, unless main() passes on --memory-budget
+#define PSV_PARQUET_DEFAULT_ROW_GROUP_BUDGET (256 * 1024 * 1024)
+
+// Most distinct values of a text column chunk that is dictionary encoded
+#define PSV_PARQUET_DICTIONARY_MAX 65536
+
+// Data pages are cut once their values reach this size
+#define PSV_PARQUET_PAGE_SIZE (1024 * 1024)
+
+// Writes a table as a Parquet file, one row group at a time, with the file metadata at the end
+typedef struct {
+    FILE *output;
+    size_t row_group_budget;    ///< Buffered bytes at which a row group is written out
+    PsvArrowBatch batch;        ///< Rows of the row group being built
+    uint64_t offset;            ///< Bytes written to the file so far
+    uint64_t num_rows;          ///< Rows in the row groups written so far
+    size_t num_row_groups;
+    PsvBytes row_groups;        ///< Thrift encoded RowGroup structs, for the file metadata
+    PsvBytes thrift;            ///< Thrift encoded page header or file metadata being written
+    PsvBytes page;              ///< Page being encoded
+    PsvBytes dictionary;        ///< Dictionary page of the column chunk being written
+    PsvBytes indices;           ///< Dictionary index (uint32) of each row of the column chunk being written
+    PsvBytes levels;            ///< Scratch uint32 values for the RLE / bit packing hybrid encoder
+} PsvParquetWriter;
+
+void psv_parquet_writer_begin(PsvParquetWriter *writer, FILE *output, PsvTable *table, size_t row_group_budget);
+void psv_parquet_writer_write_row(PsvParquetWriter *writer, PsvDataRow data_row);
+void psv_parquet_writer_end(PsvParquetWriter *writer);
+
+#endif
@@ -0,0 +1,247 @@
+/**
+ * @file psv_profile.c
+ * @brief Single Pass Column Profiling Of PSV Tables
+ *
+ * Copyright (C) 2024-2024 Brian Khuu <contact@briankhuu.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Every statistic is updated per cell as rows stream past, and each column only holds a fixed
+ * amount of state: exact counts, min/max and running mean/variance, plus a HyperLogLog for the
+ * distinct count, a KLL sketch for the quantiles of numeric columns and a SpaceSaving sketch
+ * for the most frequent values.
+ */
+
+#include <string.h>
+#include <stdlib.h>
+#include <math.h>
+#include <assert.h>
+
+#include "psv_profile.h"
+#include "psv_validate.h"
+
+#ifdef NDEBUG
+    #define assert(expression) ((void)0)
+#endif
+
+static const struct {
+    const char *name;
+    double rank;
+} profile_quantiles[] = {
+    {"p1", 0.01},
+    {"p5", 0.05},
+    {"p25", 0.25},
+    {"p50", 0.50},
+    {"p75", 0.75},
+    {"p95", 0.95},
+    {"p99", 0.99},
+};
+
+/**
+ * @brief Prepares an empty profile for the columns of a table.
+ *
+ * @param profile Pointer to the profile to initialise.
+ * @param table Pointer to the table header. Must outlive the profile.
+ */
+void psv_profile_init(PsvProfile *profile, PsvTable *table) {
+    *profile = (PsvProfile){.table = table};
+    profile->columns = malloc((table->num_headers ? table->num_headers : 1) * sizeof(PsvColumnProfile));
+    assert(profile->columns != NULL);
+
+    for (int i = 0; i < table->num_headers; i++) {
+        PsvColumnProfile *column = &profile->columns[i];
+        *column = (PsvColumnProfile){.type = psv_get_basic_type(table, i)};
+        psv_hll_init(&column->distinct);
+        psv_kll_init(&column->quantiles, PSV_KLL_DEFAULT_K);
+        psv_space_saving_init(&column->top_values, PSV_SPACE_SAVING_DEFAULT_COUNTERS);
+    }
+}
+
+static void add_numeric_value(PsvColumnProfile *column, double value) {
+    column->numeric_count++;
+    const double delta = value - column->mean;
+    column->mean += delta / column->numeric_count;
+    column->m2 += delta * (value - column->mean);
+    psv_kll_add(&column->quantiles, value);
+}
+
+static void add_cell(PsvColumnProfile *column, const char *data) {
+    if (data == NULL) {
+        column->null_count++;
+        return;
+    }
+
+    const size_t length = strlen(data);
+    if (column->count == 0 || length < column->length_min) {
+        column->length_min = length;
+    }
+    if (column->count == 0 || length > column->length_max) {
+        column->length_max = length;
+    }
+    column->length_total += length;
+    column->count++;
+
+    psv_hll_add(&column->distinct, data, length);
+    psv_space_saving_add(&column->top_values, data);
+
+    if (column->type == PSV_DATA_ANNOTATION_INTEGER || column->type == PSV_DATA_ANNOTATION_FLOAT) {
+        // Cells that --validate rejects (including numbers past the int64 or double range) are
+        // counted as invalid and kept out of the statistics and quantiles
+        const char *reason = NULL;
+        if (!psv_validate_get_type_validator(column->type)(data, &reason)) {
+            column->invalid_count++;
+            return;
+        }
+    }
+
+    switch (column->type) {
+        case PSV_DATA_ANNOTATION_INTEGER: {
+            const int64_t value = strtoll(data, NULL, 10);
+            if (column->numeric_count == 0 || value < column->int_min) {
+                column->int_min = value;
+            }
+            if (column->numeric_count == 0 || value > column->int_max) {
+                column->int_max = value;
+            }
+            add_numeric_value(column, (double)value);
+            break;
+        }
+        case PSV_DATA_ANNOTATION_FLOAT: {
+            const double value = strtod(data, NULL);
+            if (column->numeric_count == 0 || value < column->float_min) {
+                column->float_min = value;
+            }
+            if (column->numeric_count == 0 || value > column->float_max) {
+                column->float_max = value;
+            }
+            add_numeric_value(column, value);
+            break;
+        }
+        case PSV_DATA_ANNOTATION_BOOL:
+            column->true_count += psv_data_is_true(data);
+            break;
+        default:
+            if (column->text_min == NULL || strcmp(data, column->text_min) < 0) {
+                free(column->text_min);
+                column->text_min = strdup(data);
+            }
+            if (column->text_max == NULL || strcmp(data, column->text_max) > 0) {
+                free(column->text_max);
+                column->text_max = strdup(data);
+            }
+            break;
+    }
+}
+
+void psv_profile_add_row(PsvProfile *profile, PsvDataRow data_row) {
+    profile->num_rows++;
+    for (int i = 0; i < profile->table->num_headers; i++) {
+        add_cell(&profile->columns[i], data_row[i]);
+    }
+}
+
+static const char *profile_type_name(PsvDataAnnotationType type) {
+    switch (type) {
+        case PSV_DATA_ANNOTATION_INTEGER: return "int";
+        case PSV_DATA_ANNOTATION_FLOAT: return "float";
+        case PSV_DATA_ANNOTATION_BOOL: return "bool";
+        default: return "str";
+    }
+}
+
+static cJSON *create_column_json(PsvHeaderMetadataField *header_metadata, PsvColumnProfile *column) {
+    cJSON *column_json = cJSON_CreateObject();
+    cJSON_AddStringToObject(column_json, "key", header_metadata->id);
+    cJSON_AddStringToObject(column_json, "header", header_metadata->raw_header);
+    cJSON_AddStringToObject(column_json, "type", profile_type_name(column->type));
+    cJSON_AddNumberToObject(column_json, "count", column->count);
+    cJSON_AddNumberToObject(column_json, "null_count", column->null_count);
+
+    const bool numeric = (column->type == PSV_DATA_ANNOTATION_INTEGER || column->type == PSV_DATA_ANNOTATION_FLOAT);
+    if (numeric) {
+        cJSON_AddNumberToObject(column_json, "invalid_count", column->invalid_count);
+        if (column->numeric_count > 0) {
+            const bool integer = (column->type == PSV_DATA_ANNOTATION_INTEGER);
+            cJSON_AddNumberToObject(column_json, "min", integer ? (double)column->int_min : column->float_min);
+            cJSON_AddNumberToObject(column_json, "max", integer ? (double)column->int_max : column->float_max);
+            cJSON_AddNumberToObject(column_json, "mean", column->mean);
+            if (column->numeric_count > 1) {
+                const double variance = column->m2 / (column->numeric_count - 1);
+                cJSON_AddNumberToObject(column_json, "variance", variance);
+                cJSON_AddNumberToObject(column_json, "stddev", sqrt(variance));
+            }
+
+            cJSON *quantiles_json = cJSON_AddObjectToObject(column_json, "quantiles");
+            for (size_t i = 0; i < sizeof(profile_quantiles) / sizeof(profile_quantiles[0]); i++) {
+                cJSON_AddNumberToObject(quantiles_json, profile_quantiles[i].name, psv_kll_quantile(&column->quantiles, profile_quantiles[i].rank));
+            }
+        }
+    } else if (column->type == PSV_DATA_ANNOTATION_BOOL) {
+        cJSON_AddNumberToObject(column_json, "true_count", column->true_count);
+        cJSON_AddNumberToObject(column_json, "false_count", column->count - column->true_count);
+    } else if (column->count > 0) {
+        cJSON_AddStringToObject(column_json, "min", column->text_min);
+        cJSON_AddStringToObject(column_json, "max", column->text_max);
+    }
+
+    if (column->count > 0) {
+        cJSON *length_json = cJSON_AddObjectToObject(column_json, "length");
+        cJSON_AddNumberToObject(length_json, "min", column->length_min);
+        cJSON_AddNumberToObject(length_json, "max", column->length_max);
+        cJSON_AddNumberToObject(length_json, "mean", (double)column->length_total / column->count);
+    }
+
+    cJSON_AddNumberToObject(column_json, "distinct_estimate", psv_hll_estimate(&column->distinct));
+
+    const PsvSpaceSavingCounter *top = NULL;
+    const size_t num_top = psv_space_saving_top(&column->top_values, PSV_PROFILE_TOP_K, &top);
+    cJSON *top_json = cJSON_AddArrayToObject(column_json, "top_values");
+    for (size_t i = 0; i < num_top; i++) {
+        cJSON *entry_json = cJSON_CreateObject();
+        cJSON_AddStringToObject(entry_json, "value", top[i].value);
+        cJSON_AddNumberToObject(entry_json, "count", top[i].count);
+        if (top[i].error > 0) {
+            cJSON_AddNumberToObject(entry_json, "error", top[i].error);
+        }
+        cJSON_AddItemToArray(top_json, entry_json);
+    }
+
+    return column_json;
+}
+
+/**
+ * @brief Creates the JSON report of a profile.
+ *
+ * The report has the table id, the number of rows and one object per column. Distinct
+ * counts, quantiles and top value counts are estimates; everything else is exact.
+ *
+ * @param profile Pointer to the profile.
+ * @return A newly allocated cJSON object (free with cJSON_Delete()).
+ */
+cJSON *psv_profile_create_json(PsvProfile *profile) {
+    cJSON *profile_json = cJSON_CreateObject();
+    cJSON_AddStringToObject(profile_json, "id", profile->table->id);
+    cJSON_AddNumberToObject(profile_json, "num_rows", profile->num_rows);
+
+    cJSON *columns_json = cJSON_AddArrayToObject(profile_json, "columns");
+    for (int i = 0; i < profile->table->num_headers; i++) {
+        cJSON_AddItemToArray(columns_json, create_column_json(&profile->table->header_metadata[i], &profile->columns[i]));
+    }
+
+    return profile_json;
+}
+
+void psv_profile_free(PsvProfile *profile) {
+    for (int i = 0; i < profile->table->num_headers; i++) {
+        PsvColumnProfile *column = &profile->columns[i];
+        free(column->text_min);
+        free(column->text_max);
+        psv_kll_free(&column->quantiles);
+        psv_space_saving_free(&column->top_values);
+    }
+    free(profile->columns);
+    *profile = (PsvProfile){0};
+}
@@ -0,0 +1,66 @@
+/**
+ * @file psv_profile.h
+ * @brief Single Pass Column Profiling Of PSV Tables
+ *
+ * Copyright (C) 2024-2024 Brian Khuu <contact@briankhuu.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ */
+
+#ifndef PSV_PROFILE_H
+#define PSV_PROFILE_H
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "psv.h"
+#include "psv_sketch.h"
+#include "cJSON.h"
+
+#define PSV_PROFILE_TOP_K 10
+
+typedef struct {
+    PsvDataAnnotationType type;     ///< Basic type of the column, which decides which statistics are collected
+
+    uint64_t count;                 ///< Non-empty cells
+    uint64_t null_count;            ///< Empty cells
+    uint64_t invalid_count;         ///< Cells of a numeric column that are not numbers
+    uint64_t true_count;            ///< True cells of a bool column
+
+    // Numeric columns (Welford's running mean and sum of squared differences)
+    uint64_t numeric_count;
+    int64_t int_min;
+    int64_t int_max;
+    double float_min;
+    double float_max;
+    double mean;
+    double m2;
+
+    // Text columns
+    char *text_min;
+    char *text_max;
+
+    // Cell lengths in bytes
+    size_t length_min;
+    size_t length_max;
+    uint64_t length_total;
+
+    PsvHyperLogLog distinct;
+    PsvKll quantiles;
+    PsvSpaceSaving top_values;
+} PsvColumnProfile;
+
+typedef struct {
+    PsvTable *table;
+    uint64_t num_rows;
+    PsvColumnProfile *columns;
+} PsvProfile;
+
+void psv_profile_init(PsvProfile *profile, PsvTable *table);
+void psv_profile_add_row(PsvProfile *profile, PsvDataRow data_row);
+cJSON *psv_profile_create_json(PsvProfile *profile);
+void psv_profile_free(PsvProfile *profile);
+
+#endif
@@ -0,0 +1,238 @@
+/**
+ * @file psv_sample.c
+ * @brief Random Sampling Of PSV Table Rows
+ *
+ * Copyright (C) 2024-2024 Brian Khuu <contact@briankhuu.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Both samplers work out up front how many rows to skip before the next row that makes it
+ * into the sample, so the caller can skip those rows without tokenizing them.
+ *
+ * - Reservoir sampling uses Li's Algorithm L, which draws the gap between reservoir
+ *   replacements directly. A table of n rows needs only O(k log(n/k)) random numbers and
+ *   only the rows that enter the reservoir are parsed. Memory is bounded by k rows.
+ * - Bernoulli sampling keeps each row with probability p. The gaps between kept rows are
+ *   geometrically distributed, so they are drawn directly as well. No rows are stored.
+ */
+
+#include <string.h>
+#include <stdlib.h>
+#include <math.h>
+#include <assert.h>
+
+#include "psv_sample.h"
+
+#ifdef NDEBUG
+    #define assert(expression) ((void)0)
+#endif
+
+static uint64_t splitmix64(uint64_t *state) {
+    uint64_t z = (*state += 0x9e3779b97f4a7c15ULL);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+}
+
+static inline uint64_t rotl(const uint64_t x, int k) {
+    return (x << k) | (x >> (64 - k));
+}
+
+/**
+ * @brief Seeds a pseudo random number generator. The same seed always gives the same sequence.
+ *
+ * @param random Pointer to the generator.
+ * @param seed Any 64-bit seed, expanded into the generator state with splitmix64.
+ */
+void psv_random_seed(PsvRandom *random, uint64_t seed) {
+    for (int i = 0; i < 4; i++) {
+        random->state[i] = splitmix64(&seed);
+    }
+}
+
+uint64_t psv_random_next(PsvRandom *random) {
+    uint64_t *s = random->state;
+    const uint64_t result = rotl(s[1] * 5, 7) * 9;
+    const uint64_t t = s[1] << 17;
+    s[2] ^= s[0];
+    s[3] ^= s[1];
+    s[1] ^= s[2];
+    s[0] ^= s[3];
+    s[2] ^= t;
+    s[3] = rotl(s[3], 45);
+    return result;
+}
+
+/**
+ * @brief Draws a uniformly distributed double in the open interval (0, 1).
+ *
+ * Zero is excluded so that the result can safely be passed to log().
+ */
+double psv_random_unit(PsvRandom *random) {
+    return ((psv_random_next(random) >> 11) + 0.5) * (1.0 / 9007199254740992.0);
+}
+
+// Uniform integer in [0, bound)
+static uint64_t random_below(PsvRandom *random, uint64_t bound) {
+    return (uint64_t)(psv_random_unit(random) * bound) % bound;
+}
+
+// Draw floor(log(u) / log_complement), clamped to avoid overflow when the probability of a hit is tiny
+static uint64_t geometric_skip(PsvRandom *random, double log_complement) {
+    const double skip = floor(log(psv_random_unit(random)) / log_complement);
+    return (skip < 9.0e18) ? (uint64_t)skip : UINT64_MAX;
+}
+
+typedef struct {
+    PsvDataRow row;
+    uint64_t sequence;  ///< Position of the row in the table, to output the sample in table order
+} ReservoirEntry;
+
+struct PsvReservoir {
+    PsvRandom random;
+    int num_columns;
+    size_t size;
+    double weight;              ///< Algorithm L's running W
+
+    ReservoirEntry *entries;
+    size_t num_entries;
+
+    uint64_t next_sequence;     ///< Sequence number of the next row offered to the reservoir
+
+    // Output iteration
+    bool sorted;
+    size_t next_entry;
+};
+
+PsvReservoir *psv_reservoir_create(size_t size, int num_columns, uint64_t seed) {
+    PsvReservoir *reservoir = calloc(1, sizeof(PsvReservoir));
+    assert(reservoir != NULL);
+    psv_random_seed(&reservoir->random, seed);
+    reservoir->num_columns = num_columns;
+    reservoir->size = size;
+    reservoir->entries = malloc((size ? size : 1) * sizeof(ReservoirEntry));
+    assert(reservoir->entries != NULL);
+    reservoir->weight = exp(log(psv_random_unit(&reservoir->random)) / size);
+    return reservoir;
+}
+
+/**
+ * @brief Returns how many rows can be skipped before the next row to pass to psv_reservoir_add_row().
+ *
+ * The caller must skip exactly this many rows (or reach the end of the table) and then add the
+ * row after them. While the reservoir is still filling up no rows are skipped.
+ *
+ * @param reservoir Pointer to the reservoir.
+ * @return The number of rows to skip.
+ */
+uint64_t psv_reservoir_next_skip(PsvReservoir *reservoir) {
+    if (reservoir->num_entries < reservoir->size) {
+        return 0;
+    }
+
+    const uint64_t skip = geometric_skip(&reservoir->random, log(1.0 - reservoir->weight));
+    reservoir->next_sequence += skip;
+    return skip;
+}
+
+/**
+ * @brief Adds the row following the skipped rows to the reservoir.
+ *
+ * @param reservoir Pointer to the reservoir.
+ * @param data_row The data row. The reservoir takes ownership of it.
+ */
+void psv_reservoir_add_row(PsvReservoir *reservoir, PsvDataRow data_row) {
+    const uint64_t sequence = reservoir->next_sequence++;
+
+    if (reservoir->num_entries < reservoir->size) {
+        reservoir->entries[reservoir->num_entries++] = (ReservoirEntry){.row = data_row, .sequence = sequence};
+        return;
+    }
+
+    // Replace a random entry, and shrink W for the next gap
+    ReservoirEntry *victim = &reservoir->entries[random_below(&reservoir->random, reservoir->size)];
+    for (int i = 0; i < reservoir->num_columns; i++) {
+        free(victim->row[i]);
+    }
+    free(victim->row);
+    *victim = (ReservoirEntry){.row = data_row, .sequence = sequence};
+    reservoir->weight *= exp(log(psv_random_unit(&reservoir->random)) / reservoir->size);
+}
+
+static int compare_entries(const void *a, const void *b) {
+    const uint64_t sequence_a = ((const ReservoirEntry *)a)->sequence;
+    const uint64_t sequence_b = ((const ReservoirEntry *)b)->sequence;
+    return (sequence_a > sequence_b) - (sequence_a < sequence_b);
+}
+
+/**
+ * @brief Returns the next sampled row, in table order.
+ *
+ * Must only be called once all rows have been offered.
+ *
+ * @param reservoir Pointer to the reservoir.
+ * @return The next sampled row (the caller takes ownership), or NULL when all rows have been returned.
+ */
+PsvDataRow psv_reservoir_next_row(PsvReservoir *reservoir) {
+    if (!reservoir->sorted) {
+        qsort(reservoir->entries, reservoir->num_entries, sizeof(ReservoirEntry), compare_entries);
+        reservoir->sorted = true;
+    }
+
+    if (reservoir->next_entry >= reservoir->num_entries) {
+        return NULL;
+    }
+
+    PsvDataRow data_row = reservoir->entries[reservoir->next_entry].row;
+    reservoir->entries[reservoir->next_entry++].row = NULL;
+    return data_row;
+}
+
+void psv_reservoir_free(PsvReservoir **reservoir_ptr) {
+    PsvReservoir *reservoir = *reservoir_ptr;
+    if (reservoir == NULL) {
+        return;
+    }
+
+    for (size_t i = 0; i < reservoir->num_entries; i++) {
+        if (reservoir->entries[i].row == NULL) {
+            continue;
+        }
+        for (int j = 0; j < reservoir->num_columns; j++) {
+            free(reservoir->entries[i].row[j]);
+        }
+        free(reservoir->entries[i].row);
+    }
+    free(reservoir->entries);
+    free(reservoir);
+    *reservoir_ptr = NULL;
+}
+
+/**
+ * @brief Initialises a Bernoulli sampler.
+ *
+ * @param sampler Pointer to the sampler.
+ * @param rate Probability of keeping each row, in (0, 1].
+ * @param seed Random seed.
+ */
+void psv_bernoulli_init(PsvBernoulliSampler *sampler, double rate, uint64_t seed) {
+    psv_random_seed(&sampler->random, seed);
+    sampler->rate = rate;
+    sampler->log_complement = log1p(-rate);
+}
+
+/**
+ * @brief Returns how many rows to skip before the next row to keep.
+ *
+ * @param sampler Pointer to the sampler.
+ * @return The number of rows to skip.
+ */
+uint64_t psv_bernoulli_next_skip(PsvBernoulliSampler *sampler) {
+    if (sampler->rate >= 1.0) {
+        return 0;
+    }
+    return geometric_skip(&sampler->random, sampler->log_complement);
+}
@@ -0,0 +1,48 @@
+/**
+ * @file psv_sample.h
+ * @brief Random Sampling Of PSV Table Rows
+ *
+ * Copyright (C) 2024-2024 Brian Khuu <contact@briankhuu.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ */
+
+#ifndef PSV_SAMPLE_H
+#define PSV_SAMPLE_H
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "psv.h"
+
+// xoshiro256** pseudo random number generator (not for cryptographic use)
+typedef struct {
+    uint64_t state[4];
+} PsvRandom;
+
+void psv_random_seed(PsvRandom *random, uint64_t seed);
+uint64_t psv_random_next(PsvRandom *random);
+double psv_random_unit(PsvRandom *random);
+
+// Reservoir sampling of a fixed number of rows
+typedef struct PsvReservoir PsvReservoir;
+
+PsvReservoir *psv_reservoir_create(size_t size, int num_columns, uint64_t seed);
+uint64_t psv_reservoir_next_skip(PsvReservoir *reservoir);
+void psv_reservoir_add_row(PsvReservoir *reservoir, PsvDataRow data_row);
+PsvDataRow psv_reservoir_next_row(PsvReservoir *reservoir);
+void psv_reservoir_free(PsvReservoir **reservoir_ptr);
+
+// Bernoulli sampling of each row with a fixed probability
+typedef struct {
+    PsvRandom random;
+    double rate;
+    double log_complement;  ///< log(1 - rate), cached for drawing geometric skips
+} PsvBernoulliSampler;
+
+void psv_bernoulli_init(PsvBernoulliSampler *sampler, double rate, uint64_t seed);
+uint64_t psv_bernoulli_next_skip(PsvBernoulliSampler *sampler);
+
+#endif
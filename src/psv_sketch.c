@@ -0,0 +1,281 @@
+/**
+ * @file psv_sketch.c
+ * @brief Fixed Memory Streaming Sketches (Distinct Count, Quantiles, Heavy Hitters)
+ *
+ * Copyright (C) 2024-2024 Brian Khuu <contact@briankhuu.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * - HyperLogLog (Flajolet et al.) estimates the number of distinct values from the longest
+ *   run of leading zero bits seen in each of 2^14 hash buckets, with the usual linear
+ *   counting correction for small cardinalities.
+ * - KLL (Karnin, Lang and Liberty) keeps a hierarchy of compactors. When a level fills up
+ *   it is sorted and every other item is promoted to the next level with twice the weight,
+ *   so memory stays around 3k items however many values are added.
+ * - SpaceSaving (Metwally et al.) keeps a fixed number of counters. A value without a
+ *   counter takes over the smallest counter, inheriting its count as the error bound.
+ */
+
+#include <string.h>
+#include <stdlib.h>
+#include <math.h>
+#include <assert.h>
+
+#include "psv_sketch.h"
+#include "psv_hash.h"
+
+#ifdef NDEBUG
+    #define assert(expression) ((void)0)
+#endif
+
+/*******************************************************************************
+ * HyperLogLog
+ ******************************************************************************/
+
+void psv_hll_init(PsvHyperLogLog *hll) {
+    memset(hll->registers, 0, sizeof(hll->registers));
+}
+
+void psv_hll_add(PsvHyperLogLog *hll, const void *data, size_t size) {
+    const uint64_t hash = psv_hash64(data, size, 0);
+    const size_t index = hash >> (64 - PSV_HLL_PRECISION);
+
+    // Position of the first set bit in the remaining bits (a sentinel bit bounds the run)
+    uint64_t remaining = (hash << PSV_HLL_PRECISION) | (1ULL << (PSV_HLL_PRECISION - 1));
+    uint8_t rank = 1;
+    while (!(remaining & (1ULL << 63))) {
+        remaining <<= 1;
+        rank++;
+    }
+
+    if (rank > hll->registers[index]) {
+        hll->registers[index] = rank;
+    }
+}
+
+uint64_t psv_hll_estimate(const PsvHyperLogLog *hll) {
+    const double m = PSV_HLL_REGISTERS;
+    double sum = 0;
+    int zero_registers = 0;
+    for (int i = 0; i < PSV_HLL_REGISTERS; i++) {
+        sum += ldexp(1.0, -hll->registers[i]);
+        zero_registers += (hll->registers[i] == 0);
+    }
+
+    const double alpha = 0.7213 / (1.0 + 1.079 / m);
+    double estimate = alpha * m * m / sum;
+    if (estimate <= 2.5 * m && zero_registers > 0) {
+        // Linear counting is more accurate for small cardinalities
+        estimate = m * log(m / zero_registers);
+    }
+    return (uint64_t)(estimate + 0.5);
+}
+
+/*******************************************************************************
+ * KLL Quantiles
+ ******************************************************************************/
+
+// Capacity of a level, shrinking geometrically by 2/3 going down from the top level
+static size_t kll_level_capacity(const PsvKll *kll, int level) {
+    const double capacity = kll->k * pow(2.0 / 3.0, kll->num_levels - 1 - level);
+    return capacity > 2 ? (size_t)capacity : 2;
+}
+
+static void kll_level_append(PsvKllLevel *level, double value) {
+    if (level->size == level->capacity) {
+        level->capacity = level->capacity ? level->capacity * 2 : 16;
+        level->items = realloc(level->items, level->capacity * sizeof(double));
+        assert(level->items != NULL);
+    }
+    level->items[level->size++] = value;
+}
+
+static void kll_add_level(PsvKll *kll) {
+    kll->levels = realloc(kll->levels, (kll->num_levels + 1) * sizeof(PsvKllLevel));
+    assert(kll->levels != NULL);
+    kll->levels[kll->num_levels++] = (PsvKllLevel){0};
+}
+
+static int compare_doubles(const void *a, const void *b) {
+    const double value_a = *(const double *)a;
+    const double value_b = *(const double *)b;
+    return (value_a > value_b) - (value_a < value_b);
+}
+
+static void kll_compress(PsvKll *kll) {
+    for (int h = 0; h < kll->num_levels; h++) {
+        PsvKllLevel *level = &kll->levels[h];
+        if (level->size < kll_level_capacity(kll, h)) {
+            continue;
+        }
+
+        if (h + 1 == kll->num_levels) {
+            kll_add_level(kll);
+            level = &kll->levels[h];
+        }
+
+        // Promote every other item of the sorted level, starting at a random offset.
+        // An odd item out stays behind at this level.
+        qsort(level->items, level->size, sizeof(double), compare_doubles);
+        const size_t paired = level->size & ~(size_t)1;
+        const size_t offset = psv_random_next(&kll->random) & 1;
+        for (size_t i = offset; i < paired; i += 2) {
+            kll_level_append(&kll->levels[h + 1], level->items[i]);
+        }
+        if (paired < level->size) {
+            level->items[0] = level->items[paired];
+        }
+        level->size -= paired;
+        return;
+    }
+}
+
+void psv_kll_init(PsvKll *kll, int k) {
+    *kll = (PsvKll){.k = k};
+    psv_random_seed(&kll->random, 0);
+    kll_add_level(kll);
+}
+
+void psv_kll_add(PsvKll *kll, double value) {
+    kll_level_append(&kll->levels[0], value);
+    kll->count++;
+
+    size_t total_size = 0;
+    size_t total_capacity = 0;
+    for (int h = 0; h < kll->num_levels; h++) {
+        total_size += kll->levels[h].size;
+        total_capacity += kll_level_capacity(kll, h);
+    }
+    if (total_size >= total_capacity) {
+        kll_compress(kll);
+    }
+}
+
+typedef struct {
+    double value;
+    uint64_t weight;
+} KllWeightedItem;
+
+static int compare_weighted_items(const void *a, const void *b) {
+    return compare_doubles(&((const KllWeightedItem *)a)->value, &((const KllWeightedItem *)b)->value);
+}
+
+/**
+ * @brief Estimates the value at a given rank.
+ *
+ * @param kll Pointer to the sketch.
+ * @param rank Normalised rank between 0 and 1 (e.g. 0.5 for the median).
+ * @return The estimated value, or NAN if the sketch is empty.
+ */
+double psv_kll_quantile(const PsvKll *kll, double rank) {
+    size_t num_items = 0;
+    for (int h = 0; h < kll->num_levels; h++) {
+        num_items += kll->levels[h].size;
+    }
+    if (num_items == 0) {
+        return NAN;
+    }
+
+    KllWeightedItem *items = malloc(num_items * sizeof(KllWeightedItem));
+    assert(items != NULL);
+    size_t n = 0;
+    uint64_t total_weight = 0;
+    for (int h = 0; h < kll->num_levels; h++) {
+        for (size_t i = 0; i < kll->levels[h].size; i++) {
+            items[n++] = (KllWeightedItem){.value = kll->levels[h].items[i], .weight = 1ULL << h};
+            total_weight += 1ULL << h;
+        }
+    }
+    qsort(items, num_items, sizeof(KllWeightedItem), compare_weighted_items);
+
+    const double target = rank * total_weight;
+    double value = items[num_items - 1].value;
+    uint64_t cumulative_weight = 0;
+    for (size_t i = 0; i < num_items; i++) {
+        cumulative_weight += items[i].weight;
+        if (cumulative_weight >= target) {
+            value = items[i].value;
+            break;
+        }
+    }
+
+    free(items);
+    return value;
+}
+
+void psv_kll_free(PsvKll *kll) {
+    for (int h = 0; h < kll->num_levels; h++) {
+        free(kll->levels[h].items);
+    }
+    free(kll->levels);
+    *kll = (PsvKll){0};
+}
+
+/*******************************************************************************
+ * SpaceSaving Heavy Hitters
+ ******************************************************************************/
+
+void psv_space_saving_init(PsvSpaceSaving *space_saving, size_t max_counters) {
+    *space_saving = (PsvSpaceSaving){.max_counters = max_counters};
+    space_saving->counters = calloc(max_counters, sizeof(PsvSpaceSavingCounter));
+    assert(space_saving->counters != NULL);
+}
+
+void psv_space_saving_add(PsvSpaceSaving *space_saving, const char *value) {
+    const size_t value_size = strlen(value);
+    const uint64_t hash = psv_hash64(value, value_size, 0);
+
+    for (size_t i = 0; i < space_saving->num_counters; i++) {
+        PsvSpaceSavingCounter *counter = &space_saving->counters[i];
+        if (counter->hash == hash && strcmp(counter->value, value) == 0) {
+            counter->count++;
+            return;
+        }
+    }
+
+    if (space_saving->num_counters < space_saving->max_counters) {
+        space_saving->counters[space_saving->num_counters++] = (PsvSpaceSavingCounter){.hash = hash, .value = strdup(value), .count = 1};
+        return;
+    }
+
+    // Evict the smallest counter
+    PsvSpaceSavingCounter *smallest = &space_saving->counters[0];
+    for (size_t i = 1; i < space_saving->num_counters; i++) {
+        if (space_saving->counters[i].count < smallest->count) {
+            smallest = &space_saving->counters[i];
+        }
+    }
+    free(smallest->value);
+    *smallest = (PsvSpaceSavingCounter){.hash = hash, .value = strdup(value), .count = smallest->count + 1, .error = smallest->count};
+}
+
+static int compare_counters(const void *a, const void *b) {
+    const uint64_t count_a = ((const PsvSpaceSavingCounter *)a)->count;
+    const uint64_t count_b = ((const PsvSpaceSavingCounter *)b)->count;
+    return (count_a < count_b) - (count_a > count_b);
+}
+
+/**
+ * @brief Returns the most frequent values seen so far, most frequent first.
+ *
+ * @param space_saving Pointer to the sketch. Its counters are reordered.
+ * @param k Maximum number of values to return.
+ * @param top Set to point at the first of the returned counters.
+ * @return The number of counters returned.
+ */
+size_t psv_space_saving_top(PsvSpaceSaving *space_saving, size_t k, const PsvSpaceSavingCounter **top) {
+    qsort(space_saving->counters, space_saving->num_counters, sizeof(PsvSpaceSavingCounter), compare_counters);
+    *top = space_saving->counters;
+    return (k < space_saving->num_counters) ? k : space_saving->num_counters;
+}
+
+void psv_space_saving_free(PsvSpaceSaving *space_saving) {
+    for (size_t i = 0; i < space_saving->num_counters; i++) {
+        free(space_saving->counters[i].value);
+    }
+    free(space_saving->counters);
+    *space_saving = (PsvSpaceSaving){0};
+}
@@ -0,0 +1,76 @@
+/**
+ * @file psv_sketch.h
+ * @brief Fixed Memory Streaming Sketches (Distinct Count, Quantiles, Heavy Hitters)
+ *
+ * Copyright (C) 2024-2024 Brian Khuu <contact@briankhuu.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ */
+
+#ifndef PSV_SKETCH_H
+#define PSV_SKETCH_H
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "psv_sample.h"
+
+// HyperLogLog approximate distinct counter (2^14 registers, about 0.8% standard error)
+#define PSV_HLL_PRECISION 14
+#define PSV_HLL_REGISTERS (1 << PSV_HLL_PRECISION)
+
+typedef struct {
+    uint8_t registers[PSV_HLL_REGISTERS];
+} PsvHyperLogLog;
+
+void psv_hll_init(PsvHyperLogLog *hll);
+void psv_hll_add(PsvHyperLogLog *hll, const void *data, size_t size);
+uint64_t psv_hll_estimate(const PsvHyperLogLog *hll);
+
+// KLL approximate quantiles sketch
+#define PSV_KLL_DEFAULT_K 200
+
+typedef struct {
+    double *items;
+    size_t size;
+    size_t capacity;
+} PsvKllLevel;
+
+typedef struct {
+    int k;
+    uint64_t count;
+    PsvKllLevel *levels;
+    int num_levels;
+    PsvRandom random;
+} PsvKll;
+
+void psv_kll_init(PsvKll *kll, int k);
+void psv_kll_add(PsvKll *kll, double value);
+double psv_kll_quantile(const PsvKll *kll, double rank);
+void psv_kll_free(PsvKll *kll);
+
+// SpaceSaving heavy hitters: approximate counts of the most frequent values
+#define PSV_SPACE_SAVING_DEFAULT_COUNTERS 64
+
+typedef struct {
+    uint64_t hash;
+    char *value;
+    uint64_t count;     ///< Upper bound of the value's frequency
+    uint64_t error;     ///< How much count may overestimate the frequency by
+} PsvSpaceSavingCounter;
+
+typedef struct {
+    PsvSpaceSavingCounter *counters;
+    size_t num_counters;
+    size_t max_counters;
+} PsvSpaceSaving;
+
+void psv_space_saving_init(PsvSpaceSaving *space_saving, size_t max_counters);
+void psv_space_saving_add(PsvSpaceSaving *space_saving, const char *value);
+size_t psv_space_saving_top(PsvSpaceSaving *space_saving, size_t k, const PsvSpaceSavingCounter **top);
+void psv_space_saving_free(PsvSpaceSaving *space_saving);
+
+#endif
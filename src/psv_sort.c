@@ -0,0 +1,614 @@
+/**
+ * @file psv_sort.c
+ * @brief Sorting Of PSV Table Rows (In Memory, External Merge And Top K)
+ *
+ * Copyright (C) 2024-2024 Brian Khuu <contact@briankhuu.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Rows are compared on one or more sort keys, using the column's data annotation to decide
+ * between integer, float, bool, date/time and text comparison. Parsed key values are cached alongside
+ * each row so that numbers are only parsed once rather than on every comparison.
+ *
+ * - If all rows fit in the memory budget they are sorted in memory.
+ * - Otherwise each time the budget is reached the buffered rows are sorted and written out
+ *   as a sorted run to a temporary file, and the runs are k-way merged with a binary heap.
+ *   At most SORT_MERGE_RUNS_MAX runs are merged at once: whenever that many runs of the same
+ *   merge level exist they are merged into one run of the next level, so the number of open
+ *   temporary files only grows with the logarithm of the table size.
+ * - If only the first K rows are wanted, a bounded max heap of K rows is kept instead and
+ *   rows that cannot make it into the result are released immediately.
+ *
+ * Sorting is stable, and empty cells always sort after the values. [datetime] cells are compared
+ * as instants (so timestamps with different UTC offsets order correctly). Cells of [int], [float]
+ * and [datetime] keys that are not valid for their type (including NaN) sort after even the empty
+ * cells, in text order, so every key type has a consistent total order.
+ */
+
+#include <string.h>
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <math.h>
+#include <assert.h>
+
+#include "psv_sort.h"
+#include "psv_spill.h"
+#include "psv_datetime.h"
+#include "log.h"
+
+#ifdef NDEBUG
+    #define assert(expression) ((void)0)
+#endif
+
+#define SORT_MERGE_RUNS_MAX 64  ///< Most sorted runs merged (and so open) at once
+
+typedef struct {
+    union {
+        int64_t integer;
+        double real;
+    };
+    bool is_invalid;        ///< The cell is not a valid value of the key's type
+} SortValue;
+
+typedef struct {
+    PsvDataRow row;
+    uint64_t sequence;      ///< Input order (or run index while merging), used to keep sorting stable
+    SortValue values[];     ///< Parsed value of each sort key (unused for text keys)
+} SortRecord;
+
+struct PsvSorter {
+    const PsvSortSpec *spec;
+    int num_columns;
+    size_t memory_budget;
+    size_t memory_used;
+    size_t limit;
+    uint64_t next_sequence;
+
+    // Buffered records (a max heap when limit is set)
+    SortRecord **records;
+    size_t num_records;
+    size_t records_capacity;
+
+    // Sorted runs spilled to temporary files, oldest first
+    FILE **runs;
+    unsigned *run_levels;   ///< Number of merge passes that produced each run
+    size_t num_runs;
+
+    // Output iteration
+    bool input_done;
+    size_t next_record;
+    SortRecord **merge_heap;
+    size_t merge_heap_size;
+};
+
+/**
+ * @brief Parses a sort specification against a table header.
+ *
+ * @param spec Pointer to the sort specification to fill in.
+ * @param table Pointer to the table whose header the column keys are resolved against.
+ * @param sort_by Comma separated list of column keys, each optionally followed by `:asc` or `:desc`
+ *                (e.g. `city,age:desc`).
+ * @return true on success. On failure false is returned and spec->error describes the problem.
+ *         The spec must be released with psv_sort_spec_free() in both cases.
+ */
+bool psv_sort_spec_parse(PsvSortSpec *spec, PsvTable *table, const char *sort_by) {
+    *spec = (PsvSortSpec){0};
+
+    const char *token_start = sort_by;
+    while (true) {
+        const char *token_end = strchr(token_start, ',');
+        if (token_end == NULL) {
+            token_end = token_start + strlen(token_start);
+        }
+
+        // Copy and trim `key[:direction]`
+        while (token_start < token_end && isspace((unsigned char)*token_start)) {
+            token_start++;
+        }
+        char key[PSV_HEADER_ID_MAX];
+        snprintf(key, sizeof(key), "%.*s", (int)(token_end - token_start), token_start);
+        for (char *end = key + strlen(key); end > key && isspace((unsigned char)end[-1]); end--) {
+            end[-1] = '\0';
+        }
+
+        PsvSortKey sort_key = {0};
+        char *direction = strchr(key, ':');
+        if (direction != NULL) {
+            *direction++ = '\0';
+            if (strcmp(direction, "desc") == 0) {
+                sort_key.descending = true;
+            } else if (strcmp(direction, "asc") != 0) {
+                snprintf(spec->error, PSV_SORT_ERROR_MAX, "unknown sort direction '%s' (expected asc or desc)", direction);
+                return false;
+            }
+        }
+
+        sort_key.column = psv_find_header_column(table, key);
+        if (sort_key.column < 0) {
+            snprintf(spec->error, PSV_SORT_ERROR_MAX, "sort column '%s' not found", key);
+            return false;
+        }
+        sort_key.type = psv_get_basic_type(table, sort_key.column);
+        if (sort_key.type == PSV_DATA_ANNOTATION_TEXT && psv_has_data_annotation(table, sort_key.column, PSV_DATA_ANNOTATION_DATETIME)) {
+            sort_key.type = PSV_DATA_ANNOTATION_DATETIME;
+        }
+
+        spec->keys = realloc(spec->keys, (spec->num_keys + 1) * sizeof(PsvSortKey));
+        assert(spec->keys != NULL);
+        spec->keys[spec->num_keys++] = sort_key;
+
+        if (*token_end == '\0') {
+            break;
+        }
+        token_start = token_end + 1;
+    }
+
+    return true;
+}
+
+void psv_sort_spec_free(PsvSortSpec *spec) {
+    free(spec->keys);
+    *spec = (PsvSortSpec){0};
+}
+
+static SortRecord *create_record(PsvSorter *sorter, PsvDataRow data_row, uint64_t sequence) {
+    const PsvSortSpec *spec = sorter->spec;
+    SortRecord *record = malloc(sizeof(SortRecord) + spec->num_keys * sizeof(SortValue));
+    assert(record != NULL);
+    record->row = data_row;
+    record->sequence = sequence;
+
+    for (int i = 0; i < spec->num_keys; i++) {
+        const char *data = data_row[spec->keys[i].column];
+        SortValue *value = &record->values[i];
+        *value = (SortValue){0};
+        if (data == NULL) {
+            continue;
+        }
+
+        char *end = NULL;
+        switch (spec->keys[i].type) {
+            case PSV_DATA_ANNOTATION_INTEGER:
+                errno = 0;
+                value->integer = strtoll(data, &end, 10);
+                value->is_invalid = (end == data || *end != '\0' || errno == ERANGE);
+                break;
+            case PSV_DATA_ANNOTATION_FLOAT:
+                value->real = strtod(data, &end);
+                value->is_invalid = (end == data || *end != '\0' || isnan(value->real));
+                break;
+            case PSV_DATA_ANNOTATION_BOOL:
+                value->integer = psv_data_is_true(data);
+                break;
+            case PSV_DATA_ANNOTATION_DATETIME:
+                value->is_invalid = !psv_datetime_parse(data, &value->integer);
+                break;
+            default:
+                break;
+        }
+    }
+
+    return record;
+}
+
+static void free_row(PsvSorter *sorter, PsvDataRow data_row) {
+    for (int i = 0; i < sorter->num_columns; i++) {
+        free(data_row[i]);
+    }
+    free(data_row);
+}
+
+static void free_record(PsvSorter *sorter, SortRecord *record) {
+    if (record->row) {
+        free_row(sorter, record->row);
+    }
+    free(record);
+}
+
+static int compare_records(const PsvSorter *sorter, const SortRecord *a, const SortRecord *b) {
+    const PsvSortSpec *spec = sorter->spec;
+    for (int i = 0; i < spec->num_keys; i++) {
+        const PsvSortKey *key = &spec->keys[i];
+        const char *data_a = a->row[key->column];
+        const char *data_b = b->row[key->column];
+
+        // Regardless of direction, values come first, then empty cells, then cells that are not valid for the key's type
+        const int rank_a = (data_a == NULL) ? 1 : a->values[i].is_invalid ? 2 : 0;
+        const int rank_b = (data_b == NULL) ? 1 : b->values[i].is_invalid ? 2 : 0;
+        if (rank_a != rank_b) {
+            return (rank_a > rank_b) ? 1 : -1;
+        } else if (rank_a == 1) {
+            continue;
+        }
+
+        int result = 0;
+        switch (rank_a == 2 ? PSV_DATA_ANNOTATION_TEXT : key->type) {
+            case PSV_DATA_ANNOTATION_INTEGER:
+            case PSV_DATA_ANNOTATION_BOOL:
+            case PSV_DATA_ANNOTATION_DATETIME:
+                result = (a->values[i].integer > b->values[i].integer) - (a->values[i].integer < b->values[i].integer);
+                break;
+            case PSV_DATA_ANNOTATION_FLOAT:
+                result = (a->values[i].real > b->values[i].real) - (a->values[i].real < b->values[i].real);
+                break;
+            default:
+                result = strcmp(data_a, data_b);
+                break;
+        }
+
+        if (result != 0) {
+            return key->descending ? -result : result;
+        }
+    }
+
+    return (a->sequence > b->sequence) - (a->sequence < b->sequence);
+}
+
+// Stable merge sort of record pointers (qsort takes no context argument for the sort spec)
+static void merge_sort_records(const PsvSorter *sorter, SortRecord **records, SortRecord **scratch, size_t count) {
+    if (count < 2) {
+        return;
+    }
+
+    // Insertion sort small ranges
+    if (count <= 16) {
+        for (size_t i = 1; i < count; i++) {
+            SortRecord *record = records[i];
+            size_t j = i;
+            while (j > 0 && compare_records(sorter, records[j - 1], record) > 0) {
+                records[j] = records[j - 1];
+                j--;
+            }
+            records[j] = record;
+        }
+        return;
+    }
+
+    const size_t middle = count / 2;
+    merge_sort_records(sorter, records, scratch, middle);
+    merge_sort_records(sorter, records + middle, scratch, count - middle);
+
+    // Already in order, no merge needed (common for mostly sorted input)
+    if (compare_records(sorter, records[middle - 1], records[middle]) <= 0) {
+        return;
+    }
+
+    memcpy(scratch, records, middle * sizeof(SortRecord *));
+    size_t left = 0;
+    size_t right = middle;
+    size_t out = 0;
+    while (left < middle && right < count) {
+        if (compare_records(sorter, records[right], scratch[left]) < 0) {
+            records[out++] = records[right++];
+        } else {
+            records[out++] = scratch[left++];
+        }
+    }
+    while (left < middle) {
+        records[out++] = scratch[left++];
+    }
+}
+
+static void sort_records(PsvSorter *sorter) {
+    SortRecord **scratch = malloc((sorter->num_records / 2 + 1) * sizeof(SortRecord *));
+    assert(scratch != NULL);
+    merge_sort_records(sorter, sorter->records, scratch, sorter->num_records);
+    free(scratch);
+}
+
+/*******************************************************************************
+ * Binary Heap Helpers
+ *
+ * `sign` selects between a min heap (1: smallest record at the root, used for
+ * k-way merging) and a max heap (-1: largest record at the root, used for top K).
+ ******************************************************************************/
+
+static void heap_sift_up(const PsvSorter *sorter, SortRecord **heap, size_t index, int sign) {
+    while (index > 0) {
+        const size_t parent = (index - 1) / 2;
+        if (sign * compare_records(sorter, heap[parent], heap[index]) <= 0) {
+            break;
+        }
+        SortRecord *swap = heap[parent];
+        heap[parent] = heap[index];
+        heap[index] = swap;
+        index = parent;
+    }
+}
+
+static void heap_sift_down(const PsvSorter *sorter, SortRecord **heap, size_t size, size_t index, int sign) {
+    while (true) {
+        const size_t left = index * 2 + 1;
+        const size_t right = left + 1;
+        size_t top = index;
+        if (left < size && sign * compare_records(sorter, heap[left], heap[top]) < 0) {
+            top = left;
+        }
+        if (right < size && sign * compare_records(sorter, heap[right], heap[top]) < 0) {
+            top = right;
+        }
+        if (top == index) {
+            break;
+        }
+        SortRecord *swap = heap[top];
+        heap[top] = heap[index];
+        heap[index] = swap;
+        index = top;
+    }
+}
+
+/**
+ * @brief Creates a sorter.
+ *
+ * @param spec Pointer to the sort specification. Must outlive the sorter.
+ * @param num_columns The number of cells in each row.
+ * @param memory_budget Approximate number of bytes of rows to buffer before spilling a sorted run to a temporary file.
+ * @param limit If non zero, only the first `limit` rows in sort order are kept (top K mode).
+ * @return A pointer to the new sorter (free with psv_sorter_free()).
+ */
+PsvSorter *psv_sorter_create(const PsvSortSpec *spec, int num_columns, size_t memory_budget, size_t limit) {
+    PsvSorter *sorter = calloc(1, sizeof(PsvSorter));
+    assert(sorter != NULL);
+    sorter->spec = spec;
+    sorter->num_columns = num_columns;
+    sorter->memory_budget = memory_budget;
+    sorter->limit = limit;
+    return sorter;
+}
+
+/*******************************************************************************
+ * Sorted Runs
+ *
+ * Run files are created on demand with tmpfile(), so they are removed as soon as
+ * they are closed. Failing to create, write or read one ends the program, since
+ * the sorted output would otherwise silently miss rows.
+ ******************************************************************************/
+
+static FILE *create_run_file(void) {
+    FILE *run = tmpfile();
+    if (run == NULL) {
+        fprintf(stderr, "psv: cannot create sort run file: %s\n", strerror(errno));
+        exit(1);
+    }
+    return run;
+}
+
+static void write_run_row(PsvSorter *sorter, FILE *run, PsvDataRow data_row) {
+    if (!psv_spill_write_row(run, sorter->num_columns, data_row)) {
+        fprintf(stderr, "psv: cannot write to sort run file: %s\n", strerror(errno));
+        exit(1);
+    }
+}
+
+static void finish_run_file(FILE *run) {
+    if (fflush(run) != 0) {
+        fprintf(stderr, "psv: cannot write to sort run file: %s\n", strerror(errno));
+        exit(1);
+    }
+}
+
+static SortRecord *read_run_record(PsvSorter *sorter, size_t run) {
+    PsvDataRow data_row = psv_spill_read_row(sorter->runs[run], sorter->num_columns);
+    if (data_row == NULL) {
+        if (ferror(sorter->runs[run])) {
+            fprintf(stderr, "psv: cannot read sort run file: %s\n", strerror(errno));
+            exit(1);
+        }
+        return NULL;
+    }
+
+    // Ties between runs are broken by run index, since earlier runs hold earlier input rows
+    return create_record(sorter, data_row, run);
+}
+
+// Start a k-way merge of the `count` newest runs, with the first record of each run in the heap
+static void merge_heap_fill(PsvSorter *sorter, size_t count) {
+    assert(count <= SORT_MERGE_RUNS_MAX);
+    if (sorter->merge_heap == NULL) {
+        sorter->merge_heap = malloc(SORT_MERGE_RUNS_MAX * sizeof(SortRecord *));
+        assert(sorter->merge_heap != NULL);
+    }
+
+    sorter->merge_heap_size = 0;
+    for (size_t i = sorter->num_runs - count; i < sorter->num_runs; i++) {
+        rewind(sorter->runs[i]);
+        SortRecord *record = read_run_record(sorter, i);
+        if (record) {
+            sorter->merge_heap[sorter->merge_heap_size++] = record;
+            heap_sift_up(sorter, sorter->merge_heap, sorter->merge_heap_size - 1, 1);
+        }
+    }
+}
+
+// Pop the smallest head of the merge and refill from the same run
+static PsvDataRow merge_heap_pop(PsvSorter *sorter) {
+    if (sorter->merge_heap_size == 0) {
+        return NULL;
+    }
+
+    SortRecord *record = sorter->merge_heap[0];
+    const size_t run = record->sequence;
+    PsvDataRow data_row = record->row;
+    free(record);
+
+    SortRecord *next = read_run_record(sorter, run);
+    if (next) {
+        sorter->merge_heap[0] = next;
+    } else {
+        sorter->merge_heap[0] = sorter->merge_heap[--sorter->merge_heap_size];
+    }
+    heap_sift_down(sorter, sorter->merge_heap, sorter->merge_heap_size, 0, 1);
+
+    return data_row;
+}
+
+// Merge the `count` newest runs into one run that takes their place
+static void merge_newest_runs(PsvSorter *sorter, size_t count) {
+    FILE *merged = create_run_file();
+    merge_heap_fill(sorter, count);
+
+    PsvDataRow data_row = NULL;
+    while ((data_row = merge_heap_pop(sorter)) != NULL) {
+        write_run_row(sorter, merged, data_row);
+        free_row(sorter, data_row);
+    }
+    finish_run_file(merged);
+
+    const size_t first = sorter->num_runs - count;
+    unsigned level = 0;
+    for (size_t i = first; i < sorter->num_runs; i++) {
+        level = (sorter->run_levels[i] > level) ? sorter->run_levels[i] : level;
+        fclose(sorter->runs[i]);
+    }
+
+    log_debug("Merged %zu sort runs into one run of level %u", count, level + 1);
+
+    sorter->runs[first] = merged;
+    sorter->run_levels[first] = level + 1;
+    sorter->num_runs = first + 1;
+}
+
+static void spill_run(PsvSorter *sorter) {
+    sort_records(sorter);
+
+    FILE *run = create_run_file();
+    for (size_t i = 0; i < sorter->num_records; i++) {
+        write_run_row(sorter, run, sorter->records[i]->row);
+        free_record(sorter, sorter->records[i]);
+    }
+    finish_run_file(run);
+
+    log_debug("Sort memory budget exceeded, spilled run %zu with %zu rows", sorter->num_runs, sorter->num_records);
+
+    sorter->runs = realloc(sorter->runs, (sorter->num_runs + 1) * sizeof(FILE *));
+    sorter->run_levels = realloc(sorter->run_levels, (sorter->num_runs + 1) * sizeof(unsigned));
+    assert(sorter->runs != NULL && sorter->run_levels != NULL);
+    sorter->runs[sorter->num_runs] = run;
+    sorter->run_levels[sorter->num_runs++] = 0;
+    sorter->num_records = 0;
+    sorter->memory_used = 0;
+
+    // Levels never increase from the oldest run to the newest, so once the newest
+    // SORT_MERGE_RUNS_MAX runs share a level there are exactly that many runs of it
+    while (sorter->num_runs >= SORT_MERGE_RUNS_MAX && sorter->run_levels[sorter->num_runs - SORT_MERGE_RUNS_MAX] == sorter->run_levels[sorter->num_runs - 1]) {
+        merge_newest_runs(sorter, SORT_MERGE_RUNS_MAX);
+    }
+}
+
+/**
+ * @brief Adds a row to the sorter.
+ *
+ * @param sorter Pointer to the sorter.
+ * @param data_row The data row. Ownership passes to the sorter.
+ */
+void psv_sorter_add_row(PsvSorter *sorter, PsvDataRow data_row) {
+    SortRecord *record = create_record(sorter, data_row, sorter->next_sequence++);
+
+    if (sorter->limit > 0 && sorter->num_records == sorter->limit) {
+        // Top K: Only keep the row if it sorts before the current worst row
+        if (compare_records(sorter, record, sorter->records[0]) >= 0) {
+            free_record(sorter, record);
+            return;
+        }
+        free_record(sorter, sorter->records[0]);
+        sorter->records[0] = record;
+        heap_sift_down(sorter, sorter->records, sorter->num_records, 0, -1);
+        return;
+    }
+
+    if (sorter->num_records == sorter->records_capacity) {
+        sorter->records_capacity = sorter->records_capacity ? sorter->records_capacity * 2 : 1024;
+        sorter->records = realloc(sorter->records, sorter->records_capacity * sizeof(SortRecord *));
+        assert(sorter->records != NULL);
+    }
+    sorter->records[sorter->num_records++] = record;
+
+    if (sorter->limit > 0) {
+        heap_sift_up(sorter, sorter->records, sorter->num_records - 1, -1);
+        return;
+    }
+
+    sorter->memory_used += sizeof(SortRecord *) + sizeof(SortRecord) + sorter->spec->num_keys * sizeof(SortValue) + psv_spill_row_size(sorter->num_columns, data_row);
+    if (sorter->memory_used > sorter->memory_budget) {
+        spill_run(sorter);
+    }
+}
+
+static void finish_input(PsvSorter *sorter) {
+    sorter->input_done = true;
+
+    if (sorter->num_runs == 0) {
+        sort_records(sorter);
+        return;
+    }
+
+    // Spill the remainder as the final run and start the k-way merge
+    if (sorter->num_records > 0) {
+        spill_run(sorter);
+    }
+
+    // Merge just enough of the newest runs that the rest can be merged in one final pass
+    while (sorter->num_runs > SORT_MERGE_RUNS_MAX) {
+        const size_t excess = sorter->num_runs - SORT_MERGE_RUNS_MAX + 1;
+        merge_newest_runs(sorter, (excess < SORT_MERGE_RUNS_MAX) ? excess : SORT_MERGE_RUNS_MAX);
+    }
+    merge_heap_fill(sorter, sorter->num_runs);
+}
+
+/**
+ * @brief Returns the next row in sort order.
+ *
+ * Must only be called once all rows have been added.
+ *
+ * @param sorter Pointer to the sorter.
+ * @return The next data row (ownership passes to the caller), or NULL when all rows have been returned.
+ */
+PsvDataRow psv_sorter_next_row(PsvSorter *sorter) {
+    if (!sorter->input_done) {
+        finish_input(sorter);
+    }
+
+    if (sorter->num_runs == 0) {
+        if (sorter->next_record >= sorter->num_records) {
+            return NULL;
+        }
+
+        SortRecord *record = sorter->records[sorter->next_record];
+        sorter->records[sorter->next_record++] = NULL;
+        PsvDataRow data_row = record->row;
+        free(record);
+        return data_row;
+    }
+
+    return merge_heap_pop(sorter);
+}
+
+void psv_sorter_free(PsvSorter **sorter_ptr) {
+    PsvSorter *sorter = *sorter_ptr;
+
+    for (size_t i = 0; i < sorter->num_records; i++) {
+        if (sorter->records[i]) {
+            free_record(sorter, sorter->records[i]);
+        }
+    }
+    free(sorter->records);
+
+    for (size_t i = 0; i < sorter->merge_heap_size; i++) {
+        free_record(sorter, sorter->merge_heap[i]);
+    }
+    free(sorter->merge_heap);
+
+    for (size_t i = 0; i < sorter->num_runs; i++) {
+        fclose(sorter->runs[i]);
+    }
+    free(sorter->runs);
+    free(sorter->run_levels);
+
+    free(sorter);
+    *sorter_ptr = NULL;
+}
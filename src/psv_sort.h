@@ -0,0 +1,46 @@
+/**
+ * @file psv_sort.h
+ * @brief Sorting Of PSV Table Rows (In Memory, External Merge And Top K)
+ *
+ * Copyright (C) 2024-2024 Brian Khuu <contact@briankhuu.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ */
+
+#ifndef PSV_SORT_H
+#define PSV_SORT_H
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "psv.h"
+
+#define PSV_SORT_ERROR_MAX (PSV_HEADER_ID_MAX + 64)
+
+typedef struct {
+    int column;
+    PsvDataAnnotationType type;     ///< Basic type of the column (or datetime), which decides integer/float/bool/datetime/text comparison
+    bool descending;
+} PsvSortKey;
+
+typedef struct {
+    int num_keys;
+    PsvSortKey *keys;
+
+    char error[PSV_SORT_ERROR_MAX];
+} PsvSortSpec;
+
+bool psv_sort_spec_parse(PsvSortSpec *spec, PsvTable *table, const char *sort_by);
+void psv_sort_spec_free(PsvSortSpec *spec);
+
+typedef struct PsvSorter PsvSorter;
+
+PsvSorter *psv_sorter_create(const PsvSortSpec *spec, int num_columns, size_t memory_budget, size_t limit);
+void psv_sorter_add_row(PsvSorter *sorter, PsvDataRow data_row);
+PsvDataRow psv_sorter_next_row(PsvSorter *sorter);
+void psv_sorter_free(PsvSorter **sorter_ptr);
+
+#endif
@@ -0,0 +1,106 @@
+/**
+ * @file psv_spill.c
+ * @brief Temporary File Spilling Of PSV Data Rows
+ *
+ * Copyright (C) 2024-2024 Brian Khuu <contact@briankhuu.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Processing modes that must handle tables larger than their memory budget write rows out to
+ * temporary files (see tmpfile()) and read them back later. Rows are stored in a simple binary
+ * record format, which is much cheaper to read back than re-tokenizing a Markdown table row:
+ *
+ *     for each cell: <uint32 little endian length> <length bytes>
+ *
+ * A length of 0xFFFFFFFF marks an empty (NULL) cell.
+ */
+
+#include <string.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "psv_spill.h"
+
+#define PSV_SPILL_NULL_CELL 0xFFFFFFFFUL
+
+/**
+ * @brief Estimates the in-memory size of a data row.
+ *
+ * Used by processing modes to account rows against their memory budget.
+ *
+ * @param num_cells The number of cells in the row.
+ * @param data_row The data row.
+ * @return The approximate number of heap bytes used by the row.
+ */
+size_t psv_spill_row_size(int num_cells, PsvDataRow data_row) {
+    size_t size = num_cells * sizeof(PsvDataField);
+    for (int i = 0; i < num_cells; i++) {
+        if (data_row[i]) {
+            size += strlen(data_row[i]) + 1;
+        }
+    }
+    return size;
+}
+
+/**
+ * @brief Writes a data row to a spill file.
+ *
+ * @param spill The spill file stream.
+ * @param num_cells The number of cells in the row.
+ * @param data_row The data row to write.
+ * @return true on success, false if the write failed.
+ */
+bool psv_spill_write_row(FILE *spill, int num_cells, PsvDataRow data_row) {
+    for (int i = 0; i < num_cells; i++) {
+        const uint32_t length = data_row[i] ? (uint32_t)strlen(data_row[i]) : PSV_SPILL_NULL_CELL;
+        const unsigned char length_bytes[4] = {length & 0xFF, (length >> 8) & 0xFF, (length >> 16) & 0xFF, (length >> 24) & 0xFF};
+        if (fwrite(length_bytes, 1, 4, spill) != 4) {
+            return false;
+        }
+
+        if (data_row[i] && fwrite(data_row[i], 1, length, spill) != length) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Reads back a data row previously written with psv_spill_write_row().
+ *
+ * @param spill The spill file stream.
+ * @param num_cells The number of cells in the row.
+ * @return A newly allocated PsvDataRow (free with psv_parse_table_free_row()),
+ *         or NULL if the end of the spill file is reached.
+ */
+PsvDataRow psv_spill_read_row(FILE *spill, int num_cells) {
+    PsvDataRow data_row = calloc(num_cells, sizeof(PsvDataField));
+    for (int i = 0; i < num_cells; i++) {
+        unsigned char length_bytes[4];
+        if (fread(length_bytes, 1, 4, spill) != 4) {
+            goto truncated;
+        }
+
+        const uint32_t length = length_bytes[0] | (length_bytes[1] << 8) | (length_bytes[2] << 16) | ((uint32_t)length_bytes[3] << 24);
+        if (length == PSV_SPILL_NULL_CELL) {
+            continue;
+        }
+
+        data_row[i] = malloc(length + 1);
+        if (fread(data_row[i], 1, length, spill) != length) {
+            goto truncated;
+        }
+        data_row[i][length] = '\0';
+    }
+    return data_row;
+
+truncated:
+    for (int i = 0; i < num_cells; i++) {
+        free(data_row[i]);
+    }
+    free(data_row);
+    return NULL;
+}
@@ -0,0 +1,24 @@
+/**
+ * @file psv_spill.h
+ * @brief Temporary File Spilling Of PSV Data Rows
+ *
+ * Copyright (C) 2024-2024 Brian Khuu <contact@briankhuu.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ */
+
+#ifndef PSV_SPILL_H
+#define PSV_SPILL_H
+#include <stdbool.h>
+#include <stdio.h>
+
+#include "psv.h"
+
+size_t psv_spill_row_size(int num_cells, PsvDataRow data_row);
+bool psv_spill_write_row(FILE *spill, int num_cells, PsvDataRow data_row);
+PsvDataRow psv_spill_read_row(FILE *spill, int num_cells);
+
+#endif
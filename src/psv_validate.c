@@ -0,0 +1,348 @@
+/**
+ * @file psv_validate.c
+ * @brief Validation Of PSV Data Cells Against Their Data Annotations
+ *
+ * Copyright (C) 2024-2024 Brian Khuu <contact@briankhuu.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Each annotation type maps to a validator in a lookup table, resolved once per column. The
+ * validators scan cells with a 256 entry character class table, so checking a cell is a single
+ * branch light pass over its bytes with no allocation and no number conversion (other than the
+ * final range check of integers that are close to the 64-bit limit). Only columns with a multi
+ * stage decode pipeline (e.g. [hex][cbor]) decode their cells, into reusable scratch buffers.
+ */
+
+#include <string.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <errno.h>
+#include <float.h>
+#include <math.h>
+
+#include "psv_validate.h"
+#include "psv_datetime.h"
+#include "psv_cbor.h"
+
+enum {
+    CHAR_DIGIT = 1 << 0,
+    CHAR_HEX = 1 << 1,
+    CHAR_BASE64 = 1 << 2,       ///< Standard alphabet
+    CHAR_BASE64_URL = 1 << 3,   ///< URL safe alphabet
+};
+
+static uint8_t char_classes[256];
+
+static void init_char_classes(void) {
+    if (char_classes['0'] != 0) {
+        return;
+    }
+
+    for (int c = '0'; c <= '9'; c++) {
+        char_classes[c] |= CHAR_DIGIT | CHAR_HEX | CHAR_BASE64 | CHAR_BASE64_URL;
+    }
+    for (int c = 'a'; c <= 'z'; c++) {
+        char_classes[c] |= CHAR_BASE64 | CHAR_BASE64_URL | ((c <= 'f') ? CHAR_HEX : 0);
+        char_classes[c - 'a' + 'A'] |= CHAR_BASE64 | CHAR_BASE64_URL | ((c <= 'f') ? CHAR_HEX : 0);
+    }
+    char_classes['+'] |= CHAR_BASE64;
+    char_classes['/'] |= CHAR_BASE64;
+    char_classes['-'] |= CHAR_BASE64_URL;
+    char_classes['_'] |= CHAR_BASE64_URL;
+}
+
+// Advance past a run of characters of the given class
+static const char *skip_class(const char *str, uint8_t char_class) {
+    while (char_classes[(uint8_t)*str] & char_class) {
+        str++;
+    }
+    return str;
+}
+
+static bool validate_integer(const char *cell, const char **reason) {
+    const char *digits = cell + (*cell == '-' || *cell == '+');
+    const char *end = skip_class(digits, CHAR_DIGIT);
+    if (end == digits || *end != '\0') {
+        *reason = "not an integer";
+        return false;
+    }
+
+    // Only numbers as long as INT64_MAX need an actual range check
+    if (end - digits >= 19) {
+        errno = 0;
+        strtoll(cell, NULL, 10);
+        if (errno == ERANGE) {
+            *reason = "integer out of 64-bit range";
+            return false;
+        }
+    }
+    return true;
+}
+
+static bool validate_float(const char *cell, const char **reason) {
+    const char *str = cell + (*cell == '-' || *cell == '+');
+    const char *integer_end = skip_class(str, CHAR_DIGIT);
+    bool has_digits = (integer_end != str);
+    str = integer_end;
+
+    if (*str == '.') {
+        const char *fraction_end = skip_class(str + 1, CHAR_DIGIT);
+        has_digits = has_digits || (fraction_end != str + 1);
+        str = fraction_end;
+    }
+
+    const bool has_exponent = has_digits && (*str == 'e' || *str == 'E');
+    if (has_exponent) {
+        str++;
+        str += (*str == '-' || *str == '+');
+        const char *exponent_end = skip_class(str, CHAR_DIGIT);
+        has_digits = (exponent_end != str);
+        str = exponent_end;
+    }
+
+    if (!has_digits || *str != '\0') {
+        *reason = "not a number";
+        return false;
+    }
+
+    // Only an exponent or more integer digits than DBL_MAX has can overflow to infinity,
+    // which JSON cannot represent (numbers that underflow round to zero and stay valid)
+    if ((has_exponent || integer_end - cell > DBL_MAX_10_EXP) && isinf(strtod(cell, NULL))) {
+        *reason = "float out of double range";
+        return false;
+    }
+    return true;
+}
+
+static bool validate_bool(const char *cell, const char **reason) {
+    static const char *const bool_values[] = {"true", "false", "yes", "no", "y", "n", "active", "inactive"};
+    for (size_t i = 0; i < sizeof(bool_values) / sizeof(bool_values[0]); i++) {
+        if (strcmp(cell, bool_values[i]) == 0) {
+            return true;
+        }
+    }
+    *reason = "not a bool (expected true/false, yes/no, y/n or active/inactive)";
+    return false;
+}
+
+static bool validate_hex(const char *cell, const char **reason) {
+    const char *digits = cell;
+    if (digits[0] == '0' && (digits[1] == 'x' || digits[1] == 'X')) {
+        digits += 2;
+    }
+
+    const char *end = skip_class(digits, CHAR_HEX);
+    if (end == digits || *end != '\0') {
+        *reason = "not hexadecimal";
+        return false;
+    }
+    if ((end - digits) % 2 != 0) {
+        *reason = "odd number of hex digits";
+        return false;
+    }
+    return true;
+}
+
+static bool validate_base64(const char *cell, const char **reason) {
+    // Either alphabet is accepted, but not a mix of both
+    const char *standard_end = skip_class(cell, CHAR_BASE64);
+    const char *url_end = skip_class(cell, CHAR_BASE64_URL);
+    const char *end = (standard_end > url_end) ? standard_end : url_end;
+    const size_t data_length = end - cell;
+
+    size_t padding = 0;
+    while (end[padding] == '=' && padding < 2) {
+        padding++;
+    }
+
+    if (end[padding] != '\0') {
+        *reason = "not base64";
+        return false;
+    }
+    if ((padding > 0 && (data_length + padding) % 4 != 0) || data_length % 4 == 1) {
+        *reason = "bad base64 length or padding";
+        return false;
+    }
+    return true;
+}
+
+static bool validate_data_uri(const char *cell, const char **reason) {
+    const char *comma = strchr(cell, ',');
+    if (strncmp(cell, "data:", 5) != 0 || comma == NULL) {
+        *reason = "not a data URI";
+        return false;
+    }
+
+    // Base64 payloads must also be valid base64
+    if (comma - cell >= 12 && strncmp(comma - 7, ";base64", 7) == 0) {
+        return validate_base64(comma + 1, reason);
+    }
+
+    // Otherwise any percent escapes must be complete
+    for (const char *escape = strchr(comma + 1, '%'); escape != NULL; escape = strchr(escape + 1, '%')) {
+        if (!(char_classes[(uint8_t)escape[1]] & CHAR_HEX) || !(char_classes[(uint8_t)escape[2]] & CHAR_HEX)) {
+            *reason = "bad percent escape in data URI";
+            return false;
+        }
+    }
+    return true;
+}
+
+static bool validate_datetime(const char *cell, const char **reason) {
+    int64_t epoch_ns;
+    if (!psv_datetime_parse(cell, &epoch_ns)) {
+        *reason = "not an ISO 8601 date/time";
+        return false;
+    }
+    return true;
+}
+
+static bool validate_uuid(const char *cell, const char **reason) {
+    // 8-4-4-4-12 hex digits
+    static const uint8_t group_ends[] = {8, 13, 18, 23, 36};
+    size_t position = 0;
+    for (size_t group = 0; group < sizeof(group_ends); group++) {
+        const char *end = skip_class(cell + position, CHAR_HEX);
+        if ((size_t)(end - cell) != group_ends[group] || (group < 4 && *end != '-')) {
+            *reason = "not a UUID";
+            return false;
+        }
+        position = group_ends[group] + 1;
+    }
+
+    if (cell[36] != '\0') {
+        *reason = "not a UUID";
+        return false;
+    }
+    return true;
+}
+
+static const PsvCellValidator cell_validators[PSV_DATA_ANNOTATION_MAX] = {
+    [PSV_DATA_ANNOTATION_INTEGER] = validate_integer,
+    [PSV_DATA_ANNOTATION_FLOAT] = validate_float,
+    [PSV_DATA_ANNOTATION_BOOL] = validate_bool,
+    [PSV_DATA_ANNOTATION_HEX] = validate_hex,
+    [PSV_DATA_ANNOTATION_BASE64] = validate_base64,
+    [PSV_DATA_ANNOTATION_DATA_URI] = validate_data_uri,
+    [PSV_DATA_ANNOTATION_DATETIME] = validate_datetime,
+    [PSV_DATA_ANNOTATION_UUID] = validate_uuid,
+};
+
+/**
+ * @brief Resolves the checks of a column once, ready for psv_validate_column_cell().
+ *
+ * Data annotations are applied left to right. A column whose annotations start with a decode
+ * pipeline (e.g. `[hex][cbor]`) is checked by running cells through the whole pipeline, so every
+ * stage must decode and a final [cbor] stage must be a well formed data item. Annotations after the
+ * pipeline describe the decoded bytes rather than the text and are not checked. Otherwise every
+ * annotation of the column that can be validated is checked against the cell text (e.g. both the
+ * [int] and [datetime] of an `[int][datetime]` column, while [str] adds nothing). Columns without
+ * any use their inferred type.
+ *
+ * @param validator The column validator to fill in.
+ * @param table Pointer to the table.
+ * @param header_column The index of the header column.
+ */
+void psv_validate_column_init(PsvColumnValidator *validator, PsvTable *table, size_t header_column) {
+    init_char_classes();
+    *validator = (PsvColumnValidator){0};
+
+    const PsvHeaderMetadataField *header_metadata = &table->header_metadata[header_column];
+    if (header_metadata->num_decode_stages > 1 || psv_decode_pipeline_is_cbor(header_metadata)) {
+        validator->pipeline = header_metadata;
+        return;
+    }
+
+    if (header_metadata->num_decode_stages == 1) {
+        // A single binary stage can be checked without decoding
+        validator->checks[validator->num_checks++] = psv_validate_get_type_validator(header_metadata->decode_stages[0]);
+        return;
+    }
+
+    for (size_t i = 0; i < header_metadata->data_annotation_tag_size && validator->num_checks < PSV_VALIDATE_CHECKS_MAX; i++) {
+        const PsvCellValidator check = psv_validate_get_type_validator(header_metadata->data_annotation_tags[i].type);
+        if (check == NULL) {
+            continue;
+        }
+        bool is_repeated = false;
+        for (int j = 0; j < validator->num_checks; j++) {
+            is_repeated = is_repeated || validator->checks[j] == check;
+        }
+        if (!is_repeated) {
+            validator->checks[validator->num_checks++] = check;
+        }
+    }
+
+    if (validator->num_checks == 0 && psv_validate_get_type_validator(header_metadata->inferred_type) != NULL) {
+        validator->checks[validator->num_checks++] = psv_validate_get_type_validator(header_metadata->inferred_type);
+    }
+}
+
+/**
+ * @brief Checks a cell against its column's data annotations.
+ *
+ * @param validator The column validator, from psv_validate_column_init().
+ * @param cell The (non empty) cell.
+ * @param scratch Reusable buffers for decoding cells of columns with a decode pipeline.
+ * @param reason Set to a short static description of the problem if the cell is not valid.
+ * @return true if the cell is valid.
+ */
+bool psv_validate_column_cell(const PsvColumnValidator *validator, const char *cell, PsvDecodeScratch *scratch, const char **reason) {
+    if (validator->pipeline != NULL) {
+        const PsvBytes *bytes = psv_decode_pipeline_bytes(validator->pipeline, cell, scratch, reason);
+        if (bytes == NULL) {
+            return false;
+        }
+        return !psv_decode_pipeline_is_cbor(validator->pipeline) || psv_cbor_is_well_formed(bytes->data, bytes->size, reason);
+    }
+
+    for (int i = 0; i < validator->num_checks; i++) {
+        if (!validator->checks[i](cell, reason)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Finds the validator for a data annotation type.
+ *
+ * @param type The data annotation type.
+ * @return The type's cell validator, or NULL if the type has no validator (e.g. text).
+ */
+PsvCellValidator psv_validate_get_type_validator(PsvDataAnnotationType type) {
+    init_char_classes();
+    return (type >= 0 && type < PSV_DATA_ANNOTATION_MAX) ? cell_validators[type] : NULL;
+}
+
+/**
+ * @brief Finds the basic type that JSON and CBOR output write a cell as.
+ *
+ * [int] and [float] cells, and cells of columns whose type was inferred from a sample of rows,
+ * keep their column's basic type only if they are valid as it, and are otherwise written as text
+ * so no value is lost. Annotated [bool] cells are always booleans, true for the values that
+ * psv_data_is_true() accepts.
+ *
+ * @param table Pointer to the table.
+ * @param header_column The index of the cell's column.
+ * @param cell The trimmed, non empty cell.
+ * @return The basic type of the cell.
+ */
+PsvDataAnnotationType psv_validate_cell_basic_type(PsvTable *table, size_t header_column, const char *cell) {
+    const PsvDataAnnotationType basic_type = psv_get_basic_type(table, header_column);
+    if (basic_type == PSV_DATA_ANNOTATION_TEXT) {
+        return basic_type;
+    }
+
+    const bool is_inferred = (table->header_metadata[header_column].inferred_type == basic_type);
+    if (is_inferred || basic_type == PSV_DATA_ANNOTATION_INTEGER || basic_type == PSV_DATA_ANNOTATION_FLOAT) {
+        const char *reason = NULL;
+        if (!psv_validate_get_type_validator(basic_type)(cell, &reason)) {
+            return PSV_DATA_ANNOTATION_TEXT;
+        }
+    }
+    return basic_type;
+}
@@ -0,0 +1,38 @@
+/**
+ * @file psv_validate.h
+ * @brief Validation Of PSV Data Cells Against Their Data Annotations
+ *
+ * Copyright (C) 2024-2024 Brian Khuu <contact@briankhuu.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ */
+
+#ifndef PSV_VALIDATE_H
+#define PSV_VALIDATE_H
+#include <stdbool.h>
+
+#include "psv.h"
+#include "psv_decode.h"
+
+// Returns true if the cell is valid, otherwise sets reason to a short static description of the problem
+typedef bool (*PsvCellValidator)(const char *cell, const char **reason);
+
+// Most distinct annotation checks of one column
+#define PSV_VALIDATE_CHECKS_MAX 8
+
+// Checks a column's cells are held to, resolved once per column
+typedef struct {
+    int num_checks;
+    PsvCellValidator checks[PSV_VALIDATE_CHECKS_MAX];   ///< Validators the cell text must pass
+    const PsvHeaderMetadataField *pipeline;             ///< Column whose decode pipeline cells must decode through, or NULL
+} PsvColumnValidator;
+
+void psv_validate_column_init(PsvColumnValidator *validator, PsvTable *table, size_t header_column);
+bool psv_validate_column_cell(const PsvColumnValidator *validator, const char *cell, PsvDecodeScratch *scratch, const char **reason);
+PsvCellValidator psv_validate_get_type_validator(PsvDataAnnotationType type);
+PsvDataAnnotationType psv_validate_cell_basic_type(PsvTable *table, size_t header_column, const char *cell);
+
+#endif
@@ -0,0 +1,253 @@
+/**
+ * @file psv_where.c
+ * @brief Row Filter Predicate On A Single PSV Column
+ *
+ * Copyright (C) 2024-2024 Brian Khuu <contact@briankhuu.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * A predicate has the form `key<op>value` and is checked against a single cell, so a row only
+ * needs to be tokenized up to the predicate column. The value is parsed once as the column's
+ * type, so e.g. `age>=18` compares integers, `time<2024-06-01` compares timestamps and a [uuid]
+ * column compares the 16 bytes of each UUID regardless of case.
+ */
+
+#include <string.h>
+#include <ctype.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <assert.h>
+
+#include "psv_where.h"
+#include "psv_datetime.h"
+
+#ifdef NDEBUG
+    #define assert(expression) ((void)0)
+#endif
+
+static const struct {
+    const char *symbol;
+    PsvWhereOperator op;
+} where_operators[] = {
+    // Two character operators first so that e.g. `<=` is not read as `<`
+    {"==", PSV_WHERE_EQUAL},
+    {"!=", PSV_WHERE_NOT_EQUAL},
+    {"<=", PSV_WHERE_LESS_EQUAL},
+    {">=", PSV_WHERE_GREATER_EQUAL},
+    {"=",  PSV_WHERE_EQUAL},
+    {"<",  PSV_WHERE_LESS},
+    {">",  PSV_WHERE_GREATER},
+    {"~",  PSV_WHERE_CONTAINS},
+};
+
+static bool parse_integer(const char *str, int64_t *value) {
+    char *end = NULL;
+    errno = 0;
+    *value = strtoll(str, &end, 10);
+    return end != str && *end == '\0' && errno == 0;
+}
+
+static bool parse_number(const char *str, double *value) {
+    char *end = NULL;
+    *value = strtod(str, &end);
+    return end != str && *end == '\0';
+}
+
+/**
+ * @brief Parses a where predicate of the form `key<op>value`.
+ *
+ * Supported operators are `=` (or `==`), `!=`, `<`, `<=`, `>`, `>=` and `~` (text contains).
+ *
+ * @param spec The spec to initialise. Free with psv_where_spec_free() even if parsing fails.
+ * @param table The table the predicate applies to.
+ * @param where The predicate string.
+ * @return true on success, false with spec->error set otherwise.
+ */
+bool psv_where_spec_parse(PsvWhereSpec *spec, PsvTable *table, const char *where) {
+    *spec = (PsvWhereSpec){0};
+
+    const char *op_start = strpbrk(where, "=!<>~");
+    if (op_start == NULL) {
+        snprintf(spec->error, PSV_WHERE_ERROR_MAX, "where predicate has no operator (expected key<op>value)");
+        return false;
+    }
+
+    size_t op_size = 0;
+    for (size_t i = 0; i < sizeof(where_operators) / sizeof(where_operators[0]); i++) {
+        const size_t symbol_size = strlen(where_operators[i].symbol);
+        if (strncmp(op_start, where_operators[i].symbol, symbol_size) == 0) {
+            spec->op = where_operators[i].op;
+            op_size = symbol_size;
+            break;
+        }
+    }
+    if (op_size == 0) {
+        snprintf(spec->error, PSV_WHERE_ERROR_MAX, "where predicate has an unknown operator");
+        return false;
+    }
+
+    // Copy and trim the key
+    const char *key_start = where;
+    const char *key_end = op_start;
+    while (key_start < key_end && isspace((unsigned char)*key_start)) {
+        key_start++;
+    }
+    while (key_end > key_start && isspace((unsigned char)key_end[-1])) {
+        key_end--;
+    }
+    char key[PSV_HEADER_ID_MAX];
+    snprintf(key, sizeof(key), "%.*s", (int)(key_end - key_start), key_start);
+
+    spec->column = psv_find_header_column(table, key);
+    if (spec->column < 0) {
+        snprintf(spec->error, PSV_WHERE_ERROR_MAX, "where column '%s' not found", key);
+        return false;
+    }
+
+    // Copy and trim the value
+    const char *value_start = op_start + op_size;
+    while (isspace((unsigned char)*value_start)) {
+        value_start++;
+    }
+    spec->value = strdup(value_start);
+    assert(spec->value != NULL);
+    for (char *end = spec->value + strlen(spec->value); end > spec->value && isspace((unsigned char)end[-1]); end--) {
+        end[-1] = '\0';
+    }
+
+    const bool ordering = spec->op != PSV_WHERE_EQUAL && spec->op != PSV_WHERE_NOT_EQUAL;
+    if (spec->value[0] == '\0') {
+        if (ordering) {
+            snprintf(spec->error, PSV_WHERE_ERROR_MAX, "where predicate on '%s' needs a value to compare with", key);
+            return false;
+        }
+        // Compare as text, which checks for empty cells
+        spec->type = PSV_DATA_ANNOTATION_TEXT;
+        return true;
+    }
+
+    if (spec->op == PSV_WHERE_CONTAINS) {
+        spec->type = PSV_DATA_ANNOTATION_TEXT;
+        return true;
+    }
+
+    if (psv_has_data_annotation(table, spec->column, PSV_DATA_ANNOTATION_DATETIME)) {
+        spec->type = PSV_DATA_ANNOTATION_DATETIME;
+    } else if (psv_has_data_annotation(table, spec->column, PSV_DATA_ANNOTATION_UUID)) {
+        spec->type = PSV_DATA_ANNOTATION_UUID;
+    } else {
+        spec->type = psv_get_basic_type(table, spec->column);
+    }
+    switch (spec->type) {
+        case PSV_DATA_ANNOTATION_INTEGER:
+            if (!parse_integer(spec->value, &spec->integer)) {
+                snprintf(spec->error, PSV_WHERE_ERROR_MAX, "where value for '%s' is not an integer", key);
+                return false;
+            }
+            break;
+        case PSV_DATA_ANNOTATION_FLOAT:
+            if (!parse_number(spec->value, &spec->number)) {
+                snprintf(spec->error, PSV_WHERE_ERROR_MAX, "where value for '%s' is not a number", key);
+                return false;
+            }
+            break;
+        case PSV_DATA_ANNOTATION_BOOL:
+            spec->boolean = psv_data_is_true(spec->value);
+            break;
+        case PSV_DATA_ANNOTATION_DATETIME:
+            if (!psv_datetime_parse(spec->value, &spec->integer)) {
+                snprintf(spec->error, PSV_WHERE_ERROR_MAX, "where value for '%s' is not a date/time", key);
+                return false;
+            }
+            break;
+        case PSV_DATA_ANNOTATION_UUID: {
+            const char *reason = NULL;
+            if (!psv_decode_uuid(spec->value, spec->uuid, &reason)) {
+                snprintf(spec->error, PSV_WHERE_ERROR_MAX, "where value for '%s' is not a UUID", key);
+                return false;
+            }
+        } break;
+        default:
+            spec->type = PSV_DATA_ANNOTATION_TEXT;
+            break;
+    }
+
+    return true;
+}
+
+void psv_where_spec_free(PsvWhereSpec *spec) {
+    free(spec->value);
+    spec->value = NULL;
+}
+
+/**
+ * @brief Checks whether a cell satisfies a where predicate.
+ *
+ * An empty cell only equals an empty value. A cell that cannot be read as the column type
+ * (e.g. `n/a` in an [int] column) never compares equal, less or greater, so only `!=` matches it.
+ *
+ * @param spec The parsed predicate.
+ * @param cell The trimmed cell of the predicate column, or NULL if empty.
+ * @return true if the row should be kept.
+ */
+bool psv_where_match(const PsvWhereSpec *spec, const char *cell) {
+    if (cell == NULL) {
+        cell = "";
+    }
+
+    if (spec->op == PSV_WHERE_CONTAINS) {
+        return strstr(cell, spec->value) != NULL;
+    }
+
+    int comparison = 0;
+    bool comparable = true;
+    switch (spec->type) {
+        case PSV_DATA_ANNOTATION_INTEGER: {
+            int64_t value = 0;
+            comparable = parse_integer(cell, &value);
+            comparison = (value > spec->integer) - (value < spec->integer);
+        } break;
+        case PSV_DATA_ANNOTATION_FLOAT: {
+            double value = 0;
+            comparable = parse_number(cell, &value) && value == value;
+            comparison = (value > spec->number) - (value < spec->number);
+        } break;
+        case PSV_DATA_ANNOTATION_BOOL: {
+            const bool value = psv_data_is_true(cell);
+            comparable = *cell != '\0';
+            comparison = (int)value - (int)spec->boolean;
+        } break;
+        case PSV_DATA_ANNOTATION_DATETIME: {
+            int64_t value = 0;
+            comparable = psv_datetime_parse(cell, &value);
+            comparison = (value > spec->integer) - (value < spec->integer);
+        } break;
+        case PSV_DATA_ANNOTATION_UUID: {
+            // Compared on the 16 bytes, so case does not matter
+            uint8_t value[PSV_UUID_SIZE];
+            const char *reason = NULL;
+            comparable = psv_decode_uuid(cell, value, &reason);
+            comparison = comparable ? memcmp(value, spec->uuid, PSV_UUID_SIZE) : 0;
+        } break;
+        default: {
+            comparison = strcmp(cell, spec->value);
+        } break;
+    }
+
+    if (!comparable) {
+        return spec->op == PSV_WHERE_NOT_EQUAL;
+    }
+
+    switch (spec->op) {
+        case PSV_WHERE_EQUAL:         return comparison == 0;
+        case PSV_WHERE_NOT_EQUAL:     return comparison != 0;
+        case PSV_WHERE_LESS:          return comparison < 0;
+        case PSV_WHERE_LESS_EQUAL:    return comparison <= 0;
+        case PSV_WHERE_GREATER:       return comparison > 0;
+        case PSV_WHERE_GREATER_EQUAL: return comparison >= 0;
+        default:                      return false;
+    }
+}
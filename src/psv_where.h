@@ -0,0 +1,52 @@
+/**
+ * @file psv_where.h
+ * @brief Row Filter Predicate On A Single PSV Column
+ *
+ * Copyright (C) 2024-2024 Brian Khuu <contact@briankhuu.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ */
+
+#ifndef PSV_WHERE_H
+#define PSV_WHERE_H
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "psv.h"
+#include "psv_decode.h"
+
+#define PSV_WHERE_ERROR_MAX (PSV_HEADER_ID_MAX + 64)
+
+typedef enum {
+    PSV_WHERE_EQUAL,
+    PSV_WHERE_NOT_EQUAL,
+    PSV_WHERE_LESS,
+    PSV_WHERE_LESS_EQUAL,
+    PSV_WHERE_GREATER,
+    PSV_WHERE_GREATER_EQUAL,
+    PSV_WHERE_CONTAINS,
+} PsvWhereOperator;
+
+typedef struct {
+    int column;
+    PsvDataAnnotationType type;     ///< Decides integer/float/bool/datetime/uuid/text comparison
+    PsvWhereOperator op;
+    char *value;                    ///< Trimmed value to compare with (empty matches empty cells)
+
+    // Value parsed as the column type
+    int64_t integer;
+    double number;
+    bool boolean;
+    uint8_t uuid[PSV_UUID_SIZE];
+
+    char error[PSV_WHERE_ERROR_MAX];
+} PsvWhereSpec;
+
+bool psv_where_spec_parse(PsvWhereSpec *spec, PsvTable *table, const char *where);
+void psv_where_spec_free(PsvWhereSpec *spec);
+bool psv_where_match(const PsvWhereSpec *spec, const char *cell);
+
+#endif
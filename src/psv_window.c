@@ -0,0 +1,279 @@
+/**
+ * @file psv_window.c
+ * @brief Tumbling And Sliding Window Aggregation Over A [datetime] Column
+ *
+ * Copyright (C) 2024-2024 Brian Khuu <contact@briankhuu.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Windows are aligned to the Unix epoch: window k covers [k * slide, k * slide + size).
+ * With a slide equal to the size this gives tumbling windows, otherwise each row falls in
+ * up to size / slide overlapping (sliding) windows.
+ *
+ * Rows are expected to arrive roughly in time order, as in a metric log. Each window is only
+ * created once a row falls into it, and is closed (and its result rows made available) as soon
+ * as a row at or past its end arrives. So only the currently open windows are ever held in
+ * memory, each being a group by aggregation engine that holds one set of aggregate states per
+ * group. Rows that belong to an already closed window are late and are dropped.
+ */
+
+#include <string.h>
+#include <stdlib.h>
+#include <assert.h>
+
+#include "psv_window.h"
+#include "psv_datetime.h"
+
+#ifdef NDEBUG
+    #define assert(expression) ((void)0)
+#endif
+
+// Upper bound of size / slide, to keep the number of windows each row is added to sane
+#define MAX_WINDOWS_PER_ROW 10000
+
+typedef struct {
+    int64_t index;          ///< Window k, which starts at k * slide
+    bool closed;
+    PsvGroupBy *group_by;
+} PsvWindow;
+
+struct PsvWindowAggregator {
+    const PsvWindowSpec *spec;
+    const PsvAggregateSpec *aggregate_spec;
+    int num_columns;
+    size_t window_memory_budget;
+
+    // Windows that have been created but not yet fully output, in window start order.
+    // Closed windows are always ahead of open windows.
+    PsvWindow *windows;
+    size_t num_windows;
+    size_t windows_capacity;
+
+    bool any_closed;
+    int64_t last_closed_index;
+};
+
+/**
+ * @brief Parses a window specification against a table header.
+ *
+ * @param spec Pointer to the window specification to fill in.
+ * @param table Pointer to the table whose header the time column is resolved against.
+ * @param window_on Key of the time column, or NULL to use the first `[datetime]` column.
+ * @param size Window length as a duration (e.g. `5m`).
+ * @param slide Distance between window starts as a duration, or NULL for tumbling windows.
+ * @return true on success. On failure false is returned and spec->error describes the problem.
+ */
+bool psv_window_spec_parse(PsvWindowSpec *spec, PsvTable *table, const char *window_on, const char *size, const char *slide) {
+    *spec = (PsvWindowSpec){0};
+
+    if (!psv_duration_parse(size, &spec->size_ns)) {
+        snprintf(spec->error, PSV_WINDOW_ERROR_MAX, "invalid window size '%s'", size);
+        return false;
+    }
+
+    spec->slide_ns = spec->size_ns;
+    if (slide != NULL && !psv_duration_parse(slide, &spec->slide_ns)) {
+        snprintf(spec->error, PSV_WINDOW_ERROR_MAX, "invalid window slide '%s'", slide);
+        return false;
+    }
+
+    if (spec->size_ns / spec->slide_ns > MAX_WINDOWS_PER_ROW) {
+        snprintf(spec->error, PSV_WINDOW_ERROR_MAX, "window size must be at most %d times the window slide", MAX_WINDOWS_PER_ROW);
+        return false;
+    }
+
+    if (window_on != NULL) {
+        spec->time_column = psv_find_header_column(table, window_on);
+        if (spec->time_column < 0) {
+            snprintf(spec->error, PSV_WINDOW_ERROR_MAX, "window column '%s' not found", window_on);
+            return false;
+        }
+        return true;
+    }
+
+    for (int i = 0; i < table->num_headers; i++) {
+        if (psv_has_data_annotation(table, i, PSV_DATA_ANNOTATION_DATETIME)) {
+            spec->time_column = i;
+            return true;
+        }
+    }
+
+    snprintf(spec->error, PSV_WINDOW_ERROR_MAX, "no [datetime] column to window on");
+    return false;
+}
+
+/**
+ * @brief Creates the header of the table produced by a windowed aggregation.
+ *
+ * This is the aggregation result table (see psv_aggregate_create_result_table()) with
+ * `window_start [datetime]` and `window_end [datetime]` columns in front.
+ *
+ * @param table Pointer to the source table.
+ * @param aggregate_spec Pointer to the aggregate specification.
+ * @return A newly allocated header only PsvTable (free with psv_free_table()).
+ */
+PsvTable *psv_window_create_result_table(PsvTable *table, const PsvAggregateSpec *aggregate_spec) {
+    static const char *const window_headers[] = {"window_start [datetime]", "window_end [datetime]"};
+    return psv_aggregate_create_result_table(table, aggregate_spec, window_headers, 2);
+}
+
+PsvWindowAggregator *psv_window_create(const PsvWindowSpec *spec, const PsvAggregateSpec *aggregate_spec, int num_columns, size_t memory_budget) {
+    PsvWindowAggregator *window = calloc(1, sizeof(PsvWindowAggregator));
+    assert(window != NULL);
+    window->spec = spec;
+    window->aggregate_spec = aggregate_spec;
+    window->num_columns = num_columns;
+
+    // Share the budget between the windows that can be open at the same time
+    window->window_memory_budget = memory_budget / (spec->size_ns / spec->slide_ns + 1);
+    return window;
+}
+
+static int64_t floor_div(int64_t numerator, int64_t denominator) {
+    const int64_t quotient = numerator / denominator;
+    return (numerator % denominator != 0 && numerator < 0) ? quotient - 1 : quotient;
+}
+
+// Find the open window k, creating it in start order if no row has fallen into it yet
+static PsvWindow *get_window(PsvWindowAggregator *window, int64_t index) {
+    size_t position = window->num_windows;
+    while (position > 0 && !window->windows[position - 1].closed && window->windows[position - 1].index >= index) {
+        if (window->windows[position - 1].index == index) {
+            return &window->windows[position - 1];
+        }
+        position--;
+    }
+
+    if (window->num_windows == window->windows_capacity) {
+        window->windows_capacity = window->windows_capacity ? window->windows_capacity * 2 : 16;
+        window->windows = realloc(window->windows, window->windows_capacity * sizeof(PsvWindow));
+        assert(window->windows != NULL);
+    }
+
+    memmove(&window->windows[position + 1], &window->windows[position], (window->num_windows - position) * sizeof(PsvWindow));
+    window->num_windows++;
+    window->windows[position] = (PsvWindow){
+        .index = index,
+        .group_by = psv_group_by_create(window->aggregate_spec, window->num_columns, window->window_memory_budget),
+    };
+    return &window->windows[position];
+}
+
+static void close_window(PsvWindowAggregator *window, PsvWindow *closing) {
+    closing->closed = true;
+    if (!window->any_closed || closing->index > window->last_closed_index) {
+        window->last_closed_index = closing->index;
+    }
+    window->any_closed = true;
+}
+
+/**
+ * @brief Folds a row into every window its timestamp falls in.
+ *
+ * Windows that end at or before the row's timestamp are closed, after which their result rows
+ * can be read with psv_window_next_row().
+ *
+ * @param window Pointer to the window aggregator.
+ * @param data_row The data row. It is not retained.
+ * @return Whether the row was added, or why it was dropped.
+ */
+PsvWindowRowStatus psv_window_add_row(PsvWindowAggregator *window, PsvDataRow data_row) {
+    const PsvWindowSpec *spec = window->spec;
+
+    int64_t time_ns;
+    const char *time_cell = data_row[spec->time_column];
+    if (time_cell == NULL || !psv_datetime_parse(time_cell, &time_ns)) {
+        return PSV_WINDOW_ROW_INVALID_TIME;
+    }
+
+    // Windows k with k * slide <= time < k * slide + size
+    const int64_t first_index = floor_div(time_ns - spec->size_ns, spec->slide_ns) + 1;
+    const int64_t last_index = floor_div(time_ns, spec->slide_ns);
+    if (window->any_closed && first_index <= window->last_closed_index) {
+        return PSV_WINDOW_ROW_LATE;
+    }
+
+    // Time has moved past the end of these windows
+    for (size_t i = 0; i < window->num_windows && window->windows[i].index < first_index; i++) {
+        if (!window->windows[i].closed) {
+            close_window(window, &window->windows[i]);
+        }
+    }
+
+    for (int64_t index = first_index; index <= last_index; index++) {
+        psv_group_by_add_row(get_window(window, index)->group_by, data_row);
+    }
+
+    return PSV_WINDOW_ROW_ADDED;
+}
+
+/**
+ * @brief Closes all remaining windows once the end of the table is reached.
+ *
+ * @param window Pointer to the window aggregator.
+ */
+void psv_window_finish(PsvWindowAggregator *window) {
+    for (size_t i = 0; i < window->num_windows; i++) {
+        if (!window->windows[i].closed) {
+            close_window(window, &window->windows[i]);
+        }
+    }
+}
+
+/**
+ * @brief Returns the next result row of the closed windows.
+ *
+ * Result rows are returned in window start order, and within a window in group first seen order.
+ *
+ * @param window Pointer to the window aggregator.
+ * @return A newly allocated result row laid out as described by psv_window_create_result_table()
+ *         (free with psv_parse_table_free_row() on the result table), or NULL when no closed
+ *         window has any rows left.
+ */
+PsvDataRow psv_window_next_row(PsvWindowAggregator *window) {
+    const PsvAggregateSpec *aggregate_spec = window->aggregate_spec;
+    const int num_group_cells = aggregate_spec->num_group_columns + aggregate_spec->num_aggregates;
+
+    while (window->num_windows > 0 && window->windows[0].closed) {
+        PsvWindow *front = &window->windows[0];
+        PsvDataRow group_row = psv_group_by_next_row(front->group_by);
+        if (group_row != NULL) {
+            PsvDataRow result_row = malloc((2 + num_group_cells) * sizeof(PsvDataField));
+            assert(result_row != NULL);
+
+            char time_string[PSV_DATETIME_STRING_MAX];
+            const int64_t start_ns = front->index * window->spec->slide_ns;
+            psv_datetime_format(start_ns, time_string, sizeof(time_string));
+            result_row[0] = strdup(time_string);
+            psv_datetime_format(start_ns + window->spec->size_ns, time_string, sizeof(time_string));
+            result_row[1] = strdup(time_string);
+            memcpy(result_row + 2, group_row, num_group_cells * sizeof(PsvDataField));
+            free(group_row);
+            return result_row;
+        }
+
+        // Window fully output
+        psv_group_by_free(&front->group_by);
+        memmove(&window->windows[0], &window->windows[1], (window->num_windows - 1) * sizeof(PsvWindow));
+        window->num_windows--;
+    }
+
+    return NULL;
+}
+
+void psv_window_free(PsvWindowAggregator **window_ptr) {
+    PsvWindowAggregator *window = *window_ptr;
+    if (window == NULL) {
+        return;
+    }
+
+    for (size_t i = 0; i < window->num_windows; i++) {
+        psv_group_by_free(&window->windows[i].group_by);
+    }
+    free(window->windows);
+    free(window);
+    *window_ptr = NULL;
+}
@@ -0,0 +1,48 @@
+/**
+ * @file psv_window.h
+ * @brief Tumbling And Sliding Window Aggregation Over A [datetime] Column
+ *
+ * Copyright (C) 2024-2024 Brian Khuu <contact@briankhuu.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ */
+
+#ifndef PSV_WINDOW_H
+#define PSV_WINDOW_H
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "psv.h"
+#include "psv_aggregate.h"
+
+#define PSV_WINDOW_ERROR_MAX (PSV_HEADER_ID_MAX + 64)
+
+typedef struct {
+    int time_column;
+    int64_t size_ns;    ///< Length of each window
+    int64_t slide_ns;   ///< Distance between window starts (equal to size_ns for tumbling windows)
+
+    char error[PSV_WINDOW_ERROR_MAX];
+} PsvWindowSpec;
+
+typedef enum {
+    PSV_WINDOW_ROW_ADDED,
+    PSV_WINDOW_ROW_LATE,            ///< Dropped as a window it belongs to was already closed
+    PSV_WINDOW_ROW_INVALID_TIME,    ///< Dropped as the time cell is empty or not an ISO 8601 date/time
+} PsvWindowRowStatus;
+
+bool psv_window_spec_parse(PsvWindowSpec *spec, PsvTable *table, const char *window_on, const char *size, const char *slide);
+PsvTable *psv_window_create_result_table(PsvTable *table, const PsvAggregateSpec *aggregate_spec);
+
+typedef struct PsvWindowAggregator PsvWindowAggregator;
+
+PsvWindowAggregator *psv_window_create(const PsvWindowSpec *spec, const PsvAggregateSpec *aggregate_spec, int num_columns, size_t memory_budget);
+PsvWindowRowStatus psv_window_add_row(PsvWindowAggregator *window, PsvDataRow data_row);
+void psv_window_finish(PsvWindowAggregator *window);
+PsvDataRow psv_window_next_row(PsvWindowAggregator *window);
+void psv_window_free(PsvWindowAggregator **window_ptr);
+
+#endif
@@ -0,0 +1,160 @@
+/**
+ * @file psv_writer.c
+ * @brief Output Format Selection And Table Writing
+ *
+ * Copyright (C) 2024-2024 Brian Khuu <contact@briankhuu.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Every mode writes its tables through a PsvTableWriter, which passes each row on to the writer
+ * of the selected output format:
+ *
+ * - json: psv_json.c, as table objects, row arrays, one row per line or columns.
+ * - cbor and cbor-packed: psv_cbor.c, the same shapes as CBOR data items.
+ * - arrow: psv_arrow.c, an Arrow IPC stream per table.
+ * - parquet: psv_parquet.c, a Parquet file of a single table.
+ * - npy: psv_npy.c, a .npy file per numeric column of a single table.
+ *
+ * The options are read when a table is begun, so each writer keeps no global state.
+ */
+
+#include <string.h>
+#include <stdlib.h>
+
+#include "psv_writer.h"
+
+/**
+ * @brief Parses the name of an output format (json, cbor, cbor-packed, arrow or parquet).
+ *
+ * @param name The format name.
+ * @param format Set to the parsed format.
+ * @return true if the name is known, false otherwise.
+ */
+bool psv_output_format_parse(const char *name, PsvOutputFormat *format) {
+    if (strcmp(name, "json") == 0) {
+        *format = PSV_OUTPUT_JSON;
+    } else if (strcmp(name, "cbor") == 0) {
+        *format = PSV_OUTPUT_CBOR;
+    } else if (strcmp(name, "cbor-packed") == 0) {
+        *format = PSV_OUTPUT_CBOR_PACKED;
+    } else if (strcmp(name, "arrow") == 0) {
+        *format = PSV_OUTPUT_ARROW;
+    } else if (strcmp(name, "parquet") == 0) {
+        *format = PSV_OUTPUT_PARQUET;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Writes a JSON value built by a mode other than table output (such as --schema or --profile).
+ *
+ * The value is written as a line of JSON, or as one CBOR data item in CBOR format. Packed CBOR
+ * writes each item in its own stringref namespace.
+ *
+ * @param options The output options.
+ * @param output The output stream.
+ * @param item The value to write.
+ */
+void psv_writer_write_item(const PsvWriterOptions *options, FILE *output, const cJSON *item) {
+    if (options->format == PSV_OUTPUT_CBOR || options->format == PSV_OUTPUT_CBOR_PACKED) {
+        static PsvCborEncoder encoder = {0};
+        encoder.packed = (options->format == PSV_OUTPUT_CBOR_PACKED);
+        psv_cbor_encode_namespace(&encoder);
+        psv_cbor_encode_json(&encoder, item);
+        psv_cbor_encoder_flush(&encoder, output);
+        return;
+    }
+
+    char *json_string = cJSON_PrintUnformatted(item);
+    fprintf(output, "%s\n", json_string);
+    free(json_string);
+}
+
+/**
+ * @brief Starts writing a table in the output format of the options.
+ *
+ * Processing modes produce rows incrementally (e.g. aggregation or sorting), so rows are passed
+ * to the writer one at a time and neither the full table nor a cJSON tree of it is held.
+ *
+ * @param writer The writer to initialise.
+ * @param options The output options, which must outlive the writer.
+ * @param output The output stream (unused by .npy output, which writes files of its own).
+ * @param table The table whose rows will be written.
+ * @param compact_mode Write only the rows, without the header metadata.
+ * @param streaming_rows Write each row as its own line or data item.
+ */
+void psv_table_writer_begin(PsvTableWriter *writer, const PsvWriterOptions *options, FILE *output, PsvTable *table, bool compact_mode, bool streaming_rows) {
+    *writer = (PsvTableWriter){0};
+    writer->format = options->format;
+
+    switch (writer->format) {
+        case PSV_OUTPUT_CBOR:
+        case PSV_OUTPUT_CBOR_PACKED:
+            psv_cbor_writer_begin(&writer->cbor, options, output, table, compact_mode, streaming_rows);
+            break;
+        case PSV_OUTPUT_ARROW:
+            psv_arrow_writer_begin(&writer->arrow, output, table, options->batch_size);
+            break;
+        case PSV_OUTPUT_PARQUET:
+            psv_parquet_writer_begin(&writer->parquet, output, table, options->row_group_budget);
+            break;
+        case PSV_OUTPUT_NPY:
+            psv_npy_writer_begin(&writer->npy, options->npy_directory, table);
+            break;
+        default:
+            psv_json_writer_begin(&writer->json, options, output, table, compact_mode, streaming_rows);
+            break;
+    }
+}
+
+void psv_table_writer_write_row(PsvTableWriter *writer, PsvDataRow data_row) {
+    switch (writer->format) {
+        case PSV_OUTPUT_CBOR:
+        case PSV_OUTPUT_CBOR_PACKED:
+            psv_cbor_writer_write_row(&writer->cbor, data_row);
+            break;
+        case PSV_OUTPUT_ARROW:
+            psv_arrow_writer_write_row(&writer->arrow, data_row);
+            break;
+        case PSV_OUTPUT_PARQUET:
+            psv_parquet_writer_write_row(&writer->parquet, data_row);
+            break;
+        case PSV_OUTPUT_NPY:
+            psv_npy_writer_write_row(&writer->npy, data_row);
+            break;
+        default:
+            psv_json_writer_write_row(&writer->json, data_row);
+            break;
+    }
+}
+
+/**
+ * @brief Finishes the table, writing anything the format holds back until the last row, and frees the writer.
+ *
+ * @param writer The writer.
+ */
+void psv_table_writer_end(PsvTableWriter *writer) {
+    switch (writer->format) {
+        case PSV_OUTPUT_CBOR:
+        case PSV_OUTPUT_CBOR_PACKED:
+            psv_cbor_writer_end(&writer->cbor);
+            break;
+        case PSV_OUTPUT_ARROW:
+            psv_arrow_writer_end(&writer->arrow);
+            break;
+        case PSV_OUTPUT_PARQUET:
+            psv_parquet_writer_end(&writer->parquet);
+            break;
+        case PSV_OUTPUT_NPY:
+            psv_npy_writer_end(&writer->npy);
+            break;
+        default:
+            psv_json_writer_end(&writer->json);
+            break;
+    }
+}
@@ -0,0 +1,79 @@
+/**
+ * @file psv_writer.h
+ * @brief Output Format Selection And Table Writing
+ *
+ * Copyright (C) 2024-2024 Brian Khuu <contact@briankhuu.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ */
+
+#ifndef PSV_WRITER_H
+#define PSV_WRITER_H
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+
+#include "psv.h"
+#include "cJSON.h"
+#include "psv_decode.h"
+#include "psv_datetime.h"
+#include "psv_json.h"
+#include "psv_cbor.h"
+#include "psv_arrow.h"
+#include "psv_parquet.h"
+#include "psv_npy.h"
+
+// Output format of tables and of the JSON built by other modes
+typedef enum {
+    PSV_OUTPUT_JSON = 0,    ///< One JSON value per line
+    PSV_OUTPUT_CBOR,        ///< RFC 8742 CBOR sequence
+    PSV_OUTPUT_CBOR_PACKED, ///< CBOR sequence with repeated strings and values written as references
+    PSV_OUTPUT_ARROW,       ///< Arrow IPC stream per table (table rows only)
+    PSV_OUTPUT_PARQUET,     ///< Parquet file of a single table (table rows only)
+    PSV_OUTPUT_NPY,         ///< .npy file per numeric column of a single table (table rows only)
+} PsvOutputFormat;
+
+// How output is written, passed to each writer rather than kept as global state
+typedef struct PsvWriterOptions {
+    PsvOutputFormat format;
+    bool columnar;                          ///< Each table's columns instead of its rows (JSON and CBOR)
+    bool rows_as_arrays;                    ///< JSON rows as arrays of their cells in column order
+    bool row_table_tags;                    ///< Streamed JSON rows start with a PSV_JSON_TABLE_KEY entry
+    PsvBinaryEncoding binary_encoding;      ///< How JSON writes binary cells
+    PsvDatetimeEncoding datetime_encoding;  ///< How JSON and CBOR write [datetime] cells
+    size_t batch_size;                      ///< Most rows per Arrow record batch
+    size_t row_group_budget;                ///< Buffered bytes at which Parquet writes a row group
+    const char *npy_directory;              ///< Existing directory that .npy output writes into
+} PsvWriterOptions;
+
+#define PSV_WRITER_OPTIONS_DEFAULT { \
+    .format = PSV_OUTPUT_JSON, \
+    .binary_encoding = PSV_BINARY_AS_TEXT, \
+    .datetime_encoding = PSV_DATETIME_AS_TEXT, \
+    .batch_size = PSV_ARROW_DEFAULT_BATCH_SIZE, \
+    .row_group_budget = PSV_PARQUET_DEFAULT_ROW_GROUP_BUDGET, \
+}
+
+// Writes a table one row at a time through the backend of the selected output format
+typedef struct {
+    PsvOutputFormat format;
+    union {
+        PsvJsonWriter json;
+        PsvCborWriter cbor;
+        PsvArrowWriter arrow;
+        PsvParquetWriter parquet;
+        PsvNpyWriter npy;
+    };
+} PsvTableWriter;
+
+bool psv_output_format_parse(const char *name, PsvOutputFormat *format);
+void psv_writer_write_item(const PsvWriterOptions *options, FILE *output, const cJSON *item);
+
+void psv_table_writer_begin(PsvTableWriter *writer, const PsvWriterOptions *options, FILE *output, PsvTable *table, bool compact_mode, bool streaming_rows);
+void psv_table_writer_write_row(PsvTableWriter *writer, PsvDataRow data_row);
+void psv_table_writer_end(PsvTableWriter *writer);
+
+#endif
@@ -0,0 +1,53 @@
+#!/bin/bash
+# --format arrow golden bytes: Arrow IPC streams of a schema, record batches and the end of stream marker
+. "$(dirname "$0")/common.sh"
+
+printf '| n [int] | s |\n|---|---|\n| 1 | a |\n| | bc |\n' > "$TEST_TMPDIR/table.psv"
+
+# Schema {n: int64, s: utf8} with metadata id=table1, one record batch, then 0xffffffff 0x00000000.
+# Checked with pyarrow: [{"n": 1, "s": "a"}, {"n": None, "s": "bc"}]
+expected="$(tr -d '\n' <<'HEX'
+ffffffff08010000100000000c00170014001600100008000c00000000000000
+000000000000000018000000040001000a000e000c0004000800000000000000
+100000000c0000009800000000000000020000001c0000006000000010001200
+040010001100080000000c000000000014000000100000002000000028000000
+01020000010000006e0008000900040008000000000000000e00000040000000
+010000000000000010001200040010001100080000000c001000000010000000
+1800000018000000010500000100000073000400040000000600000000000000
+010000000c00000008000c000400080008000000080000000c00000002000000
+69640000060000007461626c65310000ffffffffd0000000100000000c001700
+14001600100008000c0000000000000030000000000000001800000004000300
+0a00180008001000140000000000000010000000000000000200000000000000
+0c00000030000000000000000200000002000000000000000100000000000000
+0200000000000000000000000000000000000000050000000000000000000000
+0100000000000000080000000000000010000000000000001800000000000000
+000000000000000018000000000000000c000000000000002800000000000000
+0300000000000000010000000000000001000000000000000000000000000000
+000000000100000003000000000000006162630000000000ffffffff00000000
+HEX
+)"
+
+"$PSV" --format arrow "$TEST_TMPDIR/table.psv" > "$TEST_TMPDIR/table.arrow"
+expect_output "a table is one Arrow IPC stream" "$expected" "$(hex_dump "$TEST_TMPDIR/table.arrow")"
+
+# Cells that are not valid for their column's type are null, like empty cells
+printf '| n [int] | s |\n|---|---|\n| 1 | a |\n| x | bc |\n' > "$TEST_TMPDIR/invalid.psv"
+"$PSV" --format arrow "$TEST_TMPDIR/invalid.psv" > "$TEST_TMPDIR/invalid.arrow"
+expect_output "invalid cells are written as nulls" "$expected" "$(hex_dump "$TEST_TMPDIR/invalid.arrow")"
+
+# Count the messages by their 0xffffffff continuation markers
+messages() {
+    hex_dump "$1" | fold -w 8 | grep -c ffffffff
+}
+
+"$PSV" --format arrow --batch-size 1 "$TEST_TMPDIR/table.psv" > "$TEST_TMPDIR/batches.arrow"
+expect_output "--batch-size 1 writes a record batch per row" "4" "$(messages "$TEST_TMPDIR/batches.arrow")"
+expect_output "the stream ends with the end of stream marker" "ffffffff00000000" "$(hex_dump "$TEST_TMPDIR/batches.arrow" | tail -c 16)"
+
+"$PSV" --format arrow "$TEST_TMPDIR/table.psv" "$TEST_TMPDIR/table.psv" > "$TEST_TMPDIR/two.arrow"
+expect_output "each table is its own stream" "6" "$(messages "$TEST_TMPDIR/two.arrow")"
+
+run_psv --format arrow --batch-size 0 "$TEST_TMPDIR/table.psv"
+expect_status "--batch-size must be positive" 1
+
+finish
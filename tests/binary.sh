@@ -0,0 +1,65 @@
+#!/bin/bash
+# --binary-as decodes [hex], [base64] and [dataURI] cells strictly and re-encodes them in one encoding
+. "$(dirname "$0")/common.sh"
+
+cat > "$TEST_TMPDIR/table.psv" <<'PSV'
+| h [hex] | b [base64] | u [dataURI] |
+|---|---|---|
+| 0x48690a | SGkK | data:text/plain;base64,SGkK |
+| 48 69 | SGk= | data:,Hi%20there |
+| 0xZZ | SGk | data:nope |
+| | | |
+| 0xfbffbf | -_-_ | data:;base64,+/+/ |
+| FBFFBF | +/-_ | data:,%zz |
+PSV
+
+run_psv -c "$TEST_TMPDIR/table.psv"
+expect_output "cells are output as written by default" \
+'{"h":"0x48690a","b":"SGkK","u":"data:text/plain;base64,SGkK"}
+{"h":"48 69","b":"SGk=","u":"data:,Hi%20there"}
+{"h":"0xZZ","b":"SGk","u":"data:nope"}
+{"h":null,"b":null,"u":null}
+{"h":"0xfbffbf","b":"-_-_","u":"data:;base64,+/+/"}
+{"h":"FBFFBF","b":"+/-_","u":"data:,%zz"}' "$(echo "$output" | json_rows)"
+
+# Cells that fail to decode (spaces in hex, bad digits, mixed base64 alphabets, bad escapes) are unchanged
+run_psv -c --binary-as hex "$TEST_TMPDIR/table.psv"
+expect_output "--binary-as hex" \
+'{"h":"48690a","b":"48690a","u":"48690a"}
+{"h":"48 69","b":"4869","u":"4869207468657265"}
+{"h":"0xZZ","b":"4869","u":"data:nope"}
+{"h":null,"b":null,"u":null}
+{"h":"fbffbf","b":"fbffbf","u":"fbffbf"}
+{"h":"fbffbf","b":"+/-_","u":"data:,%zz"}' "$(echo "$output" | json_rows)"
+
+run_psv -c --binary-as base64 "$TEST_TMPDIR/table.psv"
+expect_output "--binary-as base64 is padded with the standard alphabet" \
+'{"h":"SGkK","b":"SGkK","u":"SGkK"}
+{"h":"48 69","b":"SGk=","u":"SGkgdGhlcmU="}
+{"h":"0xZZ","b":"SGk=","u":"data:nope"}
+{"h":null,"b":null,"u":null}
+{"h":"+/+/","b":"+/+/","u":"+/+/"}
+{"h":"+/+/","b":"+/-_","u":"data:,%zz"}' "$(echo "$output" | json_rows)"
+
+run_psv -c --binary-as base64url "$TEST_TMPDIR/table.psv"
+expect_output "--binary-as base64url is unpadded with the URL safe alphabet" \
+'{"h":"SGkK","b":"SGkK","u":"SGkK"}
+{"h":"48 69","b":"SGk","u":"SGkgdGhlcmU"}
+{"h":"0xZZ","b":"SGk","u":"data:nope"}
+{"h":null,"b":null,"u":null}
+{"h":"-_-_","b":"-_-_","u":"-_-_"}
+{"h":"-_-_","b":"+/-_","u":"data:,%zz"}' "$(echo "$output" | json_rows)"
+
+run_psv --validate "$TEST_TMPDIR/table.psv"
+expect_status "cells that fail to decode are invalid" 1
+expect_output "--validate reports each undecodable cell" \
+"table1: row 2, column 1 'h' (byte 105): not hexadecimal: '48 69'
+table1: row 3, column 1 'h' (byte 141): not hexadecimal: '0xZZ'
+table1: row 3, column 3 'u' (byte 154): not a data URI: 'data:nope'
+table1: row 6, column 2 'b' (byte 225): not base64: '+/-_'
+table1: row 6, column 3 'u' (byte 232): bad percent escape in data URI: 'data:,%zz'" "$output"
+
+run_psv -c --binary-as base32 "$TEST_TMPDIR/table.psv"
+expect_status "an unknown --binary-as encoding is rejected" 1
+
+finish
@@ -0,0 +1,43 @@
+#!/bin/bash
+# --format cbor golden bytes: typed cells, byte strings, tag 24 items and RFC 8742 sequences
+. "$(dirname "$0")/common.sh"
+
+cat > "$TEST_TMPDIR/table.psv" <<'PSV'
+| i [int] | f [float] | b [bool] | s | h [hex] | c [hex][cbor] |
+|---|---|---|---|---|---|
+| 1 | 1.5 | true | hi | 0x0102 | a16161f5 |
+| -500 | 0.1 | false | | ff | 62c328 |
+PSV
+
+# {"i": 1, "f": 1.5 (single precision, lossless), "b": true, "s": "hi", "h": h'0102', "c": 24(h'a16161f5')}
+row1="a6616901""6166fa3fc00000""6162f5""6173626869""6168420102""6163d81844a16161f5"
+# {"i": -500, "f": 0.1 (double), "b": false, "s": null, "h": h'ff', "c": "62c328" (not valid UTF-8 inside)}
+row2="a66169""3901f3""6166fb3fb999999999999a""6162f4""6173f6""616841ff""616366363263333238"
+
+"$PSV" -c --format cbor "$TEST_TMPDIR/table.psv" > "$TEST_TMPDIR/compact.cbor"
+expect_output "--compact writes an indefinite array of row maps" \
+    "9f${row1}${row2}ff" "$(hex_dump "$TEST_TMPDIR/compact.cbor")"
+
+"$PSV" -c --format cbor --id table1 "$TEST_TMPDIR/table.psv" > "$TEST_TMPDIR/rows.cbor"
+expect_output "a single streamed table writes one data item per row" \
+    "${row1}${row2}" "$(hex_dump "$TEST_TMPDIR/rows.cbor")"
+
+"$PSV" --format cbor "$TEST_TMPDIR/table.psv" > "$TEST_TMPDIR/table.cbor"
+# {"id": "table1", "headers": [...], "keys": [...], "data_annotation": [...], "rows": [_ row1, row2]}
+metadata="a5""626964667461626c6531"\
+"6768656164657273866769205b696e745d6966205b666c6f61745d6862205b626f6f6c5d61736768205b6865785d6d63205b6865785d5b63626f725d"\
+"646b65797386616961666162617361686163"\
+"6f646174615f616e6e6f746174696f6e868163696e748165666c6f61748164626f6f6c80816368657882636865786463626f72"
+expect_output "a full table is a map of its header metadata and rows" \
+    "${metadata}64726f77739f${row1}${row2}ff" "$(hex_dump "$TEST_TMPDIR/table.cbor")"
+
+# Modes that print JSON values print the same values as CBOR items
+"$PSV" --format cbor --count "$TEST_TMPDIR/table.psv" "$TEST_TMPDIR/table.psv" > "$TEST_TMPDIR/count.cbor"
+expect_output "--count writes one data item per table as a CBOR sequence" \
+    "a2626964667461626c6531686e756d5f726f777302a2626964667461626c6532686e756d5f726f777302" \
+    "$(hex_dump "$TEST_TMPDIR/count.cbor")"
+
+run_psv --format cbor2 "$TEST_TMPDIR/table.psv"
+expect_status "an unknown --format is rejected" 1
+
+finish
@@ -0,0 +1,40 @@
+#!/bin/bash
+# --columnar --format cbor golden bytes: RFC 8746 typed arrays (tags 79 and 86) with null bitmaps
+. "$(dirname "$0")/common.sh"
+
+cat > "$TEST_TMPDIR/table.psv" <<'PSV'
+| i [int] | f [float] | s |
+|---|---|---|
+| 1 | 0.5 | a |
+| | -2 | |
+| -3 | | b |
+PSV
+
+# {"columns": {"i": 79(sint64le [1, 0, -3]), "f": 86(float64le [0.5, -2.0, 0.0]), "s": ["a", null, "b"]},
+#  "nulls": {"i": h'02', "f": h'04'}}
+# Empty cells of typed columns are zero in the array, with their bit set in the null bitmap (the first row is the lowest bit)
+columns="67636f6c756d6e73""a3"\
+"6169""d84f5818""0100000000000000""0000000000000000""fdffffffffffffff"\
+"6166""d8565818""000000000000e03f""00000000000000c0""0000000000000000"\
+"6173""836161f66162"
+nulls="656e756c6c73""a2""6169""4102""6166""4104"
+
+"$PSV" -c --columnar --format cbor "$TEST_TMPDIR/table.psv" > "$TEST_TMPDIR/compact.cbor"
+expect_output "--compact writes only the columns and null bitmaps" \
+    "a2${columns}${nulls}" "$(hex_dump "$TEST_TMPDIR/compact.cbor")"
+
+"$PSV" --columnar --format cbor "$TEST_TMPDIR/table.psv" > "$TEST_TMPDIR/table.cbor"
+metadata="626964667461626c6531"\
+"6768656164657273836769205b696e745d6966205b666c6f61745d6173"\
+"646b65797383616961666173"\
+"6f646174615f616e6e6f746174696f6e838163696e748165666c6f617480"
+expect_output "a full table keeps the header metadata" \
+    "a6${metadata}${columns}${nulls}" "$(hex_dump "$TEST_TMPDIR/table.cbor")"
+
+# A typed column is written as an array of values once it meets a cell that is not a valid number
+printf '| i [int] |\n|---|\n| 1 |\n| x |\n' > "$TEST_TMPDIR/invalid.psv"
+"$PSV" -c --columnar --format cbor "$TEST_TMPDIR/invalid.psv" > "$TEST_TMPDIR/invalid.cbor"
+expect_output "an invalid cell falls back to an array of values" \
+    "a267636f6c756d6e73a1616982016178656e756c6c73a0" "$(hex_dump "$TEST_TMPDIR/invalid.cbor")"
+
+finish
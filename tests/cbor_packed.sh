@@ -0,0 +1,48 @@
+#!/bin/bash
+# --format cbor-packed golden bytes: stringref namespaces (tags 256 and 25) and shared values (tags 28 and 29)
+. "$(dirname "$0")/common.sh"
+
+cat > "$TEST_TMPDIR/table.psv" <<'PSV'
+| name | n [int] |
+|---|---|
+| alpha | 1000000 |
+| alpha | 1000000 |
+| beta | 1000000 |
+| alpha | 7 |
+PSV
+
+# 256([_ {"name": "alpha", "n": 1000000},
+#        {25(0): 25(1), "n": 28(1000000)},
+#        {25(0): "beta", "n": 29(0)},
+#        {25(0): 25(1), "n": 7}])
+# "n" is too short to be worth a reference, and 1000000 is only shared once it repeats
+expected="d90100""9f"\
+"a2""646e616d65""65616c706861""616e""1a000f4240"\
+"a2""d81900""d81901""616e""d81c1a000f4240"\
+"a2""d81900""6462657461""616e""d81d00"\
+"a2""d81900""d81901""616e""07"\
+"ff"
+
+"$PSV" -c --format cbor-packed "$TEST_TMPDIR/table.psv" > "$TEST_TMPDIR/compact.cbor"
+expect_output "repeated strings and values are written as references" \
+    "$expected" "$(hex_dump "$TEST_TMPDIR/compact.cbor")"
+
+# References cannot cross the items of a sequence, so streamed rows stay in one array per table
+"$PSV" -c --format cbor-packed --id table1 "$TEST_TMPDIR/table.psv" > "$TEST_TMPDIR/rows.cbor"
+expect_output "a single streamed table is one namespace" \
+    "$expected" "$(hex_dump "$TEST_TMPDIR/rows.cbor")"
+
+# 256({"id": "table1", "num_rows": 4}) per table, each item starting a new namespace
+"$PSV" --format cbor-packed --count "$TEST_TMPDIR/table.psv" "$TEST_TMPDIR/table.psv" > "$TEST_TMPDIR/count.cbor"
+expect_output "each item of a sequence has its own namespace" \
+    "d90100a2626964667461626c6531686e756d5f726f777304d90100a2626964667461626c6532686e756d5f726f777304" \
+    "$(hex_dump "$TEST_TMPDIR/count.cbor")"
+
+"$PSV" -c --format cbor "$TEST_TMPDIR/table.psv" > "$TEST_TMPDIR/plain.cbor"
+if [ "$(wc -c < "$TEST_TMPDIR/compact.cbor")" -lt "$(wc -c < "$TEST_TMPDIR/plain.cbor")" ]; then
+    pass "packed output is smaller than plain CBOR"
+else
+    fail "packed output is smaller than plain CBOR"
+fi
+
+finish
@@ -0,0 +1,47 @@
+#!/bin/bash
+# --columnar JSON output: each table's columns instead of its rows, after any row mode
+. "$(dirname "$0")/common.sh"
+
+cat > "$TEST_TMPDIR/tables.psv" <<'PSV'
+| n [int] | s | b [bool] |
+|---|---|---|
+| 1 | a | yes |
+| x | | no |
+
+| k |
+|---|
+| z |
+PSV
+
+run_psv --columnar "$TEST_TMPDIR/tables.psv"
+expect_output "each table's rows are replaced by its columns" \
+'{"id":"table1","headers":["n [int]","s","b [bool]"],"keys":["n","s","b"],"data_annotation":[["int"],[],["bool"]],"columns":{"n":[1,"x"],"s":["a",null],"b":[true,false]}}
+{"id":"table2","headers":["k"],"keys":["k"],"data_annotation":[[]],"columns":{"k":["z"]}}' "$output"
+
+run_psv -c --columnar "$TEST_TMPDIR/tables.psv"
+expect_output "--compact keeps only the columns" \
+'{"columns":{"n":[1,"x"],"s":["a",null],"b":[true,false]}}
+{"columns":{"k":["z"]}}' "$output"
+
+run_psv -c --columnar --id table1 "$TEST_TMPDIR/tables.psv"
+expect_output "a single streamed table is still gathered into columns" \
+'{"columns":{"n":[1,"x"],"s":["a",null],"b":[true,false]}}' "$output"
+
+printf '| a | b [int] |\n|---|---|\n' > "$TEST_TMPDIR/empty.psv"
+run_psv -c --columnar "$TEST_TMPDIR/empty.psv"
+expect_output "a table without rows has empty columns" '{"columns":{"a":[],"b":[]}}' "$output"
+
+printf '| a | b [int] |\n|---|---|\n| x | 2 |\n| y | 1 |\n| x | 3 |\n' > "$TEST_TMPDIR/modes.psv"
+run_psv -c --columnar --sort-by b "$TEST_TMPDIR/modes.psv"
+expect_output "columns follow --sort-by order" '{"columns":{"a":["y","x","x"],"b":[1,2,3]}}' "$output"
+
+run_psv -c --columnar --distinct-on a "$TEST_TMPDIR/modes.psv"
+expect_output "columns hold only --distinct-on rows" '{"columns":{"a":["x","y"],"b":[2,1]}}' "$output"
+
+run_psv -c --columnar --group-by a --agg 'sum(b)' "$TEST_TMPDIR/modes.psv"
+expect_output "aggregate results are written as columns" '{"columns":{"a":["x","y"],"sum_b":[5,1]}}' "$output"
+
+run_psv --columnar --format arrow "$TEST_TMPDIR/modes.psv"
+expect_status "--columnar is rejected for formats that are already columnar" 1
+
+finish
@@ -0,0 +1,79 @@
+#!/bin/bash
+# Shared helpers for the psv command line tests
+#
+# Each test script sources this file, runs psv with `run_psv` and checks the result with
+# `expect_output` / `expect_status`, then calls `finish` to report and set the exit status.
+# PSV and TESTS_SRCDIR are set by `make check`; outside of it they default to the source tree.
+set -uo pipefail
+
+PSV=${PSV:-$(dirname "$0")/../psv}
+TESTS_SRCDIR=${TESTS_SRCDIR:-$(dirname "$0")}
+TEST_TMPDIR=$(mktemp -d)
+trap 'rm -rf "$TEST_TMPDIR"' EXIT
+
+failures=0
+status=0
+
+# Run psv, keeping its stdout in $output, its stderr in $errors and its exit status in $status
+run_psv() {
+    output=$("$PSV" "$@" 2>"$TEST_TMPDIR/stderr")
+    status=$?
+    errors=$(cat "$TEST_TMPDIR/stderr")
+}
+
+pass() {
+    echo "ok - $1"
+}
+
+fail() {
+    echo "FAIL - $1"
+    failures=$((failures + 1))
+}
+
+# expect_output <name> <expected> <actual>
+expect_output() {
+    if [ "$2" == "$3" ]; then
+        pass "$1"
+    else
+        fail "$1"
+        diff <(echo "$2") <(echo "$3") | head -20
+    fi
+}
+
+# expect_status <name> <expected exit status>
+expect_status() {
+    if [ "$status" -eq "$2" ]; then
+        pass "$1"
+    else
+        fail "$1 (exit status $status, expected $2)"
+        echo "$errors" | head -5
+    fi
+}
+
+# expect_contains <name> <needle> <haystack>
+expect_contains() {
+    if [[ "$3" == *"$2"* ]]; then
+        pass "$1"
+    else
+        fail "$1 (missing '$2')"
+        echo "$3" | head -5
+    fi
+}
+
+# Split compact JSON rows onto one line each, so row sets can be compared with sort
+json_rows() {
+    sed -e 's/^\[//' -e 's/\]$//' -e 's/},{/}\n{/g'
+}
+
+# Hex dump of a file, for comparing binary output against golden bytes
+hex_dump() {
+    od -An -v -tx1 "$1" | tr -d ' \n'
+}
+
+finish() {
+    if [ "$failures" -ne 0 ]; then
+        echo "$failures test(s) failed"
+        exit 1
+    fi
+    exit 0
+}
@@ -0,0 +1,67 @@
+#!/bin/bash
+# --count row counts, filtered by --where predicates compared as each column's type
+. "$(dirname "$0")/common.sh"
+
+cat > "$TEST_TMPDIR/people.psv" <<'PSV'
+{#people}
+| name | age [int] | score [float] | ok [bool] | at [datetime] |
+|---|---|---|---|---|
+| Alice | 30 | 1.5 | yes | 2024-01-01T00:00:00Z |
+| Bob | 9 | 10 | no | 2024-01-01T10:00:00+10:00 |
+| alicia | | 2.5e1 | y | 2023-12-31 |
+| Carl | 100 | x | | |
+
+{#other}
+| a |
+|---|
+| 1 |
+PSV
+
+run_psv --count "$TEST_TMPDIR/people.psv"
+expect_status "--count exit status" 0
+expect_output "one count per table" \
+'{"id":"people","num_rows":4}
+{"id":"other","num_rows":1}' "$output"
+
+while IFS='|' read -r predicate expected; do
+    run_psv --count --id people --where "$predicate" "$TEST_TMPDIR/people.psv"
+    expect_output "--where '$predicate' counts $expected" "{\"id\":\"people\",\"num_rows\":$expected}" "$output"
+done <<'PREDICATES'
+age>10|2
+age<=9|1
+age=|1
+age!=30|3
+score>=10|2
+score<2e1|2
+ok=true|2
+ok=no|1
+name~lic|2
+name<B|1
+name=Bob|1
+at<2024-01-01|1
+at=2024-01-01T00:00:00Z|2
+at>=2024-01-01T09:00:00+10:00|2
+PREDICATES
+
+run_psv --count --id people --where "nope=1" "$TEST_TMPDIR/people.psv"
+expect_output "a table without the --where column is skipped" "" "$output"
+expect_contains "the missing column is reported" "where column 'nope' not found" "$errors"
+
+run_psv --count --id people --where "age>abc" "$TEST_TMPDIR/people.psv"
+expect_contains "a value of the wrong type is reported" "where value for 'age' is not an integer" "$errors"
+
+run_psv --count --id people --where "age" "$TEST_TMPDIR/people.psv"
+expect_status "a --where without an operator is rejected" 1
+
+run_psv -c --where "age>10" "$TEST_TMPDIR/people.psv"
+expect_status "--where needs --count" 1
+
+{
+    echo "| n [int] |"
+    echo "|---|"
+    seq 1 100000 | sed 's/.*/| & |/'
+} > "$TEST_TMPDIR/large.psv"
+run_psv --count --where "n>99000" "$TEST_TMPDIR/large.psv"
+expect_output "large table count" '{"id":"table1","num_rows":1000}' "$output"
+
+finish
@@ -0,0 +1,83 @@
+#!/bin/bash
+# --datetime-as output encodings, and [datetime] cells compared as instants by --sort-by and --where
+. "$(dirname "$0")/common.sh"
+
+cat > "$TEST_TMPDIR/table.psv" <<'PSV'
+| t [datetime] | n [int] |
+|---|---|
+| 2024-03-01T12:00:00+10:00 | 1 |
+| 2024-03-01 | 2 |
+| 2024-03-01T01:30:00.250Z | 3 |
+| not a date | 4 |
+| | 5 |
+| 2024-02-29T23:59:59-05:00 | 6 |
+PSV
+
+# Cells that are not valid date/times are output unchanged by every encoding
+run_psv -c --datetime-as iso "$TEST_TMPDIR/table.psv"
+expect_output "--datetime-as iso normalises to UTC" \
+'{"t":"2024-03-01T02:00:00Z","n":1}
+{"t":"2024-03-01T00:00:00Z","n":2}
+{"t":"2024-03-01T01:30:00.25Z","n":3}
+{"t":"not a date","n":4}
+{"t":null,"n":5}
+{"t":"2024-03-01T04:59:59Z","n":6}' "$(echo "$output" | json_rows)"
+
+run_psv -c --datetime-as epoch "$TEST_TMPDIR/table.psv"
+expect_output "--datetime-as epoch keeps fractions of a second exactly" \
+'{"t":1709258400,"n":1}
+{"t":1709251200,"n":2}
+{"t":1709256600.25,"n":3}
+{"t":"not a date","n":4}
+{"t":null,"n":5}
+{"t":1709269199,"n":6}' "$(echo "$output" | json_rows)"
+
+run_psv -c --datetime-as epoch_ms "$TEST_TMPDIR/table.psv"
+expect_output "--datetime-as epoch_ms" \
+'{"t":1709258400000,"n":1}
+{"t":1709251200000,"n":2}
+{"t":1709256600250,"n":3}
+{"t":"not a date","n":4}
+{"t":null,"n":5}
+{"t":1709269199000,"n":6}' "$(echo "$output" | json_rows)"
+
+run_psv -c --datetime-as week "$TEST_TMPDIR/table.psv"
+expect_status "an unknown --datetime-as encoding is rejected" 1
+
+# CBOR writes the cells as tag 0 strings, or as tag 1 epoch seconds (a double only when there is a fraction)
+cat > "$TEST_TMPDIR/small.psv" <<'PSV'
+| t [datetime] |
+|---|
+| 2024-03-01T12:00:00+10:00 |
+| 2024-03-01T01:30:00.250Z |
+PSV
+"$PSV" -c --format cbor "$TEST_TMPDIR/small.psv" > "$TEST_TMPDIR/text.cbor"
+expect_output "CBOR tag 0 keeps the cell as written" \
+"9fa16174c07819323032342d30332d30315431323a30303a30302b31303a3030a16174c07818323032342d30332d30315430313a33303a30302e3235305aff" \
+"$(hex_dump "$TEST_TMPDIR/text.cbor")"
+"$PSV" -c --format cbor --datetime-as epoch "$TEST_TMPDIR/small.psv" > "$TEST_TMPDIR/epoch.cbor"
+expect_output "CBOR tag 1 epoch seconds" \
+"9fa16174c11a65e136a0a16174c1fb41d9784be6100000ff" \
+"$(hex_dump "$TEST_TMPDIR/epoch.cbor")"
+
+# Ordered as instants: 00:00Z, 01:30Z, 02:00Z (12:00+10:00), 04:59:59Z (23:59:59-05:00)
+run_psv -c --sort-by t "$TEST_TMPDIR/table.psv"
+expect_output "--sort-by compares instants across UTC offsets, then empty and invalid cells" \
+"2 3 1 6 5 4" "$(echo "$output" | json_rows | sed 's/.*"n":\([0-9]*\)}/\1/' | tr '\n' ' ' | sed 's/ $//')"
+
+run_psv -c --sort-by t:desc "$TEST_TMPDIR/table.psv"
+expect_output "--sort-by :desc still puts empty and invalid cells last" \
+"6 1 3 2 5 4" "$(echo "$output" | json_rows | sed 's/.*"n":\([0-9]*\)}/\1/' | tr '\n' ' ' | sed 's/ $//')"
+
+run_psv --count --where 't>2024-03-01T01:00:00Z' "$TEST_TMPDIR/table.psv"
+expect_output "--where > compares instants" '{"id":"table1","num_rows":3}' "$output"
+
+run_psv --count --where 't<2024-03-01T03:00:00+01:00' "$TEST_TMPDIR/table.psv"
+expect_output "--where value is parsed with its own UTC offset" '{"id":"table1","num_rows":2}' "$output"
+
+run_psv --validate "$TEST_TMPDIR/table.psv"
+expect_status "invalid date/times fail --validate" 1
+expect_output "--validate reports the invalid date/time" \
+"table1: row 4, column 1 't' (byte 125): not an ISO 8601 date/time: 'not a date'" "$output"
+
+finish
@@ -0,0 +1,80 @@
+#!/bin/bash
+# Stacked data annotations decoded through per-column pipelines, including strict [cbor] items
+. "$(dirname "$0")/common.sh"
+
+cat > "$TEST_TMPDIR/cbor.psv" <<'PSV'
+| n | c [hex][cbor] |
+|---|---|
+| 0 | a2617401617663616263 |
+| 1 | 420102 |
+| 2 | d82550123e4567e89b12d3a456426614174000 |
+| 3 | c24101 |
+| 4 | c11a65e136a0 |
+| 5 | 8301f93c00f6 |
+| 6 | bf6161f5ff |
+| 7 | a261 |
+| 8 | 0102 |
+| 9 | 9f01 |
+PSV
+
+# Tags are dropped for their content, except binary UUIDs and small bignums
+run_psv -c "$TEST_TMPDIR/cbor.psv"
+expect_output "[hex][cbor] cells are output as their JSON value" \
+'{"n":"0","c":{"t":1,"v":"abc"}}
+{"n":"1","c":"AQI"}
+{"n":"2","c":"123e4567-e89b-12d3-a456-426614174000"}
+{"n":"3","c":1}
+{"n":"4","c":1709258400}
+{"n":"5","c":[1,1,null]}
+{"n":"6","c":{"a":true}}
+{"n":"7","c":"a261"}
+{"n":"8","c":"0102"}
+{"n":"9","c":"9f01"}' "$(echo "$output" | json_rows)"
+
+run_psv -c --binary-as hex "$TEST_TMPDIR/cbor.psv"
+expect_output "byte strings inside CBOR items follow --binary-as" \
+'{"n":"1","c":"0102"}' "$(echo "$output" | json_rows | sed -n 2p)"
+
+run_psv --validate "$TEST_TMPDIR/cbor.psv"
+expect_status "malformed CBOR items fail --validate" 1
+expect_output "--validate reports why each CBOR item is malformed" \
+"table1: row 8, column 2 'c' (byte 205): truncated CBOR container: 'a261'
+table1: row 9, column 2 'c' (byte 218): trailing bytes after CBOR item: '0102'
+table1: row 10, column 2 'c' (byte 231): truncated CBOR item: '9f01'" "$output"
+
+# 64 levels of nesting are decoded, 65 are left as text
+nested() {
+    printf '| c [hex][cbor] |\n|---|\n| %s00 |\n' "$(printf '81%.0s' $(seq "$1"))"
+}
+nested 64 > "$TEST_TMPDIR/nested64.psv"
+run_psv -c "$TEST_TMPDIR/nested64.psv"
+expect_output "CBOR nested 64 levels deep is decoded" \
+"[{\"c\":$(printf '[%.0s' $(seq 64))0$(printf ']%.0s' $(seq 64))}]" "$output"
+nested 65 > "$TEST_TMPDIR/nested65.psv"
+run_psv --validate "$TEST_TMPDIR/nested65.psv"
+expect_contains "CBOR nested 65 levels deep is rejected" "CBOR item nested too deeply" "$output"
+
+cat > "$TEST_TMPDIR/stacked.psv" <<'PSV'
+| b [base64][hex] | j [base64][cbor] | u [dataURI][cbor] |
+|---|---|---|
+| NDg2OTBh | omF0AWF2Y2FiYw== | data:application/cbor;base64,gwECAw== |
+| NDg2OXp6 | /w== | data:,%83%01%02%03 |
+| | | |
+PSV
+
+run_psv -c --binary-as hex "$TEST_TMPDIR/stacked.psv"
+expect_output "every stage of a pipeline is decoded" \
+'{"b":"48690a","j":{"t":1,"v":"abc"},"u":[1,2,3]}
+{"b":"NDg2OXp6","j":"/w==","u":[1,2,3]}
+{"b":null,"j":null,"u":null}' "$(echo "$output" | json_rows)"
+
+run_psv -c "$TEST_TMPDIR/stacked.psv"
+expect_output "binary pipelines are output as written without --binary-as" \
+'{"b":"NDg2OTBh","j":{"t":1,"v":"abc"},"u":[1,2,3]}' "$(echo "$output" | json_rows | sed -n 1p)"
+
+run_psv --validate "$TEST_TMPDIR/stacked.psv"
+expect_output "--validate reports the stage a cell fails at" \
+"table1: row 2, column 1 'b' (byte 147): not hexadecimal: 'NDg2OXp6'
+table1: row 2, column 2 'j' (byte 158): unexpected CBOR break: '/w=='" "$output"
+
+finish
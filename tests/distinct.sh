@@ -0,0 +1,58 @@
+#!/bin/bash
+# --distinct / --distinct-on keep the first row of each distinct key, in its original position
+. "$(dirname "$0")/common.sh"
+
+cat > "$TEST_TMPDIR/small.psv" <<'PSV'
+| city | age [int] | name |
+|---|---|---|
+| Paris | 30 | a |
+| Rome | 25 | b |
+| Paris | 30 | a |
+| Paris | 31 | c |
+| Rome | 25 | d |
+| | | |
+| | | |
+PSV
+
+run_psv -c --distinct "$TEST_TMPDIR/small.psv"
+expect_status "--distinct exit status" 0
+expect_output "--distinct drops repeats of whole rows" \
+    '[{"city":"Paris","age":30,"name":"a"},{"city":"Rome","age":25,"name":"b"},{"city":"Paris","age":31,"name":"c"},{"city":"Rome","age":25,"name":"d"},{"city":null,"age":null,"name":null}]' \
+    "$output"
+
+run_psv -c --distinct-on city "$TEST_TMPDIR/small.psv"
+expect_output "--distinct-on keeps the first row of each key" \
+    '[{"city":"Paris","age":30,"name":"a"},{"city":"Rome","age":25,"name":"b"},{"city":null,"age":null,"name":null}]' \
+    "$output"
+
+run_psv -c --distinct-on city,age "$TEST_TMPDIR/small.psv"
+expect_output "--distinct-on compares every listed column" \
+    '[{"city":"Paris","age":30,"name":"a"},{"city":"Rome","age":25,"name":"b"},{"city":"Paris","age":31,"name":"c"},{"city":null,"age":null,"name":null}]' \
+    "$output"
+
+run_psv -c --distinct-on nope "$TEST_TMPDIR/small.psv"
+expect_output "a table without the --distinct-on column is skipped" "" "$output"
+expect_contains "the missing column is reported" "distinct column 'nope' not found" "$errors"
+
+# Many rows with repeated keys: every key mode must match the first occurrences found by awk
+{
+    echo "| k | v [int] |"
+    echo "|---|---|"
+    for i in $(seq 1 6000); do
+        echo "| key$(( (i * 7919) % 1500 )) | $i |"
+    done
+} > "$TEST_TMPDIR/large.psv"
+expected=$(tail -n +3 "$TEST_TMPDIR/large.psv" | awk -F' \\| ' '!seen[$1]++ { print $2 }' | tr -d ' |' | tr '\n' ',')
+expect_output "the large table has 1500 distinct keys" 1500 "$(echo "$expected" | tr ',' '\n' | grep -c .)"
+
+for mode in "" "--distinct-exact" "--distinct-approx 1M"; do
+    # shellcheck disable=SC2086
+    run_psv -c --distinct-on k $mode "$TEST_TMPDIR/large.psv"
+    actual=$(echo "$output" | json_rows | sed 's/.*"v":\([0-9]*\).*/\1/' | tr '\n' ',')
+    expect_output "--distinct-on ${mode:-(hashed)} keeps the first row of each of 1500 keys" "$expected" "$actual"
+done
+
+run_psv -c --distinct --distinct-exact --distinct-approx 1M "$TEST_TMPDIR/small.psv"
+expect_status "--distinct-exact and --distinct-approx cannot be combined" 1
+
+finish
@@ -0,0 +1,60 @@
+#!/bin/bash
+# --group-by / --agg streaming aggregation, in memory and spilled to temporary files
+. "$(dirname "$0")/common.sh"
+
+cat > "$TEST_TMPDIR/small.psv" <<'PSV'
+| city | qty [int] | price [float] |
+|---|---|---|
+| a | 1 | 1.5 |
+| b | 2 | 2.5 |
+| a | 3 | |
+| b | | 0.5 |
+| a | 5 | 4 |
+PSV
+
+run_psv -c --group-by city --agg 'count,count(qty),sum(qty),min(qty),max(price),avg(price)' "$TEST_TMPDIR/small.psv"
+expect_status "aggregates exit status" 0
+expect_output "aggregates of each group" \
+    '[{"city":"a","count":3,"count_qty":3,"sum_qty":9,"min_qty":1,"max_price":4,"avg_price":2.75},{"city":"b","count":2,"count_qty":1,"sum_qty":2,"min_qty":2,"max_price":2.5,"avg_price":1.5}]' \
+    "$output"
+
+run_psv -c --agg 'count,sum(qty)' "$TEST_TMPDIR/small.psv"
+expect_output "aggregates without --group-by" '[{"count":5,"sum_qty":11}]' "$output"
+
+cat > "$TEST_TMPDIR/invalid.psv" <<'PSV'
+| g | n [int] |
+|---|---|
+| a | 5 |
+| a | abc |
+| a | 7kg |
+| a | 9223372036854775807 |
+| a | 9223372036854775807 |
+PSV
+
+run_psv -c --group-by g --agg 'count(n),min(n),avg(n)' "$TEST_TMPDIR/invalid.psv"
+expect_output "invalid [int] cells are skipped and an overflowing average is summed as a float" \
+    '[{"g":"a","count_n":5,"min_n":5,"avg_n":6.1489146912365169e+18}]' "$output"
+
+run_psv -c --group-by g --agg 'sum(n)' "$TEST_TMPDIR/invalid.psv"
+expect_status "an overflowing [int] sum is an error" 1
+expect_contains "an overflowing [int] sum is reported" "sum() of [int] column 2 overflows a 64-bit integer" "$errors"
+
+# 3000 rows in 1000 groups, enough for a tiny memory budget to spill (and re-spill) partitions
+awk 'BEGIN {
+    print "| g | v [int] | f [float] |"
+    print "|---|---|---|"
+    for (i = 0; i < 3000; i++) printf "| k%d | %d | %.2f |\n", (i * 7919) % 1000, i % 97, (i % 13) / 4
+}' > "$TEST_TMPDIR/groups.psv"
+
+aggregates='count,sum(v),min(v),max(v),min(f),max(f),avg(f),min(g)'
+run_psv -c --group-by g --agg "$aggregates" "$TEST_TMPDIR/groups.psv"
+in_memory=$(echo "$output" | json_rows | sort)
+expect_output "in memory group count" 1000 "$(echo "$in_memory" | wc -l)"
+
+for budget in 64K 2K 1; do
+    run_psv -c --group-by g --agg "$aggregates" --memory-budget "$budget" "$TEST_TMPDIR/groups.psv"
+    expect_status "spilled group by exit status (--memory-budget $budget)" 0
+    expect_output "spilled group by matches in memory (--memory-budget $budget)" "$in_memory" "$(echo "$output" | json_rows | sort)"
+done
+
+finish
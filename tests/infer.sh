@@ -0,0 +1,39 @@
+#!/bin/bash
+# --infer-types types unannotated columns from their values, from the first --infer-rows rows or all rows
+. "$(dirname "$0")/common.sh"
+
+cat > "$TEST_TMPDIR/table.psv" <<'PSV'
+| i | f | b | d | u | z | m | e | a [str] |
+|---|---|---|---|---|---|---|---|---|
+| 1 | 1.5 | yes | 2024-01-01 | 0b32a75e-e190-4a71-b0e1-45e0d826584f | 02134 | 1 | | 5 |
+| -2 | 3 | no | 2024-01-02T10:00:00Z | 0B32A75E-E190-4A71-B0E1-45E0D826584F | 7 | x | | 6 |
+| 3 | 1e3 | y | 2024-01-03 | 0b32a75e-e190-4a71-b0e1-45e0d826584f | 9 | 2 | | 7 |
+PSV
+
+run_psv --schema --infer-types "$TEST_TMPDIR/table.psv"
+expect_output "the most specific type that fits every value" \
+    'i:integer f:float b:bool d:datetime u:uuid z:text m:text e:text a:text' \
+    "$(echo "$output" | grep -o '"key":"[a-z]*","type":"[a-z]*"' | sed 's/"key":"\([a-z]*\)","type":"\([a-z]*\)"/\1:\2/' | tr '\n' ' ' | sed 's/ $//')"
+
+run_psv -c --infer-types "$TEST_TMPDIR/table.psv"
+expect_output "inferred columns are output as their type, annotated ones are left alone" \
+'{"i":1,"f":1.5,"b":true,"d":"2024-01-01","u":"0b32a75e-e190-4a71-b0e1-45e0d826584f","z":"02134","m":"1","e":null,"a":"5"}
+{"i":-2,"f":3,"b":false,"d":"2024-01-02T10:00:00Z","u":"0B32A75E-E190-4A71-B0E1-45E0D826584F","z":"7","m":"x","e":null,"a":"6"}
+{"i":3,"f":1000,"b":true,"d":"2024-01-03","u":"0b32a75e-e190-4a71-b0e1-45e0d826584f","z":"9","m":"2","e":null,"a":"7"}' \
+    "$(echo "$output" | json_rows)"
+
+run_psv -c --infer-types --infer-rows 1 "$TEST_TMPDIR/table.psv"
+expect_output "values that do not fit a type inferred from fewer rows stay strings" \
+    '"m":1 "m":"x" "m":2' "$(echo "$output" | grep -o '"m":[^,]*' | tr '\n' ' ' | sed 's/ $//')"
+
+output=$(cat "$TEST_TMPDIR/table.psv" | "$PSV" -c --infer-types --infer-rows 0)
+expect_output "--infer-rows 0 reads piped input twice to infer from every row" \
+    '"m":"1" "m":"x" "m":"2"' "$(echo "$output" | grep -o '"m":[^,]*' | tr '\n' ' ' | sed 's/ $//')"
+
+run_psv -c "$TEST_TMPDIR/table.psv"
+expect_contains "without --infer-types columns are strings" '{"i":"1","f":"1.5","b":"yes",' "$output"
+
+run_psv -c --infer-types --sort-by i:desc "$TEST_TMPDIR/table.psv"
+expect_output "inferred types apply to --sort-by" '"i":3 "i":1 "i":-2' "$(echo "$output" | grep -o '"i":[^,]*' | tr '\n' ' ' | sed 's/ $//')"
+
+finish
@@ -0,0 +1,43 @@
+#!/bin/bash
+# --list outputs each table's header, position, row count and byte offsets without parsing rows
+. "$(dirname "$0")/common.sh"
+
+printf 'Intro\n\n{#first}\n| a | b [int] |\n|---|---|\n| 1 | 2 |\n| 3 | 4 |\n\ntext\n\n| c |\n|---|\n| x |\n\n{#empty}\n| d |\n|---|\n' > "$TEST_TMPDIR/doc.md"
+
+run_psv --list "$TEST_TMPDIR/doc.md"
+expect_status "--list exit status" 0
+expect_output "one line per table" \
+'{"id":"first","headers":["a","b [int]"],"keys":["a","b"],"data_annotation":[[],["int"]],"position":1,"num_rows":2,"header_offset":16,"data_offset":42,"end_offset":62}
+{"id":"table2","headers":["c"],"keys":["c"],"data_annotation":[[]],"position":2,"num_rows":1,"header_offset":69,"data_offset":81,"end_offset":87}
+{"id":"empty","headers":["d"],"keys":["d"],"data_annotation":[[]],"position":3,"num_rows":0,"header_offset":97,"data_offset":109,"end_offset":109}' \
+    "$output"
+
+# The offsets must point at the header row, the first data row and just past the last data row
+at_offset() {
+    tail -c +$(($1 + 1)) "$TEST_TMPDIR/doc.md" | head -c "$2"
+}
+expect_output "header_offset is the header row" "| a | b [int] |" "$(at_offset 16 15)"
+expect_output "data_offset is the first data row" "| 1 | 2 |" "$(at_offset 42 9)"
+expect_output "end_offset is after the last data row" "$(printf '| 3 | 4 |\n')" "$(head -c 62 "$TEST_TMPDIR/doc.md" | tail -c 10)"
+
+run_psv --list -i empty "$TEST_TMPDIR/doc.md"
+expect_output "--id lists only that table" \
+    '{"id":"empty","headers":["d"],"keys":["d"],"data_annotation":[[]],"position":3,"num_rows":0,"header_offset":97,"data_offset":109,"end_offset":109}' "$output"
+
+output=$(cat "$TEST_TMPDIR/doc.md" | "$PSV" --list)
+expect_contains "piped input has no offsets" '"position":2,"num_rows":1,"header_offset":null,"data_offset":null,"end_offset":null}' "$output"
+
+# Rows are counted without tokenizing them, including rows with escaped bars
+{
+    echo "| a | b |"
+    echo "|---|---|"
+    for i in $(seq 1 50000); do
+        echo "| $i \\| x | y |"
+    done
+    echo
+    echo "after the table"
+} > "$TEST_TMPDIR/large.md"
+run_psv --list "$TEST_TMPDIR/large.md"
+expect_contains "rows of a large table are counted" '"num_rows":50000,' "$output"
+
+finish
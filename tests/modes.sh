@@ -0,0 +1,52 @@
+#!/bin/bash
+# Options that each decide what is output are rejected when combined, rather than one silently winning
+. "$(dirname "$0")/common.sh"
+
+cat > "$TEST_TMPDIR/table.psv" <<'PSV'
+| a | b [int] |
+|---|---|
+| x | 2 |
+| y | 1 |
+| x | 3 |
+PSV
+
+while IFS= read -r combination; do
+    # shellcheck disable=SC2086
+    run_psv $combination "$TEST_TMPDIR/table.psv"
+    expect_status "$combination is rejected" 1
+    expect_contains "$combination error message" "cannot be used together" "$errors"
+done <<'COMBINATIONS'
+--group-by b --sort-by a
+--join t:a=t:a --sort-by a
+--sort-by a --distinct-on a
+--window 5m --sort-by a
+--agg count --sample 1
+--profile --distinct
+--validate --profile
+--list --validate
+--count --validate
+--join t:a=t:a --count
+--list --schema
+COMBINATIONS
+
+run_psv --ndjson-all --count "$TEST_TMPDIR/table.psv"
+expect_status "--ndjson-all with --count is rejected" 1
+
+# Options that refine a mode are still accepted together with it
+while IFS= read -r combination; do
+    # shellcheck disable=SC2086
+    run_psv -c $combination "$TEST_TMPDIR/table.psv"
+    expect_status "$combination is accepted" 0
+done <<'COMBINATIONS'
+--group-by a --agg sum(b)
+--sort-by b --top 2
+--distinct-on a --distinct-exact
+--sample 2 --seed 7
+--count --where b>1
+--infer-types --sort-by a
+COMBINATIONS
+
+run_psv -c --sort-by b:desc --top 2 "$TEST_TMPDIR/table.psv"
+expect_output "--sort-by with --top" '[{"a":"x","b":3},{"a":"x","b":2}]' "$output"
+
+finish
@@ -0,0 +1,50 @@
+#!/bin/bash
+# --ndjson-all: the rows of every table as one newline delimited JSON stream, tagged with their table id
+. "$(dirname "$0")/common.sh"
+
+cat > "$TEST_TMPDIR/tables.psv" <<'PSV'
+| n [int] | s | b [bool] |
+|---|---|---|
+| 1 | a | yes |
+| x | | no |
+
+| k |
+|---|
+| z |
+PSV
+
+run_psv --ndjson-all "$TEST_TMPDIR/tables.psv"
+expect_output "every row starts with its table id" \
+'{"__table":"table1","n":1,"s":"a","b":true}
+{"__table":"table1","n":"x","s":null,"b":false}
+{"__table":"table2","k":"z"}' "$output"
+
+run_psv --ndjson-all --id table2 "$TEST_TMPDIR/tables.psv"
+expect_output "table selectors still apply" '{"__table":"table2","k":"z"}' "$output"
+
+printf '| a | b [int] |\n|---|---|\n| x | 2 |\n| y | 1 |\n| x | 3 |\n' > "$TEST_TMPDIR/modes.psv"
+run_psv --ndjson-all --sort-by b:desc "$TEST_TMPDIR/modes.psv" "$TEST_TMPDIR/tables.psv"
+expect_output "row modes apply per table, with ids numbered across the input files" \
+'{"__table":"table1","a":"x","b":3}
+{"__table":"table1","a":"x","b":2}
+{"__table":"table1","a":"y","b":1}
+{"__table":"table2","n":1,"s":"a","b":true}
+{"__table":"table2","n":"x","s":null,"b":false}' "$output"
+expect_contains "tables a row mode cannot apply to are skipped" "sort column 'b' not found in table 'table3'" "$errors"
+
+run_psv --ndjson-all --distinct-on a "$TEST_TMPDIR/modes.psv"
+expect_output "--distinct-on rows are streamed" \
+'{"__table":"table1","a":"x","b":2}
+{"__table":"table1","a":"y","b":1}' "$output"
+
+# Keys are normalised without leading underscores, so a column cannot collide with the table id
+printf '| __table | a |\n|---|---|\n| q | 1 |\n' > "$TEST_TMPDIR/collide.psv"
+run_psv --ndjson-all "$TEST_TMPDIR/collide.psv"
+expect_output "a __table column does not replace the table id" '{"__table":"table1","table":"q","a":"1"}' "$output"
+
+for option in "--format cbor" "--columnar" "--rows-as-arrays"; do
+    run_psv --ndjson-all $option "$TEST_TMPDIR/modes.psv"
+    expect_status "--ndjson-all is rejected with $option" 1
+done
+
+finish
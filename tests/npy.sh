@@ -0,0 +1,52 @@
+#!/bin/bash
+# --npy writes each numeric column as a .npy array, with a .mask.npy marking its empty and invalid cells
+. "$(dirname "$0")/common.sh"
+
+cat > "$TEST_TMPDIR/table.psv" <<'PSV'
+{#features}
+| n [int] | x [float] | f [bool] | s |
+|---|---|---|---|
+| 7 | 1.5 | yes | a |
+| | x | maybe | b |
+| -2 | | no | c |
+| 12abc | 2 | | d |
+PSV
+
+mkdir "$TEST_TMPDIR/out"
+run_psv --npy "$TEST_TMPDIR/out" --id features "$TEST_TMPDIR/table.psv"
+expect_status "--npy writes the table" 0
+expect_output "one array and one mask per numeric column" \
+"f.mask.npy
+f.npy
+n.mask.npy
+n.npy
+x.mask.npy
+x.npy" "$(ls "$TEST_TMPDIR/out")"
+
+# Version 1.0 header padded to 128 bytes, then the little endian values
+npy_header() {
+    head -c 128 "$1" | tr -d '\0\001\223' | sed 's/ *$//'
+}
+npy_data() {
+    tail -c +129 "$1" | od -An -v -tx1 | tr -d ' \n'
+}
+
+expect_output "int header" "NUMPYv{'descr': '<i8', 'fortran_order': False, 'shape': (4,), }" "$(npy_header "$TEST_TMPDIR/out/n.npy")"
+expect_output "float header" "NUMPYv{'descr': '<f8', 'fortran_order': False, 'shape': (4,), }" "$(npy_header "$TEST_TMPDIR/out/x.npy")"
+expect_output "mask header" "NUMPYv{'descr': '|b1', 'fortran_order': False, 'shape': (4,), }" "$(npy_header "$TEST_TMPDIR/out/n.mask.npy")"
+
+expect_output "invalid ints are 0" "0700000000000000""0000000000000000""feffffffffffffff""0000000000000000" "$(npy_data "$TEST_TMPDIR/out/n.npy")"
+expect_output "int mask" "00010001" "$(npy_data "$TEST_TMPDIR/out/n.mask.npy")"
+expect_output "invalid floats are NaN" "000000000000f83f""000000000000f87f""000000000000f87f""0000000000000040" "$(npy_data "$TEST_TMPDIR/out/x.npy")"
+expect_output "float mask" "00010100" "$(npy_data "$TEST_TMPDIR/out/x.mask.npy")"
+expect_output "invalid bools are false" "01000000" "$(npy_data "$TEST_TMPDIR/out/f.npy")"
+expect_output "bool mask" "00010001" "$(npy_data "$TEST_TMPDIR/out/f.mask.npy")"
+
+run_psv --npy "$TEST_TMPDIR/out" "$TEST_TMPDIR/table.psv"
+expect_status "--npy needs a single table" 1
+
+run_psv --npy "$TEST_TMPDIR/missing" --id features "$TEST_TMPDIR/table.psv"
+expect_status "--npy into a missing directory fails" 1
+expect_contains "--npy into a missing directory is reported" "cannot open file '$TEST_TMPDIR/missing/n.npy' for writing" "$errors"
+
+finish
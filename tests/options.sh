@@ -0,0 +1,49 @@
+#!/bin/bash
+# Numeric option arguments are parsed strictly, so typos are errors rather than silently becoming 0
+. "$(dirname "$0")/common.sh"
+
+cat > "$TEST_TMPDIR/table.psv" <<'PSV'
+| a | b [int] |
+|---|---|
+| x | 1 |
+| y | 2 |
+| z | 3 |
+PSV
+
+while IFS= read -r option; do
+    # shellcheck disable=SC2086
+    run_psv -c $option "$TEST_TMPDIR/table.psv"
+    expect_status "$option is rejected" 1
+done <<'OPTIONS'
+--sample 2 --seed abc
+--sample 2 --seed -1
+--sample 2 --seed 18446744073709551616
+--sample 2 --seed 12x
+--memory-budget 99999999999G
+--memory-budget 18446744073709551616
+--memory-budget 1x
+--memory-budget -1M
+--distinct --distinct-approx 17179869184G
+--sort-by a --top 5x
+--sort-by a --top 0
+--sample 2.5
+--sample-rate 0.5x
+--infer-rows -3
+--format arrow --batch-size 1e3
+OPTIONS
+
+while IFS= read -r option; do
+    # shellcheck disable=SC2086
+    run_psv -c $option "$TEST_TMPDIR/table.psv"
+    expect_status "$option is accepted" 0
+done <<'OPTIONS'
+--sample 2 --seed 18446744073709551615
+--sample 2 --seed 0
+--group-by a --memory-budget 16K
+--group-by a --memory-budget 1MB
+--group-by a --memory-budget 123
+--sample-rate 0.5
+--infer-rows 0
+OPTIONS
+
+finish
@@ -0,0 +1,60 @@
+#!/bin/bash
+# --format parquet golden bytes: PLAIN and dictionary encoded column chunks, row groups and the footer
+. "$(dirname "$0")/common.sh"
+
+printf '| n [int] | s |\n|---|---|\n| 1 | a |\n| | bc |\n' > "$TEST_TMPDIR/table.psv"
+
+# "PAR1", a PLAIN int64 and a PLAIN string column chunk, the footer and its length, "PAR1".
+# Checked with pyarrow: [{"n": 1, "s": "a"}, {"n": None, "s": "bc"}] with schema metadata id=table1
+expected="$(tr -d '\n' <<'HEX'
+504152311500151c151c2c150415001506150600000200000003010100000000
+0000001500152215222c15041500150615060000020000000303010000006102
+00000062631502193c4806736368656d611504001504250218016e00150c2502
+18017325004c1c0000001604191c192c26081c1504192500061918016e150016
+04163e163e26083c360200000026461c150c1925000619180173150016041644
+164426463c36000000001682011604260816820100191c180269641806746162
+6c6531001803707376008500000050415231
+HEX
+)"
+
+# Written through a pipe, since the file metadata is only written at the end
+"$PSV" --format parquet --id table1 "$TEST_TMPDIR/table.psv" | cat > "$TEST_TMPDIR/table.parquet"
+expect_output "a table is one Parquet file" "$expected" "$(hex_dump "$TEST_TMPDIR/table.parquet")"
+
+# A text column with few distinct values gets a dictionary page and RLE_DICTIONARY data page
+printf '| s |\n|---|\n| red |\n| red |\n| red |\n| blue |\n' > "$TEST_TMPDIR/dictionary.psv"
+expected="$(tr -d '\n' <<'HEX'
+504152311504151e151e4c1504150000000300000072656404000000626c7565
+1500151215122c1508151015061506000002000000030f0103081502192c4806
+736368656d61150200150c250218017325004c1c0000001608191c191c26081c
+150c19350006101918017315001608166c166c264026081c3600000000166c16
+082608166c00191c1802696418067461626c6531001803707376006100000050
+415231
+HEX
+)"
+"$PSV" --format parquet --table 1 "$TEST_TMPDIR/dictionary.psv" > "$TEST_TMPDIR/dictionary.parquet"
+expect_output "repeated text is dictionary encoded" "$expected" "$(hex_dump "$TEST_TMPDIR/dictionary.parquet")"
+
+# A memory budget smaller than a row writes each row as its own row group (two row groups in pyarrow)
+expected="$(tr -d '\n' <<'HEX'
+504152311500151c151c2c150215001506150600000200000003010100000000
+0000001500151615162c15021500150615060000020000000301010000006115
+00150c150c2c150215001506150600000200000003001500151815182c150215
+001506150600000200000003010200000062631502193c4806736368656d6115
+04001504250218016e00150c250218017325004c1c0000001604192c192c2608
+1c1504192500061918016e15001602163e163e26083c360000000026461c150c
+1925000619180173150016021638163826463c36000000001676160226081676
+00192c267e1c1504192500061918016e15001602162e162e267e3c3602000000
+26ac011c150c192500061918017315001602163a163a26ac013c360000000016
+681602267e166800191c1802696418067461626c653100180370737600ca0000
+0050415231
+HEX
+)"
+"$PSV" --format parquet --id table1 --memory-budget 1 "$TEST_TMPDIR/table.psv" > "$TEST_TMPDIR/groups.parquet"
+expect_output "--memory-budget bounds each row group" "$expected" "$(hex_dump "$TEST_TMPDIR/groups.parquet")"
+
+run_psv --format parquet "$TEST_TMPDIR/table.psv"
+expect_status "--format parquet needs a single table" 1
+expect_contains "the error names the table selectors" "needs --id, --table or --join" "$errors"
+
+finish
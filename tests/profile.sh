@@ -0,0 +1,83 @@
+#!/bin/bash
+# --profile single pass column statistics, exact ones checked by hand and sketches checked for accuracy
+. "$(dirname "$0")/common.sh"
+
+# The JSON of one column of the profile in $output
+column_json() {
+    echo "$output" | sed 's/{"key":/\n{"key":/g' | grep "^{\"key\":\"$1\""
+}
+
+# The first value of a field in a column's JSON
+field() {
+    echo "$1" | grep -o "\"$2\":[^,}]*" | head -1 | cut -d: -f2-
+}
+
+cat > "$TEST_TMPDIR/small.psv" <<'PSV'
+| n [int] | x [float] | b [bool] | s |
+|---|---|---|---|
+| 1 | 1.5 | yes | a |
+| 2 | x | no | bb |
+| | 2.5 | yes | a |
+| 4 | | | ccc |
+| z | 0.5 | y | a |
+PSV
+
+run_psv -c --profile "$TEST_TMPDIR/small.psv"
+expect_status "--profile exit status" 0
+expect_contains "row count" '{"id":"table1","num_rows":5,' "$output"
+expect_contains "[int] column statistics skip invalid cells" \
+    '{"key":"n","header":"n [int]","type":"int","count":4,"null_count":1,"invalid_count":1,"min":1,"max":4,"mean":2.3333333333333335,"variance":2.333333333333333,' \
+    "$(column_json n)"
+expect_contains "[float] column statistics" \
+    '"count":4,"null_count":1,"invalid_count":1,"min":0.5,"max":2.5,"mean":1.5,"variance":1,"stddev":1,' "$(column_json x)"
+expect_contains "[float] cell lengths" '"length":{"min":1,"max":3,"mean":2.5}' "$(column_json x)"
+expect_contains "[bool] counts" '"count":4,"null_count":1,"true_count":3,"false_count":1,' "$(column_json b)"
+expect_contains "text min and max" '"min":"a","max":"ccc",' "$(column_json s)"
+expect_contains "text top value" '"top_values":[{"value":"a","count":3}' "$(column_json s)"
+
+cat > "$TEST_TMPDIR/overflow.psv" <<'PSV'
+| n [int] | x [float] |
+|---|---|
+| 3 | 1.5 |
+| 99999999999999999999 | 1e400 |
+| -99999999999999999999 | -1e400 |
+| 5 | nan |
+PSV
+
+run_psv -c --profile "$TEST_TMPDIR/overflow.psv"
+expect_contains "[int] cells past the 64-bit range are invalid" \
+    '"count":4,"null_count":0,"invalid_count":2,"min":3,"max":5,"mean":4,"variance":2,"stddev":1.4142135623730951,"quantiles":{"p1":3,' \
+    "$(column_json n)"
+expect_contains "[float] cells past the double range and NaN are invalid" \
+    '"count":4,"null_count":0,"invalid_count":3,"min":1.5,"max":1.5,"mean":1.5,"quantiles":{"p1":1.5,"p5":1.5,"p25":1.5,"p50":1.5,"p75":1.5,"p95":1.5,"p99":1.5}' \
+    "$(column_json x)"
+
+{
+    echo "| n [int] | g |"
+    echo "|---|---|"
+    seq 1 100000 | awk '{ printf "| %d | g%d |\n", $1, $1 % 3 == 0 ? 0 : $1 % 7 }'
+} > "$TEST_TMPDIR/large.psv"
+
+run_psv -c --profile "$TEST_TMPDIR/large.psv"
+n=$(column_json n)
+expect_output "exact mean" 50000.5 "$(field "$n" mean)"
+
+# Approximate statistics must be within their sketch's error bounds
+within() {
+    local name=$1 actual=$2 expected=$3 tolerance=$4
+    if awk -v a="$actual" -v e="$expected" -v t="$tolerance" 'BEGIN { exit !(a >= e - t && a <= e + t) }'; then
+        pass "$name ($actual)"
+    else
+        fail "$name ($actual, expected $expected +- $tolerance)"
+    fi
+}
+within "distinct estimate within 3%" "$(field "$n" distinct_estimate)" 100000 3000
+for quantile in 1 25 50 75 99; do
+    within "p$quantile within 1% of the rank" "$(field "$n" "p$quantile")" $((quantile * 1000)) 1000
+done
+
+g=$(column_json g)
+expect_output "distinct estimate of a small column is exact" 7 "$(field "$g" distinct_estimate)"
+expect_contains "the most frequent value is counted exactly" '"top_values":[{"value":"g0","count":42857}' "$g"
+
+finish
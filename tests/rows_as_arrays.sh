@@ -0,0 +1,48 @@
+#!/bin/bash
+# --rows-as-arrays: positional JSON rows, with each table's keys written once
+. "$(dirname "$0")/common.sh"
+
+cat > "$TEST_TMPDIR/tables.psv" <<'PSV'
+| n [int] | s | b [bool] |
+|---|---|---|
+| 1 | a | yes |
+| x | | no |
+
+| k |
+|---|
+| z |
+PSV
+
+run_psv --rows-as-arrays "$TEST_TMPDIR/tables.psv"
+expect_output "rows are arrays of cells in column order" \
+'{"id":"table1","headers":["n [int]","s","b [bool]"],"keys":["n","s","b"],"data_annotation":[["int"],[],["bool"]],"rows":[[1,"a",true],["x",null,false]]}
+{"id":"table2","headers":["k"],"keys":["k"],"data_annotation":[[]],"rows":[["z"]]}' "$output"
+
+run_psv -c --rows-as-arrays "$TEST_TMPDIR/tables.psv"
+expect_output "--compact tables start with their keys" \
+'[["n","s","b"],[1,"a",true],["x",null,false]]
+[["k"],["z"]]' "$output"
+
+run_psv -c --rows-as-arrays --id table1 "$TEST_TMPDIR/tables.psv"
+expect_output "a single streamed table writes its keys on the first line" \
+'["n","s","b"]
+[1,"a",true]
+["x",null,false]' "$output"
+
+printf '| a | b [int] |\n|---|---|\n' > "$TEST_TMPDIR/empty.psv"
+run_psv -c --rows-as-arrays --id table1 "$TEST_TMPDIR/empty.psv"
+expect_output "a streamed table without rows still writes its keys" '["a","b"]' "$output"
+
+printf '| a | b [int] |\n|---|---|\n| x | 2 |\n| y | 1 |\n| x | 3 |\n' > "$TEST_TMPDIR/modes.psv"
+run_psv -c --rows-as-arrays --sort-by b "$TEST_TMPDIR/modes.psv"
+expect_output "rows follow --sort-by order" '[["a","b"],["y",1],["x",2],["x",3]]' "$output"
+
+run_psv -c --rows-as-arrays --group-by a --agg count "$TEST_TMPDIR/modes.psv"
+expect_output "aggregate results use the result keys" '[["a","count"],["x",2],["y",1]]' "$output"
+
+run_psv --rows-as-arrays --format cbor "$TEST_TMPDIR/modes.psv"
+expect_status "--rows-as-arrays is rejected with --format" 1
+run_psv --rows-as-arrays --columnar "$TEST_TMPDIR/modes.psv"
+expect_status "--rows-as-arrays is rejected with --columnar" 1
+
+finish
@@ -0,0 +1,55 @@
+#!/bin/bash
+# --sample reservoir sampling and --sample-rate Bernoulli sampling, repeatable with --seed
+. "$(dirname "$0")/common.sh"
+
+{
+    echo "| n [int] |"
+    echo "|---|"
+    seq 1 10000 | sed 's/.*/| & |/'
+} > "$TEST_TMPDIR/numbers.psv"
+
+# The sampled values of n, one per line
+sampled() {
+    run_psv -c "$@" "$TEST_TMPDIR/numbers.psv"
+    echo "$output" | json_rows | sed 's/[^0-9]//g'
+}
+
+first=$(sampled --sample 100 --seed 42)
+expect_output "--sample N outputs N rows" 100 "$(echo "$first" | grep -c .)"
+expect_output "--sample keeps the original row order" "$(echo "$first" | sort -n)" "$first"
+expect_output "--sample rows are distinct" 100 "$(echo "$first" | sort -u | grep -c .)"
+expect_output "--sample is repeatable with --seed" "$first" "$(sampled --sample 100 --seed 42)"
+if [ "$first" != "$(sampled --sample 100 --seed 43)" ]; then
+    pass "--sample differs with another --seed"
+else
+    fail "--sample differs with another --seed"
+fi
+expect_output "--sample larger than the table outputs every row" "$(seq 1 10000)" "$(sampled --sample 20000 --seed 1)"
+
+rate=$(sampled --sample-rate 0.25 --seed 7)
+count=$(echo "$rate" | grep -c .)
+if [ "$count" -gt 2250 ] && [ "$count" -lt 2750 ]; then
+    pass "--sample-rate 0.25 keeps about a quarter of the rows ($count)"
+else
+    fail "--sample-rate 0.25 keeps about a quarter of the rows ($count)"
+fi
+expect_output "--sample-rate keeps the original row order" "$(echo "$rate" | sort -n)" "$rate"
+expect_output "--sample-rate is repeatable with --seed" "$rate" "$(sampled --sample-rate 0.25 --seed 7)"
+expect_output "--sample-rate 1 keeps every row" "$(seq 1 10000)" "$(sampled --sample-rate 1 --seed 1)"
+expect_output "--sample-rate 0 keeps no rows" "" "$(sampled --sample-rate 0 --seed 1)"
+
+# Sampled values must be spread over the table, not bunched at one end
+mean=$(echo "$first" | awk '{ sum += $1 } END { printf "%d", sum / NR }')
+if [ "$mean" -gt 3500 ] && [ "$mean" -lt 6500 ]; then
+    pass "--sample is spread over the table (mean $mean)"
+else
+    fail "--sample is spread over the table (mean $mean)"
+fi
+
+for option in "--sample-rate 1.5" "--sample-rate -0.1" "--sample 0"; do
+    # shellcheck disable=SC2086
+    run_psv -c $option "$TEST_TMPDIR/numbers.psv"
+    expect_status "$option is rejected" 1
+done
+
+finish
@@ -0,0 +1,39 @@
+#!/bin/bash
+# --schema outputs the header metadata and how each column is typed, without parsing rows
+. "$(dirname "$0")/common.sh"
+
+cat > "$TEST_TMPDIR/doc.md" <<'MD'
+{#t}
+| a [int] | b [str][uuid] | c [hex][cbor] | d [x] | e | f [datetime] | g [uuid] | h [bool] | i [float] |
+|---|---|---|---|---|---|---|---|---|
+| 1 | 0b32a75e-e190-4a71-b0e1-45e0d826584f | 0x01 | q | 2.5 | 2024-01-01 | 0b32a75e-e190-4a71-b0e1-45e0d826584f | yes | 1 |
+
+| only |
+|---|
+MD
+
+column() {
+    echo "$output" | head -1 | grep -o "{\"key\":\"$1\"[^}]*}"
+}
+
+run_psv --schema "$TEST_TMPDIR/doc.md"
+expect_status "--schema exit status" 0
+expect_contains "header metadata" \
+    '{"id":"t","headers":["a [int]","b [str][uuid]","c [hex][cbor]","d [x]","e","f [datetime]","g [uuid]","h [bool]","i [float]"],"keys":["a","b","c","d","e","f","g","h","i"],"data_annotation":[["int"],["str","uuid"],["hex","cbor"],["x"],[],["datetime"],["uuid"],["bool"],["float"]],"columns":[' \
+    "$output"
+expect_output "[int] column" '{"key":"a","type":"integer","json_type":"integer","cbor_tag":null}' "$(column a)"
+expect_output "the first recognised annotation decides the type" '{"key":"b","type":"text","json_type":"text","cbor_tag":null}' "$(column b)"
+expect_output "[hex] column" '{"key":"c","type":"hex","json_type":"text","cbor_tag":263}' "$(column c)"
+expect_output "unknown annotations are text" '{"key":"d","type":"text","json_type":"text","cbor_tag":null}' "$(column d)"
+expect_output "unannotated columns are text" '{"key":"e","type":"text","json_type":"text","cbor_tag":null}' "$(column e)"
+expect_output "[datetime] column" '{"key":"f","type":"datetime","json_type":"text","cbor_tag":0}' "$(column f)"
+expect_output "[uuid] column" '{"key":"g","type":"uuid","json_type":"text","cbor_tag":37}' "$(column g)"
+expect_output "[bool] column" '{"key":"h","type":"bool","json_type":"bool","cbor_tag":null}' "$(column h)"
+expect_output "[float] column" '{"key":"i","type":"float","json_type":"float","cbor_tag":null}' "$(column i)"
+expect_output "one line per table" 2 "$(echo "$output" | grep -c .)"
+expect_contains "tables without rows" '"columns":[{"key":"only","type":"text","json_type":"text","cbor_tag":null}]}' "$(echo "$output" | tail -1)"
+
+run_psv --schema --infer-types "$TEST_TMPDIR/doc.md"
+expect_output "--infer-types types unannotated columns" '{"key":"e","type":"float","json_type":"float","cbor_tag":null}' "$(column e)"
+
+finish
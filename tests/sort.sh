@@ -0,0 +1,69 @@
+#!/bin/bash
+# --sort-by in memory, as an external merge of spilled runs and as a --top heap
+. "$(dirname "$0")/common.sh"
+
+cat > "$TEST_TMPDIR/invalid.psv" <<'PSV'
+| n [int] | s |
+|---|---|
+| 5 | a |
+| abc | b |
+| | c |
+| -2 | d |
+| 3 | e |
+PSV
+
+# Row order by the s column, which says which row is which
+row_order() {
+    grep -o '"s":"[a-z]*"' | cut -d'"' -f4 | tr -d '\n'
+}
+
+run_psv -c --sort-by n "$TEST_TMPDIR/invalid.psv"
+expect_output "invalid [int] keys sort after empty cells" "deacb" "$(echo "$output" | row_order)"
+
+run_psv -c --sort-by n:desc "$TEST_TMPDIR/invalid.psv"
+expect_output "invalid [int] keys still sort last with :desc" "aedcb" "$(echo "$output" | row_order)"
+
+run_psv -c --sort-by n:desc --top 4 "$TEST_TMPDIR/invalid.psv"
+expect_output "invalid [int] keys sort last with --top" "aedc" "$(echo "$output" | row_order)"
+
+awk 'BEGIN {
+    print "| n [int] | x [float] | s |"
+    print "|---|---|---|"
+    srand(7)
+    for (i = 0; i < 4000; i++) {
+        r = int(rand() * 100)
+        if (r < 5) printf "| | nan | s%d |\n", i
+        else if (r < 10) printf "| bad%d | | s%d |\n", r, i
+        else printf "| %d | %d.25 | s%d |\n", r % 37, r % 11, i
+    }
+}' > "$TEST_TMPDIR/rows.psv"
+
+for sort_by in n x:desc,n n:desc,s; do
+    run_psv -c --sort-by "$sort_by" "$TEST_TMPDIR/rows.psv"
+    in_memory=$(echo "$output" | json_rows)
+
+    run_psv -c --sort-by "$sort_by" --memory-budget 8K "$TEST_TMPDIR/rows.psv"
+    expect_output "external merge sort by $sort_by matches in memory" "$in_memory" "$(echo "$output" | json_rows)"
+
+    run_psv -c --sort-by "$sort_by" --top 25 "$TEST_TMPDIR/rows.psv"
+    expect_output "--top 25 by $sort_by matches the first rows in memory" "$(echo "$in_memory" | head -25)" "$(echo "$output" | json_rows)"
+done
+
+# A budget of one byte spills every row as its own run. Runs are merged a bounded number
+# at a time, so thousands of them still sort within a small open file limit.
+run_psv -c --sort-by n:desc,s "$TEST_TMPDIR/rows.psv"
+in_memory=$(echo "$output" | json_rows)
+output=$(ulimit -n 256 && "$PSV" -c --sort-by n:desc,s --memory-budget 1 "$TEST_TMPDIR/rows.psv" 2>"$TEST_TMPDIR/stderr")
+status=$?
+errors=$(cat "$TEST_TMPDIR/stderr")
+expect_status "one run per row sorts under ulimit -n 256" 0
+expect_output "one run per row matches in memory" "$in_memory" "$(echo "$output" | json_rows)"
+
+# Run files that cannot be created are reported rather than giving empty output
+output=$(ulimit -n 16 && "$PSV" -c --sort-by n --memory-budget 1 "$TEST_TMPDIR/rows.psv" 2>"$TEST_TMPDIR/stderr")
+status=$?
+errors=$(cat "$TEST_TMPDIR/stderr")
+expect_status "a sort run file that cannot be created fails" 1
+expect_contains "a sort run file that cannot be created is reported" "cannot create sort run file" "$errors"
+
+finish
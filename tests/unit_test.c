@@ -1,12 +1,543 @@
+/**
+ * @file unit_test.c
+ * @brief Unit Tests Of The psv Library Modules
+ *
+ * Copyright (C) 2024-2024 Brian Khuu <contact@briankhuu.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Each test_* function exercises one module directly, reading its tables from in memory
+ * Markdown text. Command line behaviour is covered by the shell scripts in tests/ instead.
+ */
+
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
-#include "config.h"
-#include "hello.h"
-int main() {
-  if(strcmp(HELLO_MESSAGE, "Hello, world") != 0) {
-    printf("Unit test failed: Message does not match expected output.\n");
-    return 1;
-  }
-  printf("All Unit Test Passed\n");
-  return 0;
+
+#include "psv.h"
+#include "psv_aggregate.h"
+#include "psv_sort.h"
+#include "psv_datetime.h"
+#include "psv_writer.h"
+#include "log.h"
+
+static int failures = 0;
+
+#define CHECK(condition) \
+    do { \
+        if (!(condition)) { \
+            printf("FAIL %s:%d: %s\n", __FILE__, __LINE__, #condition); \
+            failures++; \
+        } \
+    } while (0)
+
+#define CHECK_STR(actual, expected) \
+    do { \
+        const char *actual_ = (actual); \
+        const char *expected_ = (expected); \
+        if (actual_ == NULL || expected_ == NULL ? actual_ != expected_ : strcmp(actual_, expected_) != 0) { \
+            printf("FAIL %s:%d: %s is \"%s\", expected \"%s\"\n", __FILE__, __LINE__, #actual, actual_ ? actual_ : "(null)", expected_ ? expected_ : "(null)"); \
+            failures++; \
+        } \
+    } while (0)
+
+/*******************************************************************************
+ * Helpers
+ ******************************************************************************/
+
+// Parse the header of a Markdown table held in memory, leaving `input` positioned at its first row
+static PsvTable *open_table(const char *markdown, FILE **input) {
+    *input = fmemopen((void *)markdown, strlen(markdown), "r");
+    PsvTable *table = psv_parse_table_header(*input, "test");
+    if (table == NULL) {
+        printf("FAIL: cannot parse test table header\n");
+        exit(1);
+    }
+    return table;
+}
+
+// Join the cells of a row with '|' (empty cells as '-') into a caller freed string
+static char *row_to_string(PsvDataRow row, int num_cells) {
+    size_t length = 1;
+    for (int i = 0; i < num_cells; i++) {
+        length += (row[i] ? strlen(row[i]) : 1) + 1;
+    }
+    char *text = calloc(length, 1);
+    for (int i = 0; i < num_cells; i++) {
+        strcat(text, row[i] ? row[i] : "-");
+        strcat(text, i + 1 < num_cells ? "|" : "");
+    }
+    return text;
+}
+
+static int compare_strings(const void *a, const void *b) {
+    return strcmp(*(char *const *)a, *(char *const *)b);
+}
+
+/*******************************************************************************
+ * Parsing
+ ******************************************************************************/
+
+// `\\` is an escaped backslash and `\|` an escaped delimiter, whether rows are parsed one by one or into a row buffer
+static void test_parse_escapes(void) {
+    const char *markdown =
+        "| a | b |\n"
+        "|---|---|\n"
+        "| x\\\\| y |\n"
+        "| p\\|q\\|r | s |\n"
+        "| \\\\\\| | t |\n"
+        "| \\|\\| | u |\n";
+    const char *expected[][2] = {{"x\\", "y"}, {"p|q|r", "s"}, {"\\|", "t"}, {"||", "u"}};
+    const int num_expected = sizeof(expected) / sizeof(expected[0]);
+
+    FILE *input = NULL;
+    PsvTable *table = open_table(markdown, &input);
+    PsvDataRow data_row = NULL;
+    int row = 0;
+    while ((data_row = psv_parse_table_row(input, table)) != NULL) {
+        CHECK(row < num_expected);
+        if (row < num_expected) {
+            CHECK_STR(data_row[0], expected[row][0]);
+            CHECK_STR(data_row[1], expected[row][1]);
+        }
+        psv_parse_table_free_row(table, &data_row);
+        row++;
+    }
+    CHECK(row == num_expected);
+    psv_free_table(&table);
+    fclose(input);
+
+    table = open_table(markdown, &input);
+    PsvRowBuffer row_buffer = {0};
+    row = 0;
+    while (psv_parse_table_row_buffer(input, table, &row_buffer)) {
+        CHECK(row < num_expected && row_buffer.num_cells == 2);
+        if (row < num_expected && row_buffer.num_cells == 2) {
+            CHECK_STR(row_buffer.cells[0], expected[row][0]);
+            CHECK_STR(row_buffer.cells[1], expected[row][1]);
+        }
+        row++;
+    }
+    CHECK(row == num_expected);
+    psv_row_buffer_free(&row_buffer);
+    psv_free_table(&table);
+    fclose(input);
+}
+
+// Each data annotation maps to its own type and CBOR tag
+static void test_parse_annotations(void) {
+    PsvTable *table = psv_create_table("test");
+    psv_table_add_header(table, "id [uuid]");
+    psv_table_add_header(table, "at [datetime]");
+
+    CHECK(psv_has_data_annotation(table, 0, PSV_DATA_ANNOTATION_UUID));
+    CHECK(!psv_has_data_annotation(table, 0, PSV_DATA_ANNOTATION_DATETIME));
+    CHECK(table->header_metadata[0].data_annotation_tags[0].tag == CBOR_TAG_BINARY_UUID);
+    CHECK(psv_has_data_annotation(table, 1, PSV_DATA_ANNOTATION_DATETIME));
+    CHECK(!psv_has_data_annotation(table, 1, PSV_DATA_ANNOTATION_UUID));
+
+    psv_free_table(&table);
+}
+
+/*******************************************************************************
+ * Date/Time
+ ******************************************************************************/
+
+static void test_datetime_parse(void) {
+    int64_t epoch_ns = 0;
+    CHECK(psv_datetime_parse("1970-01-01T00:00:00Z", &epoch_ns) && epoch_ns == 0);
+    CHECK(psv_datetime_parse("2024-02-29T12:00:00+02:00", &epoch_ns) && epoch_ns == INT64_C(1709200800) * 1000000000);
+    CHECK(psv_datetime_parse("2000-02-29", &epoch_ns));
+    CHECK(psv_datetime_parse("2024-01-31", &epoch_ns));
+    CHECK(psv_datetime_parse("2024-04-30", &epoch_ns));
+
+    // Days past the end of their month
+    CHECK(!psv_datetime_parse("2023-02-29", &epoch_ns));
+    CHECK(!psv_datetime_parse("2024-02-30", &epoch_ns));
+    CHECK(!psv_datetime_parse("1900-02-29", &epoch_ns));
+    CHECK(!psv_datetime_parse("2024-04-31", &epoch_ns));
+    CHECK(!psv_datetime_parse("2024-11-31T10:00:00Z", &epoch_ns));
+    CHECK(!psv_datetime_parse("2024-01-32", &epoch_ns));
+    CHECK(!psv_datetime_parse("2024-13-01", &epoch_ns));
+
+    // UTC offsets past 23:59
+    CHECK(psv_datetime_parse("2024-01-01T00:00:00+23:59", &epoch_ns));
+    CHECK(psv_datetime_parse("2024-01-01T00:00:00-1400", &epoch_ns));
+    CHECK(!psv_datetime_parse("2024-01-01T00:00:00+99:99", &epoch_ns));
+    CHECK(!psv_datetime_parse("2024-01-01T00:00:00+24:00", &epoch_ns));
+    CHECK(!psv_datetime_parse("2024-01-01T00:00:00-05:60", &epoch_ns));
+    CHECK(!psv_datetime_parse("2024-01-01T00:00:00+0575", &epoch_ns));
+    CHECK(!psv_datetime_parse("2024-01-01T00:00:00+25", &epoch_ns));
+}
+
+static void test_datetime_epoch_seconds(void) {
+    int64_t epoch_ns = 0;
+    CHECK(psv_datetime_parse("2024-03-01T01:30:00.250Z", &epoch_ns) && psv_datetime_epoch_seconds(epoch_ns) == 1709256600.25);
+    CHECK(psv_datetime_parse("1969-12-31T23:59:59.5Z", &epoch_ns) && psv_datetime_epoch_seconds(epoch_ns) == -0.5);
+}
+
+/*******************************************************************************
+ * Group By
+ ******************************************************************************/
+
+// Run a group by over `markdown` with the given memory budget, returning its result rows sorted
+static char **group_by_rows(const char *markdown, const char *group_by_keys, const char *aggregates, size_t memory_budget, size_t *num_rows) {
+    FILE *input = NULL;
+    PsvTable *table = open_table(markdown, &input);
+
+    PsvAggregateSpec spec = {0};
+    CHECK(psv_aggregate_spec_parse(&spec, table, group_by_keys, aggregates));
+
+    PsvGroupBy *group_by = psv_group_by_create(&spec, table->num_headers, memory_budget);
+    PsvDataRow data_row = NULL;
+    while ((data_row = psv_parse_table_row(input, table)) != NULL) {
+        psv_group_by_add_row(group_by, data_row);
+        psv_parse_table_free_row(table, &data_row);
+    }
+
+    PsvTable *result_table = psv_aggregate_create_result_table(table, &spec, NULL, 0);
+    char **rows = NULL;
+    *num_rows = 0;
+    while ((data_row = psv_group_by_next_row(group_by)) != NULL) {
+        rows = realloc(rows, (*num_rows + 1) * sizeof(char *));
+        rows[(*num_rows)++] = row_to_string(data_row, result_table->num_headers);
+        psv_parse_table_free_row(result_table, &data_row);
+    }
+    qsort(rows, *num_rows, sizeof(char *), compare_strings);
+
+    psv_group_by_free(&group_by);
+    psv_free_table(&result_table);
+    psv_aggregate_spec_free(&spec);
+    psv_free_table(&table);
+    fclose(input);
+    return rows;
+}
+
+static void free_rows(char **rows, size_t num_rows) {
+    for (size_t i = 0; i < num_rows; i++) {
+        free(rows[i]);
+    }
+    free(rows);
+}
+
+static void test_group_by(void) {
+    const char *markdown =
+        "| city | qty [int] | price [float] |\n"
+        "|---|---|---|\n"
+        "| a | 1 | 1.5 |\n"
+        "| b | 2 | 2.5 |\n"
+        "| a | 3 | |\n"
+        "| b | | 0.5 |\n"
+        "| a | 5 | 4 |\n";
+
+    size_t num_rows = 0;
+    char **rows = group_by_rows(markdown, "city", "count,count(qty),sum(qty),min(qty),max(price),avg(price),max(city)", 1 << 20, &num_rows);
+    CHECK(num_rows == 2);
+    if (num_rows == 2) {
+        CHECK_STR(rows[0], "a|3|3|9|1|4|2.75|a");
+        CHECK_STR(rows[1], "b|2|1|2|2|2.5|1.5|b");
+    }
+    free_rows(rows, num_rows);
+}
+
+// Cells that are not valid numbers (including floats past the double range and NaN) are skipped by
+// numeric aggregates, but still counted by count(col)
+static void test_group_by_invalid_cells(void) {
+    const char *markdown =
+        "| g | n [int] | x [float] |\n"
+        "|---|---|---|\n"
+        "| a | 5 | 1.5 |\n"
+        "| a | abc | 2x |\n"
+        "| a | 7kg | nope |\n"
+        "| a | 99999999999999999999 | 0.5 |\n"
+        "| a | -3 | 1e400 |\n"
+        "| a | 8 | -1e999 |\n"
+        "| a | 9 | nan |\n";
+
+    size_t num_rows = 0;
+    char **rows = group_by_rows(markdown, "g", "count(n),sum(n),min(n),max(n),avg(n),sum(x),avg(x),min(x),max(x)", 1 << 20, &num_rows);
+    CHECK(num_rows == 1);
+    if (num_rows == 1) {
+        CHECK_STR(rows[0], "a|7|19|-3|9|4.75|2|1|0.5|1.5");
+    }
+    free_rows(rows, num_rows);
+}
+
+// The running sum of an integer average carries on as a double once it passes INT64_MAX
+static void test_group_by_avg_overflow(void) {
+    const char *markdown =
+        "| g | n [int] |\n"
+        "|---|---|\n"
+        "| a | 9223372036854775807 |\n"
+        "| a | 9223372036854775807 |\n"
+        "| a | 2 |\n"
+        "| b | 9223372036854775807 |\n"
+        "| b | -9223372036854775807 |\n";
+
+    size_t num_rows = 0;
+    char **rows = group_by_rows(markdown, "g", "avg(n)", 1 << 20, &num_rows);
+    CHECK(num_rows == 2);
+    if (num_rows == 2) {
+        CHECK_STR(rows[0], "a|6.1489146912365169e+18");
+        CHECK_STR(rows[1], "b|0");
+    }
+    free_rows(rows, num_rows);
+}
+
+// Spilling groups to temporary files must not change the result, only the order groups come out in
+static void test_group_by_spill(void) {
+    size_t size = 0;
+    char *markdown = NULL;
+    FILE *text = open_memstream(&markdown, &size);
+    fprintf(text, "| g | v [int] | f [float] |\n|---|---|---|\n");
+    for (int i = 0; i < 2000; i++) {
+        fprintf(text, "| k%d | %d | %d.25 |\n", (i * 7919) % 700, i % 97, i % 13);
+    }
+    fclose(text);
+
+    const char *aggregates = "count,sum(v),min(v),max(v),avg(f),min(g)";
+    size_t num_in_memory = 0;
+    char **in_memory = group_by_rows(markdown, "g", aggregates, 1 << 30, &num_in_memory);
+    CHECK(num_in_memory == 700);
+
+    const size_t budgets[] = {16 << 10, 1024, 1};
+    for (size_t b = 0; b < sizeof(budgets) / sizeof(budgets[0]); b++) {
+        size_t num_spilled = 0;
+        char **spilled = group_by_rows(markdown, "g", aggregates, budgets[b], &num_spilled);
+        CHECK(num_spilled == num_in_memory);
+        for (size_t i = 0; i < num_spilled && i < num_in_memory; i++) {
+            CHECK_STR(spilled[i], in_memory[i]);
+        }
+        free_rows(spilled, num_spilled);
+    }
+
+    free_rows(in_memory, num_in_memory);
+    free(markdown);
+}
+
+/*******************************************************************************
+ * Sorting
+ ******************************************************************************/
+
+// Sort `markdown` by `sort_by`, returning the rows in order (all of them, or the first `limit`)
+static char **sorted_rows(const char *markdown, const char *sort_by, size_t memory_budget, size_t limit, size_t *num_rows) {
+    FILE *input = NULL;
+    PsvTable *table = open_table(markdown, &input);
+
+    PsvSortSpec spec = {0};
+    CHECK(psv_sort_spec_parse(&spec, table, sort_by));
+
+    PsvSorter *sorter = psv_sorter_create(&spec, table->num_headers, memory_budget, limit);
+    PsvDataRow data_row = NULL;
+    while ((data_row = psv_parse_table_row(input, table)) != NULL) {
+        psv_sorter_add_row(sorter, data_row);
+    }
+
+    char **rows = NULL;
+    *num_rows = 0;
+    while ((data_row = psv_sorter_next_row(sorter)) != NULL) {
+        rows = realloc(rows, (*num_rows + 1) * sizeof(char *));
+        rows[(*num_rows)++] = row_to_string(data_row, table->num_headers);
+        psv_parse_table_free_row(table, &data_row);
+    }
+
+    psv_sorter_free(&sorter);
+    psv_sort_spec_free(&spec);
+    psv_free_table(&table);
+    fclose(input);
+    return rows;
+}
+
+static void test_sort_invalid_keys(void) {
+    const char *markdown =
+        "| n [int] | x [float] |\n"
+        "|---|---|\n"
+        "| 5 | 1.5 |\n"
+        "| abc | nan |\n"
+        "| | 2 |\n"
+        "| -2 | x |\n"
+        "| 99999999999999999999 | |\n"
+        "| 3 | -1 |\n";
+
+    // Values, then empty cells, then cells that are not valid numbers (NaN included) in text order
+    const char *int_ascending[] = {"-2|x", "3|-1", "5|1.5", "-|2", "99999999999999999999|-", "abc|nan"};
+    const char *int_descending[] = {"5|1.5", "3|-1", "-2|x", "-|2", "abc|nan", "99999999999999999999|-"};
+    const char *float_ascending[] = {"3|-1", "5|1.5", "-|2", "99999999999999999999|-", "abc|nan", "-2|x"};
+    const struct {
+        const char *sort_by;
+        const char **expected;
+    } cases[] = {{"n", int_ascending}, {"n:desc", int_descending}, {"x", float_ascending}};
+
+    for (size_t c = 0; c < sizeof(cases) / sizeof(cases[0]); c++) {
+        size_t num_rows = 0;
+        char **rows = sorted_rows(markdown, cases[c].sort_by, 1 << 20, 0, &num_rows);
+        CHECK(num_rows == 6);
+        for (size_t i = 0; i < num_rows && i < 6; i++) {
+            CHECK_STR(rows[i], cases[c].expected[i]);
+        }
+        free_rows(rows, num_rows);
+    }
+}
+
+// The external merge sort and the --top heap must order rows exactly like the in memory sort
+static void test_sort_external_and_top(void) {
+    size_t size = 0;
+    char *markdown = NULL;
+    FILE *text = open_memstream(&markdown, &size);
+    fprintf(text, "| n [int] | x [float] | s |\n|---|---|---|\n");
+    unsigned int state = 12345;
+    for (int i = 0; i < 3000; i++) {
+        state = state * 1103515245 + 12345;
+        const unsigned int r = (state >> 8) % 100;
+        if (r < 5) {
+            fprintf(text, "| | nan | s%u |\n", r);
+        } else if (r < 10) {
+            fprintf(text, "| bad%u | | s%u |\n", r, r);
+        } else {
+            fprintf(text, "| %u | %u.5 | s%u |\n", r % 37, r % 11, r);
+        }
+    }
+    fclose(text);
+
+    const char *sort_specs[] = {"n", "n:desc,x", "x:desc,s", "s,n:desc"};
+    for (size_t spec = 0; spec < sizeof(sort_specs) / sizeof(sort_specs[0]); spec++) {
+        size_t num_in_memory = 0;
+        char **in_memory = sorted_rows(markdown, sort_specs[spec], 1 << 30, 0, &num_in_memory);
+        CHECK(num_in_memory == 3000);
+
+        // A one byte budget spills every row as its own run, which takes several merge passes
+        const size_t memory_budgets[] = {4 << 10, 1};
+        for (size_t b = 0; b < sizeof(memory_budgets) / sizeof(memory_budgets[0]); b++) {
+            size_t num_external = 0;
+            char **external = sorted_rows(markdown, sort_specs[spec], memory_budgets[b], 0, &num_external);
+            CHECK(num_external == num_in_memory);
+            for (size_t i = 0; i < num_external && i < num_in_memory; i++) {
+                CHECK_STR(external[i], in_memory[i]);
+            }
+            free_rows(external, num_external);
+        }
+
+        const size_t limits[] = {1, 10, 2999};
+        for (size_t l = 0; l < sizeof(limits) / sizeof(limits[0]); l++) {
+            size_t num_top = 0;
+            char **top = sorted_rows(markdown, sort_specs[spec], 1 << 30, limits[l], &num_top);
+            CHECK(num_top == limits[l]);
+            for (size_t i = 0; i < num_top && i < num_in_memory; i++) {
+                CHECK_STR(top[i], in_memory[i]);
+            }
+            free_rows(top, num_top);
+        }
+
+        free_rows(in_memory, num_in_memory);
+    }
+    free(markdown);
+}
+
+/*******************************************************************************
+ * Writing
+ ******************************************************************************/
+
+// Writers keep their options rather than global state, so differently configured writers can be open at once
+static void test_writer_options(void) {
+    FILE *input = NULL;
+    PsvTable *table = open_table("| a [int] | b |\n|---|---|\n| 1 | x |\n| | y |\n", &input);
+
+    PsvWriterOptions json_options = PSV_WRITER_OPTIONS_DEFAULT;
+    PsvWriterOptions columnar_options = PSV_WRITER_OPTIONS_DEFAULT;
+    columnar_options.columnar = true;
+    PsvWriterOptions cbor_options = PSV_WRITER_OPTIONS_DEFAULT;
+    cbor_options.format = PSV_OUTPUT_CBOR;
+
+    char *outputs[3] = {NULL};
+    size_t sizes[3] = {0};
+    FILE *streams[3];
+    PsvTableWriter writers[3];
+    const PsvWriterOptions *options[3] = {&json_options, &columnar_options, &cbor_options};
+    for (int i = 0; i < 3; i++) {
+        streams[i] = open_memstream(&outputs[i], &sizes[i]);
+        psv_table_writer_begin(&writers[i], options[i], streams[i], table, true, i == 2);
+    }
+
+    PsvDataRow row = NULL;
+    while ((row = psv_parse_table_row(input, table)) != NULL) {
+        for (int i = 0; i < 3; i++) {
+            psv_table_writer_write_row(&writers[i], row);
+        }
+        psv_parse_table_free_row(table, &row);
+    }
+    for (int i = 0; i < 3; i++) {
+        psv_table_writer_end(&writers[i]);
+        fclose(streams[i]);
+    }
+
+    CHECK_STR(outputs[0], "[{\"a\":1,\"b\":\"x\"},{\"a\":null,\"b\":\"y\"}]\n");
+    CHECK_STR(outputs[1], "{\"columns\":{\"a\":[1,null],\"b\":[\"x\",\"y\"]}}\n");
+    // One map per row: {"a": 1, "b": "x"} then {"a": null, "b": "y"}
+    static const uint8_t cbor[] = {0xa2, 0x61, 'a', 0x01, 0x61, 'b', 0x61, 'x', 0xa2, 0x61, 'a', 0xf6, 0x61, 'b', 0x61, 'y'};
+    CHECK(sizes[2] == sizeof(cbor) && memcmp(outputs[2], cbor, sizeof(cbor)) == 0);
+
+    for (int i = 0; i < 3; i++) {
+        free(outputs[i]);
+    }
+    psv_free_table(&table);
+    fclose(input);
+}
+
+// Cells that are not valid as their [int] or [float] column's type stay text in both JSON and CBOR
+static void test_writer_invalid_numbers(void) {
+    FILE *input = NULL;
+    PsvTable *table = open_table("| i [int] | f [float] |\n|---|---|\n| 99999999999999999999 | 1e400 |\n", &input);
+    PsvDataRow row = psv_parse_table_row(input, table);
+
+    PsvWriterOptions options = PSV_WRITER_OPTIONS_DEFAULT;
+    const PsvOutputFormat formats[] = {PSV_OUTPUT_JSON, PSV_OUTPUT_CBOR};
+    char *outputs[2] = {NULL};
+    size_t sizes[2] = {0};
+    for (int i = 0; i < 2; i++) {
+        options.format = formats[i];
+        FILE *output = open_memstream(&outputs[i], &sizes[i]);
+        PsvTableWriter writer;
+        psv_table_writer_begin(&writer, &options, output, table, true, true);
+        psv_table_writer_write_row(&writer, row);
+        psv_table_writer_end(&writer);
+        fclose(output);
+    }
+
+    CHECK_STR(outputs[0], "{\"i\":\"99999999999999999999\",\"f\":\"1e400\"}\n");
+    // {"i": "99999999999999999999", "f": "1e400"}
+    static const uint8_t cbor[] = {0xa2, 0x61, 'i', 0x74, '9', '9', '9', '9', '9', '9', '9', '9', '9', '9', '9', '9', '9', '9', '9', '9', '9', '9', '9', '9', 0x61, 'f', 0x65, '1', 'e', '4', '0', '0'};
+    CHECK(sizes[1] == sizeof(cbor) && memcmp(outputs[1], cbor, sizeof(cbor)) == 0);
+
+    free(outputs[0]);
+    free(outputs[1]);
+    psv_parse_table_free_row(table, &row);
+    psv_free_table(&table);
+    fclose(input);
+}
+
+int main(void) {
+    log_set_quiet(true);
+
+    test_parse_escapes();
+    test_parse_annotations();
+    test_datetime_parse();
+    test_datetime_epoch_seconds();
+    test_group_by();
+    test_group_by_invalid_cells();
+    test_group_by_avg_overflow();
+    test_group_by_spill();
+    test_sort_invalid_keys();
+    test_sort_external_and_top();
+    test_writer_options();
+    test_writer_invalid_numbers();
+
+    if (failures != 0) {
+        printf("%d unit test check(s) failed\n", failures);
+        return 1;
+    }
+    printf("All Unit Test Passed\n");
+    return 0;
 }
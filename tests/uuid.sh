@@ -0,0 +1,80 @@
+#!/bin/bash
+# [uuid] cells compared by their 16 bytes for --distinct-on, --where and --join, and written as CBOR tag 37
+. "$(dirname "$0")/common.sh"
+
+cat > "$TEST_TMPDIR/table.psv" <<'PSV'
+| id [uuid] | v |
+|---|---|
+| 123e4567-e89b-12d3-a456-426614174000 | a |
+| 123E4567-E89B-12D3-A456-426614174000 | b |
+| not-a-uuid | c |
+| NOT-A-UUID | d |
+| 123e4567e89b12d3a456426614174000 | e |
+| 00000000-0000-0000-0000-000000000001 | f |
+PSV
+
+run_psv -c --distinct-on id "$TEST_TMPDIR/table.psv"
+expect_output "--distinct-on ignores the case of UUIDs but not of invalid cells" \
+'{"id":"123e4567-e89b-12d3-a456-426614174000","v":"a"}
+{"id":"not-a-uuid","v":"c"}
+{"id":"NOT-A-UUID","v":"d"}
+{"id":"123e4567e89b12d3a456426614174000","v":"e"}
+{"id":"00000000-0000-0000-0000-000000000001","v":"f"}' "$(echo "$output" | json_rows)"
+
+run_psv --count --where 'id=123E4567-e89b-12d3-A456-426614174000' "$TEST_TMPDIR/table.psv"
+expect_output "--where = matches any spelling of the UUID" '{"id":"table1","num_rows":2}' "$output"
+
+run_psv --count --where 'id!=123e4567-e89b-12d3-a456-426614174000' "$TEST_TMPDIR/table.psv"
+expect_output "--where != counts invalid cells as different" '{"id":"table1","num_rows":4}' "$output"
+
+run_psv --count --where 'id=not-a-uuid' "$TEST_TMPDIR/table.psv"
+expect_output "a --where value that is not a UUID skips the table" "" "$output"
+expect_contains "the --where value error names the column" "not a UUID" "$errors"
+
+run_psv --validate "$TEST_TMPDIR/table.psv"
+expect_status "invalid UUIDs fail --validate" 1
+expect_output "--validate requires the hyphenated form" \
+"table1: row 3, column 1 'id' (byte 120): not a UUID: 'not-a-uuid'
+table1: row 4, column 1 'id' (byte 139): not a UUID: 'NOT-A-UUID'
+table1: row 5, column 1 'id' (byte 158): not a UUID: '123e4567e89b12d3a456426614174000'" "$output"
+
+run_psv --schema "$TEST_TMPDIR/table.psv"
+expect_contains "--schema reports CBOR tag 37" '{"key":"id","type":"uuid","json_type":"text","cbor_tag":37}' "$output"
+
+cat > "$TEST_TMPDIR/small.psv" <<'PSV'
+| id [uuid] |
+|---|
+| 123E4567-E89B-12D3-A456-426614174000 |
+| not-a-uuid |
+PSV
+"$PSV" -c --format cbor "$TEST_TMPDIR/small.psv" > "$TEST_TMPDIR/small.cbor"
+expect_output "CBOR writes UUIDs as tag 37 bytes and invalid cells as text" \
+"9fa1626964d82550123e4567e89b12d3a456426614174000a16269646a6e6f742d612d75756964ff" \
+"$(hex_dump "$TEST_TMPDIR/small.cbor")"
+
+cat > "$TEST_TMPDIR/join.psv" <<'PSV'
+| user [uuid] | name |
+|---|---|
+| 123E4567-E89B-12D3-A456-426614174000 | ann |
+| not-a-uuid | bob |
+
+| order | user |
+|---|---|
+| o1 | 123e4567-e89b-12d3-a456-426614174000 |
+| o2 | NOT-A-UUID |
+| o3 | not-a-uuid |
+PSV
+
+expected_join='{"user":"123E4567-E89B-12D3-A456-426614174000","name":"ann","order":"o1","table2_user":"123e4567-e89b-12d3-a456-426614174000"}
+{"user":"not-a-uuid","name":"bob","order":"o3","table2_user":"not-a-uuid"}'
+for build in left right; do
+    run_psv -c --join 'table1:user=table2:user' --join-build "$build" "$TEST_TMPDIR/join.psv"
+    expect_output "--join matches UUIDs of a plain text key column (building $build)" "$expected_join" "$output"
+done
+
+run_psv -c --join 'table2:user=table1:user' "$TEST_TMPDIR/join.psv"
+expect_output "--join with the [uuid] column on the right" \
+'{"order":"o1","user":"123e4567-e89b-12d3-a456-426614174000","table1_user":"123E4567-E89B-12D3-A456-426614174000","name":"ann"}
+{"order":"o3","user":"not-a-uuid","table1_user":"not-a-uuid","name":"bob"}' "$output"
+
+finish
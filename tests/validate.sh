@@ -0,0 +1,54 @@
+#!/bin/bash
+# --validate reports cells that do not match their column's annotations, with byte offsets, and sets the exit status
+. "$(dirname "$0")/common.sh"
+
+cat > "$TEST_TMPDIR/valid.md" <<'MD'
+Some text before the table.
+
+{#ok}
+| id [str] [uuid] | n [int] | x [float] | b [bool] | when [datetime] | raw [hex][cbor] |
+|---|---|---|---|---|---|
+| 0b32a75e-e190-4a71-b0e1-45e0d826584f | -12 | 1.5e3 | yes | 2024-02-29T10:00:00Z | 0x820102 |
+| | | | | | |
+MD
+
+run_psv --validate "$TEST_TMPDIR/valid.md"
+expect_status "a valid table exits 0" 0
+expect_output "a valid table reports nothing" "" "$output"
+
+cat > "$TEST_TMPDIR/invalid.md" <<'MD'
+{#checks}
+| id [str] [uuid] | n [int] | x [float] | when [datetime] | raw [hex][cbor] | name |
+|---|---|---|---|---|---|
+| nope | 99999999999999999999 | 1.5 | 2023-02-29 | 0x1f | anything |
+| 0b32a75e-e190-4a71-b0e1-45e0d826584f | 7 | 1.5x | 2024-01-01 | 0x82010203 | goes |
+MD
+
+run_psv --validate "$TEST_TMPDIR/invalid.md"
+expect_status "invalid cells exit 1" 1
+expect_output "every invalid cell is reported" \
+"checks: row 1, column 1 'id' (byte 123): not a UUID: 'nope'
+checks: row 1, column 2 'n' (byte 130): integer out of 64-bit range: '99999999999999999999'
+checks: row 1, column 4 'when' (byte 159): not an ISO 8601 date/time: '2023-02-29'
+checks: row 1, column 5 'raw' (byte 172): indefinite length on a CBOR integer or tag: '0x1f'
+checks: row 2, column 3 'x' (byte 235): not a number: '1.5x'
+checks: row 2, column 5 'raw' (byte 255): trailing bytes after CBOR item: '0x82010203'" \
+    "$output"
+
+# Each reported byte offset must point at the start of the reported cell
+while IFS= read -r line; do
+    offset=$(echo "$line" | sed -n 's/.*(byte \([0-9]*\)).*/\1/p')
+    cell=$(echo "$line" | sed -n "s/.*: '\(.*\)'$/\1/p")
+    expect_output "byte offset $offset points at '$cell'" "$cell" "$(tail -c +$((offset + 1)) "$TEST_TMPDIR/invalid.md" | head -c ${#cell})"
+done <<< "$output"
+
+run_psv --validate -i ok "$TEST_TMPDIR/invalid.md" "$TEST_TMPDIR/valid.md"
+expect_status "--id only validates the selected table" 0
+
+# Piped input has no byte offsets
+output=$(cat "$TEST_TMPDIR/invalid.md" | "$PSV" --validate)
+status=$?
+expect_status "piped invalid input exits 1" 1
+expect_contains "piped input reports rows without byte offsets" "checks: row 1, column 1 'id': not a UUID: 'nope'" "$output"
+
+finish
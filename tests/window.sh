@@ -0,0 +1,65 @@
+#!/bin/bash
+# --window tumbling and sliding time windows over a [datetime] column
+. "$(dirname "$0")/common.sh"
+
+# The third row is 00:01:30 UTC, the invalid row and the late 00:00:20 row are dropped
+cat > "$TEST_TMPDIR/metrics.psv" <<'PSV'
+| t [datetime] | host | cpu [int] |
+|---|---|---|
+| 2024-03-01T00:00:10Z | a | 10 |
+| 2024-03-01T00:00:50Z | b | 20 |
+| 2024-03-01T10:01:30+10:00 | a | 30 |
+| 2024-03-01T00:02:00Z | a | 40 |
+| nope | a | 99 |
+| 2024-03-01T00:00:20Z | a | 50 |
+| 2024-03-01T00:04:59.999Z | b | 60 |
+PSV
+
+run_psv -c --window 1m --agg 'count,sum(cpu)' "$TEST_TMPDIR/metrics.psv"
+expect_status "--window exit status" 0
+expect_output "tumbling windows, skipping those without rows" \
+'{"window_start":"2024-03-01T00:00:00Z","window_end":"2024-03-01T00:01:00Z","count":2,"sum_cpu":30}
+{"window_start":"2024-03-01T00:01:00Z","window_end":"2024-03-01T00:02:00Z","count":1,"sum_cpu":30}
+{"window_start":"2024-03-01T00:02:00Z","window_end":"2024-03-01T00:03:00Z","count":1,"sum_cpu":40}
+{"window_start":"2024-03-01T00:04:00Z","window_end":"2024-03-01T00:05:00Z","count":1,"sum_cpu":60}' \
+    "$(echo "$output" | json_rows)"
+expect_contains "late rows are reported" "dropped 1 rows in table 'table1' that arrived after their window was closed" "$errors"
+expect_contains "rows without a date/time are reported" "dropped 1 rows in table 'table1' without a valid date/time" "$errors"
+
+run_psv -c --window 2m --window-slide 1m --group-by host --agg 'count,max(cpu)' "$TEST_TMPDIR/metrics.psv"
+expect_output "sliding windows aligned to the epoch, grouped by host" \
+'{"window_start":"2024-02-29T23:59:00Z","window_end":"2024-03-01T00:01:00Z","host":"a","count":1,"max_cpu":10}
+{"window_start":"2024-02-29T23:59:00Z","window_end":"2024-03-01T00:01:00Z","host":"b","count":1,"max_cpu":20}
+{"window_start":"2024-03-01T00:00:00Z","window_end":"2024-03-01T00:02:00Z","host":"a","count":2,"max_cpu":30}
+{"window_start":"2024-03-01T00:00:00Z","window_end":"2024-03-01T00:02:00Z","host":"b","count":1,"max_cpu":20}
+{"window_start":"2024-03-01T00:01:00Z","window_end":"2024-03-01T00:03:00Z","host":"a","count":2,"max_cpu":40}
+{"window_start":"2024-03-01T00:02:00Z","window_end":"2024-03-01T00:04:00Z","host":"a","count":1,"max_cpu":40}
+{"window_start":"2024-03-01T00:03:00Z","window_end":"2024-03-01T00:05:00Z","host":"b","count":1,"max_cpu":60}
+{"window_start":"2024-03-01T00:04:00Z","window_end":"2024-03-01T00:06:00Z","host":"b","count":1,"max_cpu":60}' \
+    "$(echo "$output" | json_rows)"
+
+cat > "$TEST_TMPDIR/two_times.psv" <<'PSV'
+| created [datetime] | seen [datetime] | n [int] |
+|---|---|---|
+| 2024-03-01T00:00:00Z | 2024-03-01T05:00:00Z | 1 |
+| 2024-03-01T00:00:01Z | 2024-03-01T06:00:00Z | 2 |
+PSV
+
+run_psv -c --window 1h --agg 'sum(n)' "$TEST_TMPDIR/two_times.psv"
+expect_output "the first [datetime] column is used by default" \
+    '[{"window_start":"2024-03-01T00:00:00Z","window_end":"2024-03-01T01:00:00Z","sum_n":3}]' "$output"
+
+run_psv -c --window 1h --window-on seen --agg 'sum(n)' "$TEST_TMPDIR/two_times.psv"
+expect_output "--window-on picks the column" \
+    '[{"window_start":"2024-03-01T05:00:00Z","window_end":"2024-03-01T06:00:00Z","sum_n":1},{"window_start":"2024-03-01T06:00:00Z","window_end":"2024-03-01T07:00:00Z","sum_n":2}]' "$output"
+
+for size in 0s 5x; do
+    run_psv -c --window $size --agg count "$TEST_TMPDIR/metrics.psv"
+    expect_output "--window $size outputs nothing" "" "$output"
+    expect_contains "--window $size is reported" "invalid window size '$size'" "$errors"
+done
+
+run_psv -c --window-slide 1m --agg count "$TEST_TMPDIR/metrics.psv"
+expect_status "--window-slide needs --window" 1
+
+finish